@@ -0,0 +1,328 @@
+// This is the implementation of the concurrent generic hash table with
+//   seqlock-validated readers. Every bucket is a singly-linked list.
+//
+//   Node memory is type-stable: nodes are carved out of slabs that are only
+//   freed by cht_destroy, and a removed node is recycled through a free list
+//   of the table. A reader that still holds a pointer to a recycled node
+//   therefore never touches freed memory; it may read a stale list, which
+//   the version check of the bucket detects.
+//   Keys are different: they belong to the client and are freed by
+//   key_destroy, so removed keys are parked on a retire list until
+//   cht_quiesce.
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "chashtable.h"
+#include <assert.h>
+#include <stdio.h>
+
+// number of locks shared by the buckets (must be a power of 2)
+#define CHT_LOCK_STRIPES 64
+// number of nodes allocated at once
+#define CHT_SLAB_NODES 64
+// a reader re-validates its bucket after this many steps, so that a
+//   traversal that wandered into recycled nodes always terminates
+#define CHT_MAX_STEPS 64
+
+struct chtnode {
+  void *_Atomic key;                                // NULL while on the free list
+  struct chtnode *_Atomic next;
+};
+
+struct chtbucket {
+  atomic_uint version;                              // odd while a writer is active
+  struct chtnode *_Atomic head;
+};
+
+// a block of nodes; slabs are linked so that cht_destroy can free them
+struct chtslab {
+  struct chtslab *next;
+  struct chtnode nodes[CHT_SLAB_NODES];
+};
+
+// a key removed from the table that may still be read by a reader
+struct chtretired {
+  void *key;
+  struct chtretired *next;
+};
+
+struct chashtable {
+  struct chtbucket *table;
+  int hash_len;
+  int ht_len;                                       // number of buckets
+  pthread_mutex_t locks[CHT_LOCK_STRIPES];          // bucket i uses lock i % CHT_LOCK_STRIPES
+  pthread_mutex_t pool_lock;                        // protects slabs, free_nodes and retired
+  struct chtslab *slabs;
+  struct chtnode *free_nodes;                       // linked through next
+  struct chtretired *retired;
+  int (*hash_func)(const void *, int);
+  void *(*key_clone)(const void *);
+  int (*key_compare)(const void *, const void *);
+  void (*key_destroy)(void *);
+  void (*key_print)(const void *);
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static struct chtnode *node_alloc(struct chashtable *ht);
+static void node_recycle(struct chashtable *ht, struct chtnode *node);
+static void write_begin(struct chtbucket *b);
+static void write_end(struct chtbucket *b);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct chashtable *cht_create(void *(*key_clone)(const void *),
+                              int (*hash_func)(const void *, int),
+                              int hash_length,
+                              int (*key_compare)(const void *, const void *),
+                              void (*key_destroy)(void *),
+                              void (*key_print)(const void *)) {
+  assert(key_clone);
+  assert(hash_func);
+  assert(hash_length > 0);
+  assert(key_compare);
+  assert(key_destroy);
+  assert(key_print);
+
+  struct chashtable *ht = malloc(sizeof(struct chashtable));
+  ht->hash_len = hash_length;
+  ht->ht_len = 1 << hash_length;
+
+  ht->hash_func = hash_func;
+  ht->key_clone = key_clone;
+  ht->key_compare = key_compare;
+  ht->key_destroy = key_destroy;
+  ht->key_print = key_print;
+
+  ht->table = malloc(sizeof(struct chtbucket) * ht->ht_len);
+  for (int i = 0; i < ht->ht_len; i++) {
+    atomic_init(&ht->table[i].version, 0);
+    atomic_init(&ht->table[i].head, NULL);
+  }
+  for (int i = 0; i < CHT_LOCK_STRIPES; i++) {
+    pthread_mutex_init(&ht->locks[i], NULL);
+  }
+  pthread_mutex_init(&ht->pool_lock, NULL);
+  ht->slabs = NULL;
+  ht->free_nodes = NULL;
+  ht->retired = NULL;
+  return ht;
+}
+
+void cht_destroy(struct chashtable *ht) {
+  assert(ht);
+  for (int i = 0; i < ht->ht_len; i++) {
+    struct chtnode *node = atomic_load_explicit(&ht->table[i].head, memory_order_relaxed);
+    while (node) {
+      ht->key_destroy(atomic_load_explicit(&node->key, memory_order_relaxed));
+      node = atomic_load_explicit(&node->next, memory_order_relaxed);
+    }
+  }
+  cht_quiesce(ht);
+  while (ht->slabs) {
+    struct chtslab *next = ht->slabs->next;
+    free(ht->slabs);
+    ht->slabs = next;
+  }
+  for (int i = 0; i < CHT_LOCK_STRIPES; i++) {
+    pthread_mutex_destroy(&ht->locks[i]);
+  }
+  pthread_mutex_destroy(&ht->pool_lock);
+  free(ht->table);
+  free(ht);
+}
+
+int cht_insert(struct chashtable *ht, const void *key) {
+  assert(ht);
+  assert(key);
+  const int index = ht->hash_func(key, ht->hash_len);
+  struct chtbucket *b = &ht->table[index];
+  pthread_mutex_t *lock = &ht->locks[index & (CHT_LOCK_STRIPES - 1)];
+
+  pthread_mutex_lock(lock);
+  struct chtnode *head = atomic_load_explicit(&b->head, memory_order_relaxed);
+  for (struct chtnode *node = head; node;
+       node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+    if (ht->key_compare(key, atomic_load_explicit(&node->key, memory_order_relaxed)) == 0) {
+      pthread_mutex_unlock(lock);
+      return HT_ALREADY_STORED;
+    }
+  }
+
+  // prepare the node before the bucket is marked as being written
+  struct chtnode *node = node_alloc(ht);
+  atomic_store_explicit(&node->next, head, memory_order_release);
+  atomic_store_explicit(&node->key, ht->key_clone(key), memory_order_release);
+
+  write_begin(b);
+  atomic_store_explicit(&b->head, node, memory_order_release);
+  write_end(b);
+  pthread_mutex_unlock(lock);
+  return HT_SUCCESS;
+}
+
+int cht_remove(struct chashtable *ht, const void *key) {
+  assert(ht);
+  assert(key);
+  const int index = ht->hash_func(key, ht->hash_len);
+  struct chtbucket *b = &ht->table[index];
+  pthread_mutex_t *lock = &ht->locks[index & (CHT_LOCK_STRIPES - 1)];
+
+  pthread_mutex_lock(lock);
+  struct chtnode *_Atomic *link = &b->head;
+  struct chtnode *node = atomic_load_explicit(link, memory_order_relaxed);
+  while (node &&
+         ht->key_compare(key, atomic_load_explicit(&node->key, memory_order_relaxed)) != 0) {
+    link = &node->next;
+    node = atomic_load_explicit(link, memory_order_relaxed);
+  }
+  if (node == NULL) {
+    pthread_mutex_unlock(lock);
+    return HT_NOT_STORED;
+  }
+
+  write_begin(b);
+  atomic_store_explicit(link, atomic_load_explicit(&node->next, memory_order_relaxed),
+                        memory_order_release);
+  write_end(b);
+  node_recycle(ht, node);
+  pthread_mutex_unlock(lock);
+  return HT_SUCCESS;
+}
+
+bool cht_contains(const struct chashtable *ht, const void *key) {
+  assert(ht);
+  assert(key);
+  const int index = ht->hash_func(key, ht->hash_len);
+  const struct chtbucket *b = &ht->table[index];
+
+  for (;;) {
+    unsigned int v1 = atomic_load_explicit(&b->version, memory_order_acquire);
+    if (v1 & 1) {
+      continue;                                     // a writer is active
+    }
+    bool found = false;
+    bool stale = false;
+    int steps = 0;
+    struct chtnode *node = atomic_load_explicit(&b->head, memory_order_acquire);
+    while (node) {
+      void *node_key = atomic_load_explicit(&node->key, memory_order_acquire);
+      if (node_key && ht->key_compare(key, node_key) == 0) {
+        found = true;
+        break;
+      }
+      node = atomic_load_explicit(&node->next, memory_order_acquire);
+      if (++steps % CHT_MAX_STEPS == 0 &&
+          atomic_load_explicit(&b->version, memory_order_acquire) != v1) {
+        stale = true;
+        break;
+      }
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (!stale && atomic_load_explicit(&b->version, memory_order_relaxed) == v1) {
+      return found;
+    }
+  }
+}
+
+void cht_quiesce(struct chashtable *ht) {
+  assert(ht);
+  pthread_mutex_lock(&ht->pool_lock);
+  struct chtretired *r = ht->retired;
+  ht->retired = NULL;
+  pthread_mutex_unlock(&ht->pool_lock);
+
+  while (r) {
+    struct chtretired *next = r->next;
+    ht->key_destroy(r->key);
+    free(r);
+    r = next;
+  }
+}
+
+void cht_print(const struct chashtable *ht) {
+  assert(ht);
+  for (int i = 0; i < ht->ht_len; i++) {
+    printf("%d: [", i);
+    struct chtnode *node = atomic_load_explicit(&ht->table[i].head, memory_order_acquire);
+    for (struct chtnode *n = node; n; n = atomic_load_explicit(&n->next, memory_order_acquire)) {
+      if (n != node) {
+        printf(",");
+      }
+      ht->key_print(atomic_load_explicit(&n->key, memory_order_acquire));
+    }
+    printf("]\n");
+  }
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// node_alloc(ht) is a helper function that returns an unused node of ht,
+//  taken from the free list or from a new slab
+// requires: all pointers are valid
+// effects: may allocate memory (freed by cht_destroy)
+//          modifies ht
+// time: O(1) amortized
+static struct chtnode *node_alloc(struct chashtable *ht) {
+  assert(ht);
+  pthread_mutex_lock(&ht->pool_lock);
+  if (ht->free_nodes == NULL) {
+    struct chtslab *slab = malloc(sizeof(struct chtslab));
+    slab->next = ht->slabs;
+    ht->slabs = slab;
+    for (int i = 0; i < CHT_SLAB_NODES; i++) {
+      atomic_init(&slab->nodes[i].key, NULL);
+      atomic_init(&slab->nodes[i].next, ht->free_nodes);
+      ht->free_nodes = &slab->nodes[i];
+    }
+  }
+  struct chtnode *node = ht->free_nodes;
+  ht->free_nodes = atomic_load_explicit(&node->next, memory_order_relaxed);
+  pthread_mutex_unlock(&ht->pool_lock);
+  return node;
+}
+
+// node_recycle(ht, node) is a helper function that retires the key of the
+//  unlinked node and puts node on the free list of ht. A reader standing on
+//  node either continues into the bucket or into the free list (whose keys
+//  are NULL); both end in NULL and fail the version check.
+// requires: all pointers are valid
+// effects: allocates memory (freed by cht_quiesce)
+//          modifies ht
+// time: O(1)
+static void node_recycle(struct chashtable *ht, struct chtnode *node) {
+  assert(ht);
+  assert(node);
+  struct chtretired *r = malloc(sizeof(struct chtretired));
+  r->key = atomic_load_explicit(&node->key, memory_order_relaxed);
+  atomic_store_explicit(&node->key, NULL, memory_order_release);
+
+  pthread_mutex_lock(&ht->pool_lock);
+  r->next = ht->retired;
+  ht->retired = r;
+  atomic_store_explicit(&node->next, ht->free_nodes, memory_order_release);
+  ht->free_nodes = node;
+  pthread_mutex_unlock(&ht->pool_lock);
+}
+
+// write_begin(b) is a helper function that marks the bucket b as being
+//  modified (odd version)
+// requires: the caller holds the lock of b
+// effects: modifies b
+// time: O(1)
+static void write_begin(struct chtbucket *b) {
+  atomic_fetch_add_explicit(&b->version, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+// write_end(b) is a helper function that marks the modification of the
+//  bucket b as finished (even version)
+// requires: the caller holds the lock of b and has called write_begin(b)
+// effects: modifies b
+// time: O(1)
+static void write_end(struct chtbucket *b) {
+  atomic_fetch_add_explicit(&b->version, 1, memory_order_release);
+}
@@ -0,0 +1,70 @@
+// This is the interface of a concurrent (locked) generic hash table with
+//   optimistic readers. Writers serialize on a lock per bucket, while
+//   cht_contains never writes to shared memory: it traverses a bucket
+//   without a lock and validates the traversal with the version counter
+//   (seqlock) of the bucket, retrying only if a writer changed the bucket
+//   in the meantime.
+//   The return codes are shared with hashtable.h.
+
+#include <stdbool.h>
+#include "hashtable.h"
+
+// a generic concurrent hash table
+struct chashtable;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// cht_create(key_clone, key_hash, hash_length, key_compare, key_destroy,
+//   key_print) creates a new empty concurrent hash table. The parameters
+//   have the same meaning as for ht_create (see hashtable.h).
+// effects: allocates heap memory; client must call cht_destroy
+// requires: hash_length must be positive
+// time: O(n), where n is the length of the hash table
+struct chashtable *cht_create(void *(*key_clone)(const void *),
+                              int (*hash_func)(const void *, int),
+                              int hash_length,
+                              int (*key_compare)(const void *, const void *),
+                              void (*key_destroy)(void *),
+                              void (*key_print)(const void *));
+
+// cht_destroy(ht) frees all resources allocated by the hash table ht.
+// effects: invalidates ht
+// requires: no other thread is using ht
+// time: O(n + m * ds), where n is the length of ht and m is the number of
+//   keys in ht (including retired keys)
+void cht_destroy(struct chashtable *ht);
+
+// cht_insert(ht, key) inserts key into ht. The function returns
+//   * HT_SUCCESS if key has been inserted into ht or
+//   * HT_ALREADY_STORED if key is already stored in ht.
+// effects: modifies ht
+// time: O(cl + m * co + hf), where m is the number of keys in the bucket
+int cht_insert(struct chashtable *ht, const void *key);
+
+// cht_remove(ht, key) removes key from ht. The function returns
+//   * HT_SUCCESS if key has been removed from ht, or
+//   * HT_NOT_STORED if key was not stored in ht.
+//   The stored copy of key is retired, not destroyed: concurrent readers
+//   may still compare against it until the next cht_quiesce.
+// effects: modifies ht
+// time: O(hf + m * co), where m is the number of keys in the bucket
+int cht_remove(struct chashtable *ht, const void *key);
+
+// cht_contains(ht, key) returns true if key is stored in ht, and false
+//   otherwise. It takes no lock and does not write to shared memory.
+// time: O(hf + m * co) if no writer interferes, where m is the number of
+//   keys in the bucket
+bool cht_contains(const struct chashtable *ht, const void *key);
+
+// cht_quiesce(ht) destroys all keys retired by cht_remove since the last
+//   call.
+// effects: modifies ht
+// requires: no cht_contains call on ht is in progress
+// time: O(r * ds), where r is the number of retired keys
+void cht_quiesce(struct chashtable *ht);
+
+// cht_print(ht) prints the content of ht to the console.
+// effects: creates output
+// requires: no other thread is modifying ht
+// time: O(n + m * cp), where n: length of ht, m: number of keys in ht
+void cht_print(const struct chashtable *ht);
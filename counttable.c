@@ -0,0 +1,283 @@
+// This is the implementation of the concurrent generic counting table.
+//   Every bucket is a singly-linked list of nodes. New nodes are only
+//   prepended (under the lock of the bucket) and published with a release
+//   store, and nodes are never unlinked before ct_destroy, so readers can
+//   walk a list without taking any lock.
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "counttable.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// number of locks shared by the buckets (must be a power of 2)
+#define CT_LOCK_STRIPES 64
+
+struct ctnode {
+  void *key;
+  atomic_long count;
+  struct ctnode *next;
+};
+
+struct counttable {
+  struct ctnode *_Atomic *table;
+  int hash_len;
+  int ct_len;                                       // number of buckets
+  atomic_int count;                                 // number of keys
+  pthread_mutex_t locks[CT_LOCK_STRIPES];           // bucket i uses lock i % CT_LOCK_STRIPES
+  int (*hash_func)(const void *, int);
+  void *(*key_clone)(const void *);
+  int (*key_compare)(const void *, const void *);
+  void (*key_destroy)(void *);
+  void (*key_print)(const void *);
+};
+
+// a pending delta of a buffer
+struct ct_pending {
+  void *key;                                        // NULL if the entry is empty
+  long delta;
+};
+
+struct ct_buffer {
+  struct counttable *ct;
+  struct ct_pending *entries;
+  int len;                                          // number of entries (power of 2)
+  int hash_len;                                     // log2(len), passed to hash_func
+  int used;                                         // number of non-empty entries
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static struct ctnode *bucket_find(struct ctnode *node, const void *key,
+                                  int (*key_compare)(const void *, const void *));
+static int round_up_pwr(int n);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct counttable *ct_create(void *(*key_clone)(const void *),
+                             int (*hash_func)(const void *, int),
+                             int hash_length,
+                             int (*key_compare)(const void *, const void *),
+                             void (*key_destroy)(void *),
+                             void (*key_print)(const void *)) {
+  assert(key_clone);
+  assert(hash_func);
+  assert(hash_length > 0);
+  assert(key_compare);
+  assert(key_destroy);
+  assert(key_print);
+
+  struct counttable *ct = malloc(sizeof(struct counttable));
+  ct->hash_len = hash_length;
+  ct->ct_len = 1 << hash_length;
+  atomic_init(&ct->count, 0);
+
+  ct->hash_func = hash_func;
+  ct->key_clone = key_clone;
+  ct->key_compare = key_compare;
+  ct->key_destroy = key_destroy;
+  ct->key_print = key_print;
+
+  ct->table = malloc(sizeof(struct ctnode *) * ct->ct_len);
+  for (int i = 0; i < ct->ct_len; i++) {
+    atomic_init(&ct->table[i], NULL);
+  }
+  for (int i = 0; i < CT_LOCK_STRIPES; i++) {
+    pthread_mutex_init(&ct->locks[i], NULL);
+  }
+  return ct;
+}
+
+void ct_destroy(struct counttable *ct) {
+  assert(ct);
+  for (int i = 0; i < ct->ct_len; i++) {
+    struct ctnode *node = atomic_load_explicit(&ct->table[i], memory_order_relaxed);
+    while (node) {
+      struct ctnode *next = node->next;
+      ct->key_destroy(node->key);
+      free(node);
+      node = next;
+    }
+  }
+  for (int i = 0; i < CT_LOCK_STRIPES; i++) {
+    pthread_mutex_destroy(&ct->locks[i]);
+  }
+  free(ct->table);
+  free(ct);
+}
+
+long ct_add(struct counttable *ct, const void *key, long delta) {
+  assert(ct);
+  assert(key);
+  const int index = ct->hash_func(key, ct->hash_len);
+
+  // fast path: the key is already stored, no lock is needed
+  struct ctnode *head = atomic_load_explicit(&ct->table[index], memory_order_acquire);
+  struct ctnode *node = bucket_find(head, key, ct->key_compare);
+  if (node) {
+    return atomic_fetch_add_explicit(&node->count, delta, memory_order_relaxed) + delta;
+  }
+
+  // slow path: insert the key under the bucket lock, unless another thread
+  //   has inserted it since we looked
+  pthread_mutex_t *lock = &ct->locks[index & (CT_LOCK_STRIPES - 1)];
+  pthread_mutex_lock(lock);
+  struct ctnode *cur_head = atomic_load_explicit(&ct->table[index], memory_order_acquire);
+  if (cur_head != head) {
+    node = bucket_find(cur_head, key, ct->key_compare);
+  }
+  long result = delta;
+  if (node) {
+    result = atomic_fetch_add_explicit(&node->count, delta, memory_order_relaxed) + delta;
+  } else {
+    node = malloc(sizeof(struct ctnode));
+    node->key = ct->key_clone(key);
+    atomic_init(&node->count, delta);
+    node->next = cur_head;
+    atomic_store_explicit(&ct->table[index], node, memory_order_release);
+    atomic_fetch_add_explicit(&ct->count, 1, memory_order_relaxed);
+  }
+  pthread_mutex_unlock(lock);
+  return result;
+}
+
+long ct_get(const struct counttable *ct, const void *key) {
+  assert(ct);
+  assert(key);
+  const int index = ct->hash_func(key, ct->hash_len);
+  struct ctnode *head = atomic_load_explicit(&ct->table[index], memory_order_acquire);
+  struct ctnode *node = bucket_find(head, key, ct->key_compare);
+  if (node == NULL) {
+    return 0;
+  }
+  return atomic_load_explicit(&node->count, memory_order_relaxed);
+}
+
+int ct_count(const struct counttable *ct) {
+  assert(ct);
+  return atomic_load_explicit(&ct->count, memory_order_relaxed);
+}
+
+void ct_print(const struct counttable *ct) {
+  assert(ct);
+  for (int i = 0; i < ct->ct_len; i++) {
+    printf("%d: [", i);
+    bool first = true;
+    struct ctnode *node = atomic_load_explicit(&ct->table[i], memory_order_acquire);
+    for (; node; node = node->next) {
+      if (first) {
+        first = false;
+      } else {
+        printf(",");
+      }
+      ct->key_print(node->key);
+      printf("-%ld", atomic_load_explicit(&node->count, memory_order_relaxed));
+    }
+    printf("]\n");
+  }
+}
+
+struct ct_buffer *ct_buffer_create(struct counttable *ct, int capacity) {
+  assert(ct);
+  assert(capacity > 0);
+
+  struct ct_buffer *buf = malloc(sizeof(struct ct_buffer));
+  buf->ct = ct;
+  // keep the buffer at most 3/4 full so that probe sequences stay short
+  buf->len = round_up_pwr(capacity + capacity / 3 + 1);
+  // hash for the buffer's own length: with the table's hash length, a
+  //  buffer larger than the table would only use its first 2^hash_len
+  //  entries as home slots
+  buf->hash_len = 0;
+  while ((1 << buf->hash_len) < buf->len) {
+    buf->hash_len++;
+  }
+  buf->used = 0;
+  buf->entries = malloc(sizeof(struct ct_pending) * buf->len);
+  for (int i = 0; i < buf->len; i++) {
+    buf->entries[i].key = NULL;
+    buf->entries[i].delta = 0;
+  }
+  return buf;
+}
+
+void ct_buffer_add(struct ct_buffer *buf, const void *key, long delta) {
+  assert(buf);
+  assert(key);
+  struct counttable *ct = buf->ct;
+  const int mask = buf->len - 1;
+  int i = ct->hash_func(key, buf->hash_len) & mask;
+
+  while (buf->entries[i].key) {
+    if (ct->key_compare(key, buf->entries[i].key) == 0) {
+      buf->entries[i].delta += delta;
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  buf->entries[i].key = ct->key_clone(key);
+  buf->entries[i].delta = delta;
+  buf->used++;
+  if (buf->used * 4 >= buf->len * 3) {
+    ct_buffer_flush(buf);
+  }
+}
+
+void ct_buffer_flush(struct ct_buffer *buf) {
+  assert(buf);
+  struct counttable *ct = buf->ct;
+  for (int i = 0; i < buf->len && buf->used > 0; i++) {
+    struct ct_pending *entry = &buf->entries[i];
+    if (entry->key) {
+      if (entry->delta != 0) {
+        ct_add(ct, entry->key, entry->delta);
+      }
+      ct->key_destroy(entry->key);
+      entry->key = NULL;
+      entry->delta = 0;
+      buf->used--;
+    }
+  }
+}
+
+void ct_buffer_destroy(struct ct_buffer *buf) {
+  assert(buf);
+  ct_buffer_flush(buf);
+  free(buf->entries);
+  free(buf);
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// bucket_find(node, key, key_compare) is a helper function that returns the
+//  node of the list starting at node that stores key, or NULL if there is
+//  no such node
+// requires: key and key_compare are valid pointers
+// time: O(m * co) where m is the length of the list and co is the time
+//  complexity of key_compare
+static struct ctnode *bucket_find(struct ctnode *node, const void *key,
+                                  int (*key_compare)(const void *, const void *)) {
+  assert(key);
+  assert(key_compare);
+  while (node && key_compare(key, node->key) != 0) {
+    node = node->next;
+  }
+  return node;
+}
+
+// round_up_pwr(n) is a helper function that returns the smallest power of
+//  2 that is at least n
+// requires: n > 0
+// time: O(log n)
+static int round_up_pwr(int n) {
+  assert(n > 0);
+  int val = 1;
+  while (val < n) {
+    val *= 2;
+  }
+  return val;
+}
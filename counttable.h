@@ -0,0 +1,87 @@
+// This is the interface of a concurrent generic counting table. Every key
+//   stored in the table has a counter. Counters of keys that are already
+//   stored are updated with an atomic fetch-and-add; only the first insert
+//   of a key takes the lock of its bucket.
+//   Threads that update the same (hot) keys many times should aggregate
+//   their updates in a local ct_buffer, which flushes its deltas to the
+//   table in batches.
+
+// a generic concurrent counting table
+struct counttable;
+
+// a thread-local buffer of pending counter updates
+struct ct_buffer;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// ct_create(key_clone, key_hash, hash_length, key_compare, key_destroy,
+//   key_print) creates a new empty counting table. The parameters have the
+//   same meaning as for ht_create (see hashtable.h).
+// effects: allocates heap memory; client must call ct_destroy
+// requires: hash_length must be positive
+// time: O(n), where n is the length of the table
+struct counttable *ct_create(void *(*key_clone)(const void *),
+                             int (*hash_func)(const void *, int),
+                             int hash_length,
+                             int (*key_compare)(const void *, const void *),
+                             void (*key_destroy)(void *),
+                             void (*key_print)(const void *));
+
+// ct_destroy(ct) frees all resources allocated by the counting table ct.
+// effects: invalidates ct
+// requires: no other thread is using ct and all buffers of ct have been
+//           destroyed
+// time: O(n + m * ds), where n is the length of ct and m is the number of
+//   keys in ct
+void ct_destroy(struct counttable *ct);
+
+// ct_add(ct, key, delta) adds delta to the counter of key. If key is not
+//   stored in ct yet, it is inserted with the counter delta. The function
+//   returns the new value of the counter.
+//   ct_add may be called concurrently from several threads.
+// effects: modifies ct
+// time: O(m * co + hf) if key is stored (lock-free), plus O(cl) otherwise,
+//   where m is the number of keys in the bucket of key
+long ct_add(struct counttable *ct, const void *key, long delta);
+
+// ct_get(ct, key) returns the counter of key, or 0 if key is not stored
+//   in ct. ct_get never takes a lock.
+// time: O(m * co + hf), where m is the number of keys in the bucket of key
+long ct_get(const struct counttable *ct, const void *key);
+
+// ct_count(ct) returns the number of keys stored in ct.
+// time: O(1)
+int ct_count(const struct counttable *ct);
+
+// ct_print(ct) prints the content of ct to the console, as key-counter
+//   pairs.
+// effects: creates output
+// requires: no other thread is modifying ct
+// time: O(n + m * cp), where n: length of ct, m: number of keys in ct
+void ct_print(const struct counttable *ct);
+
+// ct_buffer_create(ct, capacity) creates an empty buffer that aggregates
+//   updates of up to capacity distinct keys before flushing them to ct.
+//   A buffer must only be used by one thread.
+// effects: allocates heap memory; client must call ct_buffer_destroy
+// requires: capacity must be positive
+// time: O(capacity)
+struct ct_buffer *ct_buffer_create(struct counttable *ct, int capacity);
+
+// ct_buffer_add(buf, key, delta) records delta for key in buf. Deltas of
+//   the same key are summed up locally; the buffer is flushed to its table
+//   when it is 3/4 full.
+// effects: modifies buf; may modify the table of buf
+// time: O(hf + co) expected, plus O(cl) if key is new to buf
+void ct_buffer_add(struct ct_buffer *buf, const void *key, long delta);
+
+// ct_buffer_flush(buf) applies all pending deltas of buf to its table and
+//   empties buf.
+// effects: modifies buf and the table of buf
+// time: O(b * (hf + m * co + ds)), where b is the number of keys in buf
+void ct_buffer_flush(struct ct_buffer *buf);
+
+// ct_buffer_destroy(buf) flushes buf and frees all its resources.
+// effects: invalidates buf; modifies the table of buf
+// time: O(capacity + b * (hf + m * co + ds))
+void ct_buffer_destroy(struct ct_buffer *buf);
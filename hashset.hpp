@@ -0,0 +1,631 @@
+// This is the interface of the policy-based C++ front end (C++17) of the
+//   hash tables of this module. A set is declared as
+//     ht::HashSet<K, Hash, Eq, Storage, Lock, Stats, Alloc>
+//   where every policy after Eq has a default, e.g.
+//     ht::HashSet<std::string, std::hash<std::string>, std::equal_to<>,
+//                 ht::RobinHood, ht::Striped<16>, ht::StatsOn>
+//   so combinations can be benchmarked by changing only the type. Policies
+//   that are switched off (NoLock, StatsOff) are empty inline code and
+//   compile away completely.
+//
+//   Storage (the engine and its bucket representation):
+//     * RobinHood         open addressing with Robin Hood probing; every
+//                         slot stores the hash of its key (default)
+//     * RobinHoodCompact  the same without stored hashes (smaller slots;
+//                         equal_fn is called more often)
+//     * Chained           the generic C table of hashtable.h (a BST per
+//                         bucket); requires operator< on K and the default
+//                         Eq (equal_to), as keys are told apart by <;
+//                         ignores Alloc
+//     * FlatU64           the integer table of htu64.h; requires
+//                         K = uint64_t and never stores HTU64_EMPTY_KEY;
+//                         ignores Hash, Eq and Alloc
+//   Lock:
+//     * NoLock            no synchronization (default)
+//     * Mutex             one std::mutex for the whole set
+//     * Striped<S>        S independent tables, each with its own mutex;
+//                         a key belongs to the table given by a second
+//                         mix of its hash (independent of the bits the
+//                         engines index with)
+//   Stats:
+//     * StatsOff          no instrumentation (default)
+//     * StatsOn           counts operations and probes (see HashSetStats)
+//   Alloc: the allocator of the RobinHood engines (std::allocator<K>).
+
+#ifndef HASHSET_HPP
+#define HASHSET_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "hashtable.h"
+#include "htu64.h"
+}
+
+namespace ht {
+
+// hashset_detail holds the parts shared by the policies.
+namespace hashset_detail {
+
+// mix(h) returns a well-mixed copy of the hash h (the splitmix64
+//   finalizer), so weak hashes (e.g. std::hash of integers) spread over
+//   all bits.
+// time: O(1)
+inline std::uint64_t mix(std::uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+// NullMutex is a mutex that does nothing.
+struct NullMutex {
+  void lock() {}
+  void unlock() {}
+};
+
+}  // namespace hashset_detail
+
+// ---------------------------------------------------------------------------
+// Storage policies. A storage policy has a member template
+//   table<K, Hash, Eq, Alloc>
+// with the operations
+//   template <bool Count>
+//   bool insert(const K &key, std::uint64_t hash, std::size_t &probes)
+//   template <bool Count>
+//   bool erase(const K &key, std::uint64_t hash, std::size_t &probes)
+//   template <bool Count>
+//   bool contains(const K &key, std::uint64_t hash, std::size_t &probes) const
+//   std::size_t size() const
+//   void for_each(F &&visit) const
+// where hash is the mixed hash of key and, if Count is true, probes is
+// increased by the number of slots (or nodes) that were looked at. Engines
+// that need extra work to count skip it if Count is false.
+
+// BasicRobinHood<StoreHash> is the Robin Hood engine: linear probing in
+// which a key that is further from its home slot than the key in a slot
+// takes that slot, so probe lengths stay short and even at a load of 7/8.
+// Removals shift the rest of the cluster back (no tombstones).
+template <bool StoreHash>
+struct BasicRobinHood {
+  template <typename K, typename Hash, typename Eq, typename Alloc>
+  class table {
+   public:
+    explicit table(const Alloc &alloc = Alloc()) : alloc_(alloc) {
+      allocate(16);
+    }
+
+    table(const table &) = delete;
+    table &operator=(const table &) = delete;
+
+    ~table() {
+      release();
+    }
+
+    template <bool Count>
+    bool insert(const K &key, std::uint64_t hash, std::size_t &probes) {
+      if (find(key, hash, probes) != capacity_) {
+        return false;
+      }
+      if ((count_ + 1) * 8 > capacity_ * 7) {
+        rehash(capacity_ * 2);
+      }
+      place(K(key), hash, probes);
+      count_++;
+      return true;
+    }
+
+    template <bool Count>
+    bool erase(const K &key, std::uint64_t hash, std::size_t &probes) {
+      std::size_t i = find(key, hash, probes);
+      if (i == capacity_) {
+        return false;
+      }
+      // shift the following keys of the cluster back by one slot
+      std::size_t next = (i + 1) & mask();
+      while (slots_[next].distance > 1) {
+        slots_[i].key() = std::move(slots_[next].key());
+        slots_[i].set_hash(slots_[next].hash());
+        slots_[i].distance = slots_[next].distance - 1;
+        i = next;
+        next = (next + 1) & mask();
+      }
+      slots_[i].key().~K();
+      slots_[i].distance = 0;
+      count_--;
+      return true;
+    }
+
+    template <bool Count>
+    bool contains(const K &key, std::uint64_t hash, std::size_t &probes) const {
+      return find(key, hash, probes) != capacity_;
+    }
+
+    std::size_t size() const {
+      return count_;
+    }
+
+    template <typename F>
+    void for_each(F &&visit) const {
+      for (std::size_t i = 0; i < capacity_; i++) {
+        if (slots_[i].distance) {
+          visit(slots_[i].key());
+        }
+      }
+    }
+
+   private:
+    // the hash of a slot, if the representation stores it
+    struct StoredHash {
+      std::uint64_t value;
+      std::uint64_t get() const { return value; }
+      void set(std::uint64_t h) { value = h; }
+    };
+    struct NoHash {
+      std::uint64_t get() const { return 0; }
+      void set(std::uint64_t) {}
+    };
+
+    // a slot: distance is 0 if the slot is free, and otherwise 1 + the
+    // distance of the slot from the home slot of its key
+    struct Slot {
+      alignas(K) unsigned char storage[sizeof(K)];
+      std::conditional_t<StoreHash, StoredHash, NoHash> stored_hash;
+      std::uint32_t distance;
+
+      K &key() { return *std::launder(reinterpret_cast<K *>(storage)); }
+      const K &key() const {
+        return *std::launder(reinterpret_cast<const K *>(storage));
+      }
+      std::uint64_t hash() const { return stored_hash.get(); }
+      void set_hash(std::uint64_t h) { stored_hash.set(h); }
+    };
+
+    using SlotAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>;
+
+    std::size_t mask() const {
+      return capacity_ - 1;
+    }
+
+    // find(key, hash, probes) returns the slot of key, or capacity_ if key
+    // is not stored; the search stops at the first slot whose key is
+    // closer to its home than key would be
+    std::size_t find(const K &key, std::uint64_t hash, std::size_t &probes) const {
+      std::size_t i = hash & mask();
+      for (std::uint32_t distance = 1; slots_[i].distance >= distance; distance++) {
+        probes++;
+        if ((!StoreHash || slots_[i].hash() == hash) && eq_(slots_[i].key(), key)) {
+          return i;
+        }
+        i = (i + 1) & mask();
+      }
+      probes++;
+      return capacity_;
+    }
+
+    // place(key, hash, probes) moves key into the table, displacing keys
+    // that are closer to their home slots
+    void place(K &&key, std::uint64_t hash, std::size_t &probes) {
+      std::size_t i = hash & mask();
+      std::uint32_t distance = 1;
+      while (slots_[i].distance) {
+        probes++;
+        if (slots_[i].distance < distance) {
+          // the displaced key continues the probe at its own distance (its
+          // hash is only needed again if it is stored)
+          std::swap(key, slots_[i].key());
+          std::swap(distance, slots_[i].distance);
+          const std::uint64_t h = slots_[i].hash();
+          slots_[i].set_hash(hash);
+          hash = h;
+        }
+        i = (i + 1) & mask();
+        distance++;
+      }
+      probes++;
+      ::new (slots_[i].storage) K(std::move(key));
+      slots_[i].set_hash(hash);
+      slots_[i].distance = distance;
+    }
+
+    void allocate(std::size_t capacity) {
+      SlotAlloc alloc(alloc_);
+      slots_ = std::allocator_traits<SlotAlloc>::allocate(alloc, capacity);
+      for (std::size_t i = 0; i < capacity; i++) {
+        slots_[i].distance = 0;
+      }
+      capacity_ = capacity;
+    }
+
+    void release() {
+      for (std::size_t i = 0; i < capacity_; i++) {
+        if (slots_[i].distance) {
+          slots_[i].key().~K();
+        }
+      }
+      SlotAlloc alloc(alloc_);
+      std::allocator_traits<SlotAlloc>::deallocate(alloc, slots_, capacity_);
+    }
+
+    void rehash(std::size_t capacity) {
+      Slot *old = slots_;
+      const std::size_t old_capacity = capacity_;
+      allocate(capacity);
+      std::size_t probes = 0;
+      for (std::size_t i = 0; i < old_capacity; i++) {
+        if (old[i].distance) {
+          const std::uint64_t h =
+              StoreHash ? old[i].hash() : hashset_detail::mix(hash_(old[i].key()));
+          place(std::move(old[i].key()), h, probes);
+          old[i].key().~K();
+        }
+      }
+      SlotAlloc alloc(alloc_);
+      std::allocator_traits<SlotAlloc>::deallocate(alloc, old, old_capacity);
+    }
+
+    Alloc alloc_;
+    Hash hash_;
+    Eq eq_;
+    Slot *slots_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t count_ = 0;
+  };
+};
+
+using RobinHood = BasicRobinHood<true>;
+using RobinHoodCompact = BasicRobinHood<false>;
+
+// Chained is the generic C engine of hashtable.h: 2^HashLength buckets, each
+// a BST of cloned keys ordered by operator<. Its probes are the bucket plus
+// the BST nodes compared on the way.
+template <int HashLength = 10>
+struct BasicChained {
+  template <typename K, typename Hash, typename Eq, typename Alloc>
+  class table {
+    // the BST finds keys with operator<, so it cannot honor another Eq
+    static_assert(std::is_same_v<Eq, std::equal_to<K>> ||
+                      std::is_same_v<Eq, std::equal_to<>>,
+                  "Chained compares keys with operator< and requires Eq = equal_to");
+
+   public:
+    explicit table(const Alloc & = Alloc())
+        : ht_(ht_create(clone, hash, HashLength, compare, destroy, print)) {}
+
+    table(const table &) = delete;
+    table &operator=(const table &) = delete;
+
+    ~table() {
+      ht_destroy(ht_);
+    }
+
+    template <bool Count>
+    bool insert(const K &key, std::uint64_t, std::size_t &probes) {
+      compares_ = 0;
+      const bool inserted = ht_insert(ht_, &key) == HT_SUCCESS;
+      probes += 1 + compares_;
+      count_ += inserted;
+      return inserted;
+    }
+
+    template <bool Count>
+    bool erase(const K &key, std::uint64_t, std::size_t &probes) {
+      compares_ = 0;
+      const bool erased = ht_remove(ht_, &key) == HT_SUCCESS;
+      probes += 1 + compares_;
+      count_ -= erased;
+      return erased;
+    }
+
+    template <bool Count>
+    bool contains(const K &key, std::uint64_t, std::size_t &probes) const {
+      compares_ = 0;
+      const bool found = ht_contains(ht_, &key);
+      probes += 1 + compares_;
+      return found;
+    }
+
+    std::size_t size() const {
+      return count_;
+    }
+
+    template <typename F>
+    void for_each(F &&visit) const {
+      using Visit = std::remove_reference_t<F>;
+      ht_foreach(ht_, [](void *ctx, const void *key) {
+        (*static_cast<Visit *>(ctx))(*static_cast<const K *>(key));
+      }, const_cast<void *>(static_cast<const void *>(&visit)));
+    }
+
+   private:
+    static void *clone(const void *key) {
+      return new K(*static_cast<const K *>(key));
+    }
+    static int hash(const void *key, int hash_length) {
+      const std::uint64_t h = hashset_detail::mix(Hash()(*static_cast<const K *>(key)));
+      return static_cast<int>(h >> (64 - hash_length));
+    }
+    static int compare(const void *a, const void *b) {
+      compares_++;
+      const K &x = *static_cast<const K *>(a);
+      const K &y = *static_cast<const K *>(b);
+      return (y < x) - (x < y);
+    }
+    static void destroy(void *key) {
+      delete static_cast<K *>(key);
+    }
+    static void print(const void *) {}
+
+    // comparisons made by the current operation of this thread (the C
+    // connectors have no context pointer)
+    static inline thread_local std::size_t compares_ = 0;
+
+    struct hashtable *ht_;
+    std::size_t count_ = 0;
+  };
+};
+
+using Chained = BasicChained<>;
+
+// FlatU64 is the integer engine of htu64.h. Probes are only measured (with
+// ht_probes_u64, an extra lookup) if they are counted.
+struct FlatU64 {
+  template <typename K, typename Hash, typename Eq, typename Alloc>
+  class table {
+    static_assert(std::is_same_v<K, std::uint64_t>, "FlatU64 requires K = uint64_t");
+
+   public:
+    explicit table(const Alloc & = Alloc()) : ht_(ht_create_u64(4)) {}
+
+    table(const table &) = delete;
+    table &operator=(const table &) = delete;
+
+    ~table() {
+      ht_destroy_u64(ht_);
+    }
+
+    template <bool Count>
+    bool insert(const K &key, std::uint64_t, std::size_t &probes) {
+      if constexpr (Count) {
+        probes += ht_probes_u64(ht_, key);
+      }
+      return ht_insert_u64(ht_, key) == HT_SUCCESS;
+    }
+
+    template <bool Count>
+    bool erase(const K &key, std::uint64_t, std::size_t &probes) {
+      if constexpr (Count) {
+        probes += ht_probes_u64(ht_, key);
+      }
+      return ht_remove_u64(ht_, key) == HT_SUCCESS;
+    }
+
+    template <bool Count>
+    bool contains(const K &key, std::uint64_t, std::size_t &probes) const {
+      if constexpr (Count) {
+        probes += ht_probes_u64(ht_, key);
+      }
+      return ht_contains_u64(ht_, key);
+    }
+
+    std::size_t size() const {
+      return ht_count_u64(ht_);
+    }
+
+    template <typename F>
+    void for_each(F &&visit) const {
+      using Visit = std::remove_reference_t<F>;
+      ht_foreach_u64(ht_, [](void *ctx, std::uint64_t key) {
+        (*static_cast<Visit *>(ctx))(key);
+      }, const_cast<void *>(static_cast<const void *>(&visit)));
+    }
+
+   private:
+    struct hashtable_u64 *ht_;
+  };
+};
+
+// ---------------------------------------------------------------------------
+// Lock policies: the number of independent tables (stripes) and the mutex
+// type of each.
+
+struct NoLock {
+  static constexpr std::size_t stripes = 1;
+  using mutex_type = hashset_detail::NullMutex;
+};
+
+struct Mutex {
+  static constexpr std::size_t stripes = 1;
+  using mutex_type = std::mutex;
+};
+
+template <std::size_t S>
+struct Striped {
+  static_assert(S > 0 && (S & (S - 1)) == 0, "the number of stripes must be a power of 2");
+  static constexpr std::size_t stripes = S;
+  using mutex_type = std::mutex;
+};
+
+// ---------------------------------------------------------------------------
+// Stats policies.
+
+// HashSetStats is a snapshot of the counters of a set with StatsOn.
+struct HashSetStats {
+  std::uint64_t inserts;                            // successful insertions
+  std::uint64_t erases;                             // successful removals
+  std::uint64_t lookups;                            // calls of contains
+  std::uint64_t operations;                         // all calls
+  std::uint64_t probes;                             // slots or nodes looked at
+};
+
+struct StatsOff {
+  static constexpr bool counts_probes = false;
+  void record(bool, bool, bool, std::size_t) {}
+  HashSetStats snapshot() const {
+    return HashSetStats{0, 0, 0, 0, 0};
+  }
+};
+
+struct StatsOn {
+  static constexpr bool counts_probes = true;
+  void record(bool inserted, bool erased, bool lookup, std::size_t probes) {
+    inserts_.fetch_add(inserted, std::memory_order_relaxed);
+    erases_.fetch_add(erased, std::memory_order_relaxed);
+    lookups_.fetch_add(lookup, std::memory_order_relaxed);
+    operations_.fetch_add(1, std::memory_order_relaxed);
+    probes_.fetch_add(probes, std::memory_order_relaxed);
+  }
+  HashSetStats snapshot() const {
+    return HashSetStats{inserts_.load(std::memory_order_relaxed),
+                        erases_.load(std::memory_order_relaxed),
+                        lookups_.load(std::memory_order_relaxed),
+                        operations_.load(std::memory_order_relaxed),
+                        probes_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  std::atomic<std::uint64_t> inserts_{0};
+  std::atomic<std::uint64_t> erases_{0};
+  std::atomic<std::uint64_t> lookups_{0};
+  std::atomic<std::uint64_t> operations_{0};
+  std::atomic<std::uint64_t> probes_{0};
+};
+
+// ---------------------------------------------------------------------------
+
+// HashSet is a set of keys of type K with the given policies (see the top
+// of this file). insert, erase and contains may be called concurrently
+// unless Lock is NoLock; size and for_each lock all stripes.
+template <typename K, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>,
+          typename Storage = RobinHood, typename Lock = NoLock,
+          typename Stats = StatsOff, typename Alloc = std::allocator<K>>
+class HashSet {
+  using Table = typename Storage::template table<K, Hash, Eq, Alloc>;
+
+ public:
+  explicit HashSet(const Alloc &alloc = Alloc()) {
+    for (std::size_t s = 0; s < Lock::stripes; s++) {
+      ::new (&stripes_[s].table) Table(alloc);
+    }
+  }
+
+  HashSet(const HashSet &) = delete;
+  HashSet &operator=(const HashSet &) = delete;
+
+  ~HashSet() {
+    for (std::size_t s = 0; s < Lock::stripes; s++) {
+      stripes_[s].table.~Table();
+    }
+  }
+
+  // insert(key) inserts key and returns true, or returns false if key is
+  //   already in the set.
+  // time: O(1) expected (RobinHood, FlatU64), O(log m) for Chained
+  bool insert(const K &key) {
+    const std::uint64_t h = hash(key);
+    Stripe &s = stripe(h);
+    std::size_t probes = 0;
+    std::lock_guard<typename Lock::mutex_type> guard(s.mutex);
+    const bool inserted = s.table.template insert<Stats::counts_probes>(key, h, probes);
+    stats_.record(inserted, false, false, probes);
+    return inserted;
+  }
+
+  // erase(key) removes key and returns true, or returns false if key is
+  //   not in the set.
+  // time: O(1) expected (RobinHood, FlatU64), O(log m) for Chained
+  bool erase(const K &key) {
+    const std::uint64_t h = hash(key);
+    Stripe &s = stripe(h);
+    std::size_t probes = 0;
+    std::lock_guard<typename Lock::mutex_type> guard(s.mutex);
+    const bool erased = s.table.template erase<Stats::counts_probes>(key, h, probes);
+    stats_.record(false, erased, false, probes);
+    return erased;
+  }
+
+  // contains(key) returns true if key is in the set.
+  // time: O(1) expected (RobinHood, FlatU64), O(log m) for Chained
+  bool contains(const K &key) const {
+    const std::uint64_t h = hash(key);
+    Stripe &s = stripe(h);
+    std::size_t probes = 0;
+    std::lock_guard<typename Lock::mutex_type> guard(s.mutex);
+    const bool found = s.table.template contains<Stats::counts_probes>(key, h, probes);
+    stats_.record(false, false, true, probes);
+    return found;
+  }
+
+  // size() returns the number of keys in the set.
+  // time: O(S), where S is the number of stripes
+  std::size_t size() const {
+    std::size_t n = 0;
+    for (std::size_t s = 0; s < Lock::stripes; s++) {
+      std::lock_guard<typename Lock::mutex_type> guard(stripes_[s].mutex);
+      n += stripes_[s].table.size();
+    }
+    return n;
+  }
+
+  // for_each(visit) calls visit(key) for every key in the set, stripe by
+  //   stripe; visit must not modify the set.
+  // time: O(n + m * v)
+  template <typename F>
+  void for_each(F &&visit) const {
+    for (std::size_t s = 0; s < Lock::stripes; s++) {
+      std::lock_guard<typename Lock::mutex_type> guard(stripes_[s].mutex);
+      stripes_[s].table.for_each(visit);
+    }
+  }
+
+  // stats() returns the counters of the set (all 0 with StatsOff).
+  // time: O(1)
+  HashSetStats stats() const {
+    return stats_.snapshot();
+  }
+
+ private:
+  // a table with its mutex; the table is constructed by HashSet
+  struct Stripe {
+    Stripe() {}
+    ~Stripe() {}
+    mutable typename Lock::mutex_type mutex;
+    union {
+      Table table;
+    };
+  };
+
+  static std::uint64_t hash(const K &key) {
+    return hashset_detail::mix(static_cast<std::uint64_t>(Hash()(key)));
+  }
+
+  // the stripe of a key is given by the top bits of a second mix of its
+  // hash: the engines index with the low (RobinHood) or the top (Chained,
+  // FlatU64) bits of h itself, so taking the stripe from h would leave each
+  // stripe's keys in 1/S of the slots of its table
+  Stripe &stripe(std::uint64_t h) const {
+    if constexpr (Lock::stripes == 1) {
+      return stripes_[0];
+    } else {
+      const std::uint64_t g = hashset_detail::mix(h ^ 0x9e3779b97f4a7c15ULL);
+      return stripes_[g >> (64 - __builtin_ctzll(Lock::stripes))];
+    }
+  }
+
+  mutable Stripe stripes_[Lock::stripes];
+  mutable Stats stats_;
+};
+
+}  // namespace ht
+
+#endif
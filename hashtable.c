@@ -2,9 +2,11 @@
 //   trees.
 
 #include <stdlib.h>
+#include <stdatomic.h>
 #include "hashtable.h"
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 // -----------------------------------------------------------------------
@@ -15,6 +17,15 @@ const int HT_ALREADY_STORED = 1;
 const int HT_NOT_STORED     = 2;
 // -----------------------------------------------------------------------
 
+const int HT_OP_INSERT = 0;
+const int HT_OP_REMOVE = 1;
+
+// number of keys whose buckets the batch functions look up ahead
+#define HT_BATCH_GROUP 16
+// ht_sample falls back to a reservoir if rejection sampling needs more
+//   tries than this per key on average
+#define HT_SAMPLE_MAX_TRIES 32
+
 // a generic bstnode
 struct bstnode {
   void *key;
@@ -26,6 +37,28 @@ struct bstnode {
 // a generic BST
 struct bst {
   struct bstnode *root;
+  int count;                                        // number of nodes
+};
+
+// an observer registered with ht_observe
+struct ht_observer {
+  void (*notify)(void *, int, const void *, int);
+  void *ctx;
+  struct ht_observer *next;
+};
+
+// the bucket that is being cleared by ht_bucket_clear
+struct ht_clear_ctx {
+  const struct hashtable *ht;
+  int index;
+};
+
+// the reservoir of keys that is being filled by sample_reservoir
+struct ht_reservoir {
+  struct hashtable *ht;
+  const void **out;
+  int k;
+  int seen;                                         // number of keys visited
 };
 
 struct hashtable {
@@ -37,6 +70,10 @@ struct hashtable {
   int (*key_compare)(const void *, const void *);   // comparison function for void pointers
   void (*key_destroy)(void *);                      // free memory allocated for the key
   void (*key_print)(const void *);                  // print the key
+  struct ht_observer *observers;                    // notified after every change
+  _Atomic int count;                                // number of keys
+  _Atomic int max_bucket;                           // no bucket has more keys
+  uint64_t random;                                  // state of ht_sample
 
 };
 
@@ -59,7 +96,23 @@ static void bstnode_print(struct bstnode *node, bool *first,
 static void bstnodes_print(struct bstnode *node, bool *first, 
                                                 void (*key_print)(const void *));
 static void bst_print (struct bst *b, void (*key_print)(const void *));
+static const struct bstnode *bst_find(const void *key, const struct bst *b,
+                                      int (*key_compare)(const void *, const void *));
+static void prefetch_group(const struct hashtable *ht, const void *const *keys,
+                           int n, int *indexes);
 static int pwr(int n);
+static void *key_adopt(const void *key);
+static void notify_observers(const struct hashtable *ht, int op, 
+                                                const void *key, int index);
+static void bstnodes_foreach(struct bstnode *node, 
+                             void (*visit)(void *, const void *), void *ctx);
+static void notify_removed(void *ctx, const void *key);
+static void key_inserted(struct hashtable *ht, const void *key, int index);
+static void key_removed(struct hashtable *ht, const void *key, int index);
+static const void *bstnode_at(const struct bstnode *node, int *position);
+static uint64_t next_random(struct hashtable *ht);
+static void reservoir_visit(void *ctx, const void *key);
+static int sample_reservoir(struct hashtable *ht, int k, const void **out);
 
 // HELPER FUNCTION DECLERATIONS END ------------------------------------
 // documentation for helper functions is available at location of definition
@@ -90,6 +143,10 @@ struct hashtable *ht_create(void *(*key_clone)(const void *),
   ht->key_compare = key_compare;
   ht->key_destroy = key_destroy;
   ht->key_print = key_print;
+  ht->observers = NULL;
+  atomic_init(&ht->count, 0);
+  atomic_init(&ht->max_bucket, 0);
+  ht->random = 0x853c49e6748fea9bULL;
 
   // allocate memory for the table and set all the BSTs to NULL
   ht->table = malloc(sizeof(struct bst) * ht->ht_len);
@@ -107,6 +164,11 @@ void ht_destroy(struct hashtable *ht) {
       bst_destroy(ht->table[i], ht->key_destroy);
     }
   }
+  while (ht->observers) {
+    struct ht_observer *next = ht->observers->next;
+    free(ht->observers);
+    ht->observers = next;
+  }
   free(ht->table);
   free(ht);
 }
@@ -119,7 +181,30 @@ int ht_insert(struct hashtable *ht, const void *key) {
     ht->table[index] = bst_create();
   }
 
-  return bst_insert(key, ht->table[index], ht->key_compare, ht->key_clone);
+  const int result = bst_insert(key, ht->table[index], ht->key_compare, 
+                                ht->key_clone);
+  if (result == HT_SUCCESS) {
+    key_inserted(ht, key, index);
+  }
+  return result;
+}
+
+int ht_adopt(struct hashtable *ht, void *key) {
+  assert(key);
+  assert(ht);
+  const int index = ht->hash_func(key, ht->hash_len);
+  if (ht->table[index] == NULL) {
+    ht->table[index] = bst_create();
+  }
+
+  // the "clone" of key is key itself, so the table takes ownership of it
+  const int result = bst_insert(key, ht->table[index], ht->key_compare, key_adopt);
+  if (result == HT_SUCCESS) {
+    key_inserted(ht, key, index);
+  } else {
+    ht->key_destroy(key);
+  }
+  return result;
 }
 
 int ht_remove(struct hashtable *ht, const void *key) {
@@ -131,7 +216,93 @@ int ht_remove(struct hashtable *ht, const void *key) {
   if (ht->table[index] == NULL) {
     return HT_NOT_STORED;
   }
-  return bst_remove(key, ht->table[index], ht->key_compare, ht->key_destroy);
+  const int result = bst_remove(key, ht->table[index], ht->key_compare, 
+                                ht->key_destroy);
+  if (result == HT_SUCCESS) {
+    key_removed(ht, key, index);
+  }
+  return result;
+}
+
+bool ht_contains(const struct hashtable *ht, const void *key) {
+  assert(ht);
+  assert(key);
+  const int index = ht->hash_func(key, ht->hash_len);
+  return ht->table[index] && bst_find(key, ht->table[index], ht->key_compare);
+}
+
+const void *ht_lookup(const struct hashtable *ht, const void *key) {
+  assert(ht);
+  assert(key);
+  const int index = ht->hash_func(key, ht->hash_len);
+  if (ht->table[index] == NULL) {
+    return NULL;
+  }
+  const struct bstnode *node = bst_find(key, ht->table[index], ht->key_compare);
+  return node ? node->key : NULL;
+}
+
+void ht_insert_batch(struct hashtable *ht, const void *const *keys, int n,
+                     int *results) {
+  assert(ht);
+  assert(keys);
+  assert(results);
+  int indexes[HT_BATCH_GROUP];
+  for (int i = 0; i < n; i += HT_BATCH_GROUP) {
+    const int group = n - i < HT_BATCH_GROUP ? n - i : HT_BATCH_GROUP;
+    prefetch_group(ht, keys + i, group, indexes);
+    for (int k = 0; k < group; k++) {
+      const int index = indexes[k];
+      if (ht->table[index] == NULL) {
+        ht->table[index] = bst_create();
+      }
+      results[i + k] = bst_insert(keys[i + k], ht->table[index], ht->key_compare,
+                                  ht->key_clone);
+      if (results[i + k] == HT_SUCCESS) {
+        key_inserted(ht, keys[i + k], index);
+      }
+    }
+  }
+}
+
+void ht_remove_batch(struct hashtable *ht, const void *const *keys, int n,
+                     int *results) {
+  assert(ht);
+  assert(keys);
+  assert(results);
+  int indexes[HT_BATCH_GROUP];
+  for (int i = 0; i < n; i += HT_BATCH_GROUP) {
+    const int group = n - i < HT_BATCH_GROUP ? n - i : HT_BATCH_GROUP;
+    prefetch_group(ht, keys + i, group, indexes);
+    for (int k = 0; k < group; k++) {
+      const int index = indexes[k];
+      if (ht->table[index] == NULL) {
+        results[i + k] = HT_NOT_STORED;
+        continue;
+      }
+      results[i + k] = bst_remove(keys[i + k], ht->table[index], ht->key_compare,
+                                  ht->key_destroy);
+      if (results[i + k] == HT_SUCCESS) {
+        key_removed(ht, keys[i + k], index);
+      }
+    }
+  }
+}
+
+void ht_contains_batch(const struct hashtable *ht, const void *const *keys,
+                       int n, bool *results) {
+  assert(ht);
+  assert(keys);
+  assert(results);
+  int indexes[HT_BATCH_GROUP];
+  for (int i = 0; i < n; i += HT_BATCH_GROUP) {
+    const int group = n - i < HT_BATCH_GROUP ? n - i : HT_BATCH_GROUP;
+    prefetch_group(ht, keys + i, group, indexes);
+    for (int k = 0; k < group; k++) {
+      const struct bst *b = ht->table[indexes[k]];
+      results[i + k] = b && bst_find(keys[i + k], b, ht->key_compare);
+    }
+  }
 }
 
 void ht_print(const struct hashtable *ht) {
@@ -146,6 +317,146 @@ void ht_print(const struct hashtable *ht) {
   }
 }
 
+int ht_index(const struct hashtable *ht, const void *key) {
+  assert(ht);
+  assert(key);
+  return ht->hash_func(key, ht->hash_len);
+}
+
+int ht_length(const struct hashtable *ht) {
+  assert(ht);
+  return ht->ht_len;
+}
+
+void ht_bucket_foreach(const struct hashtable *ht, int index,
+                       void (*visit)(void *, const void *), void *ctx) {
+  assert(ht);
+  assert(visit);
+  assert(0 <= index && index < ht->ht_len);
+  if (ht->table[index]) {
+    bstnodes_foreach(ht->table[index]->root, visit, ctx);
+  }
+}
+
+void ht_foreach(const struct hashtable *ht,
+                void (*visit)(void *, const void *), void *ctx) {
+  assert(ht);
+  assert(visit);
+  for (int i = 0; i < ht->ht_len; i++) {
+    ht_bucket_foreach(ht, i, visit, ctx);
+  }
+}
+
+void ht_bucket_clear(struct hashtable *ht, int index) {
+  assert(ht);
+  assert(0 <= index && index < ht->ht_len);
+  struct bst *b = ht->table[index];
+  if (b == NULL) {
+    return;
+  }
+  if (ht->observers) {
+    struct ht_clear_ctx ctx = {ht, index};
+    bstnodes_foreach(b->root, notify_removed, &ctx);
+  }
+  atomic_fetch_sub_explicit(&ht->count, b->count, memory_order_relaxed);
+  bst_destroy(b, ht->key_destroy);
+  ht->table[index] = NULL;
+}
+
+int ht_sample(struct hashtable *ht, int k, const void **out) {
+  assert(ht);
+  assert(out);
+  assert(k >= 0);
+  const int count = atomic_load_explicit(&ht->count, memory_order_relaxed);
+  if (count == 0) {
+    return 0;
+  }
+  // a try picks a bucket and a position below max_bucket and succeeds if
+  //  the bucket has a key at that position, which gives every key the same
+  //  chance; on average a key takes ht_len * max_bucket / count tries
+  int max_bucket = atomic_load_explicit(&ht->max_bucket, memory_order_relaxed);
+  if (max_bucket == 0 ||
+      (long)ht->ht_len * max_bucket > (long)HT_SAMPLE_MAX_TRIES * count) {
+    max_bucket = 0;
+    for (int i = 0; i < ht->ht_len; i++) {
+      if (ht->table[i] && ht->table[i]->count > max_bucket) {
+        max_bucket = ht->table[i]->count;
+      }
+    }
+    atomic_store_explicit(&ht->max_bucket, max_bucket, memory_order_relaxed);
+    if (max_bucket == 0) {
+      return 0;                                     // the table is empty after all
+    }
+    if ((long)ht->ht_len * max_bucket > (long)HT_SAMPLE_MAX_TRIES * count) {
+      return sample_reservoir(ht, k, out);
+    }
+  }
+  for (int i = 0; i < k; i++) {
+    const struct bst *b;
+    int position;
+    do {
+      b = ht->table[next_random(ht) % ht->ht_len];
+      position = next_random(ht) % max_bucket;
+    } while (b == NULL || position >= b->count);
+    out[i] = bstnode_at(b->root, &position);
+  }
+  return k;
+}
+
+void ht_observe(struct hashtable *ht,
+                void (*observer)(void *, int, const void *, int), void *ctx) {
+  assert(ht);
+  assert(observer);
+  struct ht_observer *o = malloc(sizeof(struct ht_observer));
+  o->notify = observer;
+  o->ctx = ctx;
+  o->next = ht->observers;
+  ht->observers = o;
+}
+
+void ht_unobserve(struct hashtable *ht,
+                  void (*observer)(void *, int, const void *, int), void *ctx) {
+  assert(ht);
+  assert(observer);
+  struct ht_observer **link = &ht->observers;
+  while (*link) {
+    if ((*link)->notify == observer && (*link)->ctx == ctx) {
+      struct ht_observer *o = *link;
+      *link = o->next;
+      free(o);
+      return;
+    }
+    link = &(*link)->next;
+  }
+}
+
+uint64_t ht_key_hash64(const void *key,
+                       int (*key_encode)(const void *, void *, int)) {
+  assert(key);
+  assert(key_encode);
+  unsigned char local[256];
+  unsigned char *buf = local;
+  const int len = key_encode(key, buf, sizeof(local));
+  if (len > (int)sizeof(local)) {
+    buf = malloc(len);
+    key_encode(key, buf, len);
+  }
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < len; i++) {
+    h ^= buf[i];
+    h *= 0x100000001b3ULL;
+  }
+  if (buf != local) {
+    free(buf);
+  }
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
 
 // HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
 
@@ -184,6 +495,7 @@ static void free_bstnode(struct bstnode *node, void (*key_destroy)(void *)) {
 static struct bst *bst_create(void) {
   struct bst *b = malloc(sizeof(struct bst));
   b->root = NULL;
+  b->count = 0;
   return b;
 }
 
@@ -219,7 +531,8 @@ static int bst_insert(const void *key, struct bst *b,
   if(node) {
     return HT_ALREADY_STORED;
   }
-  else if(parent == NULL) {
+  b->count++;
+  if(parent == NULL) {
     b->root = new_leaf(key, counter, key_clone);
     return HT_SUCCESS;
   }
@@ -293,6 +606,7 @@ static int bst_remove(const void *key, struct bst *b,
   if (target == NULL) {
     return HT_NOT_STORED; // key not found
   }
+  b->count--;
 
   // find the node to "replace" the target
   struct bstnode *replacement = NULL;
@@ -321,9 +635,8 @@ static int bst_remove(const void *key, struct bst *b,
     replacement->level = target->level;
   }
 
-  // free the target, and update the target's parent
-  key_destroy(target->key);
-  free(target);
+  // update the target's parent, and free the target (key may be the key
+  //  of the target, so it is not used after that)
   if (target_parent == NULL) {
     b->root = replacement;
   } else if ((key_compare(key, target_parent->key) > 0)) {
@@ -331,6 +644,8 @@ static int bst_remove(const void *key, struct bst *b,
   } else {
     target_parent->left = replacement;
   }
+  key_destroy(target->key);
+  free(target);
   return HT_SUCCESS;
 }
 
@@ -384,6 +699,50 @@ static void bst_print (struct bst *b, void (*key_print)(const void *)) {
   bstnodes_print(b->root, &first, key_print);
 }
 
+// bst_find(key, b, key_compare) is a helper function that returns the node
+//  of the bst b that stores key, or NULL if key is not stored in b
+// requires: all pointers are valid
+// time: O(m * co) where m is the number of items in b and co is the time
+//  complexity of key_compare
+static const struct bstnode *bst_find(const void *key, const struct bst *b,
+                                      int (*key_compare)(const void *, const void *)) {
+  assert(key);
+  assert(b);
+  assert(key_compare);
+  const struct bstnode *node = b->root;
+  while (node) {
+    const int cmp = key_compare(key, node->key);
+    if (cmp == 0) {
+      return node;
+    }
+    node = cmp < 0 ? node->left : node->right;
+  }
+  return NULL;
+}
+
+// prefetch_group(ht, keys, n, indexes) is a helper function that stores
+//  the bucket of keys[i] in indexes[i] for 0 <= i < n and prefetches the
+//  roots of these buckets
+// requires: all pointers are valid; n <= HT_BATCH_GROUP
+// effects: modifies indexes
+// time: O(n * hf)
+static void prefetch_group(const struct hashtable *ht, const void *const *keys,
+                           int n, int *indexes) {
+  assert(ht);
+  assert(keys);
+  assert(indexes);
+  for (int k = 0; k < n; k++) {
+    indexes[k] = ht->hash_func(keys[k], ht->hash_len);
+    __builtin_prefetch(&ht->table[indexes[k]]);
+  }
+  for (int k = 0; k < n; k++) {
+    const struct bst *b = ht->table[indexes[k]];
+    if (b) {
+      __builtin_prefetch(b->root);
+    }
+  }
+}
+
 // pwr(n) is a helper function that returns 2^n
 // requires: n > 0
 // time: O(n)
@@ -394,4 +753,160 @@ static int pwr(int n) {
     val *= 2;
   }
   return val;
-}
\ No newline at end of file
+}
+
+// key_adopt(key) is a helper function that is used in place of key_clone
+//  when the table takes ownership of key; it returns key itself
+// time: O(1)
+static void *key_adopt(const void *key) {
+  return (void *)key;
+}
+
+// notify_observers(ht, op, key, index) is a helper function that reports the
+//  operation op on key (stored in bucket index) to all observers of ht
+// requires: all pointers are valid
+// time: O(o * ob) where o is the number of observers and ob is the time
+//  complexity of an observer
+static void notify_observers(const struct hashtable *ht, int op, 
+                                                const void *key, int index) {
+  assert(ht);
+  assert(key);
+  for (struct ht_observer *o = ht->observers; o; o = o->next) {
+    o->notify(o->ctx, op, key, index);
+  }
+}
+
+// key_inserted(ht, key, index) is a helper function that records the
+//  insertion of key into bucket index in the counts of ht and reports it to
+//  the observers of ht
+// requires: all pointers are valid; the bucket index exists
+// effects: modifies ht
+// time: O(o * ob) where o is the number of observers and ob is the time
+//  complexity of an observer
+static void key_inserted(struct hashtable *ht, const void *key, int index) {
+  assert(ht);
+  assert(ht->table[index]);
+  atomic_fetch_add_explicit(&ht->count, 1, memory_order_relaxed);
+  // writers of different buckets may run in parallel (see htcheckpoint.h)
+  const int size = ht->table[index]->count;
+  int max = atomic_load_explicit(&ht->max_bucket, memory_order_relaxed);
+  while (size > max &&
+         !atomic_compare_exchange_weak_explicit(&ht->max_bucket, &max, size,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+  notify_observers(ht, HT_OP_INSERT, key, index);
+}
+
+// key_removed(ht, key, index) is a helper function that records the
+//  removal of key from bucket index in the counts of ht and reports it to
+//  the observers of ht (max_bucket stays an upper bound)
+// requires: all pointers are valid
+// effects: modifies ht
+// time: O(o * ob) where o is the number of observers and ob is the time
+//  complexity of an observer
+static void key_removed(struct hashtable *ht, const void *key, int index) {
+  assert(ht);
+  atomic_fetch_sub_explicit(&ht->count, 1, memory_order_relaxed);
+  notify_observers(ht, HT_OP_REMOVE, key, index);
+}
+
+// bstnode_at(node, position) is a helper function that returns the key at
+//  *position (counting from 0 in increasing order) in the sub-tree rooted
+//  at node, or NULL if the sub-tree has no more than *position keys; it
+//  decreases *position by the number of keys it passes
+// requires: position is a valid pointer
+// effects: modifies *position
+// time: O(m) where m is the number of subnodes in node + 1
+static const void *bstnode_at(const struct bstnode *node, int *position) {
+  assert(position);
+  if (node == NULL) {
+    return NULL;
+  }
+  const void *key = bstnode_at(node->left, position);
+  if (key) {
+    return key;
+  }
+  if (*position == 0) {
+    return node->key;
+  }
+  (*position)--;
+  return bstnode_at(node->right, position);
+}
+
+// next_random(ht) is a helper function that returns the next number of the
+//  xorshift64* generator of ht
+// requires: ht is a valid pointer
+// effects: modifies ht
+// time: O(1)
+static uint64_t next_random(struct hashtable *ht) {
+  assert(ht);
+  uint64_t x = ht->random;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  ht->random = x;
+  return x * 0x2545f4914f6cdd1dULL;
+}
+
+// reservoir_visit(ctx, key) is a helper function that offers key to the
+//  reservoir ctx (a struct ht_reservoir): key takes a random place of the
+//  reservoir with probability k / seen
+// requires: all pointers are valid
+// effects: modifies ctx
+// time: O(1)
+static void reservoir_visit(void *ctx, const void *key) {
+  struct ht_reservoir *r = ctx;
+  assert(r);
+  if (r->seen < r->k) {
+    r->out[r->seen] = key;
+  } else {
+    const uint64_t j = next_random(r->ht) % (r->seen + 1);
+    if (j < (uint64_t)r->k) {
+      r->out[j] = key;
+    }
+  }
+  r->seen++;
+}
+
+// sample_reservoir(ht, k, out) is a helper function that stores
+//  min(k, count) distinct keys of ht, chosen uniformly at random, in out
+//  and returns their number
+// requires: all pointers are valid; k >= 0
+// effects: modifies ht and out
+// time: O(n + m) where n is the length and m the number of items of ht
+static int sample_reservoir(struct hashtable *ht, int k, const void **out) {
+  assert(ht);
+  assert(out);
+  struct ht_reservoir r = {ht, out, k, 0};
+  ht_foreach(ht, reservoir_visit, &r);
+  return r.seen < k ? r.seen : k;
+}
+
+// bstnodes_foreach(node, visit, ctx) is a helper function that calls
+//  visit(ctx, key) for every key in the sub-tree rooted at node, in order
+//  from smallest to largest
+// requires: visit is a valid pointer
+// time: O(m * v) where m is the number of subnodes in node + 1 and v is
+//  the time complexity of visit
+static void bstnodes_foreach(struct bstnode *node, 
+                             void (*visit)(void *, const void *), void *ctx) {
+  assert(visit);
+  if (node) {
+    bstnodes_foreach(node->left, visit, ctx);
+    visit(ctx, node->key);
+    bstnodes_foreach(node->right, visit, ctx);
+  }
+}
+
+// notify_removed(ctx, key) is a helper function that reports the removal
+//  of key from the bucket described by ctx (a struct ht_clear_ctx) to the
+//  observers of its table
+// requires: all pointers are valid
+// time: O(o * ob) where o is the number of observers and ob is the time
+//  complexity of an observer
+static void notify_removed(void *ctx, const void *key) {
+  const struct ht_clear_ctx *c = ctx;
+  assert(c);
+  notify_observers(c->ht, HT_OP_REMOVE, key, c->index);
+}
@@ -1,3 +1,6 @@
+#include <stdbool.h>
+#include <stdint.h>
+
 // HT_SUCCESS indicates successful execution of the function.
 extern const int HT_SUCCESS;
 // HT_ALREADY_STORED indicates that a key was already stored in the hashtable.
@@ -5,6 +8,11 @@ extern const int HT_ALREADY_STORED;
 // HT_NOT_STORED indicates that a key was not stored in the hashtable.
 extern const int HT_NOT_STORED;
 
+// HT_OP_INSERT and HT_OP_REMOVE identify the operation that is reported to
+//   an observer (see ht_observe).
+extern const int HT_OP_INSERT;
+extern const int HT_OP_REMOVE;
+
 // a generic hashtable
 struct hashtable;
 
@@ -47,6 +55,13 @@ void ht_destroy(struct hashtable *ht);
 //   of key_hash
 int ht_insert(struct hashtable *ht, const void *key);
 
+// ht_adopt(ht, key) is like ht_insert, but ht takes ownership of the heap
+//   key key instead of storing a clone of it (e.g. for keys that were just
+//   created by a loader). If key is already stored in ht, key is destroyed.
+// effects: invalidates key for the caller (it belongs to ht)
+// time: O(m * co + hf), plus O(ds) if key is already stored
+int ht_adopt(struct hashtable *ht, void *key);
+
 // ht_remove(ht, key) removes the key key from the hash table ht. The
 //   function returns
 //   * HT_SUCCESS if key has been removed from ht, or
@@ -56,8 +71,116 @@ int ht_insert(struct hashtable *ht, const void *key);
 //   of key_hash
 int ht_remove(struct hashtable *ht, const void *key);
 
+// ht_contains(ht, key) returns true if key is stored in ht.
+// time: O(hf + m * co), where m is the number of items in the bucket of key
+bool ht_contains(const struct hashtable *ht, const void *key);
+
+// ht_lookup(ht, key) returns the key stored in ht that is equal to key, or
+//   NULL if there is none. The returned key belongs to ht; it is valid
+//   until it is removed.
+// time: O(hf + m * co), where m is the number of items in the bucket of key
+const void *ht_lookup(const struct hashtable *ht, const void *key);
+
+// The batch functions below apply an operation to the n keys of keys[] and
+//   store its result for keys[i] in results[i]. They compute the buckets of
+//   a group of keys before they touch any of them, so the memory accesses of
+//   the group overlap.
+
+// ht_insert_batch(ht, keys, n, results) inserts keys[0..n-1] into ht in
+//   order, like ht_insert.
+// effects: modifies ht and results
+// time: O(n * (cl + m * co + hf))
+void ht_insert_batch(struct hashtable *ht, const void *const *keys, int n,
+                     int *results);
+
+// ht_remove_batch(ht, keys, n, results) removes keys[0..n-1] from ht in
+//   order, like ht_remove.
+// effects: modifies ht and results
+// time: O(n * (ds + hf + m * co))
+void ht_remove_batch(struct hashtable *ht, const void *const *keys, int n,
+                     int *results);
+
+// ht_contains_batch(ht, keys, n, results) stores ht_contains(ht, keys[i])
+//   in results[i] for 0 <= i < n.
+// effects: modifies results
+// time: O(n * (hf + m * co))
+void ht_contains_batch(const struct hashtable *ht, const void *const *keys,
+                       int n, bool *results);
+
 // ht_print(ht) prints the content of hash table ht to the console.
 // effects: creates output
 // time: O(n + m * cp), where n: length of ht, m: number of items in ht,
 //   cp: complexity of key_print
 void ht_print(const struct hashtable *ht);
+
+// ht_index(ht, key) returns the index of the bucket of ht that key belongs
+//   to.
+// time: O(hf), where hf is the complexity of key_hash
+int ht_index(const struct hashtable *ht, const void *key);
+
+// ht_length(ht) returns the number of buckets of ht (2^hash_length).
+// time: O(1)
+int ht_length(const struct hashtable *ht);
+
+// ht_bucket_foreach(ht, index, visit, ctx) calls visit(ctx, key) for every
+//   key stored in the bucket index of ht, in increasing order. visit must
+//   not modify ht.
+// requires: 0 <= index < ht_length(ht)
+// time: O(m * v), where m is the number of items in the bucket and v is the
+//   complexity of visit
+void ht_bucket_foreach(const struct hashtable *ht, int index,
+                       void (*visit)(void *, const void *), void *ctx);
+
+// ht_foreach(ht, visit, ctx) calls visit(ctx, key) for every key stored in
+//   ht, bucket by bucket. visit must not modify ht.
+// time: O(n + m * v), where n is the length of ht, m is the number of items
+//   in ht and v is the complexity of visit
+void ht_foreach(const struct hashtable *ht,
+                void (*visit)(void *, const void *), void *ctx);
+
+// ht_bucket_clear(ht, index) removes all keys stored in the bucket index
+//   of ht. Observers are notified of every removed key.
+// effects: modifies ht
+// requires: 0 <= index < ht_length(ht)
+// time: O(m * ds), where m is the number of items in the bucket
+void ht_bucket_clear(struct hashtable *ht, int index);
+
+// ht_sample(ht, k, out) stores keys of ht chosen uniformly at random in
+//   out[0..k-1] and returns their number. Usually the k keys are drawn
+//   independently (so a key may occur more than once) by picking random
+//   buckets and accepting a bucket in proportion to its number of keys. If
+//   ht is too sparse for that (most picks would hit empty buckets), it
+//   instead stores min(k, m) distinct keys chosen by reservoir sampling over
+//   the whole table. The keys belong to ht; they are valid until they are
+//   removed.
+// effects: modifies ht (its random state) and out
+// requires: k >= 0
+// time: O(k * (n * b / m) * b) expected, where n is the length of ht, m is
+//   the number of items in ht and b the number of items in its largest
+//   bucket; O(n + m) if ht is sparse
+int ht_sample(struct hashtable *ht, int k, const void **out);
+
+// ht_observe(ht, observer, ctx) registers observer with ht: after every
+//   successful insertion (ht_insert, ht_adopt) and removal (ht_remove),
+//   observer(ctx, op, key, index) is called, where op is HT_OP_INSERT or
+//   HT_OP_REMOVE, key is the key passed by the caller and index is the
+//   bucket of key. Observers must not modify ht.
+// effects: allocates heap memory (freed by ht_unobserve or ht_destroy)
+// time: O(1)
+void ht_observe(struct hashtable *ht,
+                void (*observer)(void *, int, const void *, int), void *ctx);
+
+// ht_unobserve(ht, observer, ctx) removes the registration of observer with
+//   ctx from ht, if there is one.
+// time: O(o), where o is the number of observers of ht
+void ht_unobserve(struct hashtable *ht,
+                  void (*observer)(void *, int, const void *, int), void *ctx);
+
+// ht_key_hash64(key, key_encode) returns the 64-bit hash of the encoding
+//   of key written by key_encode (a key_encode connector, see htsnapshot.h):
+//   FNV-1a followed by the splitmix64 finalizer, so every bit depends on
+//   every byte. Keys with equal encodings have equal hashes, in every
+//   process.
+// time: O(en), where en is the complexity of key_encode
+uint64_t ht_key_hash64(const void *key,
+                       int (*key_encode)(const void *, void *, int));
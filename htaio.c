@@ -0,0 +1,552 @@
+// This is the implementation of the asynchronous file I/O engine.
+//   The io_uring backend talks to the kernel through the raw system calls
+//   and the mapped rings (no liburing is needed). If io_uring_setup fails
+//   (old kernel, seccomp filter, ...), if the kernel lacks the read and
+//   write opcodes (they came with Linux 5.6, after io_uring itself), or on
+//   systems other than Linux, requests are queued to a pool of threads that
+//   perform them with pread/pwrite.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "htaio.h"
+#include <assert.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register) && defined(IO_URING_OP_SUPPORTED)
+#define HTAIO_HAVE_URING 1
+#endif
+#endif
+
+// maximum number of threads of the fallback pool
+#define HTAIO_MAX_THREADS 4
+
+// a request of the thread pool
+struct aio_request {
+  bool write;
+  void *buf;
+  size_t len;
+  off_t offset;
+  int tag;
+  long result;
+};
+
+#ifdef HTAIO_HAVE_URING
+// the mapped rings of an io_uring instance
+struct aio_uring {
+  int ring_fd;
+  _Atomic unsigned int *sq_head;
+  _Atomic unsigned int *sq_tail;
+  unsigned int sq_mask;
+  unsigned int *sq_array;
+  struct io_uring_sqe *sqes;
+  _Atomic unsigned int *cq_head;
+  _Atomic unsigned int *cq_tail;
+  unsigned int cq_mask;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr;
+  size_t sq_size;
+  void *cq_ptr;                                     // == sq_ptr with a single mapping
+  size_t cq_size;
+  size_t sqes_size;
+  int fd;                                           // the file of the engine
+  struct aio_request *slots;                        // requests in flight, by user_data
+  int *free_slots;                                  // stack of unused slots
+  int free_len;
+  struct aio_request *failed;                       // completed without a CQE
+  int failed_len;
+};
+#endif
+
+struct htaio {
+  int fd;
+  int depth;
+  bool uring;                                       // which backend is used
+#ifdef HTAIO_HAVE_URING
+  struct aio_uring ring;
+#endif
+  // thread pool backend
+  pthread_t threads[HTAIO_MAX_THREADS];
+  int thread_count;
+  pthread_mutex_t lock;                             // protects the queues and stop
+  pthread_cond_t submitted;
+  pthread_cond_t completed;
+  struct aio_request *pending;                      // ring of submitted requests
+  int pending_head;
+  int pending_len;
+  struct aio_request *done;                         // ring of completed requests
+  int done_head;
+  int done_len;
+  bool stop;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+#ifdef HTAIO_HAVE_URING
+static bool uring_init(struct aio_uring *r, int fd, int depth);
+static bool uring_probe(int ring_fd);
+static void uring_exit(struct aio_uring *r);
+static void uring_submit(struct aio_uring *r, bool write, void *buf, size_t len,
+                         off_t offset, int tag);
+static void uring_queue(struct aio_uring *r, int slot);
+static int uring_wait(struct aio_uring *r, long *result);
+static void uring_enter(struct aio_uring *r, bool wait);
+#endif
+static void pool_submit(struct htaio *aio, bool write, void *buf, size_t len,
+                        off_t offset, int tag);
+static void *pool_main(void *arg);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htaio *htaio_create(int fd, int depth) {
+  assert(fd >= 0);
+  assert(depth > 0);
+
+  struct htaio *aio = malloc(sizeof(struct htaio));
+  aio->fd = fd;
+  aio->depth = depth;
+  aio->uring = false;
+  aio->thread_count = 0;
+#ifdef HTAIO_HAVE_URING
+  aio->uring = uring_init(&aio->ring, fd, depth);
+#endif
+  if (aio->uring) {
+    return aio;
+  }
+
+  pthread_mutex_init(&aio->lock, NULL);
+  pthread_cond_init(&aio->submitted, NULL);
+  pthread_cond_init(&aio->completed, NULL);
+  aio->pending = malloc(sizeof(struct aio_request) * depth);
+  aio->pending_head = 0;
+  aio->pending_len = 0;
+  aio->done = malloc(sizeof(struct aio_request) * depth);
+  aio->done_head = 0;
+  aio->done_len = 0;
+  aio->stop = false;
+  aio->thread_count = depth < HTAIO_MAX_THREADS ? depth : HTAIO_MAX_THREADS;
+  for (int i = 0; i < aio->thread_count; i++) {
+    pthread_create(&aio->threads[i], NULL, pool_main, aio);
+  }
+  return aio;
+}
+
+void htaio_destroy(struct htaio *aio) {
+  assert(aio);
+#ifdef HTAIO_HAVE_URING
+  if (aio->uring) {
+    uring_exit(&aio->ring);
+    free(aio);
+    return;
+  }
+#endif
+  pthread_mutex_lock(&aio->lock);
+  aio->stop = true;
+  pthread_cond_broadcast(&aio->submitted);
+  pthread_mutex_unlock(&aio->lock);
+  for (int i = 0; i < aio->thread_count; i++) {
+    pthread_join(aio->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&aio->lock);
+  pthread_cond_destroy(&aio->submitted);
+  pthread_cond_destroy(&aio->completed);
+  free(aio->pending);
+  free(aio->done);
+  free(aio);
+}
+
+void htaio_write(struct htaio *aio, const void *buf, size_t len, off_t offset,
+                 int tag) {
+  assert(aio);
+  assert(buf);
+#ifdef HTAIO_HAVE_URING
+  if (aio->uring) {
+    uring_submit(&aio->ring, true, (void *)buf, len, offset, tag);
+    return;
+  }
+#endif
+  pool_submit(aio, true, (void *)buf, len, offset, tag);
+}
+
+void htaio_read(struct htaio *aio, void *buf, size_t len, off_t offset, int tag) {
+  assert(aio);
+  assert(buf);
+#ifdef HTAIO_HAVE_URING
+  if (aio->uring) {
+    uring_submit(&aio->ring, false, buf, len, offset, tag);
+    return;
+  }
+#endif
+  pool_submit(aio, false, buf, len, offset, tag);
+}
+
+int htaio_wait(struct htaio *aio, long *result) {
+  assert(aio);
+  assert(result);
+#ifdef HTAIO_HAVE_URING
+  if (aio->uring) {
+    return uring_wait(&aio->ring, result);
+  }
+#endif
+  pthread_mutex_lock(&aio->lock);
+  while (aio->done_len == 0) {
+    pthread_cond_wait(&aio->completed, &aio->lock);
+  }
+  struct aio_request req = aio->done[aio->done_head];
+  aio->done_head = (aio->done_head + 1) % aio->depth;
+  aio->done_len--;
+  pthread_mutex_unlock(&aio->lock);
+  *result = req.result;
+  return req.tag;
+}
+
+bool htaio_uses_uring(const struct htaio *aio) {
+  assert(aio);
+  return aio->uring;
+}
+
+bool htaio_sync_dir(const char *path) {
+  assert(path);
+  const char *slash = strrchr(path, '/');
+  char *dir;
+  if (slash == NULL) {
+    dir = malloc(2);
+    strcpy(dir, ".");
+  } else {
+    const size_t len = slash == path ? 1 : slash - path;
+    dir = malloc(len + 1);
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+  }
+  const int fd = open(dir, O_RDONLY | O_DIRECTORY);
+  free(dir);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+#ifdef HTAIO_HAVE_URING
+// uring_init(r, fd, depth) is a helper function that sets up an io_uring
+//  instance for the file fd with at least depth entries and maps its rings
+//  into r. It returns false if io_uring is not available.
+// requires: r is a valid pointer
+// effects: creates a kernel object and mappings (released by uring_exit)
+// time: O(depth)
+static bool uring_init(struct aio_uring *r, int fd, int depth) {
+  assert(r);
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  r->ring_fd = syscall(__NR_io_uring_setup, depth, &p);
+  if (r->ring_fd < 0) {
+    return false;
+  }
+  if (!uring_probe(r->ring_fd)) {
+    close(r->ring_fd);
+    return false;
+  }
+
+  r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+  r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap && r->cq_size > r->sq_size) {
+    r->sq_size = r->cq_size;
+  }
+  r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING);
+  if (r->sq_ptr == MAP_FAILED) {
+    close(r->ring_fd);
+    return false;
+  }
+  r->cq_ptr = r->sq_ptr;
+  if (!single_mmap) {
+    r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING);
+    if (r->cq_ptr == MAP_FAILED) {
+      munmap(r->sq_ptr, r->sq_size);
+      close(r->ring_fd);
+      return false;
+    }
+  }
+  r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, r->ring_fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED) {
+    if (r->cq_ptr != r->sq_ptr) {
+      munmap(r->cq_ptr, r->cq_size);
+    }
+    munmap(r->sq_ptr, r->sq_size);
+    close(r->ring_fd);
+    return false;
+  }
+
+  char *sq = r->sq_ptr;
+  char *cq = r->cq_ptr;
+  r->sq_head = (_Atomic unsigned int *)(sq + p.sq_off.head);
+  r->sq_tail = (_Atomic unsigned int *)(sq + p.sq_off.tail);
+  r->sq_mask = *(unsigned int *)(sq + p.sq_off.ring_mask);
+  r->sq_array = (unsigned int *)(sq + p.sq_off.array);
+  r->cq_head = (_Atomic unsigned int *)(cq + p.cq_off.head);
+  r->cq_tail = (_Atomic unsigned int *)(cq + p.cq_off.tail);
+  r->cq_mask = *(unsigned int *)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  r->fd = fd;
+  r->slots = malloc(sizeof(struct aio_request) * p.sq_entries);
+  r->free_slots = malloc(sizeof(int) * p.sq_entries);
+  for (unsigned int i = 0; i < p.sq_entries; i++) {
+    r->free_slots[i] = p.sq_entries - 1 - i;
+  }
+  r->free_len = p.sq_entries;
+  r->failed = malloc(sizeof(struct aio_request) * p.sq_entries);
+  r->failed_len = 0;
+  return true;
+}
+
+// uring_probe(ring_fd) is a helper function that returns true if the
+//  io_uring instance ring_fd supports IORING_OP_READ and IORING_OP_WRITE.
+//  Kernels before 5.6 have neither the opcodes nor IORING_REGISTER_PROBE,
+//  so a failing probe means that they are missing.
+// effects: allocates and frees memory
+// time: O(1)
+static bool uring_probe(int ring_fd) {
+  const unsigned int ops = 256;
+  struct io_uring_probe *probe =
+      calloc(1, sizeof(struct io_uring_probe) + ops * sizeof(struct io_uring_probe_op));
+  bool ok = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe,
+                    ops) >= 0;
+  ok = ok && probe->last_op >= IORING_OP_READ && probe->last_op >= IORING_OP_WRITE &&
+       (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+       (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+  free(probe);
+  return ok;
+}
+
+// uring_exit(r) is a helper function that unmaps the rings of r and closes
+//  its io_uring instance
+// requires: r is a valid pointer
+// effects: invalidates r
+// time: O(1)
+static void uring_exit(struct aio_uring *r) {
+  assert(r);
+  munmap(r->sqes, r->sqes_size);
+  if (r->cq_ptr != r->sq_ptr) {
+    munmap(r->cq_ptr, r->cq_size);
+  }
+  munmap(r->sq_ptr, r->sq_size);
+  close(r->ring_fd);
+  free(r->slots);
+  free(r->free_slots);
+  free(r->failed);
+}
+
+// uring_submit(r, write, buf, len, offset, tag) is a helper function that
+//  queues a read or write request in a free slot and submits it to the
+//  kernel
+// requires: r and buf are valid pointers; a slot is free
+// effects: modifies r
+// time: O(1)
+static void uring_submit(struct aio_uring *r, bool write, void *buf, size_t len,
+                         off_t offset, int tag) {
+  assert(r);
+  assert(r->free_len > 0);
+  const int slot = r->free_slots[--r->free_len];
+  r->slots[slot] = (struct aio_request){write, buf, len, offset, tag, 0};
+  uring_queue(r, slot);
+  uring_enter(r, false);
+}
+
+// uring_queue(r, slot) is a helper function that puts an SQE for the part
+//  of the request in slot that has not been transferred yet (its result so
+//  far) into the submission ring of r
+// requires: r is a valid pointer; the submission ring is not full
+// effects: modifies r
+// time: O(1)
+static void uring_queue(struct aio_uring *r, int slot) {
+  assert(r);
+  const struct aio_request *req = &r->slots[slot];
+  const unsigned int tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+  const unsigned int index = tail & r->sq_mask;
+  struct io_uring_sqe *sqe = &r->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = req->write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = r->fd;
+  sqe->addr = (unsigned long)((char *)req->buf + req->result);
+  sqe->len = req->len - req->result;
+  sqe->off = req->offset + req->result;
+  sqe->user_data = (unsigned int)slot;
+  r->sq_array[index] = index;
+  atomic_store_explicit(r->sq_tail, tail + 1, memory_order_release);
+}
+
+// uring_wait(r, result) is a helper function that waits for a request of r
+//  to complete, stores its result in *result and returns its tag. Like the
+//  thread pool, it resubmits the rest of a short transfer, so a request
+//  only completes early at the end of the file or on an error (with the
+//  bytes transferred so far, or -errno if there are none).
+// requires: all pointers are valid; a request is in flight
+// effects: modifies r and *result
+// time: the time until a request completes
+static int uring_wait(struct aio_uring *r, long *result) {
+  assert(r);
+  assert(result);
+  for (;;) {
+    if (r->failed_len > 0) {
+      const struct aio_request req = r->failed[--r->failed_len];
+      *result = req.result;
+      return req.tag;
+    }
+    const unsigned int head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+    if (head == atomic_load_explicit(r->cq_tail, memory_order_acquire)) {
+      uring_enter(r, true);
+      continue;
+    }
+    const struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+    const int slot = (int)cqe->user_data;
+    const int res = cqe->res;
+    atomic_store_explicit(r->cq_head, head + 1, memory_order_release);
+
+    struct aio_request *req = &r->slots[slot];
+    if (res > 0) {
+      req->result += res;
+    }
+    if ((res > 0 && (size_t)req->result < req->len) || res == -EINTR) {
+      uring_queue(r, slot);                         // short transfer: go on
+      uring_enter(r, false);
+      continue;
+    }
+    *result = (res < 0 && req->result == 0) ? res : req->result;
+    r->free_slots[r->free_len++] = slot;
+    return req->tag;
+  }
+}
+
+// uring_enter(r, wait) is a helper function that submits the requests of r
+//  that the kernel has not taken yet and, if wait is true, waits for a
+//  completion. Transient errors (EINTR, EAGAIN, EBUSY) leave the requests
+//  queued, so they are submitted again by the next call; on any other
+//  error the requests are taken back from the ring and completed with
+//  -errno, or with the bytes that they transferred before (see
+//  uring_wait).
+// requires: r is a valid pointer
+// effects: modifies r
+// time: O(q) where q is the number of queued requests, plus the time until
+//  a request completes if wait is true
+static void uring_enter(struct aio_uring *r, bool wait) {
+  assert(r);
+  for (;;) {
+    const unsigned int tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+    const unsigned int head = atomic_load_explicit(r->sq_head, memory_order_acquire);
+    if (tail == head && !wait) {
+      return;
+    }
+    if (syscall(__NR_io_uring_enter, r->ring_fd, tail - head, wait ? 1 : 0,
+                wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0) >= 0) {
+      return;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EBUSY) {
+      // out of resources or completions: retry once some have been reaped
+      return;
+    }
+    // the kernel cannot take the requests: fail them
+    const long error = -errno;
+    for (unsigned int i = head; i != tail; i++) {
+      const struct io_uring_sqe *sqe = &r->sqes[r->sq_array[i & r->sq_mask]];
+      const int slot = (int)sqe->user_data;
+      struct aio_request req = r->slots[slot];
+      if (req.result == 0) {
+        req.result = error;
+      }
+      r->failed[r->failed_len++] = req;
+      r->free_slots[r->free_len++] = slot;
+    }
+    atomic_store_explicit(r->sq_tail, head, memory_order_release);
+    return;
+  }
+}
+#endif
+
+// pool_submit(aio, write, buf, len, offset, tag) is a helper function that
+//  queues a request for the thread pool of aio
+// requires: aio and buf are valid pointers; fewer than depth requests are
+//  in flight
+// effects: modifies aio
+// time: O(1)
+static void pool_submit(struct htaio *aio, bool write, void *buf, size_t len,
+                        off_t offset, int tag) {
+  assert(aio);
+  pthread_mutex_lock(&aio->lock);
+  assert(aio->pending_len < aio->depth);
+  const int i = (aio->pending_head + aio->pending_len) % aio->depth;
+  aio->pending[i] = (struct aio_request){write, buf, len, offset, tag, 0};
+  aio->pending_len++;
+  pthread_cond_signal(&aio->submitted);
+  pthread_mutex_unlock(&aio->lock);
+}
+
+// pool_main(arg) is the main function of the threads of the pool of the
+//  engine arg. A thread performs one request at a time; a write is retried
+//  until all bytes are written, a read until the end of the file.
+// effects: reads or writes the file of the engine
+// time: runs until htaio_destroy
+static void *pool_main(void *arg) {
+  struct htaio *aio = arg;
+  assert(aio);
+  pthread_mutex_lock(&aio->lock);
+  for (;;) {
+    while (aio->pending_len == 0 && !aio->stop) {
+      pthread_cond_wait(&aio->submitted, &aio->lock);
+    }
+    if (aio->pending_len == 0) {
+      break;
+    }
+    struct aio_request req = aio->pending[aio->pending_head];
+    aio->pending_head = (aio->pending_head + 1) % aio->depth;
+    aio->pending_len--;
+    pthread_mutex_unlock(&aio->lock);
+
+    size_t total = 0;
+    long error = 0;
+    while (total < req.len) {
+      ssize_t n = req.write
+                  ? pwrite(aio->fd, (char *)req.buf + total, req.len - total, req.offset + total)
+                  : pread(aio->fd, (char *)req.buf + total, req.len - total, req.offset + total);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        error = -errno;
+      }
+      if (n <= 0) {
+        break;
+      }
+      total += n;
+    }
+    req.result = (total == 0 && error != 0) ? error : (long)total;
+
+    pthread_mutex_lock(&aio->lock);
+    const int i = (aio->done_head + aio->done_len) % aio->depth;
+    aio->done[i] = req;
+    aio->done_len++;
+    pthread_cond_signal(&aio->completed);
+  }
+  pthread_mutex_unlock(&aio->lock);
+  return NULL;
+}
@@ -0,0 +1,69 @@
+// This is the interface of a small asynchronous file I/O engine that keeps
+//   several reads or writes of one file in flight. It uses io_uring when the
+//   kernel provides it and falls back to a pool of threads that call
+//   pread/pwrite otherwise.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// an asynchronous I/O engine for one file
+struct htaio;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htaio_create(fd, depth) creates an engine for the file descriptor fd that
+//   can have up to depth requests in flight.
+// effects: allocates heap memory and may start threads; client must call
+//          htaio_destroy
+// requires: depth must be positive
+// time: O(depth)
+struct htaio *htaio_create(int fd, int depth);
+
+// htaio_destroy(aio) frees all resources of aio (but does not close its
+//   file).
+// effects: invalidates aio
+// requires: no request of aio is in flight
+// time: O(depth)
+void htaio_destroy(struct htaio *aio);
+
+// htaio_write(aio, buf, len, offset, tag) starts writing the len bytes at
+//   buf to offset of the file of aio. The completion is reported by
+//   htaio_wait with tag.
+// effects: writes the file (asynchronously)
+// requires: fewer than depth requests of aio are in flight
+//           buf stays valid and unchanged until the request completes
+// time: O(1)
+void htaio_write(struct htaio *aio, const void *buf, size_t len, off_t offset,
+                 int tag);
+
+// htaio_read(aio, buf, len, offset, tag) starts reading up to len bytes at
+//   offset of the file of aio into buf. The completion is reported by
+//   htaio_wait with tag.
+// effects: modifies buf (asynchronously)
+// requires: fewer than depth requests of aio are in flight
+//           buf stays valid until the request completes
+// time: O(1)
+void htaio_read(struct htaio *aio, void *buf, size_t len, off_t offset, int tag);
+
+// htaio_wait(aio, result) waits for the completion of a request of aio,
+//   stores the number of bytes transferred (or -errno on failure) in
+//   *result and returns the tag of the request. Both backends transfer the
+//   whole length of a request, resubmitting the rest of a short transfer;
+//   fewer bytes are only reported if a read reaches the end of the file or
+//   an error occurs after some bytes have been transferred.
+// effects: modifies *result
+// requires: a request of aio is in flight
+// time: the time until a request completes
+int htaio_wait(struct htaio *aio, long *result);
+
+// htaio_uses_uring(aio) returns true if aio uses io_uring.
+// time: O(1)
+bool htaio_uses_uring(const struct htaio *aio);
+
+// htaio_sync_dir(path) syncs the directory that contains the file path, so
+//   that a file that has just been created or renamed to path survives a
+//   crash, and returns true on success.
+// effects: syncs a directory
+// time: O(len), where len is the length of path, plus one fsync
+bool htaio_sync_dir(const char *path);
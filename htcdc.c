@@ -0,0 +1,477 @@
+// This is the implementation of the change feed.
+//   The ring buffer has a single producer (the writer of the table, through
+//   the observer) and a single consumer (the replicator thread). Both only
+//   move forward: head is the number of bytes ever written, tail the number
+//   of bytes ever consumed, and position p is at offset p % ring_bytes. A
+//   record is
+//     u32 key_len, u32 op, u64 seq, key_len key bytes, padding to 8 bytes
+//   and never wraps around the end of the ring; if it does not fit, the
+//   producer fills the rest of the ring with a padding record (key_len
+//   0xffffffff) and starts at offset 0.
+//   The producer publishes a record by storing head with release order
+//   after writing it, and the consumer frees its space by storing tail with
+//   release order after reading it, so neither side takes a lock. A side
+//   that has to wait (the producer on a full ring, the consumer on an empty
+//   one) backs off with short sleeps.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "htcdc.h"
+#include "htserver.h"
+#include <assert.h>
+#include <stdbool.h>
+
+// the key_len of a padding record
+#define CDC_PAD 0xffffffffu
+// the length of a record header
+#define CDC_HEADER 16
+// the longest sleep of a waiting side (in nanoseconds)
+#define CDC_MAX_BACKOFF 1000000
+// the number of requests sent to a server before their responses are read
+//   (the responses must fit into the socket buffers)
+#define CDC_PIPELINE 1024
+
+struct htcdc {
+  struct hashtable *ht;
+  int (*key_encode)(const void *, void *, int);
+  unsigned char *ring;
+  uint64_t ring_bytes;
+  // written by the producer
+  _Atomic uint64_t head;
+  _Atomic uint64_t seq;                             // of the last change
+  uint64_t tail_seen;                               // last tail read by the producer
+  _Atomic bool failed;                              // a change could not be recorded
+  char pad[64];                                     // keeps head and tail in different cache lines
+  // written by the consumer
+  _Atomic uint64_t tail;
+};
+
+struct htcdc_replicator {
+  struct htcdc *feed;
+  uint64_t skip;                                    // changes up to skip are not applied
+  struct hashtable *follower;                       // NULL for a server
+  void *(*key_decode)(const void *, int);
+  void (*key_destroy)(void *);
+  int fd;                                           // connection to the server, or -1
+  char table[256];
+  int table_len;
+  unsigned char *requests;                          // requests to the server
+  size_t requests_cap;
+  _Atomic uint64_t applied;
+  _Atomic bool failed;
+  _Atomic bool stop;
+  pthread_t thread;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void record_change(void *ctx, int op, const void *key, int index);
+static void *replicator_main(void *arg);
+static struct htcdc_replicator *replicator_start(struct htcdc *feed, uint64_t seq);
+static bool consume(struct htcdc_replicator *r);
+static void apply_to_table(struct htcdc_replicator *r, int op,
+                           const unsigned char *key, uint32_t len);
+static size_t put_request(struct htcdc_replicator *r, size_t pos, uint64_t seq,
+                          int op, const unsigned char *key, uint32_t len);
+static bool send_requests(struct htcdc_replicator *r, size_t len, int n);
+static void backoff(long *ns);
+static bool has_failed(const struct htcdc_replicator *r);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htcdc *htcdc_create(struct hashtable *ht,
+                           int (*key_encode)(const void *, void *, int),
+                           int ring_bytes, uint64_t seq) {
+  assert(ht);
+  assert(key_encode);
+  assert(ring_bytes >= 4096 && (ring_bytes & (ring_bytes - 1)) == 0);
+
+  struct htcdc *feed = malloc(sizeof(struct htcdc));
+  feed->ht = ht;
+  feed->key_encode = key_encode;
+  feed->ring = malloc(ring_bytes);
+  feed->ring_bytes = ring_bytes;
+  atomic_init(&feed->head, 0);
+  atomic_init(&feed->seq, seq);
+  feed->tail_seen = 0;
+  atomic_init(&feed->failed, false);
+  atomic_init(&feed->tail, 0);
+  ht_observe(ht, record_change, feed);
+  return feed;
+}
+
+void htcdc_destroy(struct htcdc *feed) {
+  assert(feed);
+  ht_unobserve(feed->ht, record_change, feed);
+  free(feed->ring);
+  free(feed);
+}
+
+uint64_t htcdc_seq(const struct htcdc *feed) {
+  assert(feed);
+  return atomic_load_explicit(&feed->seq, memory_order_acquire);
+}
+
+struct htcdc_replicator *htcdc_replicate(struct htcdc *feed,
+                                         struct hashtable *follower,
+                                         uint64_t seq,
+                                         void *(*key_decode)(const void *, int),
+                                         void (*key_destroy)(void *)) {
+  assert(feed);
+  assert(follower);
+  assert(key_decode);
+  assert(key_destroy);
+  struct htcdc_replicator *r = replicator_start(feed, seq);
+  r->follower = follower;
+  r->key_decode = key_decode;
+  r->key_destroy = key_destroy;
+  pthread_create(&r->thread, NULL, replicator_main, r);
+  return r;
+}
+
+struct htcdc_replicator *htcdc_replicate_socket(struct htcdc *feed,
+                                                const char *path,
+                                                const char *table,
+                                                uint64_t seq) {
+  assert(feed);
+  assert(path);
+  assert(table);
+  assert(strlen(table) < 256);
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return NULL;
+  }
+  strcpy(addr.sun_path, path);
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return NULL;
+  }
+
+  struct htcdc_replicator *r = replicator_start(feed, seq);
+  r->fd = fd;
+  r->table_len = strlen(table);
+  memcpy(r->table, table, r->table_len);
+  pthread_create(&r->thread, NULL, replicator_main, r);
+  return r;
+}
+
+uint64_t htcdc_applied(const struct htcdc_replicator *r) {
+  assert(r);
+  return atomic_load_explicit(&r->applied, memory_order_acquire);
+}
+
+int htcdc_wait(struct htcdc_replicator *r, uint64_t seq) {
+  assert(r);
+  long ns = 0;
+  while (atomic_load_explicit(&r->applied, memory_order_acquire) < seq) {
+    if (has_failed(r)) {
+      return HT_IO_ERROR;
+    }
+    backoff(&ns);
+  }
+  return has_failed(r) ? HT_IO_ERROR : HT_SUCCESS;
+}
+
+int htcdc_stop(struct htcdc_replicator *r) {
+  assert(r);
+  atomic_store_explicit(&r->stop, true, memory_order_release);
+  pthread_join(r->thread, NULL);
+  const int result = has_failed(r) ? HT_IO_ERROR : HT_SUCCESS;
+  if (r->fd >= 0) {
+    close(r->fd);
+  }
+  free(r->requests);
+  free(r);
+  return result;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// record_change(ctx, op, key, index) is a helper function that is
+//  registered with ht_observe; it appends the change to the ring of the
+//  feed ctx, waiting for room if the ring is full. A change whose key is
+//  too long for the ring fails the feed, which stops recording.
+// requires: all pointers are valid
+// effects: modifies the feed ctx
+// time: O(en), plus the time to wait for room
+static void record_change(void *ctx, int op, const void *key, int index) {
+  (void)index;
+  struct htcdc *feed = ctx;
+  assert(feed);
+  assert(key);
+  const uint32_t len = feed->key_encode(key, feed->ring, 0);
+  if (atomic_load_explicit(&feed->failed, memory_order_relaxed) ||
+      len >= feed->ring_bytes / 4) {
+    // the change is lost, so no follower can be kept in step any more
+    atomic_store_explicit(&feed->failed, true, memory_order_release);
+    return;
+  }
+  const uint64_t rec = (CDC_HEADER + len + 7) & ~(uint64_t)7;
+
+  uint64_t pos = atomic_load_explicit(&feed->head, memory_order_relaxed);
+  uint64_t offset = pos & (feed->ring_bytes - 1);
+  const uint64_t skip = offset + rec > feed->ring_bytes ? feed->ring_bytes - offset : 0;
+  long ns = 0;
+  while (pos + skip + rec - feed->tail_seen > feed->ring_bytes) {
+    feed->tail_seen = atomic_load_explicit(&feed->tail, memory_order_acquire);
+    if (pos + skip + rec - feed->tail_seen > feed->ring_bytes) {
+      backoff(&ns);
+    }
+  }
+  if (skip > 0) {
+    const uint32_t pad = CDC_PAD;
+    memcpy(feed->ring + offset, &pad, sizeof(pad));
+    pos += skip;
+    offset = 0;
+  }
+
+  unsigned char *p = feed->ring + offset;
+  const uint32_t op32 = op;
+  const uint64_t seq = atomic_load_explicit(&feed->seq, memory_order_relaxed) + 1;
+  memcpy(p, &len, sizeof(len));
+  memcpy(p + 4, &op32, sizeof(op32));
+  memcpy(p + 8, &seq, sizeof(seq));
+  feed->key_encode(key, p + CDC_HEADER, len);
+  atomic_store_explicit(&feed->seq, seq, memory_order_release);
+  atomic_store_explicit(&feed->head, pos + rec, memory_order_release);
+}
+
+// replicator_main(arg) is the main function of the replicator thread of
+//  arg. It applies changes until it is stopped and the ring is empty.
+// effects: modifies the follower of the replicator
+// time: O(c * t) where c is the number of changes and t the time to apply
+//  one
+static void *replicator_main(void *arg) {
+  struct htcdc_replicator *r = arg;
+  assert(r);
+  long ns = 0;
+  for (;;) {
+    // read stop before the ring, so no change recorded before htcdc_stop
+    //  is left behind
+    const bool stop = atomic_load_explicit(&r->stop, memory_order_acquire);
+    if (consume(r)) {
+      ns = 0;
+    } else if (stop) {
+      return NULL;
+    } else {
+      backoff(&ns);
+    }
+  }
+}
+
+// replicator_start(feed, seq) is a helper function that returns a new
+//  replicator for feed that skips the changes up to seq; the caller sets
+//  its follower and starts its thread
+// requires: feed is a valid pointer
+// effects: allocates memory (freed by htcdc_stop)
+// time: O(1)
+static struct htcdc_replicator *replicator_start(struct htcdc *feed, uint64_t seq) {
+  assert(feed);
+  struct htcdc_replicator *r = calloc(1, sizeof(struct htcdc_replicator));
+  r->feed = feed;
+  r->skip = seq;
+  r->fd = -1;
+  atomic_init(&r->applied, seq);
+  atomic_init(&r->failed, false);
+  atomic_init(&r->stop, false);
+  return r;
+}
+
+// consume(r) is a helper function that applies all changes in the ring of
+//  the feed of r and frees their space. It returns false if the ring was
+//  empty.
+// requires: r is a valid pointer; called by the replicator thread
+// effects: modifies r, its feed and its follower
+// time: O(c * t) where c is the number of changes and t the time to apply
+//  one
+static bool consume(struct htcdc_replicator *r) {
+  assert(r);
+  struct htcdc *feed = r->feed;
+  const uint64_t head = atomic_load_explicit(&feed->head, memory_order_acquire);
+  uint64_t tail = atomic_load_explicit(&feed->tail, memory_order_relaxed);
+  if (tail == head) {
+    return false;
+  }
+
+  uint64_t last = 0;
+  size_t pos = 0;
+  int n = 0;
+  while (tail < head) {
+    const uint64_t offset = tail & (feed->ring_bytes - 1);
+    const unsigned char *p = feed->ring + offset;
+    uint32_t len;
+    uint32_t op;
+    memcpy(&len, p, sizeof(len));
+    if (len == CDC_PAD) {
+      tail += feed->ring_bytes - offset;
+      continue;
+    }
+    memcpy(&op, p + 4, sizeof(op));
+    memcpy(&last, p + 8, sizeof(last));
+    if (last > r->skip && !atomic_load_explicit(&r->failed, memory_order_relaxed)) {
+      if (r->follower) {
+        apply_to_table(r, op, p + CDC_HEADER, len);
+      } else {
+        pos = put_request(r, pos, last, op, p + CDC_HEADER, len);
+        if (++n == CDC_PIPELINE) {
+          if (!send_requests(r, pos, n)) {
+            atomic_store_explicit(&r->failed, true, memory_order_release);
+          }
+          pos = 0;
+          n = 0;
+        }
+      }
+    }
+    tail += (CDC_HEADER + len + 7) & ~(uint64_t)7;
+  }
+  // the requests hold copies of the keys, so the ring space can be reused
+  atomic_store_explicit(&feed->tail, tail, memory_order_release);
+
+  if (n > 0 && !send_requests(r, pos, n)) {
+    atomic_store_explicit(&r->failed, true, memory_order_release);
+  }
+  if (!atomic_load_explicit(&r->failed, memory_order_relaxed) &&
+      last > atomic_load_explicit(&r->applied, memory_order_relaxed)) {
+    atomic_store_explicit(&r->applied, last, memory_order_release);
+  }
+  return true;
+}
+
+// apply_to_table(r, op, key, len) is a helper function that applies the
+//  change op of the key encoded in the len bytes at key to the follower
+//  table of r
+// requires: all pointers are valid
+// effects: modifies the follower of r
+// time: O(de + ht_insert) or O(de + ht_remove)
+static void apply_to_table(struct htcdc_replicator *r, int op,
+                           const unsigned char *key, uint32_t len) {
+  assert(r);
+  assert(key);
+  void *decoded = r->key_decode(key, len);
+  if (op == HT_OP_INSERT) {
+    ht_adopt(r->follower, decoded);
+  } else {
+    ht_remove(r->follower, decoded);
+    r->key_destroy(decoded);
+  }
+}
+
+// put_request(r, pos, seq, op, key, len) is a helper function that writes
+//  the request for the change op of the key encoded in the len bytes at
+//  key to the request buffer of r at pos and returns the end of the
+//  request
+// requires: all pointers are valid
+// effects: modifies the request buffer of r
+// time: O(len) amortized
+static size_t put_request(struct htcdc_replicator *r, size_t pos, uint64_t seq,
+                          int op, const unsigned char *key, uint32_t len) {
+  assert(r);
+  assert(key);
+  const size_t size = HTS_HEADER_LEN + r->table_len + sizeof(uint32_t) + len;
+  if (pos + size > r->requests_cap) {
+    r->requests_cap = 2 * (pos + size);
+    r->requests = realloc(r->requests, r->requests_cap);
+  }
+  unsigned char *p = r->requests + pos;
+  const uint32_t body_len = size - sizeof(uint32_t);
+  const uint32_t id = seq;
+  const uint16_t count = 1;
+  memcpy(p, &body_len, sizeof(body_len));
+  memcpy(p + 4, &id, sizeof(id));
+  p[8] = op == HT_OP_INSERT ? HTS_OP_INSERT : HTS_OP_REMOVE;
+  p[9] = r->table_len;
+  memcpy(p + 10, &count, sizeof(count));
+  memcpy(p + HTS_HEADER_LEN, r->table, r->table_len);
+  p += HTS_HEADER_LEN + r->table_len;
+  memcpy(p, &len, sizeof(len));
+  memcpy(p + sizeof(len), key, len);
+  return pos + size;
+}
+
+// send_requests(r, len, n) is a helper function that sends the n requests
+//  in the first len bytes of the request buffer of r to the server and
+//  reads their responses. The requests are pipelined, so the server
+//  serves them as batches. It returns false if the server failed.
+// requires: r is a valid pointer
+// effects: writes and reads the connection of r
+// time: O(len)
+static bool send_requests(struct htcdc_replicator *r, size_t len, int n) {
+  assert(r);
+  size_t sent = 0;
+  while (sent < len) {
+    const ssize_t k = send(r->fd, r->requests + sent, len - sent, MSG_NOSIGNAL);
+    if (k < 0 && errno == EINTR) {
+      continue;
+    }
+    if (k <= 0) {
+      return false;
+    }
+    sent += k;
+  }
+
+  // every response to a request with one key has the same length
+  unsigned char response[HTS_HEADER_LEN + 1];
+  for (int i = 0; i < n; i++) {
+    size_t got = 0;
+    while (got < sizeof(response)) {
+      const ssize_t k = recv(r->fd, response + got, sizeof(response) - got, 0);
+      if (k < 0 && errno == EINTR) {
+        continue;
+      }
+      if (k <= 0) {
+        return false;
+      }
+      got += k;
+    }
+    if (response[8] != HTS_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// backoff(ns) is a helper function that sleeps a little longer each time it
+//  is called with the same *ns (start with 0): it yields the processor at
+//  first, then sleeps up to CDC_MAX_BACKOFF nanoseconds
+// requires: ns is a valid pointer
+// effects: modifies *ns
+// time: O(*ns)
+static void backoff(long *ns) {
+  assert(ns);
+  if (*ns < 1000) {
+    *ns += 100;
+    sched_yield();
+    return;
+  }
+  struct timespec ts = {0, *ns};
+  nanosleep(&ts, NULL);
+  *ns = *ns * 2 > CDC_MAX_BACKOFF ? CDC_MAX_BACKOFF : *ns * 2;
+}
+
+// has_failed(r) is a helper function that returns true if r or its feed
+//  has failed
+// requires: r is a valid pointer
+// time: O(1)
+static bool has_failed(const struct htcdc_replicator *r) {
+  assert(r);
+  return atomic_load_explicit(&r->failed, memory_order_acquire) ||
+         atomic_load_explicit(&r->feed->failed, memory_order_acquire);
+}
@@ -0,0 +1,101 @@
+// This is the interface of a change feed (change data capture) for generic
+//   hash tables. A feed observes a primary table and records every
+//   insertion and removal, with its key encoded by a key_encode connector
+//   (see htsnapshot.h), in a lock-free ring buffer. A replicator consumes
+//   the feed on its own thread and applies the changes to a follower: a
+//   table in the same process, or a table of an htserver (see htserver.h)
+//   reached through its Unix domain socket.
+//   Every change has a sequence number, one more than the previous change.
+//   A follower that starts from a snapshot of the primary saved with the
+//   sequence number of the feed at that time as its LSN (see htsnapshot.h)
+//   resumes by skipping the changes up to that number.
+
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// a change feed
+struct htcdc;
+
+// a replicator that applies a feed to a follower
+struct htcdc_replicator;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htcdc_create(ht, key_encode, ring_bytes, seq) creates a feed of the
+//   changes of ht with a ring buffer of ring_bytes bytes; the first change
+//   gets the sequence number seq + 1. When the ring buffer is full, the
+//   writer of ht waits for the replicator. A change whose encoded key is
+//   not shorter than ring_bytes / 4 cannot be recorded: the feed fails,
+//   records no further changes, and its replicators report HT_IO_ERROR.
+// effects: allocates heap memory and registers an observer with ht; client
+//          must call htcdc_destroy
+// requires: ring_bytes is a power of 2 and at least 4096
+//           ht is modified by one thread at a time
+// time: O(ring_bytes)
+struct htcdc *htcdc_create(struct hashtable *ht,
+                           int (*key_encode)(const void *, void *, int),
+                           int ring_bytes, uint64_t seq);
+
+// htcdc_destroy(feed) stops recording and frees all resources of feed.
+// effects: invalidates feed; modifies the table of feed
+// requires: no replicator of feed is running
+// time: O(o), where o is the number of observers of the table
+void htcdc_destroy(struct htcdc *feed);
+
+// htcdc_seq(feed) returns the sequence number of the last change recorded
+//   by feed.
+// time: O(1)
+uint64_t htcdc_seq(const struct htcdc *feed);
+
+// htcdc_replicate(feed, follower, seq, key_decode, key_destroy) starts a
+//   replicator that applies the changes of feed after the sequence number
+//   seq to the table follower.
+// effects: allocates heap memory and starts a thread; client must call
+//          htcdc_stop
+// requires: feed has no other running replicator
+//           follower is only modified by the replicator while it runs
+// time: O(1)
+struct htcdc_replicator *htcdc_replicate(struct htcdc *feed,
+                                         struct hashtable *follower,
+                                         uint64_t seq,
+                                         void *(*key_decode)(const void *, int),
+                                         void (*key_destroy)(void *));
+
+// htcdc_replicate_socket(feed, path, table, seq) starts a replicator that
+//   applies the changes of feed after the sequence number seq to the table
+//   named table of the htserver listening on the Unix domain socket path.
+//   Keys are sent as their encodings. The function returns NULL if it
+//   cannot connect to the server.
+// effects: allocates heap memory, connects to path and starts a thread;
+//          client must call htcdc_stop
+// requires: feed has no other running replicator
+//           table is at most 255 bytes long
+// time: O(1)
+struct htcdc_replicator *htcdc_replicate_socket(struct htcdc *feed,
+                                                const char *path,
+                                                const char *table,
+                                                uint64_t seq);
+
+// htcdc_applied(r) returns the sequence number of the last change that r
+//   has applied (or skipped).
+// time: O(1)
+uint64_t htcdc_applied(const struct htcdc_replicator *r);
+
+// htcdc_wait(r, seq) waits until r has applied the change with sequence
+//   number seq or has failed. The function returns
+//   * HT_SUCCESS if the change has been applied, or
+//   * HT_IO_ERROR if r has failed (the server could not be reached) or
+//     its feed has failed (a key was too long for the ring).
+// requires: seq <= htcdc_seq of the feed of r
+// time: the time until r has applied the change
+int htcdc_wait(struct htcdc_replicator *r, uint64_t seq);
+
+// htcdc_stop(r) applies the remaining recorded changes, stops r and frees
+//   its resources. The function returns
+//   * HT_SUCCESS if all changes have been applied, or
+//   * HT_IO_ERROR if r has failed.
+// effects: invalidates r
+// requires: the table of the feed of r is not modified during the call
+// time: the time to apply the remaining changes
+int htcdc_stop(struct htcdc_replicator *r);
@@ -0,0 +1,277 @@
+// This is the implementation of the background checkpointer.
+//   Every bucket has a mark: the number of the last checkpoint that has
+//   captured it. A checkpoint starts by taking all bucket locks and moving
+//   to a new number, which defines the point in time of the snapshot. After
+//   that, a bucket is captured exactly once, under its lock, either by the
+//   checkpoint thread as it walks the table or by a writer just before the
+//   bucket changes. Captured sections are queued and written by the
+//   checkpoint thread after it has released the bucket locks.
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "htcheckpoint.h"
+#include <assert.h>
+
+// number of locks shared by the buckets (must be a power of 2)
+#define CKPT_LOCK_STRIPES 64
+
+// a captured bucket section that has not been written yet
+struct ckpt_section {
+  void *data;
+  size_t len;
+  struct ckpt_section *next;
+};
+
+struct htckpt {
+  struct hashtable *ht;
+  int (*key_encode)(const void *, void *, int);
+  int ht_len;                                       // number of buckets
+  pthread_mutex_t locks[CKPT_LOCK_STRIPES];         // bucket i uses lock i % CKPT_LOCK_STRIPES
+  unsigned int *marks;                              // checkpoint that captured each bucket
+  unsigned int epoch;                               // number of the current checkpoint
+  bool running;                                     // written under all bucket locks
+  struct ht_snapwriter *writer;
+  uint64_t lsn;                                     // of the running checkpoint
+  pthread_t thread;
+  pthread_mutex_t queue_lock;                       // protects queue, result and saved_lsn
+  struct ckpt_section *queue;                       // captured sections
+  bool started;                                     // thread has to be joined
+  int result;                                       // of the last checkpoint
+  uint64_t saved_lsn;                               // of the last successful checkpoint
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void *checkpoint_main(void *arg);
+static void capture_bucket(struct htckpt *cp, int index);
+static void drain_queue(struct htckpt *cp);
+static int hash_length_of(int ht_len);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htckpt *htckpt_create(struct hashtable *ht,
+                             int (*key_encode)(const void *, void *, int)) {
+  assert(ht);
+  assert(key_encode);
+
+  struct htckpt *cp = malloc(sizeof(struct htckpt));
+  cp->ht = ht;
+  cp->key_encode = key_encode;
+  cp->ht_len = ht_length(ht);
+  for (int i = 0; i < CKPT_LOCK_STRIPES; i++) {
+    pthread_mutex_init(&cp->locks[i], NULL);
+  }
+  cp->marks = malloc(sizeof(unsigned int) * cp->ht_len);
+  for (int i = 0; i < cp->ht_len; i++) {
+    cp->marks[i] = 0;
+  }
+  cp->epoch = 0;
+  cp->running = false;
+  cp->writer = NULL;
+  cp->lsn = 0;
+  pthread_mutex_init(&cp->queue_lock, NULL);
+  cp->queue = NULL;
+  cp->started = false;
+  cp->result = HT_SUCCESS;
+  cp->saved_lsn = 0;
+  return cp;
+}
+
+void htckpt_destroy(struct htckpt *cp) {
+  assert(cp);
+  htckpt_wait(cp);
+  for (int i = 0; i < CKPT_LOCK_STRIPES; i++) {
+    pthread_mutex_destroy(&cp->locks[i]);
+  }
+  pthread_mutex_destroy(&cp->queue_lock);
+  free(cp->marks);
+  free(cp);
+}
+
+int htckpt_insert(struct htckpt *cp, const void *key) {
+  assert(cp);
+  assert(key);
+  const int index = ht_index(cp->ht, key);
+  pthread_mutex_t *lock = &cp->locks[index & (CKPT_LOCK_STRIPES - 1)];
+
+  pthread_mutex_lock(lock);
+  if (cp->running && cp->marks[index] != cp->epoch) {
+    capture_bucket(cp, index);
+  }
+  const int result = ht_insert(cp->ht, key);
+  pthread_mutex_unlock(lock);
+  return result;
+}
+
+int htckpt_remove(struct htckpt *cp, const void *key) {
+  assert(cp);
+  assert(key);
+  const int index = ht_index(cp->ht, key);
+  pthread_mutex_t *lock = &cp->locks[index & (CKPT_LOCK_STRIPES - 1)];
+
+  pthread_mutex_lock(lock);
+  if (cp->running && cp->marks[index] != cp->epoch) {
+    capture_bucket(cp, index);
+  }
+  const int result = ht_remove(cp->ht, key);
+  pthread_mutex_unlock(lock);
+  return result;
+}
+
+int htckpt_start(struct htckpt *cp, const char *path, struct htwal *wal) {
+  assert(cp);
+  assert(path);
+  assert(!htckpt_running(cp));
+  htckpt_wait(cp);
+
+  // stop all writers for a moment to fix the point in time of the snapshot
+  for (int i = 0; i < CKPT_LOCK_STRIPES; i++) {
+    pthread_mutex_lock(&cp->locks[i]);
+  }
+  const uint64_t lsn = wal ? htwal_lsn(wal) : 0;
+  cp->writer = ht_snapwriter_open(path, hash_length_of(cp->ht_len), lsn);
+  if (cp->writer) {
+    cp->lsn = lsn;
+    cp->epoch++;
+    cp->running = true;
+  }
+  for (int i = CKPT_LOCK_STRIPES - 1; i >= 0; i--) {
+    pthread_mutex_unlock(&cp->locks[i]);
+  }
+  if (cp->writer == NULL) {
+    return HT_IO_ERROR;
+  }
+
+  cp->started = true;
+  pthread_create(&cp->thread, NULL, checkpoint_main, cp);
+  return HT_SUCCESS;
+}
+
+int htckpt_wait(struct htckpt *cp) {
+  assert(cp);
+  if (cp->started) {
+    pthread_join(cp->thread, NULL);
+    cp->started = false;
+  }
+  pthread_mutex_lock(&cp->queue_lock);
+  const int result = cp->result;
+  pthread_mutex_unlock(&cp->queue_lock);
+  return result;
+}
+
+uint64_t htckpt_lsn(struct htckpt *cp) {
+  assert(cp);
+  pthread_mutex_lock(&cp->queue_lock);
+  const uint64_t lsn = cp->saved_lsn;
+  pthread_mutex_unlock(&cp->queue_lock);
+  return lsn;
+}
+
+bool htckpt_running(struct htckpt *cp) {
+  assert(cp);
+  pthread_mutex_lock(&cp->locks[0]);
+  const bool running = cp->running;
+  pthread_mutex_unlock(&cp->locks[0]);
+  return running;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// checkpoint_main(arg) is the main function of the checkpoint thread of
+//  the checkpointer arg. It captures every bucket that writers have not
+//  captured yet, writes all captured sections and commits the snapshot.
+// effects: writes the snapshot file; modifies the checkpointer
+// time: O(n + m * en) where n is the length and m the number of items of
+//  the table
+static void *checkpoint_main(void *arg) {
+  struct htckpt *cp = arg;
+  assert(cp);
+  for (int i = 0; i < cp->ht_len; i++) {
+    pthread_mutex_t *lock = &cp->locks[i & (CKPT_LOCK_STRIPES - 1)];
+    pthread_mutex_lock(lock);
+    if (cp->marks[i] != cp->epoch) {
+      capture_bucket(cp, i);
+    }
+    pthread_mutex_unlock(lock);
+    drain_queue(cp);
+  }
+  // every bucket is captured now, so no more sections are queued
+  drain_queue(cp);
+
+  for (int i = 0; i < CKPT_LOCK_STRIPES; i++) {
+    pthread_mutex_lock(&cp->locks[i]);
+  }
+  cp->running = false;
+  for (int i = CKPT_LOCK_STRIPES - 1; i >= 0; i--) {
+    pthread_mutex_unlock(&cp->locks[i]);
+  }
+
+  const int result = ht_snapwriter_commit(cp->writer);
+  cp->writer = NULL;
+  pthread_mutex_lock(&cp->queue_lock);
+  cp->result = result;
+  if (result == HT_SUCCESS) {
+    cp->saved_lsn = cp->lsn;
+  }
+  pthread_mutex_unlock(&cp->queue_lock);
+  return NULL;
+}
+
+// capture_bucket(cp, index) is a helper function that encodes the current
+//  content of the bucket index for the running checkpoint, queues it for
+//  the checkpoint thread and marks the bucket as captured. The file is
+//  never written under a bucket lock.
+// requires: cp is a valid pointer; the caller holds the lock of the bucket
+// effects: allocates memory; modifies cp
+// time: O(m * en) where m is the number of items in the bucket
+static void capture_bucket(struct htckpt *cp, int index) {
+  assert(cp);
+  size_t len = 0;
+  void *data = ht_snapshot_encode_bucket(cp->ht, index, cp->key_encode, &len);
+  cp->marks[index] = cp->epoch;
+  if (data == NULL) {
+    return;
+  }
+  struct ckpt_section *s = malloc(sizeof(struct ckpt_section));
+  s->data = data;
+  s->len = len;
+  pthread_mutex_lock(&cp->queue_lock);
+  s->next = cp->queue;
+  cp->queue = s;
+  pthread_mutex_unlock(&cp->queue_lock);
+}
+
+// drain_queue(cp) is a helper function that writes and frees all queued
+//  sections
+// requires: cp is a valid pointer; called by the checkpoint thread
+// effects: writes the snapshot file; modifies cp
+// time: O(q) where q is the total size of the queued sections
+static void drain_queue(struct htckpt *cp) {
+  assert(cp);
+  pthread_mutex_lock(&cp->queue_lock);
+  struct ckpt_section *s = cp->queue;
+  cp->queue = NULL;
+  pthread_mutex_unlock(&cp->queue_lock);
+
+  while (s) {
+    struct ckpt_section *next = s->next;
+    ht_snapwriter_add(cp->writer, s->data, s->len);
+    free(s->data);
+    free(s);
+    s = next;
+  }
+}
+
+// hash_length_of(ht_len) is a helper function that returns the base-2
+//  logarithm of ht_len
+// requires: ht_len is a power of 2
+// time: O(log ht_len)
+static int hash_length_of(int ht_len) {
+  int len = 0;
+  for (int n = ht_len; n > 1; n /= 2) {
+    len++;
+  }
+  return len;
+}
@@ -0,0 +1,75 @@
+// This is the interface of a background checkpointer for generic hash
+//   tables. A checkpoint writes a consistent snapshot (see htsnapshot.h) of
+//   a table from a background thread, bucket by bucket, while writers keep
+//   running: a writer that is about to change a bucket that the checkpoint
+//   has not captured yet first captures the old content of that bucket
+//   (copy-on-write), so the snapshot shows the table exactly as it was when
+//   the checkpoint started.
+//   Writers must go through htckpt_insert and htckpt_remove, which take a
+//   lock per bucket; this also makes them safe to call from several
+//   threads.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+#include "htwal.h"
+
+// a checkpointer of a hash table
+struct htckpt;
+
+// requires: all functions require valid (non-NULL) parameters, unless
+//           stated otherwise
+
+// htckpt_create(ht, key_encode) creates a checkpointer for ht.
+// effects: allocates heap memory; client must call htckpt_destroy
+// time: O(n), where n is the length of ht
+struct htckpt *htckpt_create(struct hashtable *ht,
+                             int (*key_encode)(const void *, void *, int));
+
+// htckpt_destroy(cp) waits for the running checkpoint of cp (if any) and
+//   frees all resources of cp.
+// effects: invalidates cp
+// time: O(1) plus the time to finish the running checkpoint
+void htckpt_destroy(struct htckpt *cp);
+
+// htckpt_insert(cp, key) inserts key into the table of cp (see ht_insert).
+// effects: modifies the table of cp
+// time: O(cl + m * co + hf), plus O(m * en) once per bucket and checkpoint
+int htckpt_insert(struct htckpt *cp, const void *key);
+
+// htckpt_remove(cp, key) removes key from the table of cp (see ht_remove).
+// effects: modifies the table of cp
+// time: O(ds + hf + m * co), plus O(m * en) once per bucket and checkpoint
+int htckpt_remove(struct htckpt *cp, const void *key);
+
+// htckpt_start(cp, path, wal) starts a checkpoint of the table of cp to the
+//   snapshot file path in a background thread. If wal is not NULL, the
+//   snapshot records the LSN of the last record of wal at the start of the
+//   checkpoint, so that it can be combined with the later records of wal by
+//   ht_recover. The function returns
+//   * HT_SUCCESS if the checkpoint has been started, or
+//   * HT_IO_ERROR if the snapshot file cannot be created.
+// effects: starts a thread; modifies cp
+// requires: no checkpoint of cp is running; if wal is not NULL, it is
+//           attached to the table of cp
+// time: O(s), where s is the number of bucket locks (writers pause briefly)
+int htckpt_start(struct htckpt *cp, const char *path, struct htwal *wal);
+
+// htckpt_wait(cp) waits until the last checkpoint started on cp is finished
+//   and returns its result:
+//   * HT_SUCCESS if the snapshot has been written, or
+//   * HT_IO_ERROR if it could not be written.
+// time: the remaining time of the checkpoint
+int htckpt_wait(struct htckpt *cp);
+
+// htckpt_lsn(cp) returns the LSN of the last checkpoint of cp that has
+//   been written successfully (0 if there is none). That snapshot is
+//   durable, so the records of the log up to this LSN can be discarded
+//   with htwal_truncate.
+// time: O(1)
+uint64_t htckpt_lsn(struct htckpt *cp);
+
+// htckpt_running(cp) returns true if a checkpoint of cp is running.
+// time: O(1)
+bool htckpt_running(struct htckpt *cp);
@@ -0,0 +1,294 @@
+// This is the implementation of the cuckoo filter (Fan et al.).
+//   The filter has a power-of-2 number of buckets of 4 slots; a slot holds a
+//   16-bit fingerprint of a key, or 0 if it is free. A key with hash h has
+//   the fingerprint f (16 bits of h, never 0) and two candidate buckets,
+//   i1 = h mod n and i2 = i1 xor hash(f) mod n; i1 can be computed from i2
+//   and f in the same way, so fingerprints can be moved between their
+//   buckets without knowing their keys. An insertion into two full buckets
+//   evicts a random fingerprint to its other bucket, and so on. If that
+//   does not end after CUCKOO_MAX_KICKS moves, the filter doubles and is
+//   rebuilt from the table.
+//   Export format (host byte order):
+//     "HTCUCKOO", u32 buckets, u32 count, buckets * 4 u16 fingerprints
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "htcuckoo.h"
+#include <assert.h>
+
+// the number of slots of a bucket
+#define CUCKOO_SLOTS 4
+// the number of evictions before an insertion gives up
+#define CUCKOO_MAX_KICKS 500
+
+static const char CUCKOO_MAGIC[8] = {'H', 'T', 'C', 'U', 'C', 'K', 'O', 'O'};
+
+struct htcuckoo {
+  struct hashtable *ht;                             // NULL for an imported filter
+  int (*key_encode)(const void *, void *, int);
+  uint32_t buckets;                                 // a power of 2
+  uint16_t *slots;                                  // buckets * CUCKOO_SLOTS fingerprints
+  int count;
+  uint32_t random;                                  // state of the eviction choice
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void cuckoo_observer(void *ctx, int op, const void *key, int index);
+static void rebuild(struct htcuckoo *f, uint32_t buckets);
+static void rebuild_key(void *ctx, const void *key);
+static bool insert_hash(struct htcuckoo *f, uint64_t h);
+static bool remove_hash(struct htcuckoo *f, uint64_t h);
+static bool bucket_put(struct htcuckoo *f, uint32_t bucket, uint16_t fp);
+static bool bucket_has(const struct htcuckoo *f, uint32_t bucket, uint16_t fp);
+static uint32_t alt_bucket(const struct htcuckoo *f, uint32_t bucket, uint16_t fp);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htcuckoo *htcuckoo_create(struct hashtable *ht,
+                                 int (*key_encode)(const void *, void *, int),
+                                 int capacity) {
+  assert(ht);
+  assert(key_encode);
+  assert(capacity > 0);
+  struct htcuckoo *f = malloc(sizeof(struct htcuckoo));
+  f->ht = ht;
+  f->key_encode = key_encode;
+  f->slots = NULL;
+  f->random = 0x9e3779b9;
+  // aim for a load of at most 90% at capacity
+  uint32_t buckets = 1;
+  while ((double)buckets * CUCKOO_SLOTS * 0.9 < capacity) {
+    buckets *= 2;
+  }
+  rebuild(f, buckets);
+  ht_observe(ht, cuckoo_observer, f);
+  return f;
+}
+
+void htcuckoo_destroy(struct htcuckoo *f) {
+  assert(f);
+  if (f->ht) {
+    ht_unobserve(f->ht, cuckoo_observer, f);
+  }
+  free(f->slots);
+  free(f);
+}
+
+bool htcuckoo_contains(const struct htcuckoo *f, const void *key) {
+  assert(f);
+  assert(key);
+  const uint64_t h = ht_key_hash64(key, f->key_encode);
+  const uint16_t fp = (h >> 32) & 0xffff ? (h >> 32) & 0xffff : 1;
+  const uint32_t i1 = h & (f->buckets - 1);
+  return bucket_has(f, i1, fp) || bucket_has(f, alt_bucket(f, i1, fp), fp);
+}
+
+int htcuckoo_count(const struct htcuckoo *f) {
+  assert(f);
+  return f->count;
+}
+
+void *htcuckoo_export(const struct htcuckoo *f, size_t *len) {
+  assert(f);
+  assert(len);
+  const size_t slots_len = sizeof(uint16_t) * f->buckets * CUCKOO_SLOTS;
+  *len = sizeof(CUCKOO_MAGIC) + 2 * sizeof(uint32_t) + slots_len;
+  unsigned char *data = malloc(*len);
+  unsigned char *p = data;
+  const uint32_t count = f->count;
+  memcpy(p, CUCKOO_MAGIC, sizeof(CUCKOO_MAGIC));
+  p += sizeof(CUCKOO_MAGIC);
+  memcpy(p, &f->buckets, sizeof(uint32_t));
+  memcpy(p + sizeof(uint32_t), &count, sizeof(uint32_t));
+  p += 2 * sizeof(uint32_t);
+  memcpy(p, f->slots, slots_len);
+  return data;
+}
+
+struct htcuckoo *htcuckoo_import(const void *data, size_t len,
+                                 int (*key_encode)(const void *, void *, int)) {
+  assert(data);
+  assert(key_encode);
+  const unsigned char *p = data;
+  const size_t header = sizeof(CUCKOO_MAGIC) + 2 * sizeof(uint32_t);
+  uint32_t buckets;
+  uint32_t count;
+  if (len < header || memcmp(p, CUCKOO_MAGIC, sizeof(CUCKOO_MAGIC)) != 0) {
+    return NULL;
+  }
+  memcpy(&buckets, p + sizeof(CUCKOO_MAGIC), sizeof(uint32_t));
+  memcpy(&count, p + sizeof(CUCKOO_MAGIC) + sizeof(uint32_t), sizeof(uint32_t));
+  if (buckets == 0 || (buckets & (buckets - 1)) != 0 ||
+      (len - header) / (sizeof(uint16_t) * CUCKOO_SLOTS) != buckets ||
+      (len - header) % (sizeof(uint16_t) * CUCKOO_SLOTS) != 0) {
+    return NULL;
+  }
+  struct htcuckoo *f = malloc(sizeof(struct htcuckoo));
+  f->ht = NULL;
+  f->key_encode = key_encode;
+  f->buckets = buckets;
+  f->slots = malloc(len - header);
+  memcpy(f->slots, p + header, len - header);
+  f->count = count;
+  f->random = 0x9e3779b9;
+  return f;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// cuckoo_observer(ctx, op, key, index) is a helper function that is
+//  registered with ht_observe; it adds the fingerprint of an inserted key to
+//  the filter ctx, or deletes the fingerprint of a removed key
+// requires: all pointers are valid
+// effects: modifies the filter ctx
+// time: O(en) expected, O(n + m * en) if the filter has to grow
+static void cuckoo_observer(void *ctx, int op, const void *key, int index) {
+  (void)index;
+  struct htcuckoo *f = ctx;
+  assert(f);
+  assert(key);
+  const uint64_t h = ht_key_hash64(key, f->key_encode);
+  if (op == HT_OP_REMOVE) {
+    if (remove_hash(f, h)) {
+      f->count--;
+    }
+  } else if (insert_hash(f, h)) {
+    f->count++;
+  } else {
+    // the table already holds key, so the rebuilt filter includes it
+    rebuild(f, f->buckets * 2);
+  }
+}
+
+// rebuild(f, buckets) is a helper function that replaces the slots of f
+//  with buckets empty buckets and adds all keys of the table of f, doubling
+//  again if an insertion fails
+// requires: f is a valid pointer with a table; buckets is a power of 2
+// effects: modifies f
+// time: O(buckets + n + m * en)
+static void rebuild(struct htcuckoo *f, uint32_t buckets) {
+  assert(f);
+  assert(f->ht);
+  for (;;) {
+    free(f->slots);
+    f->buckets = buckets;
+    f->slots = calloc((size_t)buckets * CUCKOO_SLOTS, sizeof(uint16_t));
+    f->count = 0;
+    ht_foreach(f->ht, rebuild_key, f);
+    if (f->count >= 0) {
+      return;
+    }
+    buckets *= 2;
+  }
+}
+
+// rebuild_key(ctx, key) is a helper function that adds key to the filter
+//  ctx while it is rebuilt; if the insertion fails, the count of the
+//  filter becomes negative for good
+// requires: all pointers are valid
+// effects: modifies the filter ctx
+// time: O(en) expected
+static void rebuild_key(void *ctx, const void *key) {
+  struct htcuckoo *f = ctx;
+  assert(f);
+  if (f->count < 0) {
+    return;
+  }
+  f->count = insert_hash(f, ht_key_hash64(key, f->key_encode)) ? f->count + 1 : -1;
+}
+
+// insert_hash(f, h) is a helper function that adds the fingerprint of the
+//  key hash h to f. It returns false if no free slot was found (one
+//  fingerprint of f is then lost).
+// requires: f is a valid pointer
+// effects: modifies f
+// time: O(1) expected, O(CUCKOO_MAX_KICKS) at most
+static bool insert_hash(struct htcuckoo *f, uint64_t h) {
+  assert(f);
+  uint16_t fp = (h >> 32) & 0xffff ? (h >> 32) & 0xffff : 1;
+  uint32_t bucket = h & (f->buckets - 1);
+  if (bucket_put(f, bucket, fp)) {
+    return true;
+  }
+  bucket = alt_bucket(f, bucket, fp);
+  for (int kick = 0; kick < CUCKOO_MAX_KICKS; kick++) {
+    if (bucket_put(f, bucket, fp)) {
+      return true;
+    }
+    // evict a random fingerprint of the bucket to its other bucket
+    f->random = f->random * 1664525 + 1013904223;
+    uint16_t *slot = &f->slots[bucket * CUCKOO_SLOTS + (f->random >> 30)];
+    const uint16_t evicted = *slot;
+    *slot = fp;
+    fp = evicted;
+    bucket = alt_bucket(f, bucket, fp);
+  }
+  return false;
+}
+
+// remove_hash(f, h) is a helper function that deletes one fingerprint of
+//  the key hash h from f; it returns false if there is none
+// requires: f is a valid pointer
+// effects: modifies f
+// time: O(1)
+static bool remove_hash(struct htcuckoo *f, uint64_t h) {
+  assert(f);
+  const uint16_t fp = (h >> 32) & 0xffff ? (h >> 32) & 0xffff : 1;
+  const uint32_t i1 = h & (f->buckets - 1);
+  const uint32_t candidates[2] = {i1, alt_bucket(f, i1, fp)};
+  for (int c = 0; c < 2; c++) {
+    uint16_t *slots = &f->slots[candidates[c] * CUCKOO_SLOTS];
+    for (int s = 0; s < CUCKOO_SLOTS; s++) {
+      if (slots[s] == fp) {
+        slots[s] = 0;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// bucket_put(f, bucket, fp) is a helper function that stores fp in a free
+//  slot of bucket and returns true, or returns false if bucket is full
+// requires: f is a valid pointer
+// effects: modifies f
+// time: O(1)
+static bool bucket_put(struct htcuckoo *f, uint32_t bucket, uint16_t fp) {
+  assert(f);
+  uint16_t *slots = &f->slots[bucket * CUCKOO_SLOTS];
+  for (int s = 0; s < CUCKOO_SLOTS; s++) {
+    if (slots[s] == 0) {
+      slots[s] = fp;
+      return true;
+    }
+  }
+  return false;
+}
+
+// bucket_has(f, bucket, fp) is a helper function that returns true if
+//  bucket holds fp
+// requires: f is a valid pointer
+// time: O(1)
+static bool bucket_has(const struct htcuckoo *f, uint32_t bucket, uint16_t fp) {
+  assert(f);
+  const uint16_t *slots = &f->slots[bucket * CUCKOO_SLOTS];
+  for (int s = 0; s < CUCKOO_SLOTS; s++) {
+    if (slots[s] == fp) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// alt_bucket(f, bucket, fp) is a helper function that returns the other
+//  bucket of a fingerprint fp stored in bucket
+// requires: f is a valid pointer
+// time: O(1)
+static uint32_t alt_bucket(const struct htcuckoo *f, uint32_t bucket, uint16_t fp) {
+  assert(f);
+  return (bucket ^ ((uint32_t)fp * 0x5bd1e995u)) & (f->buckets - 1);
+}
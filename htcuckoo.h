@@ -0,0 +1,61 @@
+// This is the interface of a cuckoo filter for generic hash tables: an
+//   approximate membership set that supports deletion. A filter observes a
+//   table and stays exactly in step with it (every ht_insert adds a
+//   fingerprint, every ht_remove deletes one), so unlike a Bloom filter it
+//   does not fill up with removed keys. A lookup never misses a stored key
+//   and wrongly reports an absent key with a probability of about 0.01%.
+//   A filter can be exported as a compact byte string and imported
+//   elsewhere (e.g. by another service) as a read-only filter. Keys are
+//   hashed through their key_encode encoding (see htsnapshot.h), so both
+//   sides must use the same encoding.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// a cuckoo filter
+struct htcuckoo;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htcuckoo_create(ht, key_encode, capacity) creates a filter of the keys of
+//   ht with room for about capacity keys. If the table grows beyond that,
+//   the filter doubles its size.
+// effects: allocates heap memory and registers an observer with ht; client
+//          must call htcuckoo_destroy
+// requires: capacity must be positive
+// time: O(capacity + n + m * en), where n is the length and m the number of
+//   items of ht and en is the complexity of key_encode
+struct htcuckoo *htcuckoo_create(struct hashtable *ht,
+                                 int (*key_encode)(const void *, void *, int),
+                                 int capacity);
+
+// htcuckoo_destroy(f) frees all resources of f and stops tracking its table
+//   (if it has one).
+// effects: invalidates f; may modify the table of f
+// time: O(o), where o is the number of observers of the table
+void htcuckoo_destroy(struct htcuckoo *f);
+
+// htcuckoo_contains(f, key) returns true if key may be in the set of f, and
+//   false if it is certainly not.
+// time: O(en)
+bool htcuckoo_contains(const struct htcuckoo *f, const void *key);
+
+// htcuckoo_count(f) returns the number of keys in the set of f.
+// time: O(1)
+int htcuckoo_count(const struct htcuckoo *f);
+
+// htcuckoo_export(f, len) returns the filter f as a byte string and stores
+//   its length in *len.
+// effects: allocates heap memory (caller must free); modifies *len
+// time: O(s), where s is the size of f
+void *htcuckoo_export(const struct htcuckoo *f, size_t *len);
+
+// htcuckoo_import(data, len, key_encode) returns a read-only filter from the
+//   len bytes at data (as returned by htcuckoo_export), or NULL if data is
+//   not a valid filter.
+// effects: allocates heap memory; client must call htcuckoo_destroy
+// time: O(len)
+struct htcuckoo *htcuckoo_import(const void *data, size_t len,
+                                 int (*key_encode)(const void *, void *, int));
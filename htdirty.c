@@ -0,0 +1,121 @@
+// This is the implementation of the dirty-bucket tracker. The bitmap is
+//   updated with atomic operations, so writers of different buckets (e.g.
+//   through htcheckpoint.h) may mark buckets concurrently.
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "htdirty.h"
+#include <assert.h>
+
+struct htdirty {
+  struct hashtable *ht;
+  int ht_len;                                       // number of buckets
+  int words;                                        // number of bitmap words
+  _Atomic uint64_t *bits;                           // bit i is set if bucket i is dirty
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void dirty_observer(void *ctx, int op, const void *key, int index);
+static int hash_length_of(int ht_len);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htdirty *htdirty_create(struct hashtable *ht) {
+  assert(ht);
+  struct htdirty *d = malloc(sizeof(struct htdirty));
+  d->ht = ht;
+  d->ht_len = ht_length(ht);
+  d->words = (d->ht_len + 63) / 64;
+  d->bits = malloc(sizeof(_Atomic uint64_t) * d->words);
+  for (int i = 0; i < d->words; i++) {
+    atomic_init(&d->bits[i], 0);
+  }
+  ht_observe(ht, dirty_observer, d);
+  return d;
+}
+
+void htdirty_destroy(struct htdirty *d) {
+  assert(d);
+  ht_unobserve(d->ht, dirty_observer, d);
+  free(d->bits);
+  free(d);
+}
+
+int htdirty_count(const struct htdirty *d) {
+  assert(d);
+  int count = 0;
+  for (int i = 0; i < d->words; i++) {
+    count += __builtin_popcountll(atomic_load_explicit(&d->bits[i], memory_order_relaxed));
+  }
+  return count;
+}
+
+void htdirty_clear(struct htdirty *d) {
+  assert(d);
+  for (int i = 0; i < d->words; i++) {
+    atomic_store_explicit(&d->bits[i], 0, memory_order_relaxed);
+  }
+}
+
+int htdirty_save_delta(struct htdirty *d, const char *path, uint64_t base_lsn,
+                       uint64_t lsn, int (*key_encode)(const void *, void *, int)) {
+  assert(d);
+  assert(path);
+  assert(key_encode);
+
+  struct ht_snapwriter *w = ht_snapwriter_open_delta(path, hash_length_of(d->ht_len),
+                                                     base_lsn, lsn);
+  if (w == NULL) {
+    return HT_IO_ERROR;
+  }
+  // take the bits out of the bitmap; they are put back if the write fails
+  uint64_t *taken = malloc(sizeof(uint64_t) * d->words);
+  for (int i = 0; i < d->words; i++) {
+    taken[i] = atomic_exchange_explicit(&d->bits[i], 0, memory_order_relaxed);
+    for (uint64_t word = taken[i]; word; word &= word - 1) {
+      const int index = i * 64 + __builtin_ctzll(word);
+      ht_snapwriter_add_bucket(w, d->ht, index, key_encode);
+    }
+  }
+
+  const int result = ht_snapwriter_commit(w);
+  if (result != HT_SUCCESS) {
+    for (int i = 0; i < d->words; i++) {
+      atomic_fetch_or_explicit(&d->bits[i], taken[i], memory_order_relaxed);
+    }
+  }
+  free(taken);
+  return result;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// dirty_observer(ctx, op, key, index) is a helper function that is
+//  registered with ht_observe; it marks the bucket index of the tracker ctx
+//  as dirty
+// requires: ctx is a valid pointer
+// effects: modifies the tracker ctx
+// time: O(1)
+static void dirty_observer(void *ctx, int op, const void *key, int index) {
+  (void)op;
+  (void)key;
+  struct htdirty *d = ctx;
+  assert(d);
+  atomic_fetch_or_explicit(&d->bits[index / 64], (uint64_t)1 << (index % 64),
+                           memory_order_relaxed);
+}
+
+// hash_length_of(ht_len) is a helper function that returns the base-2
+//  logarithm of ht_len
+// requires: ht_len is a power of 2
+// time: O(log ht_len)
+static int hash_length_of(int ht_len) {
+  int len = 0;
+  for (int n = ht_len; n > 1; n /= 2) {
+    len++;
+  }
+  return len;
+}
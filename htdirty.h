@@ -0,0 +1,53 @@
+// This is the interface of a dirty-bucket tracker for generic hash tables.
+//   The tracker keeps one bit per bucket of a table and sets it whenever a
+//   key of the bucket is inserted or removed. A delta snapshot (see
+//   htsnapshot.h) then only has to rewrite the buckets that changed since
+//   the last snapshot, which is a small fraction of a large table that
+//   changes by a few percent between checkpoints.
+//   A table is restored by loading its last full snapshot and applying the
+//   deltas that follow it in order (ht_snapshot_apply_delta). To bound the
+//   length of that chain, ht_snapshot_compact merges a full snapshot and
+//   its deltas into a new full snapshot, e.g. after every few deltas.
+
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// a dirty-bucket tracker
+struct htdirty;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htdirty_create(ht) creates a tracker for ht with no dirty buckets.
+// effects: allocates heap memory and registers an observer with ht; client
+//          must call htdirty_destroy
+// time: O(n), where n is the length of ht
+struct htdirty *htdirty_create(struct hashtable *ht);
+
+// htdirty_destroy(d) stops tracking and frees all resources of d.
+// effects: invalidates d; modifies the table of d
+// time: O(o), where o is the number of observers of the table
+void htdirty_destroy(struct htdirty *d);
+
+// htdirty_count(d) returns the number of dirty buckets of d.
+// time: O(n / 64), where n is the length of the table of d
+int htdirty_count(const struct htdirty *d);
+
+// htdirty_clear(d) marks all buckets as clean (e.g. after a full snapshot).
+// effects: modifies d
+// time: O(n / 64), where n is the length of the table of d
+void htdirty_clear(struct htdirty *d);
+
+// htdirty_save_delta(d, path, base_lsn, lsn, key_encode) writes a delta
+//   snapshot with LSN lsn of all dirty buckets to path; it applies to the
+//   snapshot with LSN base_lsn. On success, all buckets are marked as
+//   clean. The function returns
+//   * HT_SUCCESS if the delta has been written, or
+//   * HT_IO_ERROR if it could not be written (the dirty buckets stay
+//     dirty).
+// effects: writes a file; modifies d
+// requires: the table of d is not modified during the call
+// time: O(n / 64 + k * en), where k is the number of keys in the dirty
+//   buckets and en is the complexity of key_encode
+int htdirty_save_delta(struct htdirty *d, const char *path, uint64_t base_lsn,
+                       uint64_t lsn, int (*key_encode)(const void *, void *, int));
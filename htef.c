@@ -0,0 +1,279 @@
+// This is the implementation of the Elias-Fano set.
+//   A key is stored as its offset x = key - min, split into its l low bits
+//   and its high part x >> l. The low bits of all keys are packed into the
+//   lower array. The high parts are stored in unary in the upper bit
+//   vector: key i sets the bit (x_i >> l) + i, so the bucket of keys with
+//   high part h follows the h-th 0 bit (counting from 0) of the vector.
+//   l is the integer log2 of (max - min + 1) / n, which makes the upper
+//   vector at most 2n + 1 bits long.
+//   Select samples store the position of every EF_SAMPLE-th 1 bit and 0 bit
+//   of the upper vector; a select scans forward from the preceding sample.
+
+#include <stdlib.h>
+#include "htef.h"
+#include <assert.h>
+
+// distance (in 1 bits or 0 bits) of the select samples
+#define EF_SAMPLE 256
+
+struct htef {
+  int count;
+  uint64_t min;
+  int low_bits;                                     // l
+  uint64_t *lower;                                  // count * l bits
+  uint64_t *upper;                                  // upper_bits bits
+  size_t upper_bits;
+  size_t *ones;                                     // position of 1 bit k * EF_SAMPLE
+  size_t *zeros;                                    // position of 0 bit k * EF_SAMPLE
+  size_t zero_count;                                // number of 0 bits of upper
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static uint64_t lower_get(const struct htef *s, int i);
+static void lower_set(struct htef *s, int i, uint64_t low);
+static bool upper_get(const struct htef *s, size_t pos);
+static size_t select_bit(const struct htef *s, size_t k, bool one);
+static int bucket_start(const struct htef *s, uint64_t high);
+static void collect_key(void *ctx, uint64_t key);
+static int compare_keys(const void *a, const void *b);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+// the keys of a table that are being collected by htef_build
+struct ef_keys {
+  uint64_t *keys;
+  int len;
+};
+
+struct htef *htef_create(const uint64_t *keys, int n) {
+  assert(keys || n == 0);
+  assert(n >= 0);
+  struct htef *s = malloc(sizeof(struct htef));
+  s->count = n;
+  s->min = n ? keys[0] : 0;
+  const uint64_t range = n ? keys[n - 1] - keys[0] : 0;
+  const uint64_t per_key = n ? range / n + (range % n == (uint64_t)n - 1) : 0;
+  // l = floor(log2((range + 1) / n)), computed without overflow
+  s->low_bits = per_key ? 63 - __builtin_clzll(per_key) : 0;
+  s->upper_bits = (size_t)n + (range >> s->low_bits) + 1;
+  s->lower = calloc(((size_t)n * s->low_bits + 63) / 64 + 1, sizeof(uint64_t));
+  s->upper = calloc((s->upper_bits + 63) / 64, sizeof(uint64_t));
+  for (int i = 0; i < n; i++) {
+    assert(i == 0 || keys[i - 1] < keys[i]);
+    const uint64_t x = keys[i] - s->min;
+    lower_set(s, i, x & ((1ULL << s->low_bits) - 1));
+    const size_t pos = (x >> s->low_bits) + i;
+    s->upper[pos / 64] |= 1ULL << (pos % 64);
+  }
+  s->zero_count = s->upper_bits - n;
+  s->ones = malloc(sizeof(size_t) * (n / EF_SAMPLE + 1));
+  s->zeros = malloc(sizeof(size_t) * (s->zero_count / EF_SAMPLE + 1));
+  size_t ones = 0;
+  size_t zeros = 0;
+  for (size_t pos = 0; pos < s->upper_bits; pos++) {
+    if (upper_get(s, pos)) {
+      if (ones % EF_SAMPLE == 0) {
+        s->ones[ones / EF_SAMPLE] = pos;
+      }
+      ones++;
+    } else {
+      if (zeros % EF_SAMPLE == 0) {
+        s->zeros[zeros / EF_SAMPLE] = pos;
+      }
+      zeros++;
+    }
+  }
+  return s;
+}
+
+struct htef *htef_build(const struct hashtable_u64 *ht) {
+  assert(ht);
+  struct ef_keys c = {malloc(sizeof(uint64_t) * (ht_count_u64(ht) + 1)), 0};
+  ht_foreach_u64(ht, collect_key, &c);
+  assert(c.len == ht_count_u64(ht));
+  if (!ht_dense_u64(ht)) {
+    qsort(c.keys, c.len, sizeof(uint64_t), compare_keys);
+  }
+  struct htef *s = htef_create(c.keys, c.len);
+  free(c.keys);
+  return s;
+}
+
+void htef_destroy(struct htef *s) {
+  assert(s);
+  free(s->lower);
+  free(s->upper);
+  free(s->ones);
+  free(s->zeros);
+  free(s);
+}
+
+bool htef_contains(const struct htef *s, uint64_t key) {
+  assert(s);
+  const int i = htef_rank(s, key);
+  return i < s->count && htef_select(s, i) == key;
+}
+
+int htef_rank(const struct htef *s, uint64_t key) {
+  assert(s);
+  if (s->count == 0 || key <= s->min) {
+    return 0;
+  }
+  const uint64_t x = key - s->min;
+  const uint64_t high = x >> s->low_bits;
+  if (high >= s->zero_count) {
+    return s->count;
+  }
+  const uint64_t low = x & ((1ULL << s->low_bits) - 1);
+  // the keys of the bucket of high are ordered by their low bits
+  int i = bucket_start(s, high);
+  for (size_t pos = high + i; upper_get(s, pos) && lower_get(s, i) < low; pos++) {
+    i++;
+  }
+  return i;
+}
+
+uint64_t htef_select(const struct htef *s, int i) {
+  assert(s);
+  assert(0 <= i && i < s->count);
+  const uint64_t high = select_bit(s, i, true) - i;
+  return s->min + ((high << s->low_bits) | lower_get(s, i));
+}
+
+int htef_count(const struct htef *s) {
+  assert(s);
+  return s->count;
+}
+
+size_t htef_size(const struct htef *s) {
+  assert(s);
+  return sizeof(struct htef) +
+         sizeof(uint64_t) * (((size_t)s->count * s->low_bits + 63) / 64 + 1) +
+         sizeof(uint64_t) * ((s->upper_bits + 63) / 64) +
+         sizeof(size_t) * (s->count / EF_SAMPLE + 1) +
+         sizeof(size_t) * (s->zero_count / EF_SAMPLE + 1);
+}
+
+void htef_foreach(const struct htef *s, void (*visit)(void *, uint64_t),
+                  void *ctx) {
+  assert(s);
+  assert(visit);
+  int i = 0;
+  for (size_t w = 0; w < (s->upper_bits + 63) / 64; w++) {
+    for (uint64_t word = s->upper[w]; word; word &= word - 1) {
+      const uint64_t high = w * 64 + __builtin_ctzll(word) - i;
+      visit(ctx, s->min + ((high << s->low_bits) | lower_get(s, i)));
+      i++;
+    }
+  }
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// lower_get(s, i) is a helper function that returns the low bits of key i
+// requires: s is a valid pointer; 0 <= i < count
+// time: O(1)
+static uint64_t lower_get(const struct htef *s, int i) {
+  assert(s);
+  if (s->low_bits == 0) {
+    return 0;
+  }
+  const size_t bit = (size_t)i * s->low_bits;
+  const int shift = bit % 64;
+  uint64_t low = s->lower[bit / 64] >> shift;
+  if (shift + s->low_bits > 64) {
+    low |= s->lower[bit / 64 + 1] << (64 - shift);
+  }
+  return low & ((1ULL << s->low_bits) - 1);
+}
+
+// lower_set(s, i, low) is a helper function that stores low as the low
+//  bits of key i
+// requires: s is a valid pointer; 0 <= i < count; the low bits of key i
+//           are 0; low < 2^l
+// effects: modifies s
+// time: O(1)
+static void lower_set(struct htef *s, int i, uint64_t low) {
+  assert(s);
+  if (s->low_bits == 0) {
+    return;
+  }
+  const size_t bit = (size_t)i * s->low_bits;
+  const int shift = bit % 64;
+  s->lower[bit / 64] |= low << shift;
+  if (shift + s->low_bits > 64) {
+    s->lower[bit / 64 + 1] |= low >> (64 - shift);
+  }
+}
+
+// upper_get(s, pos) is a helper function that returns the bit pos of the
+//  upper vector of s (false past its end)
+// requires: s is a valid pointer
+// time: O(1)
+static bool upper_get(const struct htef *s, size_t pos) {
+  assert(s);
+  return pos < s->upper_bits && ((s->upper[pos / 64] >> (pos % 64)) & 1);
+}
+
+// select_bit(s, k, one) is a helper function that returns the position of
+//  the k-th (counting from 0) 1 bit of the upper vector of s if one is
+//  true, or of its k-th 0 bit otherwise
+// requires: s is a valid pointer; the vector has more than k such bits
+// time: O(1) expected (a scan of at most EF_SAMPLE bits of that kind and
+//   the bits of the other kind in between)
+static size_t select_bit(const struct htef *s, size_t k, bool one) {
+  assert(s);
+  size_t pos = (one ? s->ones : s->zeros)[k / EF_SAMPLE];
+  size_t left = k % EF_SAMPLE;
+  size_t w = pos / 64;
+  // the bits of the wanted kind in the word of pos, from pos on
+  uint64_t word = (one ? s->upper[w] : ~s->upper[w]) & (~0ULL << (pos % 64));
+  while ((size_t)__builtin_popcountll(word) <= left) {
+    left -= __builtin_popcountll(word);
+    w++;
+    word = one ? s->upper[w] : ~s->upper[w];
+  }
+  while (left > 0) {
+    word &= word - 1;
+    left--;
+  }
+  return w * 64 + __builtin_ctzll(word);
+}
+
+// bucket_start(s, high) is a helper function that returns the position of
+//  the first key of s whose high part is at least high
+// requires: s is a valid pointer; high < zero_count
+// time: O(1) expected
+static int bucket_start(const struct htef *s, uint64_t high) {
+  assert(s);
+  if (high == 0) {
+    return 0;
+  }
+  // the keys before the bucket of high are the 1 bits before the 0 bit
+  //  high - 1, which ends the bucket of high - 1
+  return select_bit(s, high - 1, false) - (high - 1);
+}
+
+// collect_key(ctx, key) is a helper function that appends key to the keys
+//  of ctx (a struct ef_keys)
+// requires: ctx is a valid pointer with room for key
+// effects: modifies ctx
+// time: O(1)
+static void collect_key(void *ctx, uint64_t key) {
+  struct ef_keys *c = ctx;
+  assert(c);
+  c->keys[c->len++] = key;
+}
+
+// compare_keys(a, b) is a helper function for qsort that orders keys
+//  increasingly
+// requires: all pointers are valid
+// time: O(1)
+static int compare_keys(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
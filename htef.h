@@ -0,0 +1,62 @@
+// This is the interface of a frozen (read-only) set of 64-bit integers in
+//   Elias-Fano encoding. A set of n keys between its smallest and largest
+//   key min and max takes about n * (2 + log2((max - min) / n)) bits, plus
+//   small select indexes, which is close to the minimum for sets of that
+//   size and range. Keys can be looked up, ranked, selected by position and
+//   visited in increasing order.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "htu64.h"
+
+// a frozen set of 64-bit integers
+struct htef;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htef_create(keys, n) creates a set of the n keys of keys.
+// effects: allocates heap memory; client must call htef_destroy
+// requires: keys[0..n-1] are strictly increasing; n >= 0
+// time: O(n + (max - min) / 2^l), where 2^l is about (max - min) / n
+struct htef *htef_create(const uint64_t *keys, int n);
+
+// htef_build(ht) creates a set of the keys stored in ht.
+// effects: allocates heap memory; client must call htef_destroy
+// time: O(s + m log m), where s is the size of ht and m is the number of
+//   keys in ht (O(s + m) if ht is a bitset)
+struct htef *htef_build(const struct hashtable_u64 *ht);
+
+// htef_destroy(s) frees all resources of s.
+// effects: invalidates s
+// time: O(1)
+void htef_destroy(struct htef *s);
+
+// htef_contains(s, key) returns true if key is in s, and false otherwise.
+// time: O(1) expected
+bool htef_contains(const struct htef *s, uint64_t key);
+
+// htef_rank(s, key) returns the number of keys of s that are smaller than
+//   key.
+// time: O(1) expected
+int htef_rank(const struct htef *s, uint64_t key);
+
+// htef_select(s, i) returns the key of s at position i (the i + 1-th
+//   smallest key).
+// requires: 0 <= i < htef_count(s)
+// time: O(1) expected
+uint64_t htef_select(const struct htef *s, int i);
+
+// htef_count(s) returns the number of keys of s.
+// time: O(1)
+int htef_count(const struct htef *s);
+
+// htef_size(s) returns the number of bytes used by s.
+// time: O(1)
+size_t htef_size(const struct htef *s);
+
+// htef_foreach(s, visit, ctx) calls visit(ctx, key) for every key of s, in
+//   increasing order.
+// time: O(n * v + (max - min) / 2^l), where v is the complexity of visit
+void htef_foreach(const struct htef *s, void (*visit)(void *, uint64_t),
+                  void *ctx);
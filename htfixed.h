@@ -0,0 +1,181 @@
+// This is the interface of fixed-capacity hash tables that never allocate
+//   memory. HTFIXED_DEFINE generates a table type for one key type and one
+//   capacity: the slots are an array inside the table object, so a table
+//   can live in static storage, on the stack or inside another object, and
+//   the capacity and the index mask are compile-time constants. Keys are
+//   copied by value (no key_clone or key_destroy), so key_type must be
+//   trivially copyable (e.g. an integer, a pointer or a small struct).
+//   The table uses open addressing with linear probing. Every slot has a
+//   tag byte: 0 if the slot is free, otherwise 7 bits of the hash of its
+//   key (so most mismatches are rejected without calling equal_fn).
+//   The return codes HT_SUCCESS, HT_ALREADY_STORED and HT_NOT_STORED are
+//   shared with hashtable.h.
+//   ht::FixedSet in htfixed.hpp is the same table for C++, with the key
+//   type and the hash length as template parameters.
+//
+// HTFIXED_DEFINE(name, key_type, hash_length, hash_fn, equal_fn) defines
+//   struct name with 2^hash_length slots and the following functions:
+//
+//   void name_init(struct name *t)
+//     makes t an empty table; time: O(n), where n is the capacity
+//   int name_insert(struct name *t, key_type key)
+//     inserts key into t and returns HT_SUCCESS, HT_ALREADY_STORED, or
+//     HTFIXED_FULL if all slots of t are occupied; time: O(1) expected
+//   int name_remove(struct name *t, key_type key)
+//     removes key from t and returns HT_SUCCESS or HT_NOT_STORED;
+//     time: O(1) expected
+//   bool name_contains(const struct name *t, key_type key)
+//     returns true if key is stored in t; time: O(1) expected
+//   int name_count(const struct name *t)
+//     returns the number of keys stored in t; time: O(1)
+//   void name_foreach(const struct name *t, void (*visit)(void *, key_type),
+//                     void *ctx)
+//     calls visit(ctx, key) for every key stored in t; visit must not
+//     modify t; time: O(n + m * v)
+//   void name_print(const struct name *t, void (*key_print)(key_type))
+//     prints the keys of t to the console; time: O(n + m * cp)
+//
+//   hash_fn(key) must return an unsigned integer (at least hash_length + 7
+//   bits are used, the low bits select the home slot), and equal_fn(a, b)
+//   must return nonzero if the keys a and b are equal; both may be
+//   functions or function-like macros. The expected times assume that at
+//   most about 3/4 of the slots are occupied.
+//   requires: all pointers must be valid; 0 < hash_length < 24
+//
+// Example:
+//   static inline uint32_t u32_hash(uint32_t k) { return k * 2654435761u; }
+//   #define U32_EQUAL(a, b) ((a) == (b))
+//   HTFIXED_DEFINE(u32set, uint32_t, 8, u32_hash, U32_EQUAL)
+//   ...
+//   struct u32set s;
+//   u32set_init(&s);
+//   u32set_insert(&s, 42);
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "hashtable.h"
+
+// HTFIXED_FULL indicates that a key could not be inserted because every
+//   slot of the table is occupied (the same value as LFHT_FULL).
+#define HTFIXED_FULL 3
+
+#define HTFIXED_DEFINE(name, key_type, hash_length, hash_fn, equal_fn)           \
+                                                                                 \
+_Static_assert((hash_length) > 0 && (hash_length) < 24,                          \
+               "hash_length of " #name " must be in [1, 23]");                   \
+                                                                                 \
+enum {                                                                           \
+  name##_CAPACITY = 1 << (hash_length),                                          \
+  name##_MASK = (1 << (hash_length)) - 1                                         \
+};                                                                               \
+                                                                                 \
+struct name {                                                                    \
+  key_type keys[name##_CAPACITY];                                                \
+  uint8_t tags[name##_CAPACITY];                    /* 0 if the slot is free */  \
+  int count;                                                                     \
+};                                                                               \
+                                                                                 \
+/* name##_tag(hash) returns the tag of a key with hash (never 0) */             \
+static inline uint8_t name##_tag(uint64_t hash) {                               \
+  return 0x80 | ((hash >> (hash_length)) & 0x7f);                                \
+}                                                                                \
+                                                                                 \
+static inline void name##_init(struct name *t) {                                 \
+  for (int i = 0; i < name##_CAPACITY; i++) {                                    \
+    t->tags[i] = 0;                                                              \
+  }                                                                              \
+  t->count = 0;                                                                  \
+}                                                                                \
+                                                                                 \
+/* name##_find(t, key, slot) returns true and sets *slot to the slot of key  \
+   if key is stored in t; otherwise it returns false and sets *slot to the   \
+   first free slot of the probe sequence of key (or to -1 if there is none) */ \
+static inline bool name##_find(const struct name *t, key_type key, int *slot) { \
+  const uint64_t hash = (uint64_t)(hash_fn(key));                                \
+  const uint8_t tag = name##_tag(hash);                                          \
+  int i = hash & name##_MASK;                                                    \
+  for (int n = 0; n < name##_CAPACITY; n++, i = (i + 1) & name##_MASK) {         \
+    if (t->tags[i] == 0) {                                                       \
+      *slot = i;                                                                 \
+      return false;                                                              \
+    }                                                                            \
+    if (t->tags[i] == tag && (equal_fn(t->keys[i], key))) {                      \
+      *slot = i;                                                                 \
+      return true;                                                               \
+    }                                                                            \
+  }                                                                              \
+  *slot = -1;                                                                    \
+  return false;                                                                  \
+}                                                                                \
+                                                                                 \
+static inline int name##_insert(struct name *t, key_type key) {                  \
+  int slot;                                                                      \
+  if (name##_find(t, key, &slot)) {                                              \
+    return HT_ALREADY_STORED;                                                    \
+  }                                                                              \
+  if (slot < 0) {                                                                \
+    return HTFIXED_FULL;                                                         \
+  }                                                                              \
+  t->keys[slot] = key;                                                           \
+  t->tags[slot] = name##_tag((uint64_t)(hash_fn(key)));                          \
+  t->count++;                                                                    \
+  return HT_SUCCESS;                                                             \
+}                                                                                \
+                                                                                 \
+static inline int name##_remove(struct name *t, key_type key) {                  \
+  int hole;                                                                      \
+  if (!name##_find(t, key, &hole)) {                                             \
+    return HT_NOT_STORED;                                                        \
+  }                                                                              \
+  /* move later keys of the probe sequence back into the hole, so that no   \
+     lookup stops early at it (backward-shift deletion) */                    \
+  int next = (hole + 1) & name##_MASK;                                           \
+  for (int n = 1; n < name##_CAPACITY && t->tags[next];                          \
+       n++, next = (next + 1) & name##_MASK) {                                   \
+    const int home = (uint64_t)(hash_fn(t->keys[next])) & name##_MASK;           \
+    if (((next - home) & name##_MASK) >= ((next - hole) & name##_MASK)) {        \
+      t->keys[hole] = t->keys[next];                                             \
+      t->tags[hole] = t->tags[next];                                             \
+      hole = next;                                                               \
+    }                                                                            \
+  }                                                                              \
+  t->tags[hole] = 0;                                                             \
+  t->count--;                                                                    \
+  return HT_SUCCESS;                                                             \
+}                                                                                \
+                                                                                 \
+static inline bool name##_contains(const struct name *t, key_type key) {         \
+  int slot;                                                                      \
+  return name##_find(t, key, &slot);                                             \
+}                                                                                \
+                                                                                 \
+static inline int name##_count(const struct name *t) {                           \
+  return t->count;                                                               \
+}                                                                                \
+                                                                                 \
+static inline void name##_foreach(const struct name *t,                          \
+                                  void (*visit)(void *, key_type), void *ctx) {  \
+  for (int i = 0; i < name##_CAPACITY; i++) {                                    \
+    if (t->tags[i]) {                                                            \
+      visit(ctx, t->keys[i]);                                                    \
+    }                                                                            \
+  }                                                                              \
+}                                                                                \
+                                                                                 \
+static inline void name##_print(const struct name *t,                            \
+                                void (*key_print)(key_type)) {                   \
+  bool first = true;                                                             \
+  printf("[");                                                                   \
+  for (int i = 0; i < name##_CAPACITY; i++) {                                    \
+    if (t->tags[i]) {                                                            \
+      if (!first) {                                                              \
+        printf(",");                                                             \
+      }                                                                          \
+      key_print(t->keys[i]);                                                     \
+      first = false;                                                             \
+    }                                                                            \
+  }                                                                              \
+  printf("]\n");                                                                 \
+}
@@ -0,0 +1,175 @@
+// This is the interface of the C++ binding (C++17) of the fixed-capacity
+//   hash tables of htfixed.h. A table is declared as
+//     ht::FixedSet<K, HashLength, Hash, Eq>
+//   where HashLength is a template parameter, so the capacity 2^HashLength,
+//   the index mask and the slot array are compile-time constants and the
+//   whole table lives inside the FixedSet object (in static storage, on the
+//   stack, inside another object or in a caller-provided buffer with
+//   placement new). No operation allocates memory.
+//   The layout and the algorithm are those of HTFIXED_DEFINE: open
+//   addressing with linear probing, a tag byte per slot (0 if the slot is
+//   free, otherwise 7 bits of the hash of its key) and backward-shift
+//   deletion. The operations return the codes of hashtable.h and
+//   HTFIXED_FULL, like their C counterparts.
+//   Hash(key) is mixed with the splitmix64 finalizer before it is used, so
+//   weak hashes (e.g. std::hash of integers) spread over all slots.
+//
+// Example:
+//   ht::FixedSet<std::uint32_t, 8> s;
+//   s.insert(42);
+
+#ifndef HTFIXED_HPP
+#define HTFIXED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+extern "C" {
+#include "htfixed.h"
+}
+
+namespace ht {
+
+// FixedSet<K, HashLength, Hash, Eq> is a set of at most 2^HashLength keys
+// of type K. Keys are copied by value.
+// requires: K is trivially copyable; 0 < HashLength < 24
+template <class K, int HashLength, class Hash = std::hash<K>,
+          class Eq = std::equal_to<K>>
+class FixedSet {
+  static_assert(HashLength > 0 && HashLength < 24,
+                "FixedSet: HashLength must be in [1, 23]");
+  static_assert(std::is_trivially_copyable_v<K>,
+                "FixedSet: keys must be trivially copyable");
+
+ public:
+  static constexpr int hash_length = HashLength;
+  static constexpr std::size_t capacity = std::size_t{1} << HashLength;
+
+  // FixedSet(hash, eq) creates an empty set.
+  // time: O(n), where n is the capacity
+  constexpr explicit FixedSet(const Hash &hash = Hash(), const Eq &eq = Eq())
+      : keys_{}, tags_{}, count_(0), hash_(hash), eq_(eq) {}
+
+  // insert(key) inserts key into the set and returns HT_SUCCESS,
+  //   HT_ALREADY_STORED, or HTFIXED_FULL if all slots are occupied.
+  // time: O(1) expected
+  int insert(const K &key) {
+    const std::uint64_t h = mix(hash_(key));
+    std::size_t slot;
+    if (find(key, h, slot)) {
+      return HT_ALREADY_STORED;
+    }
+    if (slot == capacity) {
+      return HTFIXED_FULL;
+    }
+    keys_[slot] = key;
+    tags_[slot] = tag(h);
+    count_++;
+    return HT_SUCCESS;
+  }
+
+  // remove(key) removes key from the set and returns HT_SUCCESS or
+  //   HT_NOT_STORED.
+  // time: O(1) expected
+  int remove(const K &key) {
+    std::size_t hole;
+    if (!find(key, mix(hash_(key)), hole)) {
+      return HT_NOT_STORED;
+    }
+    // move later keys of the probe sequence back into the hole, so that no
+    //   lookup stops early at it (backward-shift deletion)
+    std::size_t next = (hole + 1) & mask;
+    for (std::size_t n = 1; n < capacity && tags_[next];
+         n++, next = (next + 1) & mask) {
+      const std::size_t home = mix(hash_(keys_[next])) & mask;
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        keys_[hole] = keys_[next];
+        tags_[hole] = tags_[next];
+        hole = next;
+      }
+    }
+    tags_[hole] = 0;
+    count_--;
+    return HT_SUCCESS;
+  }
+
+  // contains(key) returns true if key is stored in the set.
+  // time: O(1) expected
+  bool contains(const K &key) const {
+    std::size_t slot;
+    return find(key, mix(hash_(key)), slot);
+  }
+
+  // count() returns the number of keys stored in the set.
+  // time: O(1)
+  int count() const {
+    return count_;
+  }
+
+  // for_each(visit) calls visit(key) for every key stored in the set; visit
+  //   must not modify the set.
+  // time: O(n + m * v)
+  template <typename F>
+  void for_each(F &&visit) const {
+    for (std::size_t i = 0; i < capacity; i++) {
+      if (tags_[i]) {
+        visit(keys_[i]);
+      }
+    }
+  }
+
+ private:
+  static constexpr std::size_t mask = capacity - 1;
+
+  // mix(h) returns a well-mixed copy of the hash h (the splitmix64
+  //   finalizer); its low bits select the home slot.
+  // time: O(1)
+  static constexpr std::uint64_t mix(std::uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+  }
+
+  // tag(h) returns the tag of a key with the mixed hash h (never 0).
+  // time: O(1)
+  static constexpr std::uint8_t tag(std::uint64_t h) {
+    return static_cast<std::uint8_t>(0x80 | ((h >> HashLength) & 0x7f));
+  }
+
+  // find(key, h, slot) returns true and sets slot to the slot of key (with
+  //   the mixed hash h) if key is stored; otherwise it returns false and
+  //   sets slot to the first free slot of the probe sequence of key (or to
+  //   capacity if there is none).
+  // time: O(1) expected
+  bool find(const K &key, std::uint64_t h, std::size_t &slot) const {
+    const std::uint8_t t = tag(h);
+    std::size_t i = h & mask;
+    for (std::size_t n = 0; n < capacity; n++, i = (i + 1) & mask) {
+      if (tags_[i] == 0) {
+        slot = i;
+        return false;
+      }
+      if (tags_[i] == t && eq_(keys_[i], key)) {
+        slot = i;
+        return true;
+      }
+    }
+    slot = capacity;
+    return false;
+  }
+
+  K keys_[capacity];
+  std::uint8_t tags_[capacity];                     // 0 if the slot is free
+  int count_;
+  Hash hash_;
+  Eq eq_;
+};
+
+}  // namespace ht
+
+#endif
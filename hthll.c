@@ -0,0 +1,139 @@
+// This is the implementation of the HyperLogLog sketch (Flajolet et al.).
+//   A key is hashed to 31 bits with key_hash and mixed by a bijection of
+//   the 31-bit values (key_hash only has to distribute keys over buckets,
+//   so its bits may be correlated). The first p bits select a register, and
+//   the register keeps the largest rank (position of the first 1 bit) seen
+//   in the remaining 31 - p bits.
+//   The estimate uses linear counting for small cardinalities and the
+//   correction for a bounded hash space (2^31) for large ones.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "hthll.h"
+#include <assert.h>
+
+// the number of hash bits used
+#define HLL_HASH_BITS 31
+
+struct hthll {
+  int (*key_hash)(const void *, int);
+  int precision;
+  int registers;                                    // 2^precision
+  uint8_t *rank;                                    // largest rank per register
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static uint32_t mix31(uint32_t x);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct hthll *hthll_create(int (*key_hash)(const void *, int), int precision) {
+  assert(key_hash);
+  assert(4 <= precision && precision <= 16);
+  struct hthll *s = malloc(sizeof(struct hthll));
+  s->key_hash = key_hash;
+  s->precision = precision;
+  s->registers = 1 << precision;
+  s->rank = calloc(s->registers, sizeof(uint8_t));
+  return s;
+}
+
+void hthll_destroy(struct hthll *s) {
+  assert(s);
+  free(s->rank);
+  free(s);
+}
+
+void hthll_add(struct hthll *s, const void *key) {
+  assert(s);
+  assert(key);
+  const uint32_t h = mix31(s->key_hash(key, HLL_HASH_BITS));
+  const int rest_bits = HLL_HASH_BITS - s->precision;
+  const uint32_t index = h >> rest_bits;
+  const uint32_t rest = h & ((1u << rest_bits) - 1);
+  // rank: 1 + number of leading zeros of rest (as a rest_bits-bit value)
+  const int rank = rest ? rest_bits - (31 - __builtin_clz(rest)) : rest_bits + 1;
+  if (rank > s->rank[index]) {
+    s->rank[index] = rank;
+  }
+}
+
+void hthll_add_batch(struct hthll *s, const void *const *keys, int n) {
+  assert(s);
+  assert(keys);
+  for (int i = 0; i < n; i++) {
+    hthll_add(s, keys[i]);
+  }
+}
+
+void hthll_merge(struct hthll *s, const struct hthll *other) {
+  assert(s);
+  assert(other);
+  assert(s->precision == other->precision);
+  assert(s->key_hash == other->key_hash);
+  for (int i = 0; i < s->registers; i++) {
+    if (other->rank[i] > s->rank[i]) {
+      s->rank[i] = other->rank[i];
+    }
+  }
+}
+
+double hthll_estimate(const struct hthll *s) {
+  assert(s);
+  const double m = s->registers;
+  double sum = 0;
+  int zeros = 0;
+  for (int i = 0; i < s->registers; i++) {
+    sum += ldexp(1.0, -s->rank[i]);
+    zeros += s->rank[i] == 0;
+  }
+  double alpha = 0.7213 / (1 + 1.079 / m);
+  if (s->registers == 16) {
+    alpha = 0.673;
+  } else if (s->registers == 32) {
+    alpha = 0.697;
+  } else if (s->registers == 64) {
+    alpha = 0.709;
+  }
+  const double estimate = alpha * m * m / sum;
+
+  const double space = ldexp(1.0, HLL_HASH_BITS);
+  if (estimate <= 2.5 * m && zeros > 0) {
+    return m * log(m / zeros);
+  }
+  if (estimate > space / 30) {
+    return -space * log(1 - estimate / space);
+  }
+  return estimate;
+}
+
+int hthll_hash_length(double keys, double load) {
+  assert(keys >= 0);
+  assert(load > 0);
+  int hash_length = 1;
+  while (hash_length < 30 && keys > load * ldexp(1.0, hash_length)) {
+    hash_length++;
+  }
+  return hash_length;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// mix31(x) is a helper function that returns a well-mixed 31-bit value;
+//  it is a bijection of the 31-bit values, so it keeps distinct hashes
+//  distinct
+// time: O(1)
+static uint32_t mix31(uint32_t x) {
+  const uint32_t mask = (1u << HLL_HASH_BITS) - 1;
+  x &= mask;
+  x ^= x >> 16;
+  x = (x * 0x45d9f3bu) & mask;
+  x ^= x >> 15;
+  x = (x * 0x2c1b3c6du) & mask;
+  x ^= x >> 16;
+  return x;
+}
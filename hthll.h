@@ -0,0 +1,58 @@
+// This is the interface of a HyperLogLog sketch that estimates the number
+//   of distinct keys of a stream, to size a hash table before it is created
+//   (its hash length cannot change later). The sketch hashes keys with the
+//   key_hash connector of the table (see hashtable.h), so it counts keys as
+//   the table will distinguish them; key_hash is called with the largest
+//   hash length it supports (31 bits).
+//   A sketch with precision p uses 2^p bytes and has a standard error of
+//   about 1.04 / sqrt(2^p) (0.8% for p = 14). Sketches with the same
+//   precision and key_hash can be merged, e.g. after each thread has fed a
+//   part of the stream to its own sketch.
+
+#include "hashtable.h"
+
+// a HyperLogLog sketch
+struct hthll;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// hthll_create(key_hash, precision) creates an empty sketch with 2^precision
+//   registers.
+// effects: allocates heap memory; client must call hthll_destroy
+// requires: 4 <= precision <= 16
+// time: O(2^precision)
+struct hthll *hthll_create(int (*key_hash)(const void *, int), int precision);
+
+// hthll_destroy(s) frees all resources of s.
+// effects: invalidates s
+// time: O(1)
+void hthll_destroy(struct hthll *s);
+
+// hthll_add(s, key) adds key to s.
+// effects: modifies s
+// time: O(hf), where hf is the complexity of key_hash
+void hthll_add(struct hthll *s, const void *key);
+
+// hthll_add_batch(s, keys, n) adds keys[0..n-1] to s.
+// effects: modifies s
+// time: O(n * hf)
+void hthll_add_batch(struct hthll *s, const void *const *keys, int n);
+
+// hthll_merge(s, other) adds all keys that were added to other to s (s then
+//   estimates the union of both streams).
+// effects: modifies s
+// requires: s and other have the same precision and key_hash
+// time: O(2^precision)
+void hthll_merge(struct hthll *s, const struct hthll *other);
+
+// hthll_estimate(s) returns the estimated number of distinct keys added to
+//   s.
+// time: O(2^precision)
+double hthll_estimate(const struct hthll *s);
+
+// hthll_hash_length(keys, load) returns the smallest hash length for a
+//   table (see ht_create) that holds keys keys with at most load keys per
+//   bucket on average (at least 1 and at most 30).
+// requires: keys >= 0 and load > 0
+// time: O(1)
+int hthll_hash_length(double keys, double load);
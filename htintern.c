@@ -0,0 +1,205 @@
+// This is the implementation of the pool of interned keys.
+//   A handle is a pointer to the entry of its key, which holds the key, its
+//   reference count and its pool. The entries of a pool are stored in a
+//   generic hash table whose connectors forward to the connectors of the
+//   pool, so the handle of a key is found with ht_lookup.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "htintern.h"
+#include "hashtable.h"
+#include <assert.h>
+
+// the entry of an interned key (a handle points to it)
+struct intern_entry {
+  struct htintern *pool;
+  void *key;
+  long refs;                                        // number of references
+};
+
+struct htintern {
+  struct hashtable *entries;                        // of struct intern_entry
+  void *(*key_clone)(const void *);
+  int (*key_hash)(const void *, int);
+  int (*key_compare)(const void *, const void *);
+  void (*key_destroy)(void *);
+  void (*key_print)(const void *);
+  int count;                                        // number of keys
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void *entry_clone(const void *entry);
+static int entry_hash(const void *entry, int hash_length);
+static int entry_compare(const void *a, const void *b);
+static void entry_destroy(void *entry);
+static void entry_print(const void *entry);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htintern *htintern_create(void *(*key_clone)(const void *),
+                                 int (*key_hash)(const void *, int),
+                                 int hash_length,
+                                 int (*key_compare)(const void *, const void *),
+                                 void (*key_destroy)(void *),
+                                 void (*key_print)(const void *)) {
+  assert(key_clone);
+  assert(key_hash);
+  assert(hash_length > 0);
+  assert(key_compare);
+  assert(key_destroy);
+  assert(key_print);
+
+  struct htintern *pool = malloc(sizeof(struct htintern));
+  pool->entries = ht_create(entry_clone, entry_hash, hash_length, entry_compare,
+                            entry_destroy, entry_print);
+  pool->key_clone = key_clone;
+  pool->key_hash = key_hash;
+  pool->key_compare = key_compare;
+  pool->key_destroy = key_destroy;
+  pool->key_print = key_print;
+  pool->count = 0;
+  return pool;
+}
+
+void htintern_destroy(struct htintern *pool) {
+  assert(pool);
+  ht_destroy(pool->entries);
+  free(pool);
+}
+
+void *htintern_get(struct htintern *pool, const void *key) {
+  assert(pool);
+  assert(key);
+  const struct intern_entry probe = {pool, (void *)key, 0};
+  struct intern_entry *e = (struct intern_entry *)ht_lookup(pool->entries, &probe);
+  if (e) {
+    e->refs++;
+    return e;
+  }
+  e = malloc(sizeof(struct intern_entry));
+  e->pool = pool;
+  e->key = pool->key_clone(key);
+  e->refs = 1;
+  ht_adopt(pool->entries, e);
+  pool->count++;
+  return e;
+}
+
+const void *htintern_key(const void *handle) {
+  assert(handle);
+  return ((const struct intern_entry *)handle)->key;
+}
+
+int htintern_count(const struct htintern *pool) {
+  assert(pool);
+  return pool->count;
+}
+
+void *htintern_ref(const void *handle) {
+  assert(handle);
+  struct intern_entry *e = (struct intern_entry *)handle;
+  e->refs++;
+  return e;
+}
+
+int htintern_hash(const void *handle, int hash_length) {
+  assert(handle);
+  assert(0 < hash_length && hash_length < 32);
+  uint64_t h = (uintptr_t)handle;
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h >> (64 - hash_length);
+}
+
+int htintern_compare(const void *a, const void *b) {
+  assert(a);
+  assert(b);
+  const uintptr_t x = (uintptr_t)a;
+  const uintptr_t y = (uintptr_t)b;
+  return (x > y) - (x < y);
+}
+
+void htintern_release(void *handle) {
+  assert(handle);
+  struct intern_entry *e = handle;
+  assert(e->refs > 0);
+  if (--e->refs == 0) {
+    struct htintern *pool = e->pool;
+    const struct intern_entry probe = {pool, e->key, 0};
+    ht_remove(pool->entries, &probe);
+    pool->count--;
+  }
+}
+
+void htintern_print(const void *handle) {
+  assert(handle);
+  const struct intern_entry *e = handle;
+  e->pool->key_print(e->key);
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// entry_clone(entry) is a helper function that returns a new entry with a
+//  copy of the key of entry and no references (the pool adopts its entries
+//  instead of cloning them)
+// requires: entry is a valid pointer
+// effects: allocates memory (caller must call entry_destroy)
+// time: O(cl)
+static void *entry_clone(const void *entry) {
+  const struct intern_entry *e = entry;
+  assert(e);
+  struct intern_entry *copy = malloc(sizeof(struct intern_entry));
+  copy->pool = e->pool;
+  copy->key = e->pool->key_clone(e->key);
+  copy->refs = 0;
+  return copy;
+}
+
+// entry_hash(entry, hash_length) is a helper function that returns the
+//  key_hash of the key of entry
+// requires: entry is a valid pointer
+// time: O(hf)
+static int entry_hash(const void *entry, int hash_length) {
+  const struct intern_entry *e = entry;
+  assert(e);
+  return e->pool->key_hash(e->key, hash_length);
+}
+
+// entry_compare(a, b) is a helper function that returns the key_compare of
+//  the keys of the entries a and b
+// requires: all pointers are valid
+// time: O(co)
+static int entry_compare(const void *a, const void *b) {
+  const struct intern_entry *x = a;
+  const struct intern_entry *y = b;
+  assert(x);
+  assert(y);
+  return x->pool->key_compare(x->key, y->key);
+}
+
+// entry_destroy(entry) is a helper function that frees entry and its key
+// requires: entry is a valid pointer
+// effects: invalidates entry
+// time: O(ds)
+static void entry_destroy(void *entry) {
+  struct intern_entry *e = entry;
+  assert(e);
+  e->pool->key_destroy(e->key);
+  free(e);
+}
+
+// entry_print(entry) is a helper function that prints the key of entry
+// requires: entry is a valid pointer
+// effects: creates output
+// time: O(cp)
+static void entry_print(const void *entry) {
+  const struct intern_entry *e = entry;
+  assert(e);
+  e->pool->key_print(e->key);
+}
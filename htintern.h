@@ -0,0 +1,84 @@
+// This is the interface of a pool of interned keys for generic hash
+//   tables. The pool stores a single reference-counted copy of every
+//   distinct key and hands out a handle for it, so equal keys get the same
+//   handle. Tables that store handles instead of keys (using the connectors
+//   htintern_ref, htintern_hash, htintern_compare, htintern_release and
+//   htintern_print) compare keys by their handles, and a key that is stored
+//   in several tables is only stored once.
+//   A pool and the tables that use its handles must not be used by several
+//   threads at the same time.
+
+// a pool of interned keys
+struct htintern;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htintern_create(key_clone, key_hash, hash_length, key_compare,
+//   key_destroy, key_print) creates an empty pool of keys. The parameters
+//   have the same meaning as for ht_create (see hashtable.h).
+// effects: allocates heap memory; client must call htintern_destroy
+// requires: hash_length must be positive
+// time: O(n), where n is the length of the pool (2^hash_length)
+struct htintern *htintern_create(void *(*key_clone)(const void *),
+                                 int (*key_hash)(const void *, int),
+                                 int hash_length,
+                                 int (*key_compare)(const void *, const void *),
+                                 void (*key_destroy)(void *),
+                                 void (*key_print)(const void *));
+
+// htintern_destroy(pool) frees all resources of pool, including all keys
+//   that still have references.
+// effects: invalidates pool and all of its handles
+// time: O(n + m * ds), where m is the number of keys in pool
+void htintern_destroy(struct htintern *pool);
+
+// htintern_get(pool, key) returns the handle of key in pool, interning a
+//   copy of key first if it is not in pool yet. The caller owns a reference
+//   to the handle.
+// effects: may allocate heap memory; client must call htintern_release
+// time: O(hf + m * co), plus O(cl) if key is new, where m is the number of
+//   keys in the bucket of key
+void *htintern_get(struct htintern *pool, const void *key);
+
+// htintern_key(handle) returns the key of handle. It is valid as long as
+//   handle is.
+// time: O(1)
+const void *htintern_key(const void *handle);
+
+// htintern_count(pool) returns the number of distinct keys in pool.
+// time: O(1)
+int htintern_count(const struct htintern *pool);
+
+// The functions below are connectors for tables that store handles, e.g.
+//   ht_create(htintern_ref, htintern_hash, hash_length, htintern_compare,
+//             htintern_release, htintern_print)
+//   All handles stored in such a table must belong to the same pool.
+
+// htintern_ref(handle) adds a reference to handle and returns handle.
+// effects: modifies the pool of handle
+// time: O(1)
+void *htintern_ref(const void *handle);
+
+// htintern_hash(handle, hash_length) returns a hash of handle in
+//   [0, 2^hash_length). It depends on the identity of handle, not on the
+//   content of its key.
+// time: O(1)
+int htintern_hash(const void *handle, int hash_length);
+
+// htintern_compare(a, b) returns 0 if a and b are the same handle (so
+//   their keys are equal), and otherwise a negative or positive value that
+//   orders handles by their identity.
+// time: O(1)
+int htintern_compare(const void *a, const void *b);
+
+// htintern_release(handle) drops a reference to handle. The key of handle
+//   is removed from its pool when its last reference is dropped.
+// effects: may invalidate handle
+// time: O(1), or O(hf + m * co + ds) if the key is removed
+void htintern_release(void *handle);
+
+// htintern_print(handle) prints the key of handle with the key_print of
+//   its pool.
+// effects: creates output
+// time: O(cp)
+void htintern_print(const void *handle);
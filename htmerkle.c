@@ -0,0 +1,199 @@
+// This is the implementation of Merkle digests.
+//   The tree is stored in an array of 2n digests (n buckets) in heap order;
+//   entry 0 is unused. A leaf holds the sum of the hashes of the keys of its
+//   bucket, and an inner node holds a mix of the digests of its children,
+//   so a change of a leaf changes all digests on its path to the root.
+
+#include <stdlib.h>
+#include "htmerkle.h"
+#include <assert.h>
+#include <stdbool.h>
+
+struct htmerkle {
+  struct hashtable *ht;
+  int (*key_encode)(const void *, void *, int);
+  int ht_len;                                       // number of buckets
+  uint64_t *tree;                                   // 2 * ht_len digests
+};
+
+// the context of add_key
+struct merkle_add_ctx {
+  struct htmerkle *m;
+  uint64_t sum;
+};
+
+// the context of insert_key
+struct merkle_sync_ctx {
+  struct hashtable *ht;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void merkle_observer(void *ctx, int op, const void *key, int index);
+static void add_key(void *ctx, const void *key);
+static void insert_key(void *ctx, const void *key);
+static uint64_t combine(uint64_t left, uint64_t right);
+static void update_path(struct htmerkle *m, int index);
+static int diff_nodes(const struct htmerkle *a, const struct htmerkle *b,
+                      int node, int *buckets, int max, int found);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htmerkle *htmerkle_create(struct hashtable *ht,
+                                 int (*key_encode)(const void *, void *, int)) {
+  assert(ht);
+  assert(key_encode);
+  struct htmerkle *m = malloc(sizeof(struct htmerkle));
+  m->ht = ht;
+  m->key_encode = key_encode;
+  m->ht_len = ht_length(ht);
+  m->tree = malloc(sizeof(uint64_t) * 2 * m->ht_len);
+  m->tree[0] = 0;
+  for (int i = 0; i < m->ht_len; i++) {
+    struct merkle_add_ctx ctx = {m, 0};
+    ht_bucket_foreach(ht, i, add_key, &ctx);
+    m->tree[m->ht_len + i] = ctx.sum;
+  }
+  for (int node = m->ht_len - 1; node >= 1; node--) {
+    m->tree[node] = combine(m->tree[2 * node], m->tree[2 * node + 1]);
+  }
+  ht_observe(ht, merkle_observer, m);
+  return m;
+}
+
+void htmerkle_destroy(struct htmerkle *m) {
+  assert(m);
+  ht_unobserve(m->ht, merkle_observer, m);
+  free(m->tree);
+  free(m);
+}
+
+uint64_t htmerkle_node(const struct htmerkle *m, int node) {
+  assert(m);
+  assert(1 <= node && node < 2 * m->ht_len);
+  return m->tree[node];
+}
+
+int htmerkle_diff(const struct htmerkle *a, const struct htmerkle *b,
+                  int *buckets, int max) {
+  assert(a);
+  assert(b);
+  assert(buckets || max == 0);
+  assert(a->ht_len == b->ht_len);
+  return diff_nodes(a, b, 1, buckets, max, 0);
+}
+
+int htmerkle_sync(const struct htmerkle *from, struct htmerkle *to) {
+  assert(from);
+  assert(to);
+  assert(from->ht_len == to->ht_len);
+  const int count = htmerkle_diff(from, to, NULL, 0);
+  if (count == 0) {
+    return 0;
+  }
+  int *buckets = malloc(sizeof(int) * count);
+  htmerkle_diff(from, to, buckets, count);
+  // clearing and refilling the buckets of to updates its digest through
+  //  the observer
+  for (int i = 0; i < count; i++) {
+    ht_bucket_clear(to->ht, buckets[i]);
+    struct merkle_sync_ctx ctx = {to->ht};
+    ht_bucket_foreach(from->ht, buckets[i], insert_key, &ctx);
+  }
+  free(buckets);
+  return count;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// merkle_observer(ctx, op, key, index) is a helper function that is
+//  registered with ht_observe; it adds the hash of an inserted key to the
+//  leaf of its bucket or subtracts the hash of a removed key, and updates
+//  the path to the root
+// requires: all pointers are valid
+// effects: modifies the digest ctx
+// time: O(en + log n)
+static void merkle_observer(void *ctx, int op, const void *key, int index) {
+  struct htmerkle *m = ctx;
+  assert(m);
+  assert(key);
+  const uint64_t h = ht_key_hash64(key, m->key_encode);
+  if (op == HT_OP_INSERT) {
+    m->tree[m->ht_len + index] += h;
+  } else {
+    m->tree[m->ht_len + index] -= h;
+  }
+  update_path(m, index);
+}
+
+// add_key(ctx, key) is a helper function that adds the hash of key to the
+//  sum of the context ctx (a struct merkle_add_ctx)
+// requires: all pointers are valid
+// effects: modifies ctx
+// time: O(en)
+static void add_key(void *ctx, const void *key) {
+  struct merkle_add_ctx *a = ctx;
+  assert(a);
+  a->sum += ht_key_hash64(key, a->m->key_encode);
+}
+
+// insert_key(ctx, key) is a helper function that inserts key into the
+//  table of the context ctx (a struct merkle_sync_ctx)
+// requires: all pointers are valid
+// effects: modifies the table of ctx
+// time: O(ht_insert)
+static void insert_key(void *ctx, const void *key) {
+  struct merkle_sync_ctx *s = ctx;
+  assert(s);
+  ht_insert(s->ht, key);
+}
+
+// combine(left, right) is a helper function that returns the digest of a
+//  node with the children digests left and right; it is not symmetric, so
+//  swapping two subtrees changes the digest
+// time: O(1)
+static uint64_t combine(uint64_t left, uint64_t right) {
+  uint64_t h = left * 0x9e3779b97f4a7c15ULL + ((right << 29) | (right >> 35));
+  h ^= h >> 32;
+  h *= 0xd6e8feb86659fd93ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+// update_path(m, index) is a helper function that recomputes the digests of
+//  the ancestors of the leaf of bucket index
+// requires: m is a valid pointer
+// effects: modifies m
+// time: O(log n)
+static void update_path(struct htmerkle *m, int index) {
+  assert(m);
+  for (int node = (m->ht_len + index) / 2; node >= 1; node /= 2) {
+    m->tree[node] = combine(m->tree[2 * node], m->tree[2 * node + 1]);
+  }
+}
+
+// diff_nodes(a, b, node, buckets, max, found) is a helper function that
+//  appends the differing buckets below node to buckets, which already holds
+//  found of them (only the first max are stored), and returns the new
+//  number of differing buckets
+// requires: a and b are valid pointers
+// effects: modifies buckets
+// time: O(k log n) where k is the number of differing buckets below node
+static int diff_nodes(const struct htmerkle *a, const struct htmerkle *b,
+                      int node, int *buckets, int max, int found) {
+  assert(a);
+  assert(b);
+  if (a->tree[node] == b->tree[node]) {
+    return found;
+  }
+  if (node >= a->ht_len) {
+    if (found < max) {
+      buckets[found] = node - a->ht_len;
+    }
+    return found + 1;
+  }
+  found = diff_nodes(a, b, 2 * node, buckets, max, found);
+  return diff_nodes(a, b, 2 * node + 1, buckets, max, found);
+}
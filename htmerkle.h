@@ -0,0 +1,64 @@
+// This is the interface of Merkle digests for generic hash tables. A
+//   digest observes a table and keeps, for every bucket, the sum of the
+//   64-bit hashes of its keys (so it does not depend on the order of
+//   insertion), and a Merkle tree over the buckets: a node digests the two
+//   halves of its range of buckets. Every insertion and removal updates one
+//   leaf and the O(log n) nodes above it.
+//   Two tables with the same hash length are compared by walking their
+//   trees from the root and only descending into subtrees whose digests
+//   differ, so a few mismatched buckets are found in O(k log n) time instead
+//   of by iterating both tables.
+//   Keys are hashed through their key_encode encoding (see htsnapshot.h),
+//   so tables compare equal if their keys have equal encodings.
+
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// a Merkle digest of a table
+struct htmerkle;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htmerkle_create(ht, key_encode) creates a digest of ht.
+// effects: allocates heap memory and registers an observer with ht; client
+//          must call htmerkle_destroy
+// time: O(n + m * en), where n is the length and m the number of items of
+//   ht and en is the complexity of key_encode
+struct htmerkle *htmerkle_create(struct hashtable *ht,
+                                 int (*key_encode)(const void *, void *, int));
+
+// htmerkle_destroy(m) stops tracking and frees all resources of m.
+// effects: invalidates m; modifies the table of m
+// time: O(o), where o is the number of observers of the table
+void htmerkle_destroy(struct htmerkle *m);
+
+// htmerkle_node(m, node) returns the digest of node of the tree of m. The
+//   nodes are numbered like a binary heap: the root is 1, the children of
+//   node i are 2i and 2i + 1, and the leaf of bucket b is n + b, where n is
+//   the length of the table. Two replicas in different processes can be
+//   compared by exchanging node digests, starting with the root.
+// requires: 1 <= node < 2 * n
+// time: O(1)
+uint64_t htmerkle_node(const struct htmerkle *m, int node);
+
+// htmerkle_diff(a, b, buckets, max) stores the indexes of the buckets whose
+//   digests differ between a and b in increasing order in buckets (at most
+//   max of them) and returns their number (also if it is larger than max).
+// requires: the tables of a and b have the same length
+//           buckets may be NULL if max is 0
+// effects: modifies buckets
+// time: O(k log n), where k is the number of differing buckets and n is the
+//   length of the tables
+int htmerkle_diff(const struct htmerkle *a, const struct htmerkle *b,
+                  int *buckets, int max);
+
+// htmerkle_sync(from, to) makes the table of to equal to the table of from
+//   by replacing every bucket of to whose digest differs with a copy of the
+//   bucket of from, and returns the number of replaced buckets.
+// effects: modifies the table of to and to
+// requires: the tables of from and to have the same length and the same
+//           connectors
+// time: O(k log n + c * cl + d * ds), where k is the number of differing
+//   buckets, c the number of keys copied and d the number of keys removed
+int htmerkle_sync(const struct htmerkle *from, struct htmerkle *to);
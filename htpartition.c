@@ -0,0 +1,213 @@
+// This is the implementation of the partitioning layer.
+//   A resize walks the old tables one by one. The keys of a table that
+//   move are collected with their new partitions and sorted by partition;
+//   each group is inserted into its new table with one batch insertion, and
+//   then all of them are removed from the old table with one batch removal,
+//   using the copies in the new tables as the keys to remove (the keys of
+//   the old table are destroyed by the removal itself).
+
+#include <stdlib.h>
+#include "htpartition.h"
+#include <assert.h>
+
+struct htpart {
+  struct hashtable **tables;
+  int n;                                            // number of partitions
+  int (*key_encode)(const void *, void *, int);
+};
+
+// a key that moves to another partition
+struct part_move {
+  const void *key;
+  int to;
+};
+
+// the context of collect_moves
+struct part_collect_ctx {
+  const struct htpart *p;
+  int from;                                         // partition of the table
+  int n;                                            // new number of partitions
+  struct part_move *moves;
+  int len;
+  int cap;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void collect_moves(void *ctx, const void *key);
+static int migrate_table(struct htpart *p, int from,
+                         struct hashtable **tables, int n);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+int htpart_jump(uint64_t key, int n) {
+  assert(n > 0);
+  int64_t b = -1;
+  int64_t j = 0;
+  while (j < n) {
+    b = j;
+    key = key * 2862933555777941757ULL + 1;
+    j = (int64_t)((b + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+  }
+  return (int)b;
+}
+
+struct htpart *htpart_create(struct hashtable **tables, int n,
+                             int (*key_encode)(const void *, void *, int)) {
+  assert(tables);
+  assert(n > 0);
+  assert(key_encode);
+  struct htpart *p = malloc(sizeof(struct htpart));
+  p->tables = malloc(sizeof(struct hashtable *) * n);
+  for (int i = 0; i < n; i++) {
+    assert(tables[i]);
+    p->tables[i] = tables[i];
+  }
+  p->n = n;
+  p->key_encode = key_encode;
+  return p;
+}
+
+void htpart_destroy(struct htpart *p) {
+  assert(p);
+  free(p->tables);
+  free(p);
+}
+
+int htpart_count(const struct htpart *p) {
+  assert(p);
+  return p->n;
+}
+
+struct hashtable *htpart_table(const struct htpart *p, int i) {
+  assert(p);
+  assert(0 <= i && i < p->n);
+  return p->tables[i];
+}
+
+int htpart_of(const struct htpart *p, const void *key) {
+  assert(p);
+  assert(key);
+  return htpart_jump(ht_key_hash64(key, p->key_encode), p->n);
+}
+
+int htpart_insert(struct htpart *p, const void *key) {
+  assert(p);
+  assert(key);
+  return ht_insert(p->tables[htpart_of(p, key)], key);
+}
+
+int htpart_remove(struct htpart *p, const void *key) {
+  assert(p);
+  assert(key);
+  return ht_remove(p->tables[htpart_of(p, key)], key);
+}
+
+bool htpart_contains(const struct htpart *p, const void *key) {
+  assert(p);
+  assert(key);
+  return ht_contains(p->tables[htpart_of(p, key)], key);
+}
+
+int htpart_resize(struct htpart *p, struct hashtable **tables, int n) {
+  assert(p);
+  assert(tables);
+  assert(n > 0);
+  for (int i = 0; i < n; i++) {
+    assert(tables[i]);
+    assert(i >= p->n || tables[i] == p->tables[i]);
+  }
+
+  int moved = 0;
+  for (int from = 0; from < p->n; from++) {
+    moved += migrate_table(p, from, tables, n);
+  }
+  p->tables = realloc(p->tables, sizeof(struct hashtable *) * n);
+  for (int i = 0; i < n; i++) {
+    p->tables[i] = tables[i];
+  }
+  p->n = n;
+  return moved;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// collect_moves(ctx, key) is a helper function that appends key to the
+//  moves of the context ctx (a struct part_collect_ctx) if its partition
+//  among the new number of partitions differs from the table it is in
+// requires: all pointers are valid
+// effects: modifies ctx
+// time: O(en + log n) amortized
+static void collect_moves(void *ctx, const void *key) {
+  struct part_collect_ctx *c = ctx;
+  assert(c);
+  assert(key);
+  const int to = htpart_jump(ht_key_hash64(key, c->p->key_encode), c->n);
+  if (to == c->from) {
+    return;
+  }
+  if (c->len == c->cap) {
+    c->cap = c->cap ? 2 * c->cap : 64;
+    c->moves = realloc(c->moves, sizeof(struct part_move) * c->cap);
+  }
+  c->moves[c->len].key = key;
+  c->moves[c->len].to = to;
+  c->len++;
+}
+
+// migrate_table(p, from, tables, n) is a helper function that moves the
+//  keys of the table of partition from of p whose partition among the n
+//  partitions of tables differs, and returns their number
+// requires: all pointers are valid
+// effects: modifies the tables
+// time: O(m * (en + log n) + k * (cl + ds + t)) where m is the number of
+//  keys of the table and k the number of moved keys
+static int migrate_table(struct htpart *p, int from,
+                         struct hashtable **tables, int n) {
+  assert(p);
+  assert(tables);
+  struct hashtable *source = p->tables[from];
+  struct part_collect_ctx c = {p, from, n, NULL, 0, 0};
+  ht_foreach(source, collect_moves, &c);
+  if (c.len == 0) {
+    return 0;
+  }
+
+  // sort the moves by partition (counting sort)
+  int *start = calloc(n + 1, sizeof(int));
+  for (int i = 0; i < c.len; i++) {
+    start[c.moves[i].to + 1]++;
+  }
+  for (int to = 0; to < n; to++) {
+    start[to + 1] += start[to];
+  }
+  const void **keys = malloc(sizeof(void *) * c.len);
+  int *fill = malloc(sizeof(int) * n);
+  for (int to = 0; to < n; to++) {
+    fill[to] = start[to];
+  }
+  for (int i = 0; i < c.len; i++) {
+    keys[fill[c.moves[i].to]++] = c.moves[i].key;
+  }
+  free(fill);
+  free(c.moves);
+
+  int *results = malloc(sizeof(int) * c.len);
+  for (int to = 0; to < n; to++) {
+    if (start[to + 1] > start[to]) {
+      ht_insert_batch(tables[to], keys + start[to], start[to + 1] - start[to],
+                      results + start[to]);
+      // from now on, refer to the copies in the new table
+      for (int i = start[to]; i < start[to + 1]; i++) {
+        keys[i] = ht_lookup(tables[to], keys[i]);
+      }
+    }
+  }
+  ht_remove_batch(source, keys, c.len, results);
+  free(results);
+  free(keys);
+  free(start);
+  return c.len;
+}
@@ -0,0 +1,83 @@
+// This is the interface of a partitioning layer that spreads the keys of a
+//   generic key set over several hash tables (e.g. one per worker process)
+//   with jump consistent hash. When the number of partitions changes from
+//   n to n', only about |n' - n| / max(n, n') of the keys move, and they are
+//   migrated in bulk with the batch functions of hashtable.h.
+//   Keys are hashed with ht_key_hash64 (see hashtable.h) through their
+//   key_encode encoding, so a key lands in the same partition in every
+//   process.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// a partitioned key set
+struct htpart;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htpart_jump(key, n) returns the partition (0 <= partition < n) of the
+//   64-bit key hash key among n partitions, by jump consistent hash
+//   (Lamping and Veach).
+// requires: n must be positive
+// time: O(log n)
+int htpart_jump(uint64_t key, int n);
+
+// htpart_create(tables, n, key_encode) creates a partitioned key set over
+//   the n tables of tables; table i holds partition i. The tables are not
+//   copied and remain owned by the caller.
+// effects: allocates heap memory; client must call htpart_destroy
+// requires: n must be positive; the tables have the same connectors
+//           every table only holds keys of its partition
+// time: O(n)
+struct htpart *htpart_create(struct hashtable **tables, int n,
+                             int (*key_encode)(const void *, void *, int));
+
+// htpart_destroy(p) frees all resources of p (but not its tables).
+// effects: invalidates p
+// time: O(1)
+void htpart_destroy(struct htpart *p);
+
+// htpart_count(p) returns the number of partitions of p.
+// time: O(1)
+int htpart_count(const struct htpart *p);
+
+// htpart_table(p, i) returns the table of partition i of p.
+// requires: 0 <= i < htpart_count(p)
+// time: O(1)
+struct hashtable *htpart_table(const struct htpart *p, int i);
+
+// htpart_of(p, key) returns the partition of key in p.
+// time: O(en + log n), where en is the complexity of key_encode
+int htpart_of(const struct htpart *p, const void *key);
+
+// htpart_insert(p, key) inserts key into the table of its partition, like
+//   ht_insert.
+// time: O(en + log n + ht_insert)
+int htpart_insert(struct htpart *p, const void *key);
+
+// htpart_remove(p, key) removes key from the table of its partition, like
+//   ht_remove.
+// time: O(en + log n + ht_remove)
+int htpart_remove(struct htpart *p, const void *key);
+
+// htpart_contains(p, key) returns true if key is stored in p.
+// time: O(en + log n + ht_contains)
+bool htpart_contains(const struct htpart *p, const void *key);
+
+// htpart_resize(p, tables, n) changes the partitions of p to the n tables
+//   of tables and migrates every key whose partition changes to the table
+//   of its new partition. The function returns the number of moved keys.
+//   After growing, the new tables hold the keys that moved to them; after
+//   shrinking, the tables that are no longer used are empty (the caller may
+//   destroy them).
+// effects: modifies p and the tables
+// requires: n must be positive
+//           tables[i] is the table of partition i of p for
+//           i < min(n, htpart_count(p)); tables beyond the old count are
+//           empty
+// time: O(m * (en + log n) + k * (cl + ds + t)), where m is the number of
+//   keys of p, k the number of moved keys and t the time of a table
+//   operation
+int htpart_resize(struct htpart *p, struct hashtable **tables, int n);
@@ -0,0 +1,186 @@
+// This is the interface of perfect-hash sets of strings that are built at
+//   compile time (C++17). ht::make_perfect_set("GET", "PUT", ...) computes
+//   a table in which every key has its own slot, so a lookup hashes the key
+//   once, reads one displacement and one slot, and compares one string; no
+//   code runs at startup and the table can live in read-only memory.
+//   The builder uses hash and displace: the keys are split into buckets by
+//   their hash, and for every bucket (largest first) it searches a
+//   displacement that sends all keys of the bucket to free slots. Building
+//   fails to compile if two keys are equal (or, very rarely, if two keys
+//   have the same 64-bit hash).
+
+#ifndef HTPERFECT_HPP
+#define HTPERFECT_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace ht {
+
+// perfect_detail holds the hash functions of the builder and the lookups.
+namespace perfect_detail {
+
+// hash(key) returns the 64-bit FNV-1a hash of key.
+// time: O(len)
+constexpr std::uint64_t hash(std::string_view key) {
+  std::uint64_t h = 0xcbf29ce484222325ULL;
+  for (char c : key) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// slot(h, displacement) returns a mix of the hash h and displacement (the
+//   splitmix64 finalizer); its low bits select the slot of a key.
+// time: O(1)
+constexpr std::uint64_t slot(std::uint64_t h, std::uint32_t displacement) {
+  h += (displacement + 1) * 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+// capacity(n) returns the number of slots for n keys: the smallest power of
+//   2 that keeps the load at most 3/4.
+// time: O(log n)
+constexpr std::size_t capacity(std::size_t n) {
+  std::size_t c = 1;
+  while (c * 3 < n * 4) {
+    c *= 2;
+  }
+  return c;
+}
+
+}  // namespace perfect_detail
+
+// PerfectSet<N> is a perfect-hash set of N strings. The strings are not
+// copied: the keys must outlive the set (string literals always do).
+template <std::size_t N>
+class PerfectSet {
+ public:
+  static constexpr std::size_t capacity = perfect_detail::capacity(N);
+
+  // PerfectSet(keys) builds the set of keys; keys[i] gets the index i.
+  // requires: the keys are distinct
+  // time: O(N * N + N * d), where d is the average number of displacements
+  //   tried per bucket
+  constexpr explicit PerfectSet(const std::array<std::string_view, N> &keys)
+      : slots_{}, indexes_{}, displacements_{} {
+    constexpr std::size_t mask = capacity - 1;
+    std::array<std::uint64_t, N> hashes{};
+    std::array<std::size_t, capacity> sizes{};
+    for (std::size_t i = 0; i < N; i++) {
+      hashes[i] = perfect_detail::hash(keys[i]);
+      for (std::size_t j = 0; j < i; j++) {
+        if (hashes[j] == hashes[i]) {
+          throw std::logic_error("PerfectSet: keys must have distinct hashes");
+        }
+      }
+      sizes[hashes[i] & mask]++;
+    }
+    for (std::size_t s = 0; s < capacity; s++) {
+      indexes_[s] = -1;
+    }
+
+    // buckets ordered by decreasing size (insertion sort)
+    std::array<std::size_t, capacity> order{};
+    for (std::size_t b = 0; b < capacity; b++) {
+      std::size_t pos = b;
+      while (pos > 0 && sizes[order[pos - 1]] < sizes[b]) {
+        order[pos] = order[pos - 1];
+        pos--;
+      }
+      order[pos] = b;
+    }
+
+    std::array<std::size_t, (N > 0 ? N : 1)> members{};
+    for (std::size_t o = 0; o < capacity && sizes[order[o]] > 0; o++) {
+      const std::size_t bucket = order[o];
+      std::size_t len = 0;
+      for (std::size_t i = 0; i < N; i++) {
+        if ((hashes[i] & mask) == bucket) {
+          members[len++] = i;
+        }
+      }
+      std::uint32_t d = 0;
+      while (!fits(hashes, members, len, d)) {
+        if (++d == 0) {
+          throw std::logic_error("PerfectSet: no displacement found");
+        }
+      }
+      displacements_[bucket] = d;
+      for (std::size_t k = 0; k < len; k++) {
+        const std::size_t s = perfect_detail::slot(hashes[members[k]], d) & mask;
+        slots_[s] = keys[members[k]];
+        indexes_[s] = static_cast<int>(members[k]);
+      }
+    }
+  }
+
+  // index(key) returns the index of key in the keys the set was built
+  //   from, or -1 if key is not in the set.
+  // time: O(len)
+  constexpr int index(std::string_view key) const {
+    const std::uint64_t h = perfect_detail::hash(key);
+    const std::size_t s =
+        perfect_detail::slot(h, displacements_[h & (capacity - 1)]) & (capacity - 1);
+    return indexes_[s] >= 0 && slots_[s] == key ? indexes_[s] : -1;
+  }
+
+  // contains(key) returns true if key is in the set.
+  // time: O(len)
+  constexpr bool contains(std::string_view key) const {
+    return index(key) >= 0;
+  }
+
+  // size() returns the number of keys of the set.
+  // time: O(1)
+  constexpr std::size_t size() const {
+    return N;
+  }
+
+ private:
+  // fits(hashes, members, len, d) returns true if displacement d sends the
+  //   len keys members[0..len-1] to distinct free slots.
+  // time: O(len * len)
+  constexpr bool fits(const std::array<std::uint64_t, N> &hashes,
+                      const std::array<std::size_t, (N > 0 ? N : 1)> &members,
+                      std::size_t len, std::uint32_t d) const {
+    for (std::size_t k = 0; k < len; k++) {
+      const std::size_t s = perfect_detail::slot(hashes[members[k]], d) & (capacity - 1);
+      if (indexes_[s] >= 0) {
+        return false;
+      }
+      for (std::size_t j = 0; j < k; j++) {
+        if ((perfect_detail::slot(hashes[members[j]], d) & (capacity - 1)) == s) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  std::array<std::string_view, capacity> slots_;
+  std::array<int, capacity> indexes_;               // -1 if the slot is free
+  std::array<std::uint32_t, capacity> displacements_;  // per bucket
+};
+
+// make_perfect_set(keys...) returns the perfect-hash set of keys; the i-th
+//   key gets the index i (e.g. the value of the i-th enumerator).
+// requires: the keys are distinct
+template <typename... Keys>
+constexpr PerfectSet<sizeof...(Keys)> make_perfect_set(Keys... keys) {
+  return PerfectSet<sizeof...(Keys)>(
+      std::array<std::string_view, sizeof...(Keys)>{std::string_view(keys)...});
+}
+
+}  // namespace ht
+
+#endif
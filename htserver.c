@@ -0,0 +1,731 @@
+// This is the implementation of htserver (see htserver.h for the protocol).
+//   The server is a single thread with an epoll event loop over
+//   non-blocking sockets. Every connection has an input buffer that
+//   collects requests and an output buffer that collects responses: after
+//   every read, all complete requests in the input buffer are served, and
+//   the responses are written as far as the socket accepts them. While a
+//   connection has a large backlog of unwritten responses, the server stops
+//   reading from it. A client that shuts down its side of the connection
+//   still receives all responses; the connection is closed once they are
+//   written.
+//   When the process runs out of descriptors, the listening socket is taken
+//   out of the epoll set until a connection closes or a short pause has
+//   passed, so pending connections do not keep the loop spinning.
+//   Keys are served from the input buffer without copying: a key in a
+//   request (u32 key_len followed by the bytes) has the same layout as a
+//   key in a table, so only keys that are inserted are cloned.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "hashtable.h"
+#include "htserver.h"
+#include <assert.h>
+#include <stdbool.h>
+
+// the default hash length of tables
+#define SERVER_HASH_LENGTH 16
+// the number of bytes read from a socket at once
+#define SERVER_READ_BYTES (64 << 10)
+// a connection is not read while it has more unwritten output
+#define SERVER_MAX_OUTPUT (4 << 20)
+// the maximum number of events handled per epoll_wait
+#define SERVER_EVENTS 64
+// how long accepting pauses when the process is out of descriptors (ms)
+#define SERVER_ACCEPT_PAUSE_MS 100
+
+// a table hosted by the server
+struct server_table {
+  char name[256];
+  int name_len;
+  struct hashtable *ht;
+  uint32_t count;                                   // number of keys
+  struct server_table *next;
+};
+
+// a client connection
+struct server_conn {
+  int fd;
+  unsigned char *in;                                // received, unserved bytes
+  size_t in_len;
+  size_t in_cap;
+  unsigned char *out;                               // unwritten responses
+  size_t out_len;
+  size_t out_off;                                   // bytes of out already written
+  size_t out_cap;
+  uint32_t events;                                  // registered with epoll
+  bool eof;                                         // the client will send nothing more
+};
+
+// a parsed request
+struct server_request {
+  uint32_t id;
+  int op;
+  const char *name;
+  int name_len;
+  int count;                                        // number of keys
+  int first;                                        // index of its first key in keys
+  bool valid;
+};
+
+struct server {
+  int epoll_fd;
+  int listen_fd;
+  int hash_length;
+  struct server_table *tables;
+  const void **keys;                                // keys of the requests being served
+  int keys_cap;
+  int *results;
+  bool *found;
+  struct server_request *requests;                  // requests being served
+  int requests_cap;
+  bool accept_paused;                               // listen_fd is out of the epoll set
+  long long accept_resume_ms;                       // when accepting is tried again
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void *key_clone(const void *key);
+static int key_hash(const void *key, int hash_length);
+static int key_compare(const void *a, const void *b);
+static void key_destroy(void *key);
+static void key_print(const void *key);
+static uint32_t key_len(const void *key);
+static void on_signal(int sig);
+static int listen_on(const char *path);
+static void accept_clients(struct server *s);
+static void set_accepting(struct server *s, bool on);
+static long long now_ms(void);
+static void close_conn(struct server *s, struct server_conn *c);
+static bool read_conn(struct server *s, struct server_conn *c);
+static bool write_conn(struct server *s, struct server_conn *c);
+static void update_events(struct server *s, struct server_conn *c);
+static size_t serve_requests(struct server *s, struct server_conn *c);
+static bool parse_request(struct server *s, const unsigned char *p, size_t len,
+                          struct server_request *r);
+static void serve_run(struct server *s, struct server_conn *c,
+                      struct server_request *run, int n);
+static struct server_table *find_table(struct server *s, const char *name,
+                                       int name_len, bool create);
+static void put_response(struct server_conn *c, uint32_t id, int status,
+                         const unsigned char *results, int count);
+static void reserve(unsigned char **buf, size_t *cap, size_t len);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+// set by SIGINT and SIGTERM
+static volatile sig_atomic_t stop = 0;
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <socket path> [hash_length]\n", argv[0]);
+    return 1;
+  }
+  struct server s = {0};
+  s.hash_length = argc == 3 ? atoi(argv[2]) : SERVER_HASH_LENGTH;
+  if (s.hash_length <= 0 || s.hash_length > 30) {
+    fprintf(stderr, "%s: invalid hash length %s\n", argv[0], argv[2]);
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  s.listen_fd = listen_on(argv[1]);
+  if (s.listen_fd < 0) {
+    perror(argv[1]);
+    return 1;
+  }
+  s.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+  epoll_ctl(s.epoll_fd, EPOLL_CTL_ADD, s.listen_fd, &ev);
+
+  struct epoll_event events[SERVER_EVENTS];
+  while (!stop) {
+    const int timeout = s.accept_paused ? SERVER_ACCEPT_PAUSE_MS : -1;
+    const int n = epoll_wait(s.epoll_fd, events, SERVER_EVENTS, timeout);
+    if (n < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      break;
+    }
+    if (s.accept_paused && now_ms() >= s.accept_resume_ms) {
+      set_accepting(&s, true);
+    }
+    for (int i = 0; i < n; i++) {
+      struct server_conn *c = events[i].data.ptr;
+      if (c == NULL) {
+        accept_clients(&s);
+        continue;
+      }
+      bool open = true;
+      if (events[i].events & EPOLLOUT) {
+        open = write_conn(&s, c);
+      }
+      // a hang-up is noticed by read, after the last requests are served
+      if (open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        open = read_conn(&s, c);
+      }
+      if (!open) {
+        close_conn(&s, c);
+      }
+    }
+  }
+
+  // connections are left to the operating system
+  close(s.listen_fd);
+  close(s.epoll_fd);
+  unlink(argv[1]);
+  while (s.tables) {
+    struct server_table *t = s.tables;
+    s.tables = t->next;
+    ht_destroy(t->ht);
+    free(t);
+  }
+  free(s.keys);
+  free(s.results);
+  free(s.found);
+  free(s.requests);
+  return 0;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// key_clone(key) is the key_clone connector of the tables; a key is a u32
+//  length followed by the bytes of the key (not aligned)
+// requires: key is a valid pointer
+// effects: allocates memory (freed with key_destroy)
+// time: O(l) where l is the length of key
+static void *key_clone(const void *key) {
+  assert(key);
+  const size_t len = sizeof(uint32_t) + key_len(key);
+  void *clone = malloc(len);
+  memcpy(clone, key, len);
+  return clone;
+}
+
+// key_hash(key, hash_length) is the key_hash connector of the tables: the
+//  top hash_length bits of the 64-bit FNV-1a hash of the bytes of key
+// requires: key is a valid pointer
+// time: O(l) where l is the length of key
+static int key_hash(const void *key, int hash_length) {
+  assert(key);
+  const unsigned char *bytes = (const unsigned char *)key + sizeof(uint32_t);
+  const uint32_t len = key_len(key);
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (uint32_t i = 0; i < len; i++) {
+    h ^= bytes[i];
+    h *= 0x100000001b3ULL;
+  }
+  return (int)(h >> (64 - hash_length));
+}
+
+// key_compare(a, b) is the key_compare connector of the tables; it orders
+//  keys by their bytes, then by their length
+// requires: all pointers are valid
+// time: O(l) where l is the length of the shorter key
+static int key_compare(const void *a, const void *b) {
+  assert(a);
+  assert(b);
+  const uint32_t len_a = key_len(a);
+  const uint32_t len_b = key_len(b);
+  const int cmp = memcmp((const unsigned char *)a + sizeof(uint32_t),
+                         (const unsigned char *)b + sizeof(uint32_t),
+                         len_a < len_b ? len_a : len_b);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return (len_a > len_b) - (len_a < len_b);
+}
+
+// key_destroy(key) is the key_destroy connector of the tables
+// effects: frees memory
+// time: O(1)
+static void key_destroy(void *key) {
+  free(key);
+}
+
+// key_print(key) is the key_print connector of the tables
+// requires: key is a valid pointer
+// effects: creates output
+// time: O(l) where l is the length of key
+static void key_print(const void *key) {
+  assert(key);
+  printf("%.*s", (int)key_len(key), (const char *)key + sizeof(uint32_t));
+}
+
+// key_len(key) is a helper function that returns the length of key
+// requires: key is a valid pointer
+// time: O(1)
+static uint32_t key_len(const void *key) {
+  assert(key);
+  uint32_t len;
+  memcpy(&len, key, sizeof(len));
+  return len;
+}
+
+// on_signal(sig) is the handler of SIGINT and SIGTERM; it stops the event
+//  loop
+// effects: modifies stop
+// time: O(1)
+static void on_signal(int sig) {
+  (void)sig;
+  stop = 1;
+}
+
+// listen_on(path) is a helper function that returns a non-blocking socket
+//  listening on the Unix domain socket path (replacing an existing socket
+//  file), or -1 on failure
+// requires: path is a valid pointer
+// effects: creates a socket and a file
+// time: O(1)
+static int listen_on(const char *path) {
+  assert(path);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// accept_clients(s) is a helper function that accepts all pending
+//  connections of the server s. If the process or the system is out of
+//  descriptors or memory, accepting pauses (see set_accepting), since the
+//  pending connections would keep the listening socket readable.
+// requires: s is a valid pointer
+// effects: allocates memory for the connections (freed by close_conn); may
+//  modify the epoll set of s
+// time: O(p) where p is the number of pending connections
+static void accept_clients(struct server *s) {
+  assert(s);
+  for (;;) {
+    const int fd = accept4(s->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0 && (errno == EINTR || errno == ECONNABORTED)) {
+      continue;
+    }
+    if (fd < 0 && (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+                   errno == ENOMEM)) {
+      set_accepting(s, false);
+      return;
+    }
+    if (fd < 0) {
+      return;
+    }
+    struct server_conn *c = calloc(1, sizeof(struct server_conn));
+    c->fd = fd;
+    c->events = EPOLLIN;
+    struct epoll_event ev = {.events = c->events, .data.ptr = c};
+    epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+  }
+}
+
+// set_accepting(s, on) is a helper function that adds the listening socket
+//  of s to its epoll set (on is true) or takes it out for
+//  SERVER_ACCEPT_PAUSE_MS (on is false)
+// requires: s is a valid pointer
+// effects: modifies s and its epoll set
+// time: O(1)
+static void set_accepting(struct server *s, bool on) {
+  assert(s);
+  if (on == !s->accept_paused) {
+    return;
+  }
+  struct epoll_event ev = {.events = on ? EPOLLIN : 0, .data.ptr = NULL};
+  epoll_ctl(s->epoll_fd, EPOLL_CTL_MOD, s->listen_fd, &ev);
+  s->accept_paused = !on;
+  s->accept_resume_ms = now_ms() + SERVER_ACCEPT_PAUSE_MS;
+}
+
+// now_ms() is a helper function that returns the time of a monotonic clock
+//  in milliseconds
+// time: O(1)
+static long long now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// close_conn(s, c) is a helper function that closes the connection c; the
+//  descriptor it frees lets a paused server accept again
+// requires: all pointers are valid
+// effects: invalidates c; modifies s
+// time: O(1)
+static void close_conn(struct server *s, struct server_conn *c) {
+  assert(s);
+  assert(c);
+  epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+  close(c->fd);
+  free(c->in);
+  free(c->out);
+  free(c);
+  set_accepting(s, true);
+}
+
+// read_conn(s, c) is a helper function that reads from the connection c,
+//  serves all complete requests and writes their responses. At the end of
+//  the input, c stops reading but stays open until its responses are
+//  written. It returns false if c has to be closed.
+// requires: all pointers are valid
+// effects: modifies c and the tables of s; reads and writes the socket
+// time: O(b + r) where b is the number of bytes read and r is the time to
+//  serve the requests
+static bool read_conn(struct server *s, struct server_conn *c) {
+  assert(s);
+  assert(c);
+  while (!c->eof && c->out_len - c->out_off < SERVER_MAX_OUTPUT) {
+    reserve(&c->in, &c->in_cap, c->in_len + SERVER_READ_BYTES);
+    const ssize_t n = read(c->fd, c->in + c->in_len, SERVER_READ_BYTES);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno == EAGAIN) {
+      break;
+    }
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      c->eof = true;                                // a half-close: flush, then close
+      break;
+    }
+    c->in_len += n;
+
+    const size_t served = serve_requests(s, c);
+    if (served == (size_t)-1) {
+      return false;
+    }
+    memmove(c->in, c->in + served, c->in_len - served);
+    c->in_len -= served;
+    if (!write_conn(s, c)) {
+      return false;
+    }
+  }
+  if (c->eof && c->out_len == c->out_off) {
+    return false;
+  }
+  update_events(s, c);
+  return true;
+}
+
+// write_conn(s, c) is a helper function that writes as many responses of
+//  the connection c as the socket accepts. It returns false if c has to be
+//  closed (also once all responses of a client at the end of its input
+//  are written).
+// requires: all pointers are valid
+// effects: modifies c; writes the socket
+// time: O(b) where b is the number of bytes written
+static bool write_conn(struct server *s, struct server_conn *c) {
+  assert(s);
+  assert(c);
+  while (c->out_off < c->out_len) {
+    const ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off,
+                           MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno == EAGAIN) {
+      break;
+    }
+    if (n < 0) {
+      return false;
+    }
+    c->out_off += n;
+  }
+  if (c->out_off == c->out_len) {
+    c->out_off = 0;
+    c->out_len = 0;
+    if (c->eof) {
+      return false;
+    }
+  }
+  update_events(s, c);
+  return true;
+}
+
+// update_events(s, c) is a helper function that registers c for output
+//  events while it has unwritten responses and for input events while its
+//  backlog of responses is small and its input has not ended
+// requires: all pointers are valid
+// effects: modifies c and the epoll set of s
+// time: O(1)
+static void update_events(struct server *s, struct server_conn *c) {
+  assert(s);
+  assert(c);
+  const size_t pending = c->out_len - c->out_off;
+  const uint32_t events = (!c->eof && pending < SERVER_MAX_OUTPUT ? EPOLLIN : 0) |
+                          (pending > 0 ? EPOLLOUT : 0);
+  if (events != c->events) {
+    c->events = events;
+    struct epoll_event ev = {.events = events, .data.ptr = c};
+    epoll_ctl(s->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+  }
+}
+
+// serve_requests(s, c) is a helper function that serves all complete
+//  requests at the start of the input buffer of c and returns the number
+//  of bytes they take, or (size_t)-1 if a request is too large. Runs of
+//  requests with the same operation and table are served together.
+// requires: all pointers are valid
+// effects: modifies c and the tables of s
+// time: O(b + k * t) where b is the number of bytes of the requests, k
+//  the number of keys and t the time of a table operation
+static size_t serve_requests(struct server *s, struct server_conn *c) {
+  assert(s);
+  assert(c);
+  size_t pos = 0;
+  int n = 0;
+  int keys = 0;
+  for (;;) {
+    uint32_t body_len = 0;
+    const bool complete = c->in_len - pos >= sizeof(uint32_t);
+    if (complete) {
+      memcpy(&body_len, c->in + pos, sizeof(body_len));
+      if (body_len > HTS_MAX_REQUEST) {
+        return (size_t)-1;
+      }
+    }
+    if (!complete || c->in_len - pos - sizeof(uint32_t) < body_len) {
+      serve_run(s, c, s->requests, n);
+      return pos;
+    }
+
+    if (n == s->requests_cap) {
+      s->requests_cap = s->requests_cap ? 2 * s->requests_cap : 64;
+      s->requests = realloc(s->requests, sizeof(struct server_request) * s->requests_cap);
+    }
+    struct server_request *r = &s->requests[n];
+    r->first = keys;
+    parse_request(s, c->in + pos + sizeof(uint32_t), body_len, r);
+    pos += sizeof(uint32_t) + body_len;
+
+    // a request that cannot join the current run ends it
+    const struct server_request *prev = n > 0 ? &s->requests[n - 1] : NULL;
+    if (prev && !(r->valid && prev->valid && r->op == prev->op &&
+                  r->op != HTS_OP_COUNT && r->name_len == prev->name_len &&
+                  memcmp(r->name, prev->name, r->name_len) == 0)) {
+      serve_run(s, c, s->requests, n);
+      s->requests[0] = *r;
+      r = &s->requests[0];
+      // move the keys of r to the front of the key list
+      memmove(s->keys, s->keys + r->first, sizeof(void *) * r->count);
+      r->first = 0;
+      n = 0;
+    }
+    n++;
+    keys = r->first + r->count;
+  }
+}
+
+// parse_request(s, p, len, r) is a helper function that parses the request
+//  body of len bytes at p into r and appends its keys to the key list of
+//  s. It returns r->valid, which is false if the body is malformed.
+// requires: all pointers are valid; r->first is the end of the key list
+// effects: modifies r and s
+// time: O(k) where k is the number of keys of the request
+static bool parse_request(struct server *s, const unsigned char *p, size_t len,
+                          struct server_request *r) {
+  assert(s);
+  assert(p);
+  assert(r);
+  const unsigned char *end = p + len;
+  r->count = 0;
+  r->valid = false;
+  r->id = 0;
+  if (len < HTS_HEADER_LEN - sizeof(uint32_t)) {
+    return false;
+  }
+  memcpy(&r->id, p, sizeof(uint32_t));
+  r->op = p[4];
+  r->name_len = p[5];
+  uint16_t count;
+  memcpy(&count, p + 6, sizeof(count));
+  p += HTS_HEADER_LEN - sizeof(uint32_t);
+  if ((size_t)(end - p) < (size_t)r->name_len || r->op < HTS_OP_INSERT ||
+      r->op > HTS_OP_COUNT || (r->op == HTS_OP_COUNT && count != 0)) {
+    return false;
+  }
+  r->name = (const char *)p;
+  p += r->name_len;
+
+  if (r->first + count > s->keys_cap) {
+    s->keys_cap = 2 * (r->first + count);
+    s->keys = realloc(s->keys, sizeof(void *) * s->keys_cap);
+    s->results = realloc(s->results, sizeof(int) * s->keys_cap);
+    s->found = realloc(s->found, sizeof(bool) * s->keys_cap);
+  }
+  for (int k = 0; k < count; k++) {
+    if ((size_t)(end - p) < sizeof(uint32_t) ||
+        (size_t)(end - p) - sizeof(uint32_t) < key_len(p)) {
+      return false;
+    }
+    s->keys[r->first + k] = p;
+    p += sizeof(uint32_t) + key_len(p);
+  }
+  if (p != end) {
+    return false;
+  }
+  r->count = count;
+  r->valid = true;
+  return true;
+}
+
+// serve_run(s, c, run, n) is a helper function that serves the n requests
+//  of run, which are either a single request or valid requests with the
+//  same operation and table, and appends their responses to c
+// requires: all pointers are valid; the keys of run are the first keys of
+//  the key list of s
+// effects: modifies c and the tables of s
+// time: O(k * t) where k is the number of keys and t the time of a table
+//  operation
+static void serve_run(struct server *s, struct server_conn *c,
+                      struct server_request *run, int n) {
+  assert(s);
+  assert(c);
+  assert(run);
+  if (n == 0) {
+    return;
+  }
+  if (!run[0].valid) {
+    assert(n == 1);
+    put_response(c, run[0].id, HTS_BAD_REQUEST, NULL, 0);
+    return;
+  }
+  // only an insertion creates a table; the other operations see a missing
+  //   table as empty
+  struct server_table *t = find_table(s, run[0].name, run[0].name_len,
+                                      run[0].op == HTS_OP_INSERT);
+  if (run[0].op == HTS_OP_COUNT) {
+    const uint32_t count = t ? t->count : 0;
+    for (int i = 0; i < n; i++) {
+      put_response(c, run[i].id, HTS_OK, (const unsigned char *)&count,
+                   sizeof(count));
+    }
+    return;
+  }
+
+  const int keys = run[n - 1].first + run[n - 1].count;
+  if (keys == 0) {
+    // requests without keys
+  } else if (t == NULL) {
+    for (int k = 0; k < keys; k++) {
+      s->results[k] = run[0].op == HTS_OP_REMOVE ? HT_NOT_STORED : 0;
+    }
+  } else if (run[0].op == HTS_OP_INSERT) {
+    ht_insert_batch(t->ht, s->keys, keys, s->results);
+  } else if (run[0].op == HTS_OP_REMOVE) {
+    ht_remove_batch(t->ht, s->keys, keys, s->results);
+  } else {
+    ht_contains_batch(t->ht, s->keys, keys, s->found);
+    for (int k = 0; k < keys; k++) {
+      s->results[k] = s->found[k];
+    }
+  }
+
+  unsigned char results[UINT16_MAX];
+  for (int i = 0; i < n; i++) {
+    for (int k = 0; k < run[i].count; k++) {
+      const int result = s->results[run[i].first + k];
+      results[k] = result;
+      if (run[0].op == HTS_OP_INSERT && result == HT_SUCCESS) {
+        t->count++;
+      } else if (run[0].op == HTS_OP_REMOVE && result == HT_SUCCESS) {
+        t->count--;
+      }
+    }
+    put_response(c, run[i].id, HTS_OK, results, run[i].count);
+  }
+}
+
+// find_table(s, name, name_len, create) is a helper function that returns
+//  the table of s with the given name. If it does not exist, it is created
+//  if create is true, and NULL is returned otherwise.
+// requires: all pointers are valid; name_len < 256
+// effects: may allocate memory (freed by main)
+// time: O(t + n) where t is the number of tables and n the length of a new
+//  table
+static struct server_table *find_table(struct server *s, const char *name,
+                                       int name_len, bool create) {
+  assert(s);
+  assert(name);
+  for (struct server_table *t = s->tables; t; t = t->next) {
+    if (t->name_len == name_len && memcmp(t->name, name, name_len) == 0) {
+      return t;
+    }
+  }
+  if (!create) {
+    return NULL;
+  }
+  struct server_table *t = malloc(sizeof(struct server_table));
+  memcpy(t->name, name, name_len);
+  t->name_len = name_len;
+  t->ht = ht_create(key_clone, key_hash, s->hash_length, key_compare,
+                    key_destroy, key_print);
+  t->count = 0;
+  t->next = s->tables;
+  s->tables = t;
+  return t;
+}
+
+// put_response(c, id, status, results, count) is a helper function that
+//  appends a response to the output buffer of c
+// requires: c is a valid pointer; results is valid if count > 0
+// effects: modifies c
+// time: O(count)
+static void put_response(struct server_conn *c, uint32_t id, int status,
+                         const unsigned char *results, int count) {
+  assert(c);
+  const uint32_t body_len = HTS_HEADER_LEN - sizeof(uint32_t) + count;
+  reserve(&c->out, &c->out_cap, c->out_len + sizeof(uint32_t) + body_len);
+  unsigned char *p = c->out + c->out_len;
+  const uint16_t count16 = count;
+  memcpy(p, &body_len, sizeof(uint32_t));
+  memcpy(p + 4, &id, sizeof(uint32_t));
+  p[8] = status;
+  p[9] = 0;
+  memcpy(p + 10, &count16, sizeof(uint16_t));
+  if (count > 0) {
+    memcpy(p + HTS_HEADER_LEN, results, count);
+  }
+  c->out_len += sizeof(uint32_t) + body_len;
+}
+
+// reserve(buf, cap, len) is a helper function that makes sure that the
+//  buffer *buf of capacity *cap holds at least len bytes
+// requires: all pointers are valid
+// effects: may reallocate *buf; modifies *cap
+// time: O(len) amortized O(1)
+static void reserve(unsigned char **buf, size_t *cap, size_t len) {
+  assert(buf);
+  assert(cap);
+  if (len > *cap) {
+    *cap = len * 2;
+    *buf = realloc(*buf, *cap);
+  }
+}
@@ -0,0 +1,49 @@
+// This is the protocol of htserver, a server that hosts named hash tables
+//   of byte-string keys and serves them over a Unix domain socket:
+//     htserver <socket path> [hash_length]
+//   A table is created with the given hash length (default 16) the first
+//   time a key is inserted into it; the other operations treat a table
+//   that does not exist as empty (and do not create it).
+//
+//   Clients send requests and receive one response per request, in the
+//   order of the requests. A client may send any number of requests before
+//   it reads the responses (pipelining). All integers are in host byte
+//   order.
+//     request:  u32 body_len, u32 id, u8 op, u8 name_len, u16 count,
+//               name_len bytes table name,
+//               count * (u32 key_len, key_len key bytes)
+//     response: u32 body_len, u32 id, u8 status, u8 0, u16 count,
+//               count * u8 result
+//   where body_len is the number of bytes that follow the body_len field,
+//   id is chosen by the client and copied to the response, and result[i]
+//   is the result of the operation for key i:
+//   * HTS_OP_INSERT:   HT_SUCCESS or HT_ALREADY_STORED (see hashtable.h),
+//   * HTS_OP_REMOVE:   HT_SUCCESS or HT_NOT_STORED,
+//   * HTS_OP_CONTAINS: 1 if the key is stored and 0 otherwise.
+//   HTS_OP_COUNT has no keys; its response has count 4 and holds the
+//   number of keys of the table as a u32.
+//   A request with several keys is applied with the batch functions of
+//   hashtable.h, and so are runs of pipelined requests with the same
+//   operation and table.
+//   A client may shut down its side of the connection after its last
+//   request (a half-close); the server still sends all responses before it
+//   closes the connection.
+
+#include <stdint.h>
+
+// operations
+#define HTS_OP_INSERT   1
+#define HTS_OP_REMOVE   2
+#define HTS_OP_CONTAINS 3
+#define HTS_OP_COUNT    4
+
+// statuses
+#define HTS_OK          0
+#define HTS_BAD_REQUEST 1
+
+// the length of the fixed part of requests and responses (with body_len)
+#define HTS_HEADER_LEN 12
+
+// the largest body_len of a request; a client that sends a larger request
+//   is disconnected
+#define HTS_MAX_REQUEST (64 << 20)
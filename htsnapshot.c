@@ -0,0 +1,855 @@
+// This is the implementation of hash table snapshots.
+//   A snapshot file has the following layout (integers in host byte order):
+//     header:  "HTSNAP01", u32 hash_len, u32 flags, u64 lsn, u64 base_lsn
+//     buckets: u32 index, u32 count, count * (u32 len, len key bytes)
+//              (one section per non-empty bucket, in any order)
+//     trailer: u32 0xffffffff, u32 0, u64 checksum
+//   where checksum is the 64-bit FNV-1a hash of all bucket sections.
+//   A delta snapshot has the flag SNAP_DELTA and the LSN of the snapshot it
+//   applies to as base_lsn (0 for full snapshots). It holds a section for
+//   every bucket that changed since that snapshot, also for buckets that
+//   became empty; a section replaces the whole content of its bucket.
+//
+//   Snapshot files are written and read through htaio (io_uring, or a
+//   pread/pwrite thread pool) in large aligned buffers, with several
+//   buffers in flight: while the kernel writes the previous buffers, the
+//   next buckets are serialized into a free one, and while a buffer is
+//   parsed, the following ones are already being read. Files are opened
+//   with O_DIRECT where the file system supports it.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "htsnapshot.h"
+#include "htaio.h"
+#include <assert.h>
+#include <stdbool.h>
+
+const int HT_IO_ERROR = 3;
+
+static const char SNAP_MAGIC[8] = {'H', 'T', 'S', 'N', 'A', 'P', '0', '1'};
+static const uint32_t SNAP_END = 0xffffffff;
+static const uint32_t SNAP_DELTA = 1;
+
+// number of I/O buffers of a snapshot reader or writer
+#define SNAP_BUFFERS 4
+// size of an I/O buffer (a multiple of SNAP_ALIGN)
+#define SNAP_BUFFER_LEN (1 << 20)
+// alignment of buffers, offsets and lengths for O_DIRECT
+#define SNAP_ALIGN 4096
+
+struct snap_header {
+  char magic[8];
+  uint32_t hash_len;
+  uint32_t flags;
+  uint64_t lsn;
+  uint64_t base_lsn;                                // of the base of a delta snapshot
+};
+
+// the section of the bucket that is currently being written
+struct snap_section {
+  unsigned char *data;
+  size_t len;
+  size_t cap;
+  uint32_t count;
+  int (*key_encode)(const void *, void *, int);
+};
+
+struct ht_snapwriter {
+  int fd;
+  bool direct;                                      // fd was opened with O_DIRECT
+  struct htaio *aio;
+  char *path;
+  char *tmp_path;
+  unsigned char *bufs[SNAP_BUFFERS];
+  size_t lens[SNAP_BUFFERS];                        // length of the write of a busy buffer
+  bool busy[SNAP_BUFFERS];                          // a write of the buffer is in flight
+  int in_flight;
+  int cur;                                          // buffer that is being filled
+  size_t fill;                                      // bytes in the current buffer
+  off_t offset;                                     // file offset of the current buffer
+  uint64_t checksum;                                // of all sections added so far
+  bool ok;                                          // no write has failed
+  bool delta;                                       // a delta snapshot is written
+};
+
+// a snapshot file that is being read
+struct snap_reader {
+  int fd;
+  struct htaio *aio;
+  unsigned char *bufs[SNAP_BUFFERS];                // filled in round-robin order
+  size_t lens[SNAP_BUFFERS];                        // bytes read into a ready buffer
+  bool submitted[SNAP_BUFFERS];                     // a read of the buffer was started
+  bool ready[SNAP_BUFFERS];                         // that read has completed
+  int in_flight;
+  int cur;                                          // buffer that is being parsed
+  size_t pos;                                       // position in the current buffer
+  off_t next_offset;                                // offset of the next read
+  off_t size;                                       // size of the file
+  bool ok;                                          // no read has failed
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void section_reserve(struct snap_section *s, size_t extra);
+static void section_add_key(void *ctx, const void *key);
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len);
+static int hash_length_of(const struct hashtable *ht);
+static struct ht_snapwriter *writer_open(const char *path, int hash_length,
+                                         uint32_t flags, uint64_t base_lsn,
+                                         uint64_t lsn);
+static int load_file(struct hashtable *ht, const char *path, uint64_t *lsn,
+                     void *(*key_decode)(const void *, int), bool delta);
+static int open_direct(const char *path, int flags, bool *direct);
+static void writer_put(struct ht_snapwriter *w, const void *data, size_t len);
+static void writer_flush(struct ht_snapwriter *w, size_t len);
+static void writer_reap(struct ht_snapwriter *w);
+static bool reader_open(struct snap_reader *r, const char *path);
+static bool reader_get(struct snap_reader *r, void *dst, size_t len);
+static void reader_close(struct snap_reader *r);
+static bool read_header(const char *path, struct snap_header *hdr);
+static bool copy_sections(struct ht_snapwriter *w, const char *path,
+                          uint64_t *taken, uint32_t hash_len);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+int ht_snapshot_save(const struct hashtable *ht, const char *path, uint64_t lsn,
+                     int (*key_encode)(const void *, void *, int)) {
+  assert(ht);
+  assert(path);
+  assert(key_encode);
+
+  struct ht_snapwriter *w = ht_snapwriter_open(path, hash_length_of(ht), lsn);
+  if (w == NULL) {
+    return HT_IO_ERROR;
+  }
+  for (int i = 0; i < ht_length(ht); i++) {
+    ht_snapwriter_add_bucket(w, ht, i, key_encode);
+  }
+  return ht_snapwriter_commit(w);
+}
+
+int ht_snapshot_load(struct hashtable *ht, const char *path, uint64_t *lsn,
+                     void *(*key_decode)(const void *, int)) {
+  assert(ht);
+  assert(path);
+  assert(lsn);
+  assert(key_decode);
+  return load_file(ht, path, lsn, key_decode, false);
+}
+
+int ht_snapshot_apply_delta(struct hashtable *ht, const char *path, uint64_t *lsn,
+                            void *(*key_decode)(const void *, int)) {
+  assert(ht);
+  assert(path);
+  assert(lsn);
+  assert(key_decode);
+  return load_file(ht, path, lsn, key_decode, true);
+}
+
+int ht_snapshot_compact(const char *base_path, const char *const *delta_paths,
+                        int n, const char *out_path) {
+  assert(base_path);
+  assert(delta_paths || n == 0);
+  assert(out_path);
+  assert(n >= 0);
+
+  // check that the files form a chain: base, then deltas that apply in order
+  struct snap_header base;
+  if (!read_header(base_path, &base) || (base.flags & SNAP_DELTA) != 0 ||
+      base.hash_len == 0 || base.hash_len > 30) {
+    return HT_IO_ERROR;
+  }
+  uint64_t lsn = base.lsn;
+  for (int i = 0; i < n; i++) {
+    struct snap_header hdr;
+    if (!read_header(delta_paths[i], &hdr) || (hdr.flags & SNAP_DELTA) == 0 ||
+        hdr.base_lsn != lsn || hdr.hash_len != base.hash_len) {
+      return HT_IO_ERROR;
+    }
+    lsn = hdr.lsn;
+  }
+
+  // the newest section of a bucket wins, so copy the files from the newest
+  //   to the oldest and skip buckets that have been taken already
+  struct ht_snapwriter *w = ht_snapwriter_open(out_path, base.hash_len, lsn);
+  if (w == NULL) {
+    return HT_IO_ERROR;
+  }
+  uint64_t *taken = calloc(((1ULL << base.hash_len) + 63) / 64, sizeof(uint64_t));
+  bool ok = true;
+  for (int i = n; ok && i >= 0; i--) {
+    ok = copy_sections(w, i == 0 ? base_path : delta_paths[i - 1], taken,
+                       base.hash_len);
+  }
+  free(taken);
+  if (!ok) {
+    ht_snapwriter_abort(w);
+    return HT_IO_ERROR;
+  }
+  return ht_snapwriter_commit(w);
+}
+
+void *ht_snapshot_encode_bucket(const struct hashtable *ht, int index,
+                                int (*key_encode)(const void *, void *, int),
+                                size_t *len) {
+  assert(ht);
+  assert(key_encode);
+  assert(len);
+
+  // reserve the section header, then fill in the keys of the bucket
+  struct snap_section s = {NULL, 2 * sizeof(uint32_t), 0, 0, key_encode};
+  section_reserve(&s, 0);
+  ht_bucket_foreach(ht, index, section_add_key, &s);
+  if (s.count == 0) {
+    free(s.data);
+    return NULL;
+  }
+  const uint32_t section_index = index;
+  memcpy(s.data, &section_index, sizeof(uint32_t));
+  memcpy(s.data + sizeof(uint32_t), &s.count, sizeof(uint32_t));
+  *len = s.len;
+  return s.data;
+}
+
+int ht_snapshot_decode_bucket(struct hashtable *ht, const void *section,
+                              size_t len, void *(*key_decode)(const void *, int)) {
+  assert(ht);
+  assert(section);
+  assert(key_decode);
+  const unsigned char *p = section;
+  const unsigned char *end = p + len;
+  uint32_t header[2];
+  if (len < sizeof(header)) {
+    return HT_IO_ERROR;
+  }
+  memcpy(header, p, sizeof(header));
+  p += sizeof(header);
+  for (uint32_t k = 0; k < header[1]; k++) {
+    uint32_t key_len;
+    if ((size_t)(end - p) < sizeof(key_len)) {
+      return HT_IO_ERROR;
+    }
+    memcpy(&key_len, p, sizeof(key_len));
+    p += sizeof(key_len);
+    if ((size_t)(end - p) < key_len) {
+      return HT_IO_ERROR;
+    }
+    ht_adopt(ht, key_decode(p, key_len));
+    p += key_len;
+  }
+  return p == end ? HT_SUCCESS : HT_IO_ERROR;
+}
+
+struct ht_snapwriter *ht_snapwriter_open(const char *path, int hash_length,
+                                         uint64_t lsn) {
+  assert(path);
+  assert(hash_length > 0);
+  return writer_open(path, hash_length, 0, 0, lsn);
+}
+
+struct ht_snapwriter *ht_snapwriter_open_delta(const char *path, int hash_length,
+                                               uint64_t base_lsn, uint64_t lsn) {
+  assert(path);
+  assert(hash_length > 0);
+  return writer_open(path, hash_length, SNAP_DELTA, base_lsn, lsn);
+}
+
+void ht_snapwriter_add(struct ht_snapwriter *w, const void *section, size_t len) {
+  assert(w);
+  assert(section);
+  w->checksum = fnv1a(w->checksum, section, len);
+  writer_put(w, section, len);
+}
+
+void ht_snapwriter_add_bucket(struct ht_snapwriter *w,
+                              const struct hashtable *ht, int index,
+                              int (*key_encode)(const void *, void *, int)) {
+  assert(w);
+  assert(ht);
+  assert(key_encode);
+  size_t len = 0;
+  void *section = ht_snapshot_encode_bucket(ht, index, key_encode, &len);
+  if (section) {
+    ht_snapwriter_add(w, section, len);
+    free(section);
+  } else if (w->delta) {
+    // an empty bucket still has to replace its old content
+    const uint32_t empty[2] = {index, 0};
+    ht_snapwriter_add(w, empty, sizeof(empty));
+  }
+}
+
+int ht_snapwriter_commit(struct ht_snapwriter *w) {
+  assert(w);
+  const uint32_t trailer[2] = {SNAP_END, 0};
+  writer_put(w, trailer, sizeof(trailer));
+  writer_put(w, &w->checksum, sizeof(w->checksum));
+
+  // O_DIRECT needs an aligned length: pad the last buffer with zeros and
+  //   cut the file back to its real size afterwards
+  const off_t size = w->offset + w->fill;
+  size_t len = w->fill;
+  if (w->direct && len % SNAP_ALIGN != 0) {
+    const size_t padded = (len / SNAP_ALIGN + 1) * SNAP_ALIGN;
+    memset(w->bufs[w->cur] + len, 0, padded - len);
+    len = padded;
+  }
+  if (len > 0) {
+    writer_flush(w, len);
+  }
+  while (w->in_flight > 0) {
+    writer_reap(w);
+  }
+  bool ok = w->ok && (!w->direct || ftruncate(w->fd, size) == 0);
+  ok = ok && fsync(w->fd) == 0;
+  ok = (close(w->fd) == 0) && ok;
+  ok = ok && rename(w->tmp_path, w->path) == 0;
+  if (!ok) {
+    remove(w->tmp_path);
+  }
+  // the rename must be durable before the caller drops what the snapshot
+  //   covers (e.g. the log records up to its LSN)
+  ok = ok && htaio_sync_dir(w->path);
+  htaio_destroy(w->aio);
+  for (int i = 0; i < SNAP_BUFFERS; i++) {
+    free(w->bufs[i]);
+  }
+  free(w->tmp_path);
+  free(w->path);
+  free(w);
+  return ok ? HT_SUCCESS : HT_IO_ERROR;
+}
+
+void ht_snapwriter_abort(struct ht_snapwriter *w) {
+  assert(w);
+  while (w->in_flight > 0) {
+    writer_reap(w);
+  }
+  htaio_destroy(w->aio);
+  close(w->fd);
+  remove(w->tmp_path);
+  for (int i = 0; i < SNAP_BUFFERS; i++) {
+    free(w->bufs[i]);
+  }
+  free(w->tmp_path);
+  free(w->path);
+  free(w);
+}
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// load_file(ht, path, lsn, key_decode, delta) is a helper function that
+//  loads the snapshot (or, if delta is true, applies the delta snapshot)
+//  path to ht; see ht_snapshot_load and ht_snapshot_apply_delta
+// requires: all pointers are valid
+// effects: modifies ht and *lsn; reads a file
+// time: O(m * (de + hf + k * co)) where m is the number of keys in the
+//  file and k the number of items in a bucket of ht
+static int load_file(struct hashtable *ht, const char *path, uint64_t *lsn,
+                     void *(*key_decode)(const void *, int), bool delta) {
+  assert(ht);
+  assert(path);
+  assert(lsn);
+  assert(key_decode);
+
+  struct snap_reader r;
+  if (!reader_open(&r, path)) {
+    return HT_IO_ERROR;
+  }
+  struct snap_header hdr;
+  if (!reader_get(&r, &hdr, sizeof(hdr)) ||
+      memcmp(hdr.magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0 ||
+      ((hdr.flags & SNAP_DELTA) != 0) != delta ||
+      (delta && (hdr.base_lsn != *lsn ||
+                 (int)hdr.hash_len != hash_length_of(ht)))) {
+    reader_close(&r);
+    return HT_IO_ERROR;
+  }
+
+  uint64_t checksum = 0xcbf29ce484222325ULL;
+  unsigned char *buf = NULL;
+  uint32_t buf_cap = 0;
+  bool ok = true;
+  for (;;) {
+    uint32_t section[2];
+    if (!reader_get(&r, section, sizeof(section))) {
+      ok = false;
+      break;
+    }
+    if (section[0] == SNAP_END) {
+      uint64_t expected;
+      ok = reader_get(&r, &expected, sizeof(expected)) && expected == checksum;
+      break;
+    }
+    checksum = fnv1a(checksum, section, sizeof(section));
+    if (delta) {
+      // the section replaces the whole bucket
+      if (section[0] >= (uint32_t)ht_length(ht)) {
+        ok = false;
+        break;
+      }
+      ht_bucket_clear(ht, section[0]);
+    }
+    for (uint32_t k = 0; ok && k < section[1]; k++) {
+      uint32_t len;
+      ok = reader_get(&r, &len, sizeof(len));
+      if (ok && len > buf_cap) {
+        buf_cap = len;
+        buf = realloc(buf, buf_cap);
+      }
+      ok = ok && reader_get(&r, buf, len);
+      if (ok) {
+        checksum = fnv1a(checksum, &len, sizeof(len));
+        checksum = fnv1a(checksum, buf, len);
+        ht_adopt(ht, key_decode(buf, len));
+      }
+    }
+    if (!ok) {
+      break;
+    }
+  }
+  free(buf);
+  reader_close(&r);
+  if (!ok) {
+    return HT_IO_ERROR;
+  }
+  *lsn = hdr.lsn;
+  return HT_SUCCESS;
+}
+
+// section_reserve(s, extra) is a helper function that makes sure that s
+//  has room for extra more bytes
+// requires: s is a valid pointer
+// effects: may allocate memory (caller must free s->data)
+// time: O(s->len) amortized O(1)
+static void section_reserve(struct snap_section *s, size_t extra) {
+  assert(s);
+  if (s->len + extra > s->cap) {
+    s->cap = (s->len + extra) * 2;
+    s->data = realloc(s->data, s->cap);
+  }
+}
+
+// section_add_key(ctx, key) is a helper function that appends the length
+//  and the encoding of key to the section ctx
+// requires: all pointers are valid
+// effects: modifies the section ctx
+// time: O(en) where en is the time complexity of key_encode
+static void section_add_key(void *ctx, const void *key) {
+  struct snap_section *s = ctx;
+  assert(s);
+  assert(key);
+  section_reserve(s, sizeof(uint32_t));
+  int room = s->cap - s->len - sizeof(uint32_t);
+  uint32_t len = s->key_encode(key, s->data + s->len + sizeof(uint32_t), room);
+  if ((int)len > room) {
+    section_reserve(s, sizeof(uint32_t) + len);
+    s->key_encode(key, s->data + s->len + sizeof(uint32_t), len);
+  }
+  memcpy(s->data + s->len, &len, sizeof(uint32_t));
+  s->len += sizeof(uint32_t) + len;
+  s->count++;
+}
+
+// fnv1a(h, data, len) is a helper function that continues the 64-bit
+//  FNV-1a hash h with the len bytes at data
+// time: O(len)
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= bytes[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// hash_length_of(ht) is a helper function that returns the hash length of
+//  ht (the base-2 logarithm of its number of buckets)
+// time: O(hash_length)
+static int hash_length_of(const struct hashtable *ht) {
+  assert(ht);
+  int len = 0;
+  for (int n = ht_length(ht); n > 1; n /= 2) {
+    len++;
+  }
+  return len;
+}
+
+// writer_open(path, hash_length, flags, base_lsn, lsn) is a helper function
+//  that starts writing a snapshot with the given header fields; see
+//  ht_snapwriter_open and ht_snapwriter_open_delta. It returns NULL if the
+//  file cannot be created or the buffers cannot be allocated.
+// requires: path is a valid pointer
+// effects: allocates memory and creates a file (caller must call
+//  ht_snapwriter_commit or ht_snapwriter_abort)
+// time: O(1)
+static struct ht_snapwriter *writer_open(const char *path, int hash_length,
+                                         uint32_t flags, uint64_t base_lsn,
+                                         uint64_t lsn) {
+  assert(path);
+
+  struct ht_snapwriter *w = malloc(sizeof(struct ht_snapwriter));
+  w->path = malloc(strlen(path) + 1);
+  strcpy(w->path, path);
+  w->tmp_path = malloc(strlen(path) + 5);
+  strcpy(w->tmp_path, path);
+  strcat(w->tmp_path, ".tmp");
+  w->fd = open_direct(w->tmp_path, O_WRONLY | O_CREAT | O_TRUNC, &w->direct);
+  if (w->fd < 0) {
+    free(w->tmp_path);
+    free(w->path);
+    free(w);
+    return NULL;
+  }
+
+  bool ok = true;
+  for (int i = 0; i < SNAP_BUFFERS; i++) {
+    void *buf = NULL;
+    if (posix_memalign(&buf, SNAP_ALIGN, SNAP_BUFFER_LEN) != 0) {
+      buf = NULL;
+      ok = false;
+    }
+    w->bufs[i] = buf;
+    w->lens[i] = 0;
+    w->busy[i] = false;
+  }
+  if (!ok) {
+    for (int i = 0; i < SNAP_BUFFERS; i++) {
+      free(w->bufs[i]);
+    }
+    close(w->fd);
+    remove(w->tmp_path);
+    free(w->tmp_path);
+    free(w->path);
+    free(w);
+    return NULL;
+  }
+  w->aio = htaio_create(w->fd, SNAP_BUFFERS);
+  w->in_flight = 0;
+  w->cur = 0;
+  w->fill = 0;
+  w->offset = 0;
+  w->checksum = 0xcbf29ce484222325ULL;
+  w->ok = true;
+  w->delta = flags & SNAP_DELTA;
+
+  struct snap_header hdr;
+  memcpy(hdr.magic, SNAP_MAGIC, sizeof(SNAP_MAGIC));
+  hdr.hash_len = hash_length;
+  hdr.flags = flags;
+  hdr.lsn = lsn;
+  hdr.base_lsn = base_lsn;
+  writer_put(w, &hdr, sizeof(hdr));
+  return w;
+}
+
+// open_direct(path, flags, direct) is a helper function that opens path
+//  with flags and O_DIRECT, or without O_DIRECT if the file system does not
+//  support it, and stores in *direct which one happened
+// requires: all pointers are valid
+// effects: opens a file (caller must close); modifies *direct
+// time: O(1)
+static int open_direct(const char *path, int flags, bool *direct) {
+  assert(path);
+  assert(direct);
+#ifdef O_DIRECT
+  int fd = open(path, flags | O_DIRECT, 0644);
+  if (fd >= 0) {
+    *direct = true;
+    return fd;
+  }
+#endif
+  *direct = false;
+  return open(path, flags, 0644);
+}
+
+// writer_put(w, data, len) is a helper function that copies the len bytes
+//  at data into the buffers of w, starting a write for every buffer that
+//  becomes full
+// requires: all pointers are valid
+// effects: modifies w; writes to the file of w
+// time: O(len)
+static void writer_put(struct ht_snapwriter *w, const void *data, size_t len) {
+  assert(w);
+  assert(data);
+  const unsigned char *bytes = data;
+  while (len > 0) {
+    size_t n = SNAP_BUFFER_LEN - w->fill;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(w->bufs[w->cur] + w->fill, bytes, n);
+    w->fill += n;
+    bytes += n;
+    len -= n;
+    if (w->fill == SNAP_BUFFER_LEN) {
+      writer_flush(w, SNAP_BUFFER_LEN);
+    }
+  }
+}
+
+// writer_flush(w, len) is a helper function that starts writing the first
+//  len bytes of the current buffer of w and switches to a free buffer,
+//  waiting for a write to complete if all buffers are busy
+// requires: w is a valid pointer
+// effects: modifies w; writes to the file of w
+// time: O(1), plus the time of one write if all buffers are busy
+static void writer_flush(struct ht_snapwriter *w, size_t len) {
+  assert(w);
+  htaio_write(w->aio, w->bufs[w->cur], len, w->offset, w->cur);
+  w->busy[w->cur] = true;
+  w->lens[w->cur] = len;
+  w->in_flight++;
+  w->offset += w->fill;
+  w->fill = 0;
+
+  for (;;) {
+    for (int i = 0; i < SNAP_BUFFERS; i++) {
+      if (!w->busy[i]) {
+        w->cur = i;
+        return;
+      }
+    }
+    writer_reap(w);
+  }
+}
+
+// writer_reap(w) is a helper function that waits for one write of w to
+//  complete and frees its buffer
+// requires: w is a valid pointer; a write of w is in flight
+// effects: modifies w
+// time: the time until a write completes
+static void writer_reap(struct ht_snapwriter *w) {
+  assert(w);
+  long result = 0;
+  const int i = htaio_wait(w->aio, &result);
+  if (result != (long)w->lens[i]) {
+    w->ok = false;
+  }
+  w->busy[i] = false;
+  w->in_flight--;
+}
+
+// reader_open(r, path) is a helper function that opens the file path for
+//  reading with r and starts reading its first buffers. It returns false if
+//  path cannot be opened or the buffers cannot be allocated.
+// requires: all pointers are valid
+// effects: opens a file and allocates memory (caller must call
+//  reader_close if it returns true)
+// time: O(1)
+static bool reader_open(struct snap_reader *r, const char *path) {
+  assert(r);
+  assert(path);
+  bool direct = false;
+  r->fd = open_direct(path, O_RDONLY, &direct);
+  struct stat st;
+  if (r->fd < 0) {
+    return false;
+  }
+  if (fstat(r->fd, &st) != 0) {
+    close(r->fd);
+    return false;
+  }
+  r->size = st.st_size;
+  bool ok = true;
+  for (int i = 0; i < SNAP_BUFFERS; i++) {
+    void *buf = NULL;
+    if (posix_memalign(&buf, SNAP_ALIGN, SNAP_BUFFER_LEN) != 0) {
+      buf = NULL;
+      ok = false;
+    }
+    r->bufs[i] = buf;
+  }
+  if (!ok) {
+    for (int i = 0; i < SNAP_BUFFERS; i++) {
+      free(r->bufs[i]);
+    }
+    close(r->fd);
+    return false;
+  }
+  r->aio = htaio_create(r->fd, SNAP_BUFFERS);
+  r->in_flight = 0;
+  r->next_offset = 0;
+  r->cur = 0;
+  r->pos = 0;
+  r->ok = true;
+  for (int i = 0; i < SNAP_BUFFERS; i++) {
+    r->lens[i] = 0;
+    r->ready[i] = false;
+    r->submitted[i] = r->next_offset < r->size;
+    if (r->submitted[i]) {
+      htaio_read(r->aio, r->bufs[i], SNAP_BUFFER_LEN, r->next_offset, i);
+      r->next_offset += SNAP_BUFFER_LEN;
+      r->in_flight++;
+    }
+  }
+  return true;
+}
+
+// reader_get(r, dst, len) is a helper function that copies the next len
+//  bytes of the file of r to dst. Every buffer that has been parsed
+//  completely is reused for the next read ahead. It returns false if the
+//  file ends before len bytes or cannot be read.
+// requires: all pointers are valid
+// effects: modifies r and dst; reads from the file of r
+// time: O(len), plus the time to wait for reads
+static bool reader_get(struct snap_reader *r, void *dst, size_t len) {
+  assert(r);
+  assert(dst || len == 0);
+  unsigned char *bytes = dst;
+  while (len > 0) {
+    if (!r->submitted[r->cur]) {
+      return false;                                 // end of the file
+    }
+    while (!r->ready[r->cur]) {
+      long result = 0;
+      const int i = htaio_wait(r->aio, &result);
+      r->in_flight--;
+      r->ready[i] = true;
+      r->lens[i] = result < 0 ? 0 : result;
+      if (result < 0) {
+        r->ok = false;
+      }
+    }
+    if (!r->ok) {
+      return false;
+    }
+    if (r->pos == r->lens[r->cur]) {
+      if (r->lens[r->cur] < SNAP_BUFFER_LEN) {
+        return false;                               // short read: end of the file
+      }
+      // the buffer is used up: read ahead into it and move to the next one
+      r->ready[r->cur] = false;
+      r->submitted[r->cur] = r->next_offset < r->size;
+      if (r->submitted[r->cur]) {
+        htaio_read(r->aio, r->bufs[r->cur], SNAP_BUFFER_LEN, r->next_offset, r->cur);
+        r->next_offset += SNAP_BUFFER_LEN;
+        r->in_flight++;
+      }
+      r->cur = (r->cur + 1) % SNAP_BUFFERS;
+      r->pos = 0;
+      continue;
+    }
+    size_t n = r->lens[r->cur] - r->pos;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(bytes, r->bufs[r->cur] + r->pos, n);
+    r->pos += n;
+    bytes += n;
+    len -= n;
+  }
+  return true;
+}
+
+// reader_close(r) is a helper function that waits for the reads of r that
+//  are still in flight and releases all resources of r
+// requires: r is a valid pointer
+// effects: closes the file of r; frees memory
+// time: the time until all reads complete
+static void reader_close(struct snap_reader *r) {
+  assert(r);
+  while (r->in_flight > 0) {
+    long result = 0;
+    htaio_wait(r->aio, &result);
+    r->in_flight--;
+  }
+  htaio_destroy(r->aio);
+  close(r->fd);
+  for (int i = 0; i < SNAP_BUFFERS; i++) {
+    free(r->bufs[i]);
+  }
+}
+
+// read_header(path, hdr) is a helper function that reads the header of the
+//  snapshot file path into *hdr and returns true if it is a snapshot header
+// requires: all pointers are valid
+// effects: reads a file; modifies *hdr
+// time: O(1)
+static bool read_header(const char *path, struct snap_header *hdr) {
+  assert(path);
+  assert(hdr);
+  struct snap_reader r;
+  if (!reader_open(&r, path)) {
+    return false;
+  }
+  const bool ok = reader_get(&r, hdr, sizeof(*hdr)) &&
+                  memcmp(hdr->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) == 0;
+  reader_close(&r);
+  return ok;
+}
+
+// copy_sections(w, path, taken, hash_len) is a helper function that adds
+//  the sections of the snapshot file path whose bucket is not set in the
+//  bitmap taken to w (except empty ones) and sets their bits. It returns
+//  false if path is not a valid snapshot with hash length hash_len.
+// requires: all pointers are valid; taken has 2^hash_len bits
+// effects: reads a file; writes to the file of w; modifies taken
+// time: O(s) where s is the size of the file
+static bool copy_sections(struct ht_snapwriter *w, const char *path,
+                          uint64_t *taken, uint32_t hash_len) {
+  assert(w);
+  assert(path);
+  assert(taken);
+  struct snap_reader r;
+  if (!reader_open(&r, path)) {
+    return false;
+  }
+  struct snap_header hdr;
+  bool ok = reader_get(&r, &hdr, sizeof(hdr)) && hdr.hash_len == hash_len;
+  uint64_t checksum = 0xcbf29ce484222325ULL;
+  struct snap_section s = {NULL, 0, 0, 0, NULL};
+  while (ok) {
+    uint32_t section[2];
+    if (!reader_get(&r, section, sizeof(section))) {
+      ok = false;
+      break;
+    }
+    if (section[0] == SNAP_END) {
+      uint64_t expected;
+      ok = reader_get(&r, &expected, sizeof(expected)) && expected == checksum;
+      break;
+    }
+    if (section[0] >= (1u << hash_len)) {
+      ok = false;
+      break;
+    }
+    // collect the whole section, it is copied unchanged
+    s.len = 0;
+    section_reserve(&s, sizeof(section));
+    memcpy(s.data, section, sizeof(section));
+    s.len = sizeof(section);
+    for (uint32_t k = 0; ok && k < section[1]; k++) {
+      uint32_t len;
+      ok = reader_get(&r, &len, sizeof(len));
+      if (ok) {
+        section_reserve(&s, sizeof(len) + len);
+        memcpy(s.data + s.len, &len, sizeof(len));
+        ok = reader_get(&r, s.data + s.len + sizeof(len), len);
+        s.len += sizeof(len) + len;
+      }
+    }
+    if (!ok) {
+      break;
+    }
+    checksum = fnv1a(checksum, s.data, s.len);
+    uint64_t *word = &taken[section[0] / 64];
+    const uint64_t bit = 1ULL << (section[0] % 64);
+    if ((*word & bit) == 0) {
+      *word |= bit;
+      if (section[1] > 0) {
+        ht_snapwriter_add(w, s.data, s.len);
+      }
+    }
+  }
+  free(s.data);
+  reader_close(&r);
+  return ok;
+}
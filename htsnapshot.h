@@ -0,0 +1,160 @@
+// This is the interface for saving a generic hash table to a snapshot file
+//   and loading it back. Keys are written with a key_encode connector and
+//   read with a key_decode connector:
+//   * key_encode(key, buf, len) writes the encoding of key to buf if it has
+//                 room for it (len bytes) and returns the length of the
+//                 encoding (also if it is larger than len);
+//   * key_decode(buf, len) returns a new heap key from the len bytes at buf
+//                 (destroyed with the key_destroy connector of the table).
+//   A snapshot stores the log sequence number (LSN) of the last write-ahead
+//   log record it reflects (see htwal.h), or 0 if there is no log.
+//   A delta snapshot only holds the buckets that changed since an earlier
+//   (full or delta) snapshot, its base; it is applied on top of the table
+//   loaded from its base (see htdirty.h).
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hashtable.h"
+
+// HT_IO_ERROR indicates that a file could not be read or written, or that
+//   it is not a valid (complete) file.
+extern const int HT_IO_ERROR;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// ht_snapshot_save(ht, path, lsn, key_encode) writes all keys of ht and
+//   lsn to the snapshot file path. The file is written under a temporary
+//   name, synced and then renamed (and the rename is synced), so path
+//   always holds a complete snapshot. The function returns
+//   * HT_SUCCESS if the snapshot has been written, or
+//   * HT_IO_ERROR if it could not be written.
+// effects: writes a file
+// time: O(n + m * en), where n is the length of ht, m is the number of
+//   items in ht and en is the complexity of key_encode
+int ht_snapshot_save(const struct hashtable *ht, const char *path, uint64_t lsn,
+                     int (*key_encode)(const void *, void *, int));
+
+// ht_snapshot_load(ht, path, lsn, key_decode) inserts all keys of the
+//   snapshot file path into ht and stores the LSN of the snapshot in *lsn.
+//   The function returns
+//   * HT_SUCCESS if the snapshot has been loaded, or
+//   * HT_IO_ERROR if path could not be read or is not a valid snapshot; ht
+//     may then hold a part of the keys of the snapshot.
+// effects: modifies ht and *lsn
+// time: O(m * (de + hf + k * co)), where m is the number of keys in the
+//   snapshot, k the number of items in a bucket of ht and de is the
+//   complexity of key_decode
+int ht_snapshot_load(struct hashtable *ht, const char *path, uint64_t *lsn,
+                     void *(*key_decode)(const void *, int));
+
+// ht_snapshot_apply_delta(ht, path, lsn, key_decode) applies the delta
+//   snapshot path to ht, which must hold the contents of its base snapshot
+//   with LSN *lsn: every bucket stored in the delta replaces the bucket of
+//   ht. On success, the LSN of the delta is stored in *lsn. The function
+//   returns
+//   * HT_SUCCESS if the delta has been applied, or
+//   * HT_IO_ERROR if path could not be read, is not a valid delta snapshot,
+//     or does not apply to the snapshot *lsn or to the hash length of ht;
+//     ht may then be partially updated.
+// effects: modifies ht and *lsn
+// time: O(b * ds + m * (de + hf + k * co)), where b is the number of keys
+//   in the replaced buckets, m is the number of keys in the delta and k the
+//   number of items in a bucket of ht
+int ht_snapshot_apply_delta(struct hashtable *ht, const char *path, uint64_t *lsn,
+                            void *(*key_decode)(const void *, int));
+
+// ht_snapshot_compact(base_path, delta_paths, n, out_path) merges the full
+//   snapshot base_path and the n delta snapshots delta_paths[0..n-1], which
+//   must apply to it in this order, into the full snapshot out_path with
+//   the LSN of the last delta. Sections are copied without decoding any
+//   key, so no table is needed; out_path may be base_path (it is replaced
+//   only once the new snapshot is complete), and the deltas can be removed
+//   afterwards. Compacting from time to time keeps delta chains, and thus
+//   recovery times, short. The function returns
+//   * HT_SUCCESS if the snapshot has been written, or
+//   * HT_IO_ERROR if a file could not be read or written, is not valid, or
+//     the deltas do not form a chain on top of base_path.
+// effects: writes a file
+// requires: n >= 0
+// time: O(s + 2^h / 64), where s is the total size of the files and h is
+//   their hash length
+int ht_snapshot_compact(const char *base_path, const char *const *delta_paths,
+                        int n, const char *out_path);
+
+// The functions below build a snapshot file bucket by bucket, for writers
+//   that capture buckets at different times (e.g. htcheckpoint.h).
+
+// a snapshot file that is being written
+struct ht_snapwriter;
+
+// ht_snapshot_encode_bucket(ht, index, key_encode, len) returns the
+//   snapshot section of the bucket index of ht and stores its length in
+//   *len, or returns NULL if the bucket is empty.
+// effects: allocates heap memory (caller must free); modifies *len
+// requires: 0 <= index < ht_length(ht)
+// time: O(k * en), where k is the number of items in the bucket
+void *ht_snapshot_encode_bucket(const struct hashtable *ht, int index,
+                                int (*key_encode)(const void *, void *, int),
+                                size_t *len);
+
+// ht_snapshot_decode_bucket(ht, section, len, key_decode) inserts all keys
+//   of the len bytes of section (as returned by ht_snapshot_encode_bucket)
+//   into ht. The function returns
+//   * HT_SUCCESS if the keys have been inserted, or
+//   * HT_IO_ERROR if section is not a valid section; ht may then hold a part
+//     of its keys.
+// effects: modifies ht
+// time: O(k * (de + hf + k * co)), where k is the number of keys in section
+int ht_snapshot_decode_bucket(struct hashtable *ht, const void *section,
+                              size_t len, void *(*key_decode)(const void *, int));
+
+// ht_snapwriter_open(path, hash_length, lsn) starts writing a snapshot
+//   with the given hash length and LSN to a temporary file next to path.
+//   The function returns NULL if the file cannot be created or there is
+//   not enough memory for its buffers.
+// effects: allocates heap memory and creates a file; client must call
+//          ht_snapwriter_commit or ht_snapwriter_abort
+// time: O(1)
+struct ht_snapwriter *ht_snapwriter_open(const char *path, int hash_length,
+                                         uint64_t lsn);
+
+// ht_snapwriter_open_delta(path, hash_length, base_lsn, lsn) is like
+//   ht_snapwriter_open, but starts a delta snapshot that applies to the
+//   snapshot with LSN base_lsn.
+// effects: allocates heap memory and creates a file; client must call
+//          ht_snapwriter_commit or ht_snapwriter_abort
+// time: O(1)
+struct ht_snapwriter *ht_snapwriter_open_delta(const char *path, int hash_length,
+                                               uint64_t base_lsn, uint64_t lsn);
+
+// ht_snapwriter_add_bucket(w, ht, index, key_encode) appends the bucket
+//   index of ht to w. For a full snapshot, empty buckets are skipped; a
+//   delta snapshot records them as empty.
+// effects: writes to the file of w
+// requires: 0 <= index < ht_length(ht)
+// time: O(k * en), where k is the number of items in the bucket
+void ht_snapwriter_add_bucket(struct ht_snapwriter *w,
+                              const struct hashtable *ht, int index,
+                              int (*key_encode)(const void *, void *, int));
+
+// ht_snapwriter_add(w, section, len) appends the len bytes of section (as
+//   returned by ht_snapshot_encode_bucket) to w. Each bucket must be added
+//   at most once; the order does not matter.
+// effects: writes to the file of w
+// time: O(len)
+void ht_snapwriter_add(struct ht_snapwriter *w, const void *section, size_t len);
+
+// ht_snapwriter_commit(w) completes the snapshot of w, syncs it, renames
+//   it to its path and syncs the directory, so the new snapshot survives a
+//   crash once the function returns. The function returns
+//   * HT_SUCCESS if the snapshot has been written, or
+//   * HT_IO_ERROR if it could not be written (path is left unchanged) or
+//     the rename could not be synced (path may hold either snapshot).
+// effects: invalidates w
+// time: O(1) plus the time to sync the file and its directory
+int ht_snapwriter_commit(struct ht_snapwriter *w);
+
+// ht_snapwriter_abort(w) discards the snapshot of w.
+// effects: invalidates w
+// time: O(1)
+void ht_snapwriter_abort(struct ht_snapwriter *w);
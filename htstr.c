@@ -0,0 +1,307 @@
+// This is the implementation of the hash table of strings with open
+//   addressing (linear probing over 2^hash_len slots).
+//   A slot holds the 32-bit hash, the length and the arena offset of its
+//   key; a length of STR_EMPTY marks a free slot. The home slot of a key is
+//   given by the low hash_len bits of its hash, so the table grows without
+//   hashing any key again.
+//   The bytes of every key are appended to the arena with a NUL byte. The
+//   bytes of a removed key stay there as garbage until the arena is
+//   compacted. Removals shift later keys of the cluster back into the freed
+//   slot (backward-shift deletion), so there are no tombstones.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include "htstr.h"
+#include <assert.h>
+
+// the length that marks a free slot
+#define STR_EMPTY UINT32_MAX
+// the arena is only compacted once it has at least this much garbage
+#define STR_MIN_GARBAGE 4096
+
+// a slot
+struct str_slot {
+  uint32_t hash;
+  uint32_t len;                                     // STR_EMPTY if free
+  size_t offset;                                    // of the key in the arena
+};
+
+struct hashtable_str {
+  struct str_slot *slots;
+  int hash_len;
+  int slots_mask;                                   // 2^hash_len - 1
+  int count;                                        // number of keys stored
+  char *arena;
+  size_t arena_len;                                 // bytes used (including garbage)
+  size_t arena_cap;
+  size_t garbage;                                   // bytes of removed keys
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static struct str_slot *slots_create(int len);
+static uint32_t str_hash(const char *key, size_t len);
+static int find_slot(const struct hashtable_str *ht, const char *key,
+                     size_t len, uint32_t hash, bool *found);
+static size_t arena_append(struct hashtable_str *ht, const char *key, size_t len);
+static void grow(struct hashtable_str *ht);
+static void compact(struct hashtable_str *ht);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct hashtable_str *ht_create_str(int hash_length) {
+  assert(hash_length > 0 && hash_length < 31);
+
+  struct hashtable_str *ht = malloc(sizeof(struct hashtable_str));
+  ht->hash_len = hash_length;
+  ht->slots_mask = (1 << hash_length) - 1;
+  ht->slots = slots_create(1 << hash_length);
+  ht->count = 0;
+  ht->arena_cap = 256;
+  ht->arena = malloc(ht->arena_cap);
+  ht->arena_len = 0;
+  ht->garbage = 0;
+  return ht;
+}
+
+void ht_destroy_str(struct hashtable_str *ht) {
+  assert(ht);
+  free(ht->slots);
+  free(ht->arena);
+  free(ht);
+}
+
+int ht_insert_str(struct hashtable_str *ht, const char *key, size_t len) {
+  assert(ht);
+  assert(key);
+  assert(len < STR_EMPTY);
+  const uint32_t hash = str_hash(key, len);
+  bool found;
+  int slot = find_slot(ht, key, len, hash, &found);
+  if (found) {
+    return HT_ALREADY_STORED;
+  }
+  // keep the load at most 3/4
+  if (ht->count >= (ht->slots_mask + 1) / 4 * 3) {
+    grow(ht);
+    slot = find_slot(ht, key, len, hash, &found);
+  }
+  ht->slots[slot].hash = hash;
+  ht->slots[slot].len = len;
+  ht->slots[slot].offset = arena_append(ht, key, len);
+  ht->count++;
+  return HT_SUCCESS;
+}
+
+int ht_remove_str(struct hashtable_str *ht, const char *key, size_t len) {
+  assert(ht);
+  assert(key);
+  assert(len < STR_EMPTY);
+  bool found;
+  int hole = find_slot(ht, key, len, str_hash(key, len), &found);
+  if (!found) {
+    return HT_NOT_STORED;
+  }
+  ht->garbage += len + 1;
+  const int mask = ht->slots_mask;
+  for (int next = (hole + 1) & mask; ht->slots[next].len != STR_EMPTY;
+       next = (next + 1) & mask) {
+    const int home = ht->slots[next].hash & mask;
+    // the key at next may move to hole if hole lies on its probe path from
+    //  home to next (cyclically)
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      ht->slots[hole] = ht->slots[next];
+      hole = next;
+    }
+  }
+  ht->slots[hole].len = STR_EMPTY;
+  ht->count--;
+  if (ht->garbage >= STR_MIN_GARBAGE && ht->garbage > ht->arena_len / 2) {
+    compact(ht);
+  }
+  return HT_SUCCESS;
+}
+
+bool ht_contains_str(const struct hashtable_str *ht, const char *key, size_t len) {
+  return ht_lookup_str(ht, key, len) != NULL;
+}
+
+const char *ht_lookup_str(const struct hashtable_str *ht, const char *key,
+                          size_t len) {
+  assert(ht);
+  assert(key);
+  assert(len < STR_EMPTY);
+  bool found;
+  const int slot = find_slot(ht, key, len, str_hash(key, len), &found);
+  return found ? ht->arena + ht->slots[slot].offset : NULL;
+}
+
+int ht_count_str(const struct hashtable_str *ht) {
+  assert(ht);
+  return ht->count;
+}
+
+void ht_foreach_str(const struct hashtable_str *ht,
+                    void (*visit)(void *, const char *, size_t), void *ctx) {
+  assert(ht);
+  assert(visit);
+  for (int i = 0; i <= ht->slots_mask; i++) {
+    const struct str_slot *s = &ht->slots[i];
+    if (s->len != STR_EMPTY) {
+      visit(ctx, ht->arena + s->offset, s->len);
+    }
+  }
+}
+
+void ht_print_str(const struct hashtable_str *ht) {
+  assert(ht);
+  for (int i = 0; i <= ht->slots_mask; i++) {
+    const struct str_slot *s = &ht->slots[i];
+    printf("%d: [", i);
+    if (s->len != STR_EMPTY) {
+      printf("%.*s", (int)s->len, ht->arena + s->offset);
+    }
+    printf("]\n");
+  }
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// slots_create(len) is a helper function that returns an array of len free
+//  slots
+// effects: allocates memory (caller must free)
+// time: O(len)
+static struct str_slot *slots_create(int len) {
+  struct str_slot *slots = malloc(sizeof(struct str_slot) * len);
+  for (int i = 0; i < len; i++) {
+    slots[i].len = STR_EMPTY;
+  }
+  return slots;
+}
+
+// str_hash(key, len) is a helper function that returns the 32-bit hash of
+//  the len bytes at key (FNV-1a, folded by the splitmix64 finalizer)
+// requires: key is a valid pointer
+// time: O(len)
+static uint32_t str_hash(const char *key, size_t len) {
+  assert(key);
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)key[i];
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return (uint32_t)h;
+}
+
+// find_slot(ht, key, len, hash, found) is a helper function that returns
+//  the slot of the len bytes at key (with hash) and sets *found to true if
+//  they are stored in ht, or returns the first free slot of their probe
+//  sequence and sets *found to false; the bytes of a stored key are only
+//  compared if its hash and length match
+// requires: all pointers are valid; ht has a free slot
+// effects: modifies *found
+// time: O(c + len), where c is the length of the cluster at the home slot
+static int find_slot(const struct hashtable_str *ht, const char *key,
+                     size_t len, uint32_t hash, bool *found) {
+  assert(ht);
+  assert(key);
+  assert(found);
+  int i = hash & ht->slots_mask;
+  for (; ht->slots[i].len != STR_EMPTY; i = (i + 1) & ht->slots_mask) {
+    const struct str_slot *s = &ht->slots[i];
+    if (s->hash == hash && s->len == len &&
+        memcmp(ht->arena + s->offset, key, len) == 0) {
+      *found = true;
+      return i;
+    }
+  }
+  *found = false;
+  return i;
+}
+
+// arena_append(ht, key, len) is a helper function that copies the len
+//  bytes at key and a NUL byte to the end of the arena of ht and returns
+//  their offset
+// requires: all pointers are valid; key does not point into the arena
+// effects: may reallocate the arena of ht
+// time: O(len) amortized
+static size_t arena_append(struct hashtable_str *ht, const char *key, size_t len) {
+  assert(ht);
+  assert(key);
+  if (ht->arena_len + len + 1 > ht->arena_cap) {
+    while (ht->arena_len + len + 1 > ht->arena_cap) {
+      ht->arena_cap *= 2;
+    }
+    ht->arena = realloc(ht->arena, ht->arena_cap);
+  }
+  const size_t offset = ht->arena_len;
+  memcpy(ht->arena + offset, key, len);
+  ht->arena[offset + len] = '\0';
+  ht->arena_len += len + 1;
+  return offset;
+}
+
+// grow(ht) is a helper function that moves all keys of ht into a slot
+//  array that is twice as long; the arena is not touched
+// requires: ht is a valid pointer; hash_len < 30
+// effects: modifies ht
+// time: O(n), where n is the number of slots
+static void grow(struct hashtable_str *ht) {
+  assert(ht);
+  assert(ht->hash_len < 30);
+  struct str_slot *old = ht->slots;
+  const int old_len = ht->slots_mask + 1;
+  ht->hash_len++;
+  ht->slots_mask = (1 << ht->hash_len) - 1;
+  ht->slots = slots_create(1 << ht->hash_len);
+  for (int i = 0; i < old_len; i++) {
+    if (old[i].len != STR_EMPTY) {
+      int j = old[i].hash & ht->slots_mask;
+      while (ht->slots[j].len != STR_EMPTY) {
+        j = (j + 1) & ht->slots_mask;
+      }
+      ht->slots[j] = old[i];
+    }
+  }
+  free(old);
+}
+
+// compact(ht) is a helper function that copies the keys of ht into a new
+//  arena without the garbage of removed keys
+// requires: ht is a valid pointer
+// effects: modifies ht
+// time: O(n + b), where n is the number of slots and b is the size of the
+//   arena
+static void compact(struct hashtable_str *ht) {
+  assert(ht);
+  const size_t live = ht->arena_len - ht->garbage;
+  size_t cap = 256;
+  while (cap < live) {
+    cap *= 2;
+  }
+  char *arena = malloc(cap);
+  size_t len = 0;
+  for (int i = 0; i <= ht->slots_mask; i++) {
+    struct str_slot *s = &ht->slots[i];
+    if (s->len != STR_EMPTY) {
+      memcpy(arena + len, ht->arena + s->offset, s->len + 1);
+      s->offset = len;
+      len += s->len + 1;
+    }
+  }
+  assert(len == live);
+  free(ht->arena);
+  ht->arena = arena;
+  ht->arena_len = len;
+  ht->arena_cap = cap;
+  ht->garbage = 0;
+}
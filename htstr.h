@@ -0,0 +1,80 @@
+// This is the interface of a hash table that is specialized for string
+//   keys. A string is given as a pointer and a length, so it need not be
+//   NUL-terminated and may contain NUL bytes. The table copies the bytes of
+//   every key into a single arena (instead of a key_clone allocation per
+//   key) and keeps the hash, the length and the arena offset of each key in
+//   its slot, so a lookup only calls memcmp on keys with the same hash and
+//   length. No connectors are needed.
+//   The return codes HT_SUCCESS, HT_ALREADY_STORED and HT_NOT_STORED are
+//   shared with hashtable.h.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hashtable.h"
+
+// a hash table of strings
+struct hashtable_str;
+
+// requires: all functions require valid (non-NULL) parameters
+//           lengths of keys must be less than 2^32 - 1
+
+// ht_create_str(hash_length) creates a new empty table with room for
+//   3/4 * 2^hash_length keys before it first grows.
+// effects: allocates heap memory; client must call ht_destroy_str
+// requires: 0 < hash_length < 31
+// time: O(n), where n is the number of slots
+struct hashtable_str *ht_create_str(int hash_length);
+
+// ht_destroy_str(ht) frees all resources allocated by the table ht.
+// effects: invalidates ht
+// time: O(1)
+void ht_destroy_str(struct hashtable_str *ht);
+
+// ht_insert_str(ht, key, len) inserts the len bytes at key into ht. The
+//   function returns
+//   * HT_SUCCESS if key has been inserted into ht or
+//   * HT_ALREADY_STORED if key is already stored in ht.
+// effects: may modify ht
+// time: O(len) expected, O(n + b) if ht grows, where b is the size of the
+//   arena
+int ht_insert_str(struct hashtable_str *ht, const char *key, size_t len);
+
+// ht_remove_str(ht, key, len) removes the len bytes at key from ht. The
+//   function returns
+//   * HT_SUCCESS if key has been removed from ht, or
+//   * HT_NOT_STORED if key was not stored in ht.
+//   The arena is compacted once more than half of it belongs to removed
+//   keys.
+// effects: may modify ht
+// time: O(len) expected, O(n + b) if the arena is compacted
+int ht_remove_str(struct hashtable_str *ht, const char *key, size_t len);
+
+// ht_contains_str(ht, key, len) returns true if the len bytes at key are
+//   stored in ht, and false otherwise.
+// time: O(len) expected
+bool ht_contains_str(const struct hashtable_str *ht, const char *key, size_t len);
+
+// ht_lookup_str(ht, key, len) returns the copy of key that is stored in ht
+//   (followed by a NUL byte), or NULL if key is not stored in ht. The copy
+//   is valid until ht is modified.
+// time: O(len) expected
+const char *ht_lookup_str(const struct hashtable_str *ht, const char *key,
+                          size_t len);
+
+// ht_count_str(ht) returns the number of keys stored in ht.
+// time: O(1)
+int ht_count_str(const struct hashtable_str *ht);
+
+// ht_foreach_str(ht, visit, ctx) calls visit(ctx, key, len) for every key
+//   stored in ht, in no particular order; key is followed by a NUL byte.
+//   visit must not modify ht.
+// time: O(n + m * v), where n is the number of slots, m is the number of
+//   keys in ht and v is the complexity of visit
+void ht_foreach_str(const struct hashtable_str *ht,
+                    void (*visit)(void *, const char *, size_t), void *ctx);
+
+// ht_print_str(ht) prints the keys of ht to the console.
+// effects: creates output
+// time: O(n + b), where n is the number of slots and b is the size of the
+//   arena
+void ht_print_str(const struct hashtable_str *ht);
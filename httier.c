@@ -0,0 +1,464 @@
+// This is the implementation of tiered storage.
+//   A spilled bucket is stored as one snapshot section (see htsnapshot.h)
+//   that is appended to the segment file; a bucket that is faulted back in
+//   leaves its old section behind as garbage. When the garbage outgrows the
+//   live sections, the live sections are copied to a new segment file.
+//   Cold buckets are chosen with the clock algorithm: every access sets the
+//   referenced bit of a bucket, and the clock hand spills the next bucket
+//   without it, clearing the bits it passes.
+//   The filter of a spilled bucket is a 64-bit Bloom filter with two bits
+//   per key, taken from the hash of the encoding of the key
+//   (ht_key_hash64).
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "httier.h"
+#include <assert.h>
+#include <stdbool.h>
+
+// the segment file is compacted once it holds this much garbage (and more
+//   garbage than live sections)
+#define TIER_COMPACT_BYTES (1 << 20)
+
+// the state of a bucket
+struct tier_bucket {
+  uint64_t offset;                                  // of the section of a spilled bucket
+  uint32_t len;                                     // of the section; 0 if in memory
+  int count;                                        // number of keys of the bucket
+  uint64_t filter;                                  // of the keys of a spilled bucket
+  bool referenced;                                  // accessed since the clock hand passed
+};
+
+struct httier {
+  struct hashtable *ht;
+  int (*key_encode)(const void *, void *, int);
+  void *(*key_decode)(const void *, int);
+  char *path;                                       // of the segment file
+  int fd;                                           // of the segment file
+  uint64_t end;                                     // size of the segment file
+  uint64_t garbage;                                 // bytes of sections faulted back in
+  int ht_len;                                       // number of buckets
+  struct tier_bucket *buckets;
+  int hand;                                         // the clock hand
+  int count;                                        // number of keys
+  int resident;                                     // number of keys in memory
+  int max_resident;
+  int spilled;                                      // number of spilled buckets
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static int touch_bucket(struct httier *t, int index);
+static int fault_in(struct httier *t, int index);
+static bool spill(struct httier *t, int index);
+static void evict(struct httier *t, int keep);
+static void compact(struct httier *t);
+static uint64_t key_filter(const struct httier *t, const void *key);
+static void filter_add(void *ctx, const void *key);
+static void count_key(void *ctx, const void *key);
+static bool read_all(int fd, void *buf, size_t len, uint64_t offset);
+static bool write_all(int fd, const void *buf, size_t len, uint64_t offset);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+// the context of filter_add
+struct tier_filter_ctx {
+  const struct httier *t;
+  uint64_t filter;
+};
+
+struct httier *httier_create(struct hashtable *ht, const char *path,
+                             int max_resident,
+                             int (*key_encode)(const void *, void *, int),
+                             void *(*key_decode)(const void *, int)) {
+  assert(ht);
+  assert(path);
+  assert(max_resident > 0);
+  assert(key_encode);
+  assert(key_decode);
+
+  const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct httier *t = malloc(sizeof(struct httier));
+  t->ht = ht;
+  t->key_encode = key_encode;
+  t->key_decode = key_decode;
+  t->path = strdup(path);
+  t->fd = fd;
+  t->end = 0;
+  t->garbage = 0;
+  t->ht_len = ht_length(ht);
+  t->buckets = malloc(sizeof(struct tier_bucket) * t->ht_len);
+  t->hand = 0;
+  t->count = 0;
+  t->max_resident = max_resident;
+  t->spilled = 0;
+  for (int i = 0; i < t->ht_len; i++) {
+    struct tier_bucket *b = &t->buckets[i];
+    b->offset = 0;
+    b->len = 0;
+    b->count = 0;
+    ht_bucket_foreach(ht, i, count_key, &b->count);
+    b->filter = 0;
+    b->referenced = false;
+    t->count += b->count;
+  }
+  t->resident = t->count;
+  evict(t, -1);
+  return t;
+}
+
+void httier_destroy(struct httier *t) {
+  assert(t);
+  close(t->fd);
+  unlink(t->path);
+  free(t->path);
+  free(t->buckets);
+  free(t);
+}
+
+int httier_insert(struct httier *t, const void *key) {
+  assert(t);
+  assert(key);
+  const int index = ht_index(t->ht, key);
+  if (touch_bucket(t, index) != HT_SUCCESS) {
+    return HT_IO_ERROR;
+  }
+  const int result = ht_insert(t->ht, key);
+  if (result == HT_SUCCESS) {
+    t->buckets[index].count++;
+    t->count++;
+    t->resident++;
+    evict(t, index);
+  }
+  return result;
+}
+
+int httier_remove(struct httier *t, const void *key) {
+  assert(t);
+  assert(key);
+  const int index = ht_index(t->ht, key);
+  const struct tier_bucket *b = &t->buckets[index];
+  if (b->len > 0) {
+    const uint64_t bits = key_filter(t, key);
+    if ((b->filter & bits) != bits) {
+      return HT_NOT_STORED;
+    }
+  }
+  if (touch_bucket(t, index) != HT_SUCCESS) {
+    return HT_IO_ERROR;
+  }
+  const int result = ht_remove(t->ht, key);
+  if (result == HT_SUCCESS) {
+    t->buckets[index].count--;
+    t->count--;
+    t->resident--;
+  }
+  return result;
+}
+
+int httier_contains(struct httier *t, const void *key) {
+  assert(t);
+  assert(key);
+  const int index = ht_index(t->ht, key);
+  const struct tier_bucket *b = &t->buckets[index];
+  if (b->len > 0) {
+    const uint64_t bits = key_filter(t, key);
+    if ((b->filter & bits) != bits) {
+      return HT_NOT_STORED;
+    }
+  }
+  if (touch_bucket(t, index) != HT_SUCCESS) {
+    return HT_IO_ERROR;
+  }
+  return ht_contains(t->ht, key) ? HT_ALREADY_STORED : HT_NOT_STORED;
+}
+
+int httier_load_all(struct httier *t) {
+  assert(t);
+  int result = HT_SUCCESS;
+  for (int i = 0; i < t->ht_len; i++) {
+    if (t->buckets[i].len > 0 && fault_in(t, i) != HT_SUCCESS) {
+      result = HT_IO_ERROR;
+    }
+  }
+  return result;
+}
+
+int httier_count(const struct httier *t) {
+  assert(t);
+  return t->count;
+}
+
+int httier_resident(const struct httier *t) {
+  assert(t);
+  return t->resident;
+}
+
+int httier_spilled(const struct httier *t) {
+  assert(t);
+  return t->spilled;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// touch_bucket(t, index) is a helper function that marks the bucket index
+//  as referenced and faults it in if it is spilled. It returns HT_SUCCESS
+//  if the bucket is in memory and HT_IO_ERROR otherwise.
+// requires: t is a valid pointer; 0 <= index < t->ht_len
+// effects: modifies t; may read and write the segment file
+// time: O(1), plus the time to fault in the bucket and to spill others
+static int touch_bucket(struct httier *t, int index) {
+  assert(t);
+  struct tier_bucket *b = &t->buckets[index];
+  b->referenced = true;
+  if (b->len == 0) {
+    return HT_SUCCESS;
+  }
+  const int result = fault_in(t, index);
+  if (result == HT_SUCCESS) {
+    evict(t, index);
+  }
+  return result;
+}
+
+// fault_in(t, index) is a helper function that reads the spilled bucket
+//  index back into the table. It returns HT_SUCCESS or HT_IO_ERROR (the
+//  bucket then stays spilled).
+// requires: t is a valid pointer; the bucket index is spilled
+// effects: modifies t and its table; reads the segment file and may
+//  compact it
+// time: O(k * (de + hf + k * co)) where k is the number of keys of the
+//  bucket
+static int fault_in(struct httier *t, int index) {
+  assert(t);
+  struct tier_bucket *b = &t->buckets[index];
+  assert(b->len > 0);
+  void *section = malloc(b->len);
+  if (!read_all(t->fd, section, b->len, b->offset) ||
+      ht_snapshot_decode_bucket(t->ht, section, b->len, t->key_decode) != HT_SUCCESS) {
+    free(section);
+    ht_bucket_clear(t->ht, index);
+    return HT_IO_ERROR;
+  }
+  free(section);
+  t->garbage += b->len;
+  t->resident += b->count;
+  t->spilled--;
+  b->len = 0;
+  b->filter = 0;
+  if (t->spilled == 0) {
+    // nothing in the segment file is live anymore
+    if (ftruncate(t->fd, 0) == 0) {
+      t->end = 0;
+      t->garbage = 0;
+    }
+  } else if (t->garbage >= TIER_COMPACT_BYTES && t->garbage > t->end - t->garbage) {
+    compact(t);
+  }
+  return HT_SUCCESS;
+}
+
+// spill(t, index) is a helper function that appends the bucket index to
+//  the segment file and removes its keys from the table. It returns false
+//  if the bucket could not be written (it then stays in memory).
+// requires: t is a valid pointer; the bucket index is in memory and not
+//  empty
+// effects: modifies t and its table; writes the segment file
+// time: O(k * (en + ds)) where k is the number of keys of the bucket
+static bool spill(struct httier *t, int index) {
+  assert(t);
+  struct tier_bucket *b = &t->buckets[index];
+  assert(b->len == 0 && b->count > 0);
+  size_t len = 0;
+  void *section = ht_snapshot_encode_bucket(t->ht, index, t->key_encode, &len);
+  assert(section);
+  if (len > UINT32_MAX || !write_all(t->fd, section, len, t->end)) {
+    free(section);
+    return false;
+  }
+  free(section);
+
+  struct tier_filter_ctx ctx = {t, 0};
+  ht_bucket_foreach(t->ht, index, filter_add, &ctx);
+  ht_bucket_clear(t->ht, index);
+  b->offset = t->end;
+  b->len = len;
+  b->filter = ctx.filter;
+  t->end += len;
+  t->resident -= b->count;
+  t->spilled++;
+  return true;
+}
+
+// evict(t, keep) is a helper function that spills cold buckets other than
+//  keep until at most max_resident keys are in memory. It gives up after
+//  the clock hand has gone around twice or if the segment file cannot be
+//  written.
+// requires: t is a valid pointer
+// effects: modifies t and its table; writes the segment file
+// time: O(n), plus the time to spill, where n is the length of the table
+static void evict(struct httier *t, int keep) {
+  assert(t);
+  for (int steps = 0; t->resident > t->max_resident && steps < 2 * t->ht_len; steps++) {
+    const int index = t->hand;
+    t->hand = (t->hand + 1) % t->ht_len;
+    struct tier_bucket *b = &t->buckets[index];
+    if (index == keep || b->len > 0 || b->count == 0) {
+      continue;
+    }
+    if (b->referenced) {
+      b->referenced = false;
+      continue;
+    }
+    if (!spill(t, index)) {
+      return;
+    }
+  }
+}
+
+// compact(t) is a helper function that copies the sections of all spilled
+//  buckets to a new segment file that replaces the old one. If the new file
+//  cannot be written, the old one is kept.
+// requires: t is a valid pointer
+// effects: modifies t; replaces the segment file
+// time: O(n + s) where n is the length of the table and s the size of the
+//  live sections
+static void compact(struct httier *t) {
+  assert(t);
+  const size_t path_len = strlen(t->path);
+  char *tmp_path = malloc(path_len + sizeof(".tmp"));
+  memcpy(tmp_path, t->path, path_len);
+  memcpy(tmp_path + path_len, ".tmp", sizeof(".tmp"));
+  const int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    free(tmp_path);
+    return;
+  }
+
+  uint64_t *offsets = malloc(sizeof(uint64_t) * t->ht_len);
+  void *buf = NULL;
+  size_t buf_cap = 0;
+  uint64_t end = 0;
+  bool ok = true;
+  for (int i = 0; ok && i < t->ht_len; i++) {
+    const struct tier_bucket *b = &t->buckets[i];
+    if (b->len == 0) {
+      continue;
+    }
+    if (b->len > buf_cap) {
+      buf_cap = b->len;
+      buf = realloc(buf, buf_cap);
+    }
+    ok = read_all(t->fd, buf, b->len, b->offset) &&
+         write_all(fd, buf, b->len, end);
+    offsets[i] = end;
+    end += b->len;
+  }
+  free(buf);
+
+  if (ok && rename(tmp_path, t->path) == 0) {
+    close(t->fd);
+    t->fd = fd;
+    for (int i = 0; i < t->ht_len; i++) {
+      if (t->buckets[i].len > 0) {
+        t->buckets[i].offset = offsets[i];
+      }
+    }
+    t->end = end;
+    t->garbage = 0;
+  } else {
+    close(fd);
+    unlink(tmp_path);
+  }
+  free(offsets);
+  free(tmp_path);
+}
+
+// key_filter(t, key) is a helper function that returns the two filter bits
+//  of key
+// requires: all pointers are valid
+// time: O(en) where en is the time complexity of key_encode
+static uint64_t key_filter(const struct httier *t, const void *key) {
+  assert(t);
+  assert(key);
+  const uint64_t h = ht_key_hash64(key, t->key_encode);
+  return ((uint64_t)1 << (h & 63)) | ((uint64_t)1 << ((h >> 6) & 63));
+}
+
+// filter_add(ctx, key) is a helper function that adds key to the filter of
+//  the context ctx (a struct tier_filter_ctx)
+// requires: all pointers are valid
+// effects: modifies ctx
+// time: O(en) where en is the time complexity of key_encode
+static void filter_add(void *ctx, const void *key) {
+  struct tier_filter_ctx *f = ctx;
+  assert(f);
+  f->filter |= key_filter(f->t, key);
+}
+
+// count_key(ctx, key) is a helper function that increments the int ctx
+// requires: ctx is a valid pointer
+// effects: modifies ctx
+// time: O(1)
+static void count_key(void *ctx, const void *key) {
+  (void)key;
+  int *count = ctx;
+  assert(count);
+  (*count)++;
+}
+
+// read_all(fd, buf, len, offset) is a helper function that reads len bytes
+//  at offset of the file fd into buf; it returns false on failure
+// requires: buf is a valid pointer
+// effects: modifies buf
+// time: O(len)
+static bool read_all(int fd, void *buf, size_t len, uint64_t offset) {
+  assert(buf);
+  unsigned char *p = buf;
+  while (len > 0) {
+    const ssize_t n = pread(fd, p, len, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+// write_all(fd, buf, len, offset) is a helper function that writes the len
+//  bytes at buf to offset of the file fd; it returns false on failure
+// requires: buf is a valid pointer
+// effects: writes the file fd
+// time: O(len)
+static bool write_all(int fd, const void *buf, size_t len, uint64_t offset) {
+  assert(buf);
+  const unsigned char *p = buf;
+  while (len > 0) {
+    const ssize_t n = pwrite(fd, p, len, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
@@ -0,0 +1,95 @@
+// This is the interface of tiered storage for generic hash tables that are
+//   larger than memory. A tier keeps at most a given number of keys of a
+//   table in memory. When there are more, cold buckets (buckets that have
+//   not been accessed for a while) are spilled: their keys are written to an
+//   append-only segment file and removed from the table, and the tier only
+//   keeps the file offset of the bucket and a small filter of its keys.
+//   Accessing a spilled bucket faults it back into the table; the filter
+//   answers most removals of keys that are not stored without reading the
+//   file.
+//   Keys are written with a key_encode connector and read with a key_decode
+//   connector (see htsnapshot.h).
+
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// a tier of a hash table
+struct httier;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// httier_create(ht, path, max_resident, key_encode, key_decode) creates a
+//   tier for ht with the segment file path (created or truncated) that
+//   keeps at most max_resident keys of ht in memory, spilling buckets of
+//   ht right away if it holds more. The function returns NULL if the
+//   segment file cannot be created.
+// effects: allocates heap memory and creates a file; client must call
+//          httier_destroy
+// requires: max_resident must be positive
+//           ht has no observers (see ht_observe) and is only modified
+//           through the tier while it exists
+// time: O(n + m), plus the time to spill, where n is the length and m the
+//   number of items of ht
+struct httier *httier_create(struct hashtable *ht, const char *path,
+                             int max_resident,
+                             int (*key_encode)(const void *, void *, int),
+                             void *(*key_decode)(const void *, int));
+
+// httier_destroy(t) frees all resources of t and removes its segment file.
+//   The keys of spilled buckets are discarded; call httier_load_all first to
+//   keep them in the table.
+// effects: invalidates t; removes a file
+// time: O(n), where n is the length of the table of t
+void httier_destroy(struct httier *t);
+
+// httier_insert(t, key) inserts key into the table of t, like ht_insert.
+//   The function returns
+//   * HT_SUCCESS if key has been inserted,
+//   * HT_ALREADY_STORED if key is already stored, or
+//   * HT_IO_ERROR if the bucket of key could not be faulted in.
+// effects: modifies the table of t; may read and write the segment file
+// time: O(ht_insert), plus the time to fault in the bucket of key and to
+//   spill other buckets
+int httier_insert(struct httier *t, const void *key);
+
+// httier_remove(t, key) removes key from the table of t, like ht_remove.
+//   The function returns
+//   * HT_SUCCESS if key has been removed,
+//   * HT_NOT_STORED if key was not stored, or
+//   * HT_IO_ERROR if the bucket of key could not be faulted in.
+// effects: modifies the table of t; may read and write the segment file
+// time: O(ht_remove + en), plus the time to fault in the bucket of key and
+//   to spill other buckets
+int httier_remove(struct httier *t, const void *key);
+
+// httier_contains(t, key) returns
+//   * HT_ALREADY_STORED if key is stored in the table of t,
+//   * HT_NOT_STORED if it is not, or
+//   * HT_IO_ERROR if the bucket of key could not be faulted in.
+// effects: may read and write the segment file
+// time: O(ht_contains + en), plus the time to fault in the bucket of key
+//   and to spill other buckets
+int httier_contains(struct httier *t, const void *key);
+
+// httier_load_all(t) faults all spilled buckets of t back into its table,
+//   regardless of the limit of resident keys. The function returns
+//   * HT_SUCCESS if all buckets are in memory, or
+//   * HT_IO_ERROR if a bucket could not be faulted in (it stays spilled).
+// effects: modifies the table of t; reads the segment file
+// time: O(n + s), where n is the length of the table and s the number of
+//   spilled keys
+int httier_load_all(struct httier *t);
+
+// httier_count(t) returns the number of keys stored in t, in memory or
+//   spilled.
+// time: O(1)
+int httier_count(const struct httier *t);
+
+// httier_resident(t) returns the number of keys of t that are in memory.
+// time: O(1)
+int httier_resident(const struct httier *t);
+
+// httier_spilled(t) returns the number of spilled buckets of t.
+// time: O(1)
+int httier_spilled(const struct httier *t);
@@ -0,0 +1,359 @@
+// This is the implementation of the top-k tracker.
+//   The count-min sketch has depth rows of width counters; row i counts a
+//   key in the column given by a separate 64-bit mix of the key hash and i,
+//   so two keys that share a column in one row rarely share it in another
+//   (double hashing would make them collide in all rows with probability
+//   1 / width^2). The estimate of a key is the smallest of its depth
+//   counters.
+//   The candidates are kept in a min-heap ordered by their estimates, so the
+//   lightest candidate is the one to replace, and in an open-addressing
+//   index (linear probing over 2k or more slots) for finding a candidate by
+//   key. Unlike plain space-saving, a new key only replaces the lightest
+//   candidate if its own estimate is larger, so light keys do not churn
+//   the candidate set.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "httopk.h"
+#include <assert.h>
+#include <stdbool.h>
+
+// the hash length used for key_hash
+#define TOPK_HASH_BITS 31
+
+// a candidate
+struct topk_entry {
+  void *key;
+  long count;                                       // estimate of the key
+  uint32_t hash;
+  int heap_pos;                                     // position in the heap
+};
+
+struct httopk {
+  void *(*key_clone)(const void *);
+  int (*key_hash)(const void *, int);
+  int (*key_compare)(const void *, const void *);
+  void (*key_destroy)(void *);
+  void (*key_print)(const void *);
+  int width;
+  int depth;
+  long *sketch;                                     // depth rows of width counters
+  int k;                                            // maximum number of candidates
+  int len;                                          // number of candidates
+  struct topk_entry *entries;
+  int *heap;                                        // entries, min-heap by count
+  int *slots;                                       // index of entries; -1 if free
+  int slots_mask;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static size_t column(const struct httopk *t, uint32_t hash, int row);
+static long sketch_add(struct httopk *t, uint32_t hash, long delta);
+static int find_entry(const struct httopk *t, const void *key, uint32_t hash);
+static void slot_insert(struct httopk *t, int entry);
+static void slot_remove(struct httopk *t, int entry);
+static void heap_swap(struct httopk *t, int a, int b);
+static void sift_down(struct httopk *t, int pos);
+static void sift_up(struct httopk *t, int pos);
+static int compare_entries(const void *a, const void *b);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct httopk *httopk_create(void *(*key_clone)(const void *),
+                             int (*key_hash)(const void *, int),
+                             int (*key_compare)(const void *, const void *),
+                             void (*key_destroy)(void *),
+                             void (*key_print)(const void *),
+                             int k, int width, int depth) {
+  assert(key_clone);
+  assert(key_hash);
+  assert(key_compare);
+  assert(key_destroy);
+  assert(key_print);
+  assert(k > 0);
+  assert(width > 0 && (width & (width - 1)) == 0);
+  assert(depth > 0);
+
+  struct httopk *t = malloc(sizeof(struct httopk));
+  t->key_clone = key_clone;
+  t->key_hash = key_hash;
+  t->key_compare = key_compare;
+  t->key_destroy = key_destroy;
+  t->key_print = key_print;
+  t->width = width;
+  t->depth = depth;
+  t->sketch = calloc((size_t)width * depth, sizeof(long));
+  t->k = k;
+  t->len = 0;
+  t->entries = malloc(sizeof(struct topk_entry) * k);
+  t->heap = malloc(sizeof(int) * k);
+  int slots = 1;
+  while (slots < 2 * k) {
+    slots *= 2;
+  }
+  t->slots = malloc(sizeof(int) * slots);
+  for (int i = 0; i < slots; i++) {
+    t->slots[i] = -1;
+  }
+  t->slots_mask = slots - 1;
+  return t;
+}
+
+void httopk_destroy(struct httopk *t) {
+  assert(t);
+  for (int i = 0; i < t->len; i++) {
+    t->key_destroy(t->entries[i].key);
+  }
+  free(t->sketch);
+  free(t->entries);
+  free(t->heap);
+  free(t->slots);
+  free(t);
+}
+
+long httopk_add(struct httopk *t, const void *key, long delta) {
+  assert(t);
+  assert(key);
+  assert(delta > 0);
+  const uint32_t hash = t->key_hash(key, TOPK_HASH_BITS);
+  const long estimate = sketch_add(t, hash, delta);
+
+  const int found = find_entry(t, key, hash);
+  if (found >= 0) {
+    t->entries[found].count = estimate;
+    sift_down(t, t->entries[found].heap_pos);
+    return estimate;
+  }
+
+  int entry;
+  if (t->len < t->k) {
+    entry = t->len++;
+    t->heap[entry] = entry;
+    t->entries[entry].heap_pos = entry;
+  } else if (estimate > t->entries[t->heap[0]].count) {
+    // replace the lightest candidate
+    entry = t->heap[0];
+    slot_remove(t, entry);
+    t->key_destroy(t->entries[entry].key);
+  } else {
+    return estimate;
+  }
+  t->entries[entry].key = t->key_clone(key);
+  t->entries[entry].count = estimate;
+  t->entries[entry].hash = hash;
+  slot_insert(t, entry);
+  sift_up(t, t->entries[entry].heap_pos);
+  sift_down(t, t->entries[entry].heap_pos);
+  return estimate;
+}
+
+long httopk_estimate(const struct httopk *t, const void *key) {
+  assert(t);
+  assert(key);
+  const uint32_t hash = t->key_hash(key, TOPK_HASH_BITS);
+  long estimate = t->sketch[column(t, hash, 0)];
+  for (int i = 1; i < t->depth; i++) {
+    const long count = t->sketch[column(t, hash, i)];
+    if (count < estimate) {
+      estimate = count;
+    }
+  }
+  return estimate;
+}
+
+int httopk_list(const struct httopk *t, const void **keys, long *counts, int max) {
+  assert(t);
+  assert(keys);
+  assert(counts);
+  struct topk_entry *sorted = malloc(sizeof(struct topk_entry) * (t->len ? t->len : 1));
+  for (int i = 0; i < t->len; i++) {
+    sorted[i] = t->entries[i];
+  }
+  qsort(sorted, t->len, sizeof(struct topk_entry), compare_entries);
+  const int n = t->len < max ? t->len : max;
+  for (int i = 0; i < n; i++) {
+    keys[i] = sorted[i].key;
+    counts[i] = sorted[i].count;
+  }
+  free(sorted);
+  return n;
+}
+
+void httopk_print(const struct httopk *t) {
+  assert(t);
+  const void **keys = malloc(sizeof(void *) * t->k);
+  long *counts = malloc(sizeof(long) * t->k);
+  const int n = httopk_list(t, keys, counts, t->k);
+  printf("[");
+  for (int i = 0; i < n; i++) {
+    if (i > 0) {
+      printf(",");
+    }
+    t->key_print(keys[i]);
+    printf("-%ld", counts[i]);
+  }
+  printf("]\n");
+  free(keys);
+  free(counts);
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// column(t, hash, row) is a helper function that returns the position in
+//  the sketch of t of the counter of row for the key with hash (splitmix64
+//  of hash and row)
+// requires: t is a valid pointer; 0 <= row < depth
+// time: O(1)
+static size_t column(const struct httopk *t, uint32_t hash, int row) {
+  assert(t);
+  uint64_t h = hash + (uint64_t)(row + 1) * 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return (size_t)row * t->width + (h & (t->width - 1));
+}
+
+// sketch_add(t, hash, delta) is a helper function that adds delta to the
+//  counters of the key with hash in the sketch of t and returns the new
+//  estimate of its count
+// requires: t is a valid pointer
+// effects: modifies t
+// time: O(depth)
+static long sketch_add(struct httopk *t, uint32_t hash, long delta) {
+  assert(t);
+  long estimate = -1;
+  for (int i = 0; i < t->depth; i++) {
+    long *counter = &t->sketch[column(t, hash, i)];
+    *counter += delta;
+    if (estimate < 0 || *counter < estimate) {
+      estimate = *counter;
+    }
+  }
+  return estimate;
+}
+
+// find_entry(t, key, hash) is a helper function that returns the candidate
+//  entry of key, or -1 if key is not a candidate
+// requires: all pointers are valid
+// time: O(co) expected
+static int find_entry(const struct httopk *t, const void *key, uint32_t hash) {
+  assert(t);
+  assert(key);
+  for (int slot = hash & t->slots_mask; t->slots[slot] >= 0;
+       slot = (slot + 1) & t->slots_mask) {
+    const struct topk_entry *e = &t->entries[t->slots[slot]];
+    if (e->hash == hash && t->key_compare(key, e->key) == 0) {
+      return t->slots[slot];
+    }
+  }
+  return -1;
+}
+
+// slot_insert(t, entry) is a helper function that adds entry to the index
+//  of t
+// requires: t is a valid pointer; the index has a free slot
+// effects: modifies t
+// time: O(1) expected
+static void slot_insert(struct httopk *t, int entry) {
+  assert(t);
+  int slot = t->entries[entry].hash & t->slots_mask;
+  while (t->slots[slot] >= 0) {
+    slot = (slot + 1) & t->slots_mask;
+  }
+  t->slots[slot] = entry;
+}
+
+// slot_remove(t, entry) is a helper function that removes entry from the
+//  index of t, moving later entries of its probe sequence back so that no
+//  lookup stops early at the freed slot
+// requires: t is a valid pointer; entry is in the index
+// effects: modifies t
+// time: O(1) expected
+static void slot_remove(struct httopk *t, int entry) {
+  assert(t);
+  int slot = t->entries[entry].hash & t->slots_mask;
+  while (t->slots[slot] != entry) {
+    slot = (slot + 1) & t->slots_mask;
+  }
+  int hole = slot;
+  for (int next = (hole + 1) & t->slots_mask; t->slots[next] >= 0;
+       next = (next + 1) & t->slots_mask) {
+    const int home = t->entries[t->slots[next]].hash & t->slots_mask;
+    // the entry at next may move to hole if hole lies on its probe path
+    //  from home to next (cyclically)
+    if (((next - home) & t->slots_mask) >= ((next - hole) & t->slots_mask)) {
+      t->slots[hole] = t->slots[next];
+      hole = next;
+    }
+  }
+  t->slots[hole] = -1;
+}
+
+// heap_swap(t, a, b) is a helper function that swaps the heap positions a
+//  and b
+// requires: t is a valid pointer
+// effects: modifies t
+// time: O(1)
+static void heap_swap(struct httopk *t, int a, int b) {
+  assert(t);
+  const int entry = t->heap[a];
+  t->heap[a] = t->heap[b];
+  t->heap[b] = entry;
+  t->entries[t->heap[a]].heap_pos = a;
+  t->entries[t->heap[b]].heap_pos = b;
+}
+
+// sift_down(t, pos) is a helper function that moves the entry at heap
+//  position pos down until no child has a smaller count
+// requires: t is a valid pointer
+// effects: modifies t
+// time: O(log k)
+static void sift_down(struct httopk *t, int pos) {
+  assert(t);
+  for (;;) {
+    int smallest = pos;
+    for (int child = 2 * pos + 1; child <= 2 * pos + 2 && child < t->len; child++) {
+      if (t->entries[t->heap[child]].count < t->entries[t->heap[smallest]].count) {
+        smallest = child;
+      }
+    }
+    if (smallest == pos) {
+      return;
+    }
+    heap_swap(t, pos, smallest);
+    pos = smallest;
+  }
+}
+
+// sift_up(t, pos) is a helper function that moves the entry at heap
+//  position pos up until its parent has no larger count
+// requires: t is a valid pointer
+// effects: modifies t
+// time: O(log k)
+static void sift_up(struct httopk *t, int pos) {
+  assert(t);
+  while (pos > 0) {
+    const int parent = (pos - 1) / 2;
+    if (t->entries[t->heap[parent]].count <= t->entries[t->heap[pos]].count) {
+      return;
+    }
+    heap_swap(t, pos, parent);
+    pos = parent;
+  }
+}
+
+// compare_entries(a, b) is a helper function for qsort that orders
+//  entries by decreasing count
+// requires: all pointers are valid
+// time: O(1)
+static int compare_entries(const void *a, const void *b) {
+  const long count_a = ((const struct topk_entry *)a)->count;
+  const long count_b = ((const struct topk_entry *)b)->count;
+  return (count_a < count_b) - (count_a > count_b);
+}
@@ -0,0 +1,60 @@
+// This is the interface of a generic heavy-hitter (top-k) tracker. It
+//   counts a stream of keys in fixed memory, regardless of the number of
+//   distinct keys: a count-min sketch estimates the count of every key, and
+//   a bounded set of k candidates (maintained like the space-saving
+//   algorithm) keeps the keys with the largest estimates.
+//   An estimate is never smaller than the true count; it is larger by at
+//   most e * N / width with probability 1 - exp(-depth), where N is the sum
+//   of all counts.
+
+// a top-k tracker
+struct httopk;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// httopk_create(key_clone, key_hash, key_compare, key_destroy, key_print,
+//   k, width, depth) creates an empty tracker of the k heaviest keys with a
+//   count-min sketch of depth rows of width counters. The connectors have
+//   the same meaning as for ht_create (see hashtable.h); key_hash is called
+//   with a hash length of 31.
+// effects: allocates heap memory; client must call httopk_destroy
+// requires: k, width and depth must be positive; width is a power of 2
+// time: O(k + width * depth)
+struct httopk *httopk_create(void *(*key_clone)(const void *),
+                             int (*key_hash)(const void *, int),
+                             int (*key_compare)(const void *, const void *),
+                             void (*key_destroy)(void *),
+                             void (*key_print)(const void *),
+                             int k, int width, int depth);
+
+// httopk_destroy(t) frees all resources of t.
+// effects: invalidates t
+// time: O(k * ds)
+void httopk_destroy(struct httopk *t);
+
+// httopk_add(t, key, delta) adds delta to the count of key and returns the
+//   new estimate of its count. If the estimate exceeds the smallest count
+//   of the candidates, key becomes a candidate (replacing that one if there
+//   are k candidates already).
+// effects: modifies t
+// requires: delta must be positive
+// time: O(hf + depth + co + log k) expected, plus O(cl + ds) if key becomes a
+//   candidate
+long httopk_add(struct httopk *t, const void *key, long delta);
+
+// httopk_estimate(t, key) returns the estimated count of key.
+// time: O(hf + depth)
+long httopk_estimate(const struct httopk *t, const void *key);
+
+// httopk_list(t, keys, counts, max) stores up to max candidates of t with
+//   their estimated counts in keys and counts, heaviest first, and returns
+//   their number. The keys belong to t and are valid until t is modified.
+// effects: modifies keys and counts
+// time: O(k log k)
+int httopk_list(const struct httopk *t, const void **keys, long *counts, int max);
+
+// httopk_print(t) prints the candidates of t, heaviest first, as key-count
+//   pairs.
+// effects: creates output
+// time: O(k log k + k * cp)
+void httopk_print(const struct httopk *t);
@@ -0,0 +1,750 @@
+// This is the implementation of the hash table of 64-bit integers with
+//   open addressing (linear probing).
+//   The home slot of a key is given by the top hash_len bits of a mix of
+//   the key. Probe sequences do not wrap around: the slot array has
+//   HTU64_TAIL extra slots after the 2^hash_len home slots, and the table
+//   grows if a key would land in the last two of them. So the last two
+//   slots are always empty, and a probe can always read two slots at once
+//   without checking the end of the array.
+//   Removals shift later keys of the cluster back into the freed slot
+//   (backward-shift deletion), so there are no tombstones and a lookup can
+//   stop at the first empty slot.
+//   A table whose keys are dense within their range is stored as a bitset
+//   instead: bit i stands for the key base + i. The table becomes a bitset
+//   once it has HTU64_DENSE_MIN_KEYS keys and its keys span at most
+//   HTU64_DENSE_BITS possible keys per key, and it goes back to slots once
+//   the bitset has more than HTU64_SPARSE_BITS bits per key (the gap
+//   between the two keeps a table from switching back and forth). A bitset
+//   grows by doubling when a key outside its range is inserted. The rank
+//   index holds the number of set bits before every block of
+//   HTU64_RANK_WORDS words; it is rebuilt by ht_rank_u64 after changes.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "htu64.h"
+#include <assert.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// number of slots after the home slots
+#define HTU64_TAIL 64
+// number of keys whose slots the batch functions look up ahead
+#define HTU64_BATCH_GROUP 16
+// a table with at least this many keys may become a bitset
+#define HTU64_DENSE_MIN_KEYS 64
+// a table becomes a bitset if its keys span at most this many keys per key
+#define HTU64_DENSE_BITS 64
+// a bitset becomes a table if it has more than this many bits per key
+#define HTU64_SPARSE_BITS 128
+// number of words of a block of the rank index
+#define HTU64_RANK_WORDS 8
+
+struct hashtable_u64 {
+  uint64_t *slots;                                  // NULL if ht is a bitset
+  int hash_len;
+  int home_len;                                     // number of home slots (2^hash_len)
+  int min_hash_len;                                 // hash_len passed to ht_create_u64
+  int count;                                        // number of keys stored
+  int epoch;                                        // changes whenever keys move
+  uint64_t min;                                     // no key is smaller
+  uint64_t max;                                     // no key is larger
+  uint64_t *bits;                                   // NULL unless ht is a bitset
+  uint64_t base;                                    // key of the first bit
+  size_t words;                                     // length of bits
+  uint32_t *rank;                                   // set bits before each block
+  bool rank_valid;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static uint64_t *slots_create(int len);
+static int home(const struct hashtable_u64 *ht, uint64_t key);
+static int probe(const uint64_t *slots, int start, uint64_t key, bool *found);
+static void grow(struct hashtable_u64 *ht);
+static int insert_at(struct hashtable_u64 *ht, uint64_t key, int start);
+static int remove_at(struct hashtable_u64 *ht, uint64_t key, int start);
+static void prefetch_group(const struct hashtable_u64 *ht, const uint64_t *keys,
+                           int n, int *homes);
+static int insert_key(struct hashtable_u64 *ht, uint64_t key, int start);
+static int remove_key(struct hashtable_u64 *ht, uint64_t key, int start);
+static bool contains_key(const struct hashtable_u64 *ht, uint64_t key, int start);
+static bool bits_test(const struct hashtable_u64 *ht, uint64_t key);
+static int bits_insert(struct hashtable_u64 *ht, uint64_t key);
+static int bits_remove(struct hashtable_u64 *ht, uint64_t key);
+static bool bits_cover(struct hashtable_u64 *ht, uint64_t key);
+static void bits_shrink(struct hashtable_u64 *ht);
+static void bits_rebuild(struct hashtable_u64 *ht, uint64_t base, size_t words);
+static void to_bits(struct hashtable_u64 *ht);
+static void to_slots(struct hashtable_u64 *ht);
+static void rank_build(struct hashtable_u64 *ht);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct hashtable_u64 *ht_create_u64(int hash_length) {
+  assert(hash_length > 0 && hash_length < 31);
+
+  struct hashtable_u64 *ht = malloc(sizeof(struct hashtable_u64));
+  ht->hash_len = hash_length;
+  ht->home_len = 1 << hash_length;
+  ht->slots = slots_create(ht->home_len + HTU64_TAIL);
+  ht->min_hash_len = hash_length;
+  ht->count = 0;
+  ht->epoch = 0;
+  ht->min = HTU64_EMPTY_KEY;
+  ht->max = 0;
+  ht->bits = NULL;
+  ht->base = 0;
+  ht->words = 0;
+  ht->rank = NULL;
+  ht->rank_valid = false;
+  return ht;
+}
+
+void ht_destroy_u64(struct hashtable_u64 *ht) {
+  assert(ht);
+  free(ht->slots);
+  free(ht->bits);
+  free(ht->rank);
+  free(ht);
+}
+
+int ht_insert_u64(struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(key != HTU64_EMPTY_KEY);
+  return insert_key(ht, key, -1);
+}
+
+int ht_remove_u64(struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(key != HTU64_EMPTY_KEY);
+  return remove_key(ht, key, -1);
+}
+
+bool ht_contains_u64(const struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(key != HTU64_EMPTY_KEY);
+  return contains_key(ht, key, -1);
+}
+
+int ht_count_u64(const struct hashtable_u64 *ht) {
+  assert(ht);
+  return ht->count;
+}
+
+void ht_insert_batch_u64(struct hashtable_u64 *ht, const uint64_t *keys,
+                         int n, int *results) {
+  assert(ht);
+  assert(keys);
+  assert(results);
+  int homes[HTU64_BATCH_GROUP];
+  for (int i = 0; i < n; i += HTU64_BATCH_GROUP) {
+    const int group = n - i < HTU64_BATCH_GROUP ? n - i : HTU64_BATCH_GROUP;
+    prefetch_group(ht, keys + i, group, homes);
+    const int epoch = ht->epoch;
+    for (int k = 0; k < group; k++) {
+      assert(keys[i + k] != HTU64_EMPTY_KEY);
+      // an insertion may move all keys, and with them every home slot
+      results[i + k] = insert_key(ht, keys[i + k], ht->epoch == epoch ? homes[k] : -1);
+    }
+  }
+}
+
+void ht_remove_batch_u64(struct hashtable_u64 *ht, const uint64_t *keys,
+                         int n, int *results) {
+  assert(ht);
+  assert(keys);
+  assert(results);
+  int homes[HTU64_BATCH_GROUP];
+  for (int i = 0; i < n; i += HTU64_BATCH_GROUP) {
+    const int group = n - i < HTU64_BATCH_GROUP ? n - i : HTU64_BATCH_GROUP;
+    prefetch_group(ht, keys + i, group, homes);
+    const int epoch = ht->epoch;
+    for (int k = 0; k < group; k++) {
+      assert(keys[i + k] != HTU64_EMPTY_KEY);
+      results[i + k] = remove_key(ht, keys[i + k], ht->epoch == epoch ? homes[k] : -1);
+    }
+  }
+}
+
+void ht_contains_batch_u64(const struct hashtable_u64 *ht,
+                           const uint64_t *keys, int n, bool *results) {
+  assert(ht);
+  assert(keys);
+  assert(results);
+  int homes[HTU64_BATCH_GROUP];
+  for (int i = 0; i < n; i += HTU64_BATCH_GROUP) {
+    const int group = n - i < HTU64_BATCH_GROUP ? n - i : HTU64_BATCH_GROUP;
+    prefetch_group(ht, keys + i, group, homes);
+    for (int k = 0; k < group; k++) {
+      assert(keys[i + k] != HTU64_EMPTY_KEY);
+      results[i + k] = contains_key(ht, keys[i + k], homes[k]);
+    }
+  }
+}
+
+void ht_foreach_u64(const struct hashtable_u64 *ht,
+                    void (*visit)(void *, uint64_t), void *ctx) {
+  assert(ht);
+  assert(visit);
+  if (ht->bits) {
+    for (size_t w = 0; w < ht->words; w++) {
+      for (uint64_t word = ht->bits[w]; word; word &= word - 1) {
+        visit(ctx, ht->base + w * 64 + __builtin_ctzll(word));
+      }
+    }
+    return;
+  }
+  const int len = ht->home_len + HTU64_TAIL;
+  for (int i = 0; i < len; i++) {
+    if (ht->slots[i] != HTU64_EMPTY_KEY) {
+      visit(ctx, ht->slots[i]);
+    }
+  }
+}
+
+int ht_rank_u64(struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  if (ht->bits == NULL) {
+    int rank = 0;
+    const int len = ht->home_len + HTU64_TAIL;
+    for (int i = 0; i < len; i++) {
+      rank += ht->slots[i] < key;
+    }
+    return rank;
+  }
+  if (key < ht->base) {
+    return 0;
+  }
+  const uint64_t bit = key - ht->base;
+  if (bit >= ht->words * 64) {
+    return ht->count;
+  }
+  if (!ht->rank_valid) {
+    rank_build(ht);
+  }
+  const size_t word = bit / 64;
+  int rank = ht->rank[word / HTU64_RANK_WORDS];
+  for (size_t w = word / HTU64_RANK_WORDS * HTU64_RANK_WORDS; w < word; w++) {
+    rank += __builtin_popcountll(ht->bits[w]);
+  }
+  return rank + __builtin_popcountll(ht->bits[word] & ((1ULL << (bit % 64)) - 1));
+}
+
+int ht_probes_u64(const struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(key != HTU64_EMPTY_KEY);
+  if (ht->bits) {
+    return 1;
+  }
+  const int start = home(ht, key);
+  bool found;
+  return probe(ht->slots, start, key, &found) - start + 1;
+}
+
+bool ht_dense_u64(const struct hashtable_u64 *ht) {
+  assert(ht);
+  return ht->bits != NULL;
+}
+
+void ht_print_u64(const struct hashtable_u64 *ht) {
+  assert(ht);
+  if (ht->bits) {
+    bool first = true;
+    printf("[");
+    for (size_t w = 0; w < ht->words; w++) {
+      for (uint64_t word = ht->bits[w]; word; word &= word - 1) {
+        printf(first ? "%llu" : ",%llu",
+               (unsigned long long)(ht->base + w * 64 + __builtin_ctzll(word)));
+        first = false;
+      }
+    }
+    printf("]\n");
+    return;
+  }
+  const int len = ht->home_len + HTU64_TAIL;
+  for (int i = 0; i < len; i++) {
+    printf("%d: [", i);
+    if (ht->slots[i] != HTU64_EMPTY_KEY) {
+      printf("%llu", (unsigned long long)ht->slots[i]);
+    }
+    printf("]\n");
+  }
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// slots_create(len) is a helper function that returns an array of len
+//  slots that are all set to HTU64_EMPTY_KEY
+// effects: allocates memory (caller must free)
+// time: O(len)
+static uint64_t *slots_create(int len) {
+  uint64_t *slots = malloc(sizeof(uint64_t) * len);
+  for (int i = 0; i < len; i++) {
+    slots[i] = HTU64_EMPTY_KEY;
+  }
+  return slots;
+}
+
+// home(ht, key) is a helper function that returns the home slot of key
+//  (the top hash_len bits of the splitmix64 finalizer of key)
+// requires: ht is a valid pointer
+// time: O(1)
+static int home(const struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return key >> (64 - ht->hash_len);
+}
+
+// probe(slots, start, key, found) is a helper function that returns the
+//  slot of key if it is stored on the probe sequence that starts at start
+//  (and sets *found to true), or the first empty slot of that sequence
+//  (and sets *found to false)
+// requires: all pointers are valid; an empty slot follows start, and the
+//           slot after it exists
+// effects: modifies *found
+// time: O(c), where c is the length of the cluster at start
+static int probe(const uint64_t *slots, int start, uint64_t key, bool *found) {
+  assert(slots);
+  assert(found);
+#if defined(__SSE2__)
+  // SSE2 has no 64-bit compare: a 64-bit lane is equal if both of its
+  //  32-bit halves are, i.e. if the 32-bit result and its swapped halves
+  //  are both set
+  const __m128i needle = _mm_set1_epi64x((long long)key);
+  const __m128i empty = _mm_set1_epi64x((long long)HTU64_EMPTY_KEY);
+  for (int i = start; ; i += 2) {
+    const __m128i pair = _mm_loadu_si128((const __m128i *)&slots[i]);
+    __m128i is_key = _mm_cmpeq_epi32(pair, needle);
+    is_key = _mm_and_si128(is_key, _mm_shuffle_epi32(is_key, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128i is_empty = _mm_cmpeq_epi32(pair, empty);
+    is_empty = _mm_and_si128(is_empty, _mm_shuffle_epi32(is_empty, _MM_SHUFFLE(2, 3, 0, 1)));
+    const int key_mask = _mm_movemask_epi8(is_key);
+    const int stop_mask = key_mask | _mm_movemask_epi8(is_empty);
+    if (stop_mask) {
+      // 8 mask bits per lane
+      const int lane = __builtin_ctz(stop_mask) >> 3;
+      *found = (key_mask >> (lane * 8)) & 1;
+      return i + lane;
+    }
+  }
+#else
+  for (int i = start; ; i++) {
+    if (slots[i] == key) {
+      *found = true;
+      return i;
+    }
+    if (slots[i] == HTU64_EMPTY_KEY) {
+      *found = false;
+      return i;
+    }
+  }
+#endif
+}
+
+// grow(ht) is a helper function that moves all keys of ht into a slot
+//  array with twice as many home slots (or more, if a cluster still reaches
+//  the last two slots)
+// requires: ht is a valid pointer
+// effects: modifies ht
+// time: O(n), where n is the number of slots
+static void grow(struct hashtable_u64 *ht) {
+  assert(ht);
+  uint64_t *old = ht->slots;
+  const int old_len = ht->home_len + HTU64_TAIL;
+  bool moved = false;
+  while (!moved) {
+    assert(ht->hash_len < 30);
+    ht->hash_len++;
+    ht->home_len *= 2;
+    ht->slots = slots_create(ht->home_len + HTU64_TAIL);
+    // the bounds may have been loose since keys were removed
+    ht->min = HTU64_EMPTY_KEY;
+    ht->max = 0;
+    moved = true;
+    for (int i = 0; i < old_len && moved; i++) {
+      if (old[i] != HTU64_EMPTY_KEY) {
+        bool found;
+        const int slot = probe(ht->slots, home(ht, old[i]), old[i], &found);
+        ht->slots[slot] = old[i];
+        moved = slot < ht->home_len + HTU64_TAIL - 2;
+        ht->min = old[i] < ht->min ? old[i] : ht->min;
+        ht->max = old[i] > ht->max ? old[i] : ht->max;
+      }
+    }
+    if (!moved) {
+      free(ht->slots);
+    }
+  }
+  ht->epoch++;
+  free(old);
+}
+
+// insert_at(ht, key, start) is a helper function that inserts key into ht,
+//  given its home slot start, and returns HT_SUCCESS or HT_ALREADY_STORED
+// requires: ht is a valid pointer; start is the home slot of key
+// effects: may modify ht
+// time: O(c) expected, where c is the length of the cluster at start, or
+//   O(n) if ht grows
+static int insert_at(struct hashtable_u64 *ht, uint64_t key, int start) {
+  assert(ht);
+  bool found;
+  int slot = probe(ht->slots, start, key, &found);
+  if (found) {
+    return HT_ALREADY_STORED;
+  }
+  // keep the load at most 3/4 and the last two slots empty
+  while (ht->count >= ht->home_len / 4 * 3 ||
+         slot >= ht->home_len + HTU64_TAIL - 2) {
+    grow(ht);
+    slot = probe(ht->slots, home(ht, key), key, &found);
+  }
+  ht->slots[slot] = key;
+  ht->count++;
+  return HT_SUCCESS;
+}
+
+// remove_at(ht, key, start) is a helper function that removes key from ht,
+//  given its home slot start, and returns HT_SUCCESS or HT_NOT_STORED; the
+//  keys after it in its cluster are moved back to close the gap
+// requires: ht is a valid pointer; start is the home slot of key
+// effects: may modify ht
+// time: O(c), where c is the length of the cluster at start
+static int remove_at(struct hashtable_u64 *ht, uint64_t key, int start) {
+  assert(ht);
+  bool found;
+  int hole = probe(ht->slots, start, key, &found);
+  if (!found) {
+    return HT_NOT_STORED;
+  }
+  for (int i = hole + 1; ht->slots[i] != HTU64_EMPTY_KEY; i++) {
+    // the key at i may move to hole if its home is not after hole (probe
+    //  sequences do not wrap around)
+    if (home(ht, ht->slots[i]) <= hole) {
+      ht->slots[hole] = ht->slots[i];
+      hole = i;
+    }
+  }
+  ht->slots[hole] = HTU64_EMPTY_KEY;
+  ht->count--;
+  return HT_SUCCESS;
+}
+
+// prefetch_group(ht, keys, n, homes) is a helper function that stores the
+//  home slot of keys[i] in homes[i] for 0 <= i < n and prefetches these
+//  slots (or, if ht is a bitset, sets homes[i] to -1 and prefetches the
+//  words of the keys)
+// requires: all pointers are valid; n <= HTU64_BATCH_GROUP
+// effects: modifies homes
+// time: O(n)
+static void prefetch_group(const struct hashtable_u64 *ht, const uint64_t *keys,
+                           int n, int *homes) {
+  assert(ht);
+  assert(keys);
+  assert(homes);
+  for (int k = 0; k < n; k++) {
+    if (ht->bits) {
+      homes[k] = -1;
+      if (keys[k] >= ht->base && keys[k] - ht->base < ht->words * 64) {
+        __builtin_prefetch(&ht->bits[(keys[k] - ht->base) / 64]);
+      }
+    } else {
+      homes[k] = home(ht, keys[k]);
+      __builtin_prefetch(&ht->slots[homes[k]]);
+    }
+  }
+}
+
+// insert_key(ht, key, start) is a helper function that inserts key into
+//  ht and returns HT_SUCCESS or HT_ALREADY_STORED; if ht is stored in
+//  slots, start is the home slot of key, or -1 if it is not known yet. A
+//  table that has become dense enough is turned into a bitset.
+// requires: ht is a valid pointer
+// effects: may modify ht
+// time: O(1) expected, O(n) if the keys of ht move
+static int insert_key(struct hashtable_u64 *ht, uint64_t key, int start) {
+  assert(ht);
+  if (ht->bits) {
+    return bits_insert(ht, key);
+  }
+  const int result = insert_at(ht, key, start >= 0 ? start : home(ht, key));
+  if (result == HT_SUCCESS) {
+    ht->min = key < ht->min ? key : ht->min;
+    ht->max = key > ht->max ? key : ht->max;
+    if (ht->count >= HTU64_DENSE_MIN_KEYS &&
+        ht->max - ht->min < (uint64_t)ht->count * HTU64_DENSE_BITS) {
+      to_bits(ht);
+    }
+  }
+  return result;
+}
+
+// remove_key(ht, key, start) is a helper function that removes key from
+//  ht and returns HT_SUCCESS or HT_NOT_STORED; start is as for insert_key
+// requires: ht is a valid pointer
+// effects: may modify ht
+// time: O(1) expected, O(n) if the keys of ht move
+static int remove_key(struct hashtable_u64 *ht, uint64_t key, int start) {
+  assert(ht);
+  if (ht->bits) {
+    return bits_remove(ht, key);
+  }
+  return remove_at(ht, key, start >= 0 ? start : home(ht, key));
+}
+
+// contains_key(ht, key, start) is a helper function that returns true if
+//  key is stored in ht; start is as for insert_key
+// requires: ht is a valid pointer
+// time: O(1) expected
+static bool contains_key(const struct hashtable_u64 *ht, uint64_t key, int start) {
+  assert(ht);
+  if (ht->bits) {
+    return bits_test(ht, key);
+  }
+  bool found;
+  probe(ht->slots, start >= 0 ? start : home(ht, key), key, &found);
+  return found;
+}
+
+// bits_test(ht, key) is a helper function that returns true if the bit of
+//  key is in the bitset of ht and set
+// requires: ht is a valid pointer and a bitset
+// time: O(1)
+static bool bits_test(const struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(ht->bits);
+  if (key < ht->base || key - ht->base >= ht->words * 64) {
+    return false;
+  }
+  const uint64_t bit = key - ht->base;
+  return (ht->bits[bit / 64] >> (bit % 64)) & 1;
+}
+
+// bits_insert(ht, key) is a helper function that inserts key into the
+//  bitset ht and returns HT_SUCCESS or HT_ALREADY_STORED; if key is outside
+//  of the range of the bitset and the bitset cannot cover it without
+//  becoming too sparse, ht is turned into slots first
+// requires: ht is a valid pointer and a bitset
+// effects: may modify ht
+// time: O(1) amortized if the range of ht grows by doubling, O(n) if ht is
+//   turned into slots
+static int bits_insert(struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(ht->bits);
+  if (bits_test(ht, key)) {
+    return HT_ALREADY_STORED;
+  }
+  if (key < ht->base || key - ht->base >= ht->words * 64) {
+    if (!bits_cover(ht, key)) {
+      to_slots(ht);
+      return insert_key(ht, key, -1);
+    }
+  }
+  const uint64_t bit = key - ht->base;
+  ht->bits[bit / 64] |= 1ULL << (bit % 64);
+  ht->count++;
+  ht->min = key < ht->min ? key : ht->min;
+  ht->max = key > ht->max ? key : ht->max;
+  ht->rank_valid = false;
+  return HT_SUCCESS;
+}
+
+// bits_remove(ht, key) is a helper function that removes key from the
+//  bitset ht and returns HT_SUCCESS or HT_NOT_STORED; a bitset that has
+//  become too sparse is shrunk or turned into slots
+// requires: ht is a valid pointer and a bitset
+// effects: may modify ht
+// time: O(1), or O(n) if the keys of ht move
+static int bits_remove(struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(ht->bits);
+  if (!bits_test(ht, key)) {
+    return HT_NOT_STORED;
+  }
+  const uint64_t bit = key - ht->base;
+  ht->bits[bit / 64] &= ~(1ULL << (bit % 64));
+  ht->count--;
+  ht->rank_valid = false;
+  if (ht->words * 64 > (uint64_t)ht->count * HTU64_SPARSE_BITS) {
+    bits_shrink(ht);
+  }
+  return HT_SUCCESS;
+}
+
+// bits_cover(ht, key) is a helper function that extends the range of the
+//  bitset ht to cover key (at least doubling its length) and returns true,
+//  or returns false if the bitset would then have more than
+//  HTU64_SPARSE_BITS bits per key
+// requires: ht is a valid pointer and a bitset; key is outside its range
+// effects: may modify ht
+// time: O(w), where w is the new number of words
+static bool bits_cover(struct hashtable_u64 *ht, uint64_t key) {
+  assert(ht);
+  assert(ht->bits);
+  const uint64_t lo = ht->count && ht->min < key ? ht->min : key;
+  const uint64_t hi = ht->count && ht->max > key ? ht->max : key;
+  const uint64_t limit = (uint64_t)(ht->count + 1) * HTU64_SPARSE_BITS;
+  if (hi - lo >= limit) {
+    return false;
+  }
+  uint64_t bits = ht->words * 64 * 2;
+  if (bits < hi - lo + 1 || bits > limit) {
+    bits = hi - lo + 1;
+  }
+  const size_t words = (bits + 63) / 64;
+  bits = words * 64;
+  uint64_t base;
+  if (key < ht->base) {
+    // grow downwards
+    base = hi >= bits - 1 ? hi - (bits - 1) : 0;
+  } else {
+    // grow upwards
+    base = lo <= UINT64_MAX - (bits - 1) ? lo : UINT64_MAX - (bits - 1);
+  }
+  bits_rebuild(ht, base, words);
+  return true;
+}
+
+// bits_shrink(ht) is a helper function that fits the bitset ht to the
+//  range of its keys if they are still dense enough, and turns it into
+//  slots otherwise
+// requires: ht is a valid pointer and a bitset
+// effects: modifies ht
+// time: O(w + n), where w is the number of words and n the number of keys
+static void bits_shrink(struct hashtable_u64 *ht) {
+  assert(ht);
+  assert(ht->bits);
+  if (ht->count < HTU64_DENSE_MIN_KEYS) {
+    to_slots(ht);
+    return;
+  }
+  size_t first = 0;
+  while (ht->bits[first] == 0) {
+    first++;
+  }
+  size_t last = ht->words - 1;
+  while (ht->bits[last] == 0) {
+    last--;
+  }
+  ht->min = ht->base + first * 64 + __builtin_ctzll(ht->bits[first]);
+  ht->max = ht->base + last * 64 + 63 - __builtin_clzll(ht->bits[last]);
+  if (ht->max - ht->min < (uint64_t)ht->count * HTU64_DENSE_BITS) {
+    bits_rebuild(ht, ht->min, (ht->max - ht->min) / 64 + 1);
+  } else {
+    to_slots(ht);
+  }
+}
+
+// bits_rebuild(ht, base, words) is a helper function that moves the keys
+//  of the bitset ht into a new bitset of words words that starts at base
+// requires: ht is a valid pointer and a bitset; the new bitset covers all
+//           keys of ht
+// effects: modifies ht
+// time: O(w + w'), where w is the old and w' the new number of words
+static void bits_rebuild(struct hashtable_u64 *ht, uint64_t base, size_t words) {
+  assert(ht);
+  assert(ht->bits);
+  uint64_t *bits = calloc(words, sizeof(uint64_t));
+  for (size_t w = 0; w < ht->words; w++) {
+    for (uint64_t word = ht->bits[w]; word; word &= word - 1) {
+      const uint64_t bit = ht->base + w * 64 + __builtin_ctzll(word) - base;
+      assert(bit < words * 64);
+      bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+  }
+  free(ht->bits);
+  free(ht->rank);
+  ht->bits = bits;
+  ht->base = base;
+  ht->words = words;
+  ht->rank = malloc(sizeof(uint32_t) * ((words + HTU64_RANK_WORDS - 1) / HTU64_RANK_WORDS));
+  ht->rank_valid = false;
+  ht->epoch++;
+}
+
+// to_bits(ht) is a helper function that turns the slots of ht into a
+//  bitset that covers the bounds of its keys
+// requires: ht is a valid pointer and not a bitset; ht has keys
+// effects: modifies ht
+// time: O(n + w), where n is the number of slots and w the number of words
+static void to_bits(struct hashtable_u64 *ht) {
+  assert(ht);
+  assert(ht->slots);
+  assert(ht->count > 0);
+  ht->base = ht->min;
+  ht->words = (ht->max - ht->min) / 64 + 1;
+  ht->bits = calloc(ht->words, sizeof(uint64_t));
+  const int len = ht->home_len + HTU64_TAIL;
+  for (int i = 0; i < len; i++) {
+    if (ht->slots[i] != HTU64_EMPTY_KEY) {
+      const uint64_t bit = ht->slots[i] - ht->base;
+      ht->bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+  }
+  free(ht->slots);
+  ht->slots = NULL;
+  ht->rank = malloc(sizeof(uint32_t) *
+                    ((ht->words + HTU64_RANK_WORDS - 1) / HTU64_RANK_WORDS));
+  ht->rank_valid = false;
+  ht->epoch++;
+}
+
+// to_slots(ht) is a helper function that turns the bitset ht into slots
+//  with a load of at most 3/4
+// requires: ht is a valid pointer and a bitset
+// effects: modifies ht
+// time: O(w + n), where w is the number of words and n the number of keys
+static void to_slots(struct hashtable_u64 *ht) {
+  assert(ht);
+  assert(ht->bits);
+  const int count = ht->count;
+  ht->hash_len = ht->min_hash_len;
+  while ((1 << ht->hash_len) / 4 * 3 <= count) {
+    ht->hash_len++;
+  }
+  ht->home_len = 1 << ht->hash_len;
+  ht->slots = slots_create(ht->home_len + HTU64_TAIL);
+  ht->count = 0;
+  ht->min = HTU64_EMPTY_KEY;
+  ht->max = 0;
+  for (size_t w = 0; w < ht->words; w++) {
+    for (uint64_t word = ht->bits[w]; word; word &= word - 1) {
+      const uint64_t key = ht->base + w * 64 + __builtin_ctzll(word);
+      insert_at(ht, key, home(ht, key));
+      ht->min = key < ht->min ? key : ht->min;
+      ht->max = key > ht->max ? key : ht->max;
+    }
+  }
+  assert(ht->count == count);
+  free(ht->bits);
+  free(ht->rank);
+  ht->bits = NULL;
+  ht->rank = NULL;
+  ht->words = 0;
+  ht->epoch++;
+}
+
+// rank_build(ht) is a helper function that computes the rank index of the
+//  bitset ht
+// requires: ht is a valid pointer and a bitset
+// effects: modifies ht
+// time: O(w), where w is the number of words
+static void rank_build(struct hashtable_u64 *ht) {
+  assert(ht);
+  assert(ht->bits);
+  uint32_t rank = 0;
+  for (size_t w = 0; w < ht->words; w++) {
+    if (w % HTU64_RANK_WORDS == 0) {
+      ht->rank[w / HTU64_RANK_WORDS] = rank;
+    }
+    rank += __builtin_popcountll(ht->bits[w]);
+  }
+  ht->rank_valid = true;
+}
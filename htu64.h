@@ -0,0 +1,121 @@
+// This is the interface of a hash table that is specialized for 64-bit
+//   integer keys. Keys are stored inline in a flat slot array, so no
+//   key_clone, key_hash, key_compare or key_destroy connectors are needed
+//   (or called), and a lookup compares several slots at once with SIMD
+//   instructions where the target supports them (SSE2), or one by one
+//   otherwise. The table grows automatically.
+//   If the keys of a table become dense within their range (at least 64
+//   keys, and at least one key per 64 possible keys between the smallest
+//   and the largest), the table switches to a bitset with one bit per
+//   possible key, and it switches back once fewer than one bit in 128 is
+//   set.
+//   The return codes HT_SUCCESS, HT_ALREADY_STORED and HT_NOT_STORED are
+//   shared with hashtable.h.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hashtable.h"
+
+// HTU64_EMPTY_KEY is reserved to mark free slots; it cannot be stored in
+//   the table.
+#define HTU64_EMPTY_KEY UINT64_MAX
+
+// a hash table of 64-bit integers
+struct hashtable_u64;
+
+// requires: all functions require valid (non-NULL) parameters
+//           keys must not be HTU64_EMPTY_KEY
+
+// ht_create_u64(hash_length) creates a new empty table with room for
+//   3/4 * 2^hash_length keys before it first grows.
+// effects: allocates heap memory; client must call ht_destroy_u64
+// requires: 0 < hash_length < 31
+// time: O(n), where n is the number of slots
+struct hashtable_u64 *ht_create_u64(int hash_length);
+
+// ht_destroy_u64(ht) frees all resources allocated by the table ht.
+// effects: invalidates ht
+// time: O(1)
+void ht_destroy_u64(struct hashtable_u64 *ht);
+
+// ht_insert_u64(ht, key) inserts key into ht. The function returns
+//   * HT_SUCCESS if key has been inserted into ht or
+//   * HT_ALREADY_STORED if key is already stored in ht.
+// effects: may modify ht
+// time: O(1) expected (amortized), O(n) if ht grows or switches between
+//   slots and a bitset
+int ht_insert_u64(struct hashtable_u64 *ht, uint64_t key);
+
+// ht_remove_u64(ht, key) removes key from ht. The function returns
+//   * HT_SUCCESS if key has been removed from ht, or
+//   * HT_NOT_STORED if key was not stored in ht.
+// effects: may modify ht
+// time: O(1) expected, O(n) if ht switches between slots and a bitset
+int ht_remove_u64(struct hashtable_u64 *ht, uint64_t key);
+
+// ht_contains_u64(ht, key) returns true if key is stored in ht, and false
+//   otherwise.
+// time: O(1) expected
+bool ht_contains_u64(const struct hashtable_u64 *ht, uint64_t key);
+
+// ht_count_u64(ht) returns the number of keys stored in ht.
+// time: O(1)
+int ht_count_u64(const struct hashtable_u64 *ht);
+
+// The batch functions below apply an operation to the n keys of keys[] and
+//   store its result for keys[i] in results[i], like the batch functions of
+//   hashtable.h.
+
+// ht_insert_batch_u64(ht, keys, n, results) inserts keys[0..n-1] into ht
+//   in order, like ht_insert_u64.
+// effects: modifies ht and results
+// time: O(n) expected
+void ht_insert_batch_u64(struct hashtable_u64 *ht, const uint64_t *keys,
+                         int n, int *results);
+
+// ht_remove_batch_u64(ht, keys, n, results) removes keys[0..n-1] from ht
+//   in order, like ht_remove_u64.
+// effects: modifies ht and results
+// time: O(n) expected
+void ht_remove_batch_u64(struct hashtable_u64 *ht, const uint64_t *keys,
+                         int n, int *results);
+
+// ht_contains_batch_u64(ht, keys, n, results) stores
+//   ht_contains_u64(ht, keys[i]) in results[i] for 0 <= i < n.
+// effects: modifies results
+// time: O(n) expected
+void ht_contains_batch_u64(const struct hashtable_u64 *ht,
+                           const uint64_t *keys, int n, bool *results);
+
+// ht_foreach_u64(ht, visit, ctx) calls visit(ctx, key) for every key stored
+//   in ht, in no particular order (in increasing order if ht is a bitset).
+//   visit must not modify ht.
+// time: O(n + m * v), where n is the number of slots (or words of the
+//   bitset), m is the number of keys in ht and v is the complexity of visit
+void ht_foreach_u64(const struct hashtable_u64 *ht,
+                    void (*visit)(void *, uint64_t), void *ctx);
+
+// ht_rank_u64(ht, key) returns the number of keys stored in ht that are
+//   smaller than key.
+// effects: may modify ht (its rank index)
+// time: O(1) if ht is a bitset and has not changed since the last call,
+//   O(w) if it has, where w is the number of words of the bitset; O(n)
+//   otherwise
+int ht_rank_u64(struct hashtable_u64 *ht, uint64_t key);
+
+// ht_probes_u64(ht, key) returns the number of slots that a lookup of key
+//   in ht looks at (up to the slot of key or the first free slot; 1 if ht
+//   is a bitset). It lets callers measure probe lengths without changing
+//   ht.
+// time: O(1) expected
+int ht_probes_u64(const struct hashtable_u64 *ht, uint64_t key);
+
+// ht_dense_u64(ht) returns true if ht is currently stored as a bitset.
+// time: O(1)
+bool ht_dense_u64(const struct hashtable_u64 *ht);
+
+// ht_print_u64(ht) prints the keys of ht to the console (slot by slot, or
+//   as a list if ht is a bitset).
+// effects: creates output
+// time: O(n), where n is the number of slots
+void ht_print_u64(const struct hashtable_u64 *ht);
@@ -0,0 +1,562 @@
+// This is the implementation of the write-ahead log with group commit.
+//   A log file has the following layout (integers in host byte order):
+//     header:  "HTWAL001", u64 base_lsn
+//     records: u32 len, u32 op, u64 lsn, len key bytes, u64 checksum
+//   where base_lsn is the LSN of the last record discarded by
+//   htwal_truncate, LSNs increase by one from record to record, and
+//   checksum is the 64-bit FNV-1a hash of the record before it.
+//   A log is only ever replaced as a whole: htwal_truncate and a restart by
+//   htwal_open write the new log to path.tmp, sync it and rename it over
+//   path, so path always starts with a complete header.
+//
+//   Appenders encode their record into the active buffer under the lock of
+//   the log. The committer thread swaps the active buffer with an empty one
+//   and writes and syncs the full one without holding the lock, so
+//   appenders only wait for each other, never for the disk.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "htwal.h"
+#include "htaio.h"
+#include <assert.h>
+#include <stdbool.h>
+
+const int HT_LOG_GAP = 4;
+
+static const char WAL_MAGIC[8] = {'H', 'T', 'W', 'A', 'L', '0', '0', '1'};
+
+// the committer thread writes early once this many bytes are pending
+#define WAL_COMMIT_BYTES (1 << 20)
+
+struct wal_header {
+  char magic[8];
+  uint64_t base_lsn;
+};
+
+struct wal_record {
+  uint32_t len;
+  uint32_t op;
+  uint64_t lsn;
+};
+
+struct wal_buffer {
+  unsigned char *data;
+  size_t len;
+  size_t cap;
+};
+
+struct htwal {
+  int fd;
+  char *path;
+  int (*key_encode)(const void *, void *, int);
+  int commit_interval_us;
+  pthread_t committer;
+  pthread_mutex_t lock;                             // protects all fields below
+  pthread_cond_t work;                              // signalled when records are pending
+  pthread_cond_t durable;                           // signalled after every commit
+  struct wal_buffer active;                         // records not yet handed to the committer
+  struct wal_buffer writing;                        // records being written by the committer
+  uint64_t next_lsn;                                // LSN of the next record
+  uint64_t durable_lsn;                             // all records up to this LSN are durable
+  bool committing;                                  // the committer is writing outside the lock
+  bool failed;                                      // a write or sync has failed
+  bool closing;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static void *committer_main(void *arg);
+static void wal_observer(void *ctx, int op, const void *key, int index);
+static void buffer_reserve(struct wal_buffer *b, size_t extra);
+static bool write_all(int fd, const void *data, size_t len);
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len);
+static bool read_record(FILE *f, struct wal_record *rec, unsigned char **key,
+                        uint32_t *key_cap);
+static long scan_log(int fd, uint64_t *last_lsn);
+static int rewrite_log(const char *path, int src_fd, uint64_t base_lsn,
+                       bool *synced);
+static bool copy_records(int src_fd, int dst_fd, uint64_t base_lsn);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct htwal *htwal_open(const char *path,
+                         int (*key_encode)(const void *, void *, int),
+                         int commit_interval_us, uint64_t start_lsn) {
+  assert(path);
+  assert(key_encode);
+  assert(commit_interval_us >= 0);
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+  uint64_t last_lsn = 0;
+  long end = scan_log(fd, &last_lsn);
+  if (end < 0 && lseek(fd, 0, SEEK_END) != 0) {
+    close(fd);                                      // not a log: leave it alone
+    return NULL;
+  }
+  if (end < 0 || last_lsn < start_lsn) {
+    // a new log, or a log that ends before the recovered state (all of its
+    //   records are covered by the snapshot): restart it after start_lsn
+    close(fd);
+    bool synced;
+    fd = rewrite_log(path, -1, start_lsn, &synced);
+    if (fd >= 0 && !synced) {
+      close(fd);
+      fd = -1;
+    }
+    if (fd < 0) {
+      return NULL;
+    }
+    last_lsn = start_lsn;
+    end = sizeof(struct wal_header);
+  }
+  // drop a torn tail and continue after the last valid record
+  if (ftruncate(fd, end) != 0 || lseek(fd, end, SEEK_SET) != end) {
+    close(fd);
+    return NULL;
+  }
+
+  struct htwal *wal = malloc(sizeof(struct htwal));
+  wal->fd = fd;
+  wal->path = malloc(strlen(path) + 1);
+  strcpy(wal->path, path);
+  wal->key_encode = key_encode;
+  wal->commit_interval_us = commit_interval_us;
+  pthread_mutex_init(&wal->lock, NULL);
+  pthread_cond_init(&wal->work, NULL);
+  pthread_cond_init(&wal->durable, NULL);
+  wal->active = (struct wal_buffer){NULL, 0, 0};
+  wal->writing = (struct wal_buffer){NULL, 0, 0};
+  wal->next_lsn = last_lsn + 1;
+  wal->durable_lsn = last_lsn;
+  wal->committing = false;
+  wal->failed = false;
+  wal->closing = false;
+  pthread_create(&wal->committer, NULL, committer_main, wal);
+  return wal;
+}
+
+void htwal_close(struct htwal *wal) {
+  assert(wal);
+  pthread_mutex_lock(&wal->lock);
+  wal->closing = true;
+  pthread_cond_signal(&wal->work);
+  pthread_mutex_unlock(&wal->lock);
+  pthread_join(wal->committer, NULL);
+
+  close(wal->fd);
+  free(wal->path);
+  pthread_mutex_destroy(&wal->lock);
+  pthread_cond_destroy(&wal->work);
+  pthread_cond_destroy(&wal->durable);
+  free(wal->active.data);
+  free(wal->writing.data);
+  free(wal);
+}
+
+void htwal_attach(struct htwal *wal, struct hashtable *ht) {
+  assert(wal);
+  assert(ht);
+  ht_observe(ht, wal_observer, wal);
+}
+
+void htwal_detach(struct htwal *wal, struct hashtable *ht) {
+  assert(wal);
+  assert(ht);
+  ht_unobserve(ht, wal_observer, wal);
+}
+
+uint64_t htwal_append(struct htwal *wal, int op, const void *key) {
+  assert(wal);
+  assert(key);
+  assert(op == HT_OP_INSERT || op == HT_OP_REMOVE);
+
+  pthread_mutex_lock(&wal->lock);
+  struct wal_buffer *b = &wal->active;
+  const bool was_empty = b->len == 0;
+  const size_t start = b->len;
+
+  // encode the key behind the record header, retrying once if it is larger
+  //   than the free space
+  buffer_reserve(b, sizeof(struct wal_record) + 64);
+  unsigned char *key_buf = b->data + start + sizeof(struct wal_record);
+  int room = b->cap - start - sizeof(struct wal_record);
+  int len = wal->key_encode(key, key_buf, room);
+  if (len + sizeof(uint64_t) > (size_t)room) {
+    buffer_reserve(b, sizeof(struct wal_record) + len + sizeof(uint64_t));
+    key_buf = b->data + start + sizeof(struct wal_record);
+    wal->key_encode(key, key_buf, len);
+  }
+
+  struct wal_record rec = {len, op, wal->next_lsn++};
+  memcpy(b->data + start, &rec, sizeof(rec));
+  const size_t rec_len = sizeof(rec) + len;
+  const uint64_t checksum = fnv1a(0xcbf29ce484222325ULL, b->data + start, rec_len);
+  memcpy(b->data + start + rec_len, &checksum, sizeof(checksum));
+  b->len += rec_len + sizeof(checksum);
+
+  if (was_empty || b->len >= WAL_COMMIT_BYTES) {
+    pthread_cond_signal(&wal->work);
+  }
+  pthread_mutex_unlock(&wal->lock);
+  return rec.lsn;
+}
+
+uint64_t htwal_lsn(struct htwal *wal) {
+  assert(wal);
+  pthread_mutex_lock(&wal->lock);
+  const uint64_t lsn = wal->next_lsn - 1;
+  pthread_mutex_unlock(&wal->lock);
+  return lsn;
+}
+
+int htwal_sync(struct htwal *wal, uint64_t lsn) {
+  assert(wal);
+  pthread_mutex_lock(&wal->lock);
+  while (wal->durable_lsn < lsn && !wal->failed) {
+    pthread_cond_signal(&wal->work);
+    pthread_cond_wait(&wal->durable, &wal->lock);
+  }
+  const bool failed = wal->failed;
+  pthread_mutex_unlock(&wal->lock);
+  return failed ? HT_IO_ERROR : HT_SUCCESS;
+}
+
+int htwal_truncate(struct htwal *wal, uint64_t upto_lsn) {
+  assert(wal);
+  pthread_mutex_lock(&wal->lock);
+  assert(upto_lsn < wal->next_lsn);
+  // wait until the records up to upto_lsn are in the file and the committer
+  //   is idle; the records that are still pending are all later ones
+  while ((wal->durable_lsn < upto_lsn || wal->committing) && !wal->failed) {
+    pthread_cond_signal(&wal->work);
+    pthread_cond_wait(&wal->durable, &wal->lock);
+  }
+  bool ok = !wal->failed;
+  if (ok) {
+    const int fd = rewrite_log(wal->path, wal->fd, upto_lsn, &ok);
+    if (fd >= 0) {
+      // the new log has replaced the old one, so append to it even if the
+      //   rename could not be synced
+      close(wal->fd);
+      wal->fd = fd;
+    } else {
+      ok = false;
+    }
+  }
+  pthread_mutex_unlock(&wal->lock);
+  return ok ? HT_SUCCESS : HT_IO_ERROR;
+}
+
+int ht_recover(struct hashtable *ht, const char *snapshot_path,
+               const char *wal_path,
+               void *(*key_decode)(const void *, int),
+               void (*key_destroy)(void *), uint64_t *lsn) {
+  assert(ht);
+  assert(snapshot_path);
+  assert(wal_path);
+  assert(key_decode);
+  assert(key_destroy);
+  assert(lsn);
+
+  uint64_t snap_lsn = 0;
+  if (access(snapshot_path, F_OK) == 0 &&
+      ht_snapshot_load(ht, snapshot_path, &snap_lsn, key_decode) != HT_SUCCESS) {
+    return HT_IO_ERROR;
+  }
+  *lsn = snap_lsn;
+
+  FILE *f = fopen(wal_path, "rb");
+  if (f == NULL) {
+    return errno == ENOENT ? HT_SUCCESS : HT_IO_ERROR;
+  }
+  struct wal_header hdr;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      memcmp(hdr.magic, WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) {
+    // an empty or torn log header holds no records
+    fclose(f);
+    return HT_SUCCESS;
+  }
+  if (hdr.base_lsn > snap_lsn) {
+    fclose(f);
+    return HT_LOG_GAP;                              // the log starts after the snapshot
+  }
+
+  struct wal_record rec;
+  unsigned char *key = NULL;
+  uint32_t key_cap = 0;
+  uint64_t prev_lsn = hdr.base_lsn;
+  int result = HT_SUCCESS;
+  while (read_record(f, &rec, &key, &key_cap)) {
+    if (rec.lsn != prev_lsn + 1) {
+      result = HT_LOG_GAP;                          // a complete record out of sequence
+      break;
+    }
+    prev_lsn = rec.lsn;
+    if (rec.lsn <= snap_lsn) {
+      continue;
+    }
+    *lsn = rec.lsn;
+    void *k = key_decode(key, rec.len);
+    if (rec.op == (uint32_t)HT_OP_INSERT) {
+      ht_adopt(ht, k);
+    } else {
+      ht_remove(ht, k);
+      key_destroy(k);
+    }
+  }
+  free(key);
+  fclose(f);
+  return result;
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// committer_main(arg) is the main function of the committer thread of the
+//  log arg. It waits for pending records, gives later appenders up to one
+//  commit interval to join the group, and then writes and syncs all of
+//  them at once.
+// effects: writes to the log file; modifies the log
+// time: runs until htwal_close
+static void *committer_main(void *arg) {
+  struct htwal *wal = arg;
+  assert(wal);
+  pthread_mutex_lock(&wal->lock);
+  for (;;) {
+    while (wal->active.len == 0 && !wal->closing) {
+      pthread_cond_wait(&wal->work, &wal->lock);
+    }
+    if (wal->active.len == 0) {
+      break;                                        // closing and nothing pending
+    }
+    if (wal->commit_interval_us > 0 && !wal->closing &&
+        wal->active.len < WAL_COMMIT_BYTES) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += (long)wal->commit_interval_us * 1000;
+      deadline.tv_sec += deadline.tv_nsec / 1000000000;
+      deadline.tv_nsec %= 1000000000;
+      pthread_cond_timedwait(&wal->work, &wal->lock, &deadline);
+    }
+
+    struct wal_buffer full = wal->active;
+    wal->active = wal->writing;
+    wal->active.len = 0;
+    const uint64_t last_lsn = wal->next_lsn - 1;
+    wal->committing = true;
+    pthread_mutex_unlock(&wal->lock);
+
+    const bool ok = write_all(wal->fd, full.data, full.len) && fdatasync(wal->fd) == 0;
+
+    pthread_mutex_lock(&wal->lock);
+    wal->writing = full;
+    wal->committing = false;
+    if (ok) {
+      wal->durable_lsn = last_lsn;
+    } else {
+      wal->failed = true;
+    }
+    pthread_cond_broadcast(&wal->durable);
+  }
+  pthread_mutex_unlock(&wal->lock);
+  return NULL;
+}
+
+// wal_observer(ctx, op, key, index) is a helper function that is registered
+//  with ht_observe; it appends a record for op on key to the log ctx
+// requires: all pointers are valid
+// effects: modifies the log ctx
+// time: O(en) where en is the time complexity of key_encode
+static void wal_observer(void *ctx, int op, const void *key, int index) {
+  (void)index;
+  htwal_append(ctx, op, key);
+}
+
+// buffer_reserve(b, extra) is a helper function that makes sure that b has
+//  room for extra more bytes
+// requires: b is a valid pointer
+// effects: may allocate memory (freed by htwal_close)
+// time: O(b->len) amortized O(1)
+static void buffer_reserve(struct wal_buffer *b, size_t extra) {
+  assert(b);
+  if (b->len + extra > b->cap) {
+    b->cap = (b->len + extra) * 2;
+    b->data = realloc(b->data, b->cap);
+  }
+}
+
+// write_all(fd, data, len) is a helper function that writes the len bytes
+//  at data to fd and returns true on success
+// effects: writes to fd
+// time: O(len)
+static bool write_all(int fd, const void *data, size_t len) {
+  const unsigned char *p = data;
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+// fnv1a(h, data, len) is a helper function that continues the 64-bit
+//  FNV-1a hash h with the len bytes at data
+// time: O(len)
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= bytes[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// read_record(f, rec, key, key_cap) is a helper function that reads the
+//  next record of the log f into *rec and its key bytes into *key (which
+//  is grown if it is smaller than *key_cap). It returns false at the end
+//  of the log or at a torn or corrupt record.
+// requires: all pointers are valid
+// effects: reads from f; may allocate memory (caller must free *key)
+// time: O(len) where len is the length of the record
+static bool read_record(FILE *f, struct wal_record *rec, unsigned char **key,
+                        uint32_t *key_cap) {
+  assert(f);
+  if (fread(rec, sizeof(*rec), 1, f) != 1 || rec->len > (1u << 30)) {
+    return false;
+  }
+  if (rec->len > *key_cap) {
+    *key_cap = rec->len;
+    *key = realloc(*key, *key_cap);
+  }
+  uint64_t checksum;
+  if (fread(*key, 1, rec->len, f) != rec->len ||
+      fread(&checksum, sizeof(checksum), 1, f) != 1) {
+    return false;
+  }
+  uint64_t h = fnv1a(0xcbf29ce484222325ULL, rec, sizeof(*rec));
+  return fnv1a(h, *key, rec->len) == checksum;
+}
+
+// scan_log(fd, last_lsn) is a helper function that validates the log fd.
+//  It returns the offset just behind the last valid record and stores its
+//  LSN in *last_lsn, or returns -1 if fd does not start with a log header.
+// requires: last_lsn is a valid pointer
+// effects: reads from fd
+// time: O(l) where l is the size of the log
+static long scan_log(int fd, uint64_t *last_lsn) {
+  assert(last_lsn);
+  int dup_fd = dup(fd);
+  FILE *f = dup_fd < 0 ? NULL : fdopen(dup_fd, "rb");
+  if (f == NULL) {
+    if (dup_fd >= 0) {
+      close(dup_fd);
+    }
+    return -1;
+  }
+  rewind(f);
+  struct wal_header hdr;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      memcmp(hdr.magic, WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) {
+    fclose(f);
+    return -1;
+  }
+  *last_lsn = hdr.base_lsn;
+  long end = sizeof(hdr);
+  struct wal_record rec;
+  unsigned char *key = NULL;
+  uint32_t key_cap = 0;
+  while (read_record(f, &rec, &key, &key_cap) && rec.lsn == *last_lsn + 1) {
+    *last_lsn = rec.lsn;
+    end = ftell(f);
+  }
+  free(key);
+  fclose(f);
+  return end;
+}
+
+// rewrite_log(path, src_fd, base_lsn, synced) is a helper function that
+//  replaces the log path with a log with base_lsn whose records are the
+//  records of the log src_fd (if src_fd >= 0) with a larger LSN than
+//  base_lsn. The new log is written to path.tmp, synced and renamed over
+//  path. The function returns a descriptor of the new log positioned at
+//  its end, or -1 if path has not been replaced; *synced is set to false
+//  if the rename could not be made durable.
+// requires: synced is a valid pointer
+// effects: writes files; changes the offset of src_fd
+// time: O(l) where l is the size of the log src_fd
+static int rewrite_log(const char *path, int src_fd, uint64_t base_lsn,
+                       bool *synced) {
+  assert(path);
+  assert(synced);
+  char *tmp_path = malloc(strlen(path) + 5);
+  strcpy(tmp_path, path);
+  strcat(tmp_path, ".tmp");
+  int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  struct wal_header hdr;
+  memcpy(hdr.magic, WAL_MAGIC, sizeof(WAL_MAGIC));
+  hdr.base_lsn = base_lsn;
+  const bool ok = fd >= 0 && write_all(fd, &hdr, sizeof(hdr)) &&
+                  (src_fd < 0 || copy_records(src_fd, fd, base_lsn)) &&
+                  fdatasync(fd) == 0 && rename(tmp_path, path) == 0;
+  if (!ok) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    remove(tmp_path);
+    fd = -1;
+  }
+  *synced = ok && htaio_sync_dir(path);
+  free(tmp_path);
+  return fd;
+}
+
+// copy_records(src_fd, dst_fd, base_lsn) is a helper function that appends
+//  the valid records of the log src_fd with a larger LSN than base_lsn to
+//  dst_fd and returns true on success
+// effects: writes to dst_fd; changes the offset of src_fd
+// time: O(l) where l is the size of the log src_fd
+static bool copy_records(int src_fd, int dst_fd, uint64_t base_lsn) {
+  int dup_fd = dup(src_fd);
+  FILE *f = dup_fd < 0 ? NULL : fdopen(dup_fd, "rb");
+  if (f == NULL) {
+    if (dup_fd >= 0) {
+      close(dup_fd);
+    }
+    return false;
+  }
+  rewind(f);
+  struct wal_header hdr;
+  bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1;
+  struct wal_record rec;
+  unsigned char *key = NULL;
+  uint32_t key_cap = 0;
+  while (ok && read_record(f, &rec, &key, &key_cap)) {
+    if (rec.lsn <= base_lsn) {
+      continue;
+    }
+    uint64_t checksum = fnv1a(0xcbf29ce484222325ULL, &rec, sizeof(rec));
+    checksum = fnv1a(checksum, key, rec.len);
+    ok = write_all(dst_fd, &rec, sizeof(rec)) && write_all(dst_fd, key, rec.len) &&
+         write_all(dst_fd, &checksum, sizeof(checksum));
+  }
+  free(key);
+  fclose(f);
+  return ok;
+}
@@ -0,0 +1,115 @@
+// This is the interface of a write-ahead log (WAL) for generic hash tables.
+//   Once a log is attached to a table, every successful ht_insert and
+//   ht_remove appends a compact record to the log. Records are buffered in
+//   memory and written by a background thread with group commit: all
+//   records that arrive within one commit interval share a single write and
+//   fdatasync, so durability costs amortized microseconds per operation.
+//   After a crash, ht_recover rebuilds a table from the latest snapshot (see
+//   htsnapshot.h) plus the log records that follow it.
+//   Keys are encoded and decoded with the connectors of htsnapshot.h.
+
+#include <stdint.h>
+#include "hashtable.h"
+#include "htsnapshot.h"
+
+// HT_LOG_GAP indicates that a log does not continue the snapshot it is
+//   recovered with: records between the two are missing.
+extern const int HT_LOG_GAP;
+
+// a write-ahead log
+struct htwal;
+
+// requires: all functions require valid (non-NULL) parameters
+
+// htwal_open(path, key_encode, commit_interval_us, start_lsn) opens the log
+//   file path (it is created if it does not exist) for appending. Records
+//   that follow a torn or corrupt record at the end of an existing log are
+//   discarded. start_lsn is the LSN up to which the table has been
+//   recovered (see ht_recover), or 0 for a new table; if the log ends
+//   before start_lsn, it is restarted so that the next record gets the LSN
+//   start_lsn + 1 (the LSNs of a snapshot are never reused). The background
+//   thread commits at most every commit_interval_us microseconds. The
+//   function returns NULL if path cannot be opened or is not a log (an
+//   existing file that is not empty and does not start with a log header
+//   is left untouched).
+// effects: allocates heap memory and starts a thread; client must call
+//          htwal_close
+// requires: commit_interval_us >= 0
+// time: O(l), where l is the size of the existing log
+struct htwal *htwal_open(const char *path,
+                         int (*key_encode)(const void *, void *, int),
+                         int commit_interval_us, uint64_t start_lsn);
+
+// htwal_close(wal) commits all pending records, stops the background thread
+//   and frees all resources of wal.
+// effects: invalidates wal
+// requires: wal is not attached to a table
+// time: O(p), where p is the size of the pending records
+void htwal_close(struct htwal *wal);
+
+// htwal_attach(wal, ht) makes every successful ht_insert and ht_remove on
+//   ht append a record to wal (see ht_observe).
+// effects: modifies ht
+// time: O(1)
+void htwal_attach(struct htwal *wal, struct hashtable *ht);
+
+// htwal_detach(wal, ht) stops logging the operations on ht.
+// effects: modifies ht
+// time: O(o), where o is the number of observers of ht
+void htwal_detach(struct htwal *wal, struct hashtable *ht);
+
+// htwal_append(wal, op, key) appends a record for the operation op
+//   (HT_OP_INSERT or HT_OP_REMOVE) on key to wal and returns the log
+//   sequence number (LSN) of the record. The record is durable once
+//   htwal_sync returns for this LSN (or a larger one).
+//   htwal_append may be called concurrently from several threads.
+// effects: modifies wal
+// time: O(en), where en is the complexity of key_encode
+uint64_t htwal_append(struct htwal *wal, int op, const void *key);
+
+// htwal_lsn(wal) returns the LSN of the last record appended to wal.
+// time: O(1)
+uint64_t htwal_lsn(struct htwal *wal);
+
+// htwal_sync(wal, lsn) blocks until all records up to lsn are durable. The
+//   function returns
+//   * HT_SUCCESS if the records are durable, or
+//   * HT_IO_ERROR if the log could not be written.
+// time: at most one commit interval plus one write and fdatasync
+int htwal_sync(struct htwal *wal, uint64_t lsn);
+
+// htwal_truncate(wal, upto_lsn) discards the records of wal up to upto_lsn
+//   and keeps the later ones. It is meant to be called after a snapshot
+//   with LSN upto_lsn has been saved durably (see ht_snapwriter_commit;
+//   htckpt_lsn reports the LSN of the last such checkpoint). The shortened
+//   log is written to a temporary file that replaces the log, so a crash
+//   leaves either the old or the new log. The function returns
+//   * HT_SUCCESS if the log has been truncated, or
+//   * HT_IO_ERROR if the log could not be written (it is left unchanged).
+// effects: modifies wal and its file
+// requires: upto_lsn <= htwal_lsn(wal)
+// time: O(l), where l is the size of the log (appenders wait meanwhile)
+int htwal_truncate(struct htwal *wal, uint64_t upto_lsn);
+
+// ht_recover(ht, snapshot_path, wal_path, key_decode, key_destroy, lsn)
+//   loads the snapshot snapshot_path (if that file exists) into ht and then
+//   replays all records of the log wal_path with a larger LSN than the
+//   snapshot, up to the first torn or corrupt record. key_destroy must be
+//   the key_destroy connector of ht. The LSN up to which ht has been
+//   recovered is stored in *lsn; it is the start_lsn of htwal_open when the
+//   log is reopened. The LSNs must be continuous: the log must start at or
+//   before the LSN of the snapshot, and every record must follow the one
+//   before it. The function returns
+//   * HT_SUCCESS if ht has been recovered,
+//   * HT_IO_ERROR if the snapshot is invalid, or
+//   * HT_LOG_GAP if records are missing between the snapshot and the log
+//     or within the log; ht then holds the state up to the gap (*lsn).
+// effects: modifies ht and *lsn
+// requires: ht is empty and wal_path is not open for appending
+// time: O(s + r * (de + hf + k * co)), where s is the time to load the
+//   snapshot, r is the number of replayed records and k is the number of
+//   items in a bucket of ht
+int ht_recover(struct hashtable *ht, const char *snapshot_path,
+               const char *wal_path,
+               void *(*key_decode)(const void *, int),
+               void (*key_destroy)(void *), uint64_t *lsn);
@@ -0,0 +1,200 @@
+// This is the implementation of the lock-free hash table of 64-bit integers
+//   with open addressing (linear probing).
+//   Insertions claim the first empty slot on the probe sequence of a key
+//   with a CAS on the key word; removals CAS the key to a tombstone.
+//   Tombstones are never reused by lfht_insert (this keeps every key on a
+//   single, stable probe sequence), they are only reclaimed by lfht_resize.
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "lfhashtable.h"
+#include <assert.h>
+#include <stdio.h>
+
+const int LFHT_FULL = 3;
+
+struct lfhashtable {
+  _Atomic uint64_t *slots;
+  int hash_len;
+  int slots_len;                // number of slots (2^hash_len)
+  atomic_int count;             // number of keys stored
+  atomic_int used;              // number of slots holding a key or a tombstone
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static _Atomic uint64_t *slots_create(int len);
+static uint64_t mix(uint64_t key);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct lfhashtable *lfht_create(int hash_length) {
+  assert(hash_length > 0 && hash_length < 31);
+
+  struct lfhashtable *ht = malloc(sizeof(struct lfhashtable));
+  ht->hash_len = hash_length;
+  ht->slots_len = 1 << hash_length;
+  ht->slots = slots_create(ht->slots_len);
+  atomic_init(&ht->count, 0);
+  atomic_init(&ht->used, 0);
+  return ht;
+}
+
+void lfht_destroy(struct lfhashtable *ht) {
+  assert(ht);
+  free(ht->slots);
+  free(ht);
+}
+
+int lfht_insert(struct lfhashtable *ht, uint64_t key) {
+  assert(ht);
+  assert(key != LFHT_EMPTY_KEY && key != LFHT_TOMBSTONE_KEY);
+
+  const uint64_t mask = ht->slots_len - 1;
+  uint64_t i = mix(key) & mask;
+  for (int probes = 0; probes < ht->slots_len; probes++) {
+    uint64_t cur = atomic_load_explicit(&ht->slots[i], memory_order_acquire);
+    if (cur == key) {
+      return HT_ALREADY_STORED;
+    }
+    if (cur == LFHT_EMPTY_KEY) {
+      if (atomic_compare_exchange_strong_explicit(&ht->slots[i], &cur, key,
+                                                  memory_order_acq_rel,
+                                                  memory_order_acquire)) {
+        atomic_fetch_add_explicit(&ht->count, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ht->used, 1, memory_order_relaxed);
+        return HT_SUCCESS;
+      }
+      // another thread claimed the slot first; cur now holds its key
+      if (cur == key) {
+        return HT_ALREADY_STORED;
+      }
+    }
+    i = (i + 1) & mask;
+  }
+  return LFHT_FULL;
+}
+
+int lfht_remove(struct lfhashtable *ht, uint64_t key) {
+  assert(ht);
+  assert(key != LFHT_EMPTY_KEY && key != LFHT_TOMBSTONE_KEY);
+
+  const uint64_t mask = ht->slots_len - 1;
+  uint64_t i = mix(key) & mask;
+  for (int probes = 0; probes < ht->slots_len; probes++) {
+    uint64_t cur = atomic_load_explicit(&ht->slots[i], memory_order_acquire);
+    if (cur == LFHT_EMPTY_KEY) {
+      return HT_NOT_STORED;
+    }
+    if (cur == key) {
+      // only one of several concurrent removers can win this CAS
+      if (atomic_compare_exchange_strong_explicit(&ht->slots[i], &cur,
+                                                  LFHT_TOMBSTONE_KEY,
+                                                  memory_order_acq_rel,
+                                                  memory_order_acquire)) {
+        atomic_fetch_sub_explicit(&ht->count, 1, memory_order_relaxed);
+        return HT_SUCCESS;
+      }
+      return HT_NOT_STORED;
+    }
+    i = (i + 1) & mask;
+  }
+  return HT_NOT_STORED;
+}
+
+bool lfht_contains(const struct lfhashtable *ht, uint64_t key) {
+  assert(ht);
+  assert(key != LFHT_EMPTY_KEY && key != LFHT_TOMBSTONE_KEY);
+
+  const uint64_t mask = ht->slots_len - 1;
+  uint64_t i = mix(key) & mask;
+  for (int probes = 0; probes < ht->slots_len; probes++) {
+    uint64_t cur = atomic_load_explicit(&ht->slots[i], memory_order_acquire);
+    if (cur == key) {
+      return true;
+    }
+    if (cur == LFHT_EMPTY_KEY) {
+      return false;
+    }
+    i = (i + 1) & mask;
+  }
+  return false;
+}
+
+int lfht_count(const struct lfhashtable *ht) {
+  assert(ht);
+  return atomic_load_explicit(&ht->count, memory_order_relaxed);
+}
+
+bool lfht_needs_resize(const struct lfhashtable *ht) {
+  assert(ht);
+  int used = atomic_load_explicit(&ht->used, memory_order_relaxed);
+  return used > ht->slots_len / 4 * 3;
+}
+
+void lfht_resize(struct lfhashtable *ht, int hash_length) {
+  assert(ht);
+  assert(hash_length > 0 && hash_length < 31);
+  assert((1 << hash_length) > lfht_count(ht));
+
+  _Atomic uint64_t *old_slots = ht->slots;
+  const int old_len = ht->slots_len;
+
+  ht->hash_len = hash_length;
+  ht->slots_len = 1 << hash_length;
+  ht->slots = slots_create(ht->slots_len);
+  atomic_store(&ht->count, 0);
+  atomic_store(&ht->used, 0);
+
+  // reinsert the live keys; tombstones are simply dropped
+  for (int i = 0; i < old_len; i++) {
+    uint64_t key = atomic_load_explicit(&old_slots[i], memory_order_relaxed);
+    if (key != LFHT_EMPTY_KEY && key != LFHT_TOMBSTONE_KEY) {
+      lfht_insert(ht, key);
+    }
+  }
+  free(old_slots);
+}
+
+void lfht_print(const struct lfhashtable *ht) {
+  assert(ht);
+  for (int i = 0; i < ht->slots_len; i++) {
+    uint64_t key = atomic_load_explicit(&ht->slots[i], memory_order_relaxed);
+    printf("%d: [", i);
+    if (key == LFHT_TOMBSTONE_KEY) {
+      printf("X");
+    } else if (key != LFHT_EMPTY_KEY) {
+      printf("%llu", (unsigned long long)key);
+    }
+    printf("]\n");
+  }
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// slots_create(len) is a helper function that returns an array of len
+//  slots that are all set to LFHT_EMPTY_KEY
+// effects: allocates memory (caller must free)
+// time: O(len)
+static _Atomic uint64_t *slots_create(int len) {
+  assert(len > 0);
+  _Atomic uint64_t *slots = malloc(sizeof(_Atomic uint64_t) * len);
+  for (int i = 0; i < len; i++) {
+    atomic_init(&slots[i], LFHT_EMPTY_KEY);
+  }
+  return slots;
+}
+
+// mix(key) is a helper function that scrambles the bits of key (splitmix64
+//  finalizer) so that consecutive integers spread over the whole table
+// time: O(1)
+static uint64_t mix(uint64_t key) {
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return key;
+}
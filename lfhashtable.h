@@ -0,0 +1,87 @@
+// This is the interface of a lock-free open-addressing hash table that is
+//   specialized for 64-bit integer keys. Slots are claimed with a
+//   compare-and-swap on the key word, so no key_clone, key_compare or
+//   key_destroy connectors are needed (or called).
+//   The return codes HT_SUCCESS, HT_ALREADY_STORED and HT_NOT_STORED are
+//   shared with hashtable.h.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hashtable.h"
+
+// LFHT_FULL indicates that a key could not be inserted because every slot
+//   of the table is occupied by a key or a tombstone (see lfht_resize).
+extern const int LFHT_FULL;
+
+// LFHT_EMPTY_KEY and LFHT_TOMBSTONE_KEY are reserved to mark free and
+//   deleted slots; they cannot be stored in the table.
+#define LFHT_EMPTY_KEY     UINT64_MAX
+#define LFHT_TOMBSTONE_KEY (UINT64_MAX - 1)
+
+// a lock-free hash table of 64-bit integers
+struct lfhashtable;
+
+// requires: all functions require valid (non-NULL) parameters
+//           keys must not be LFHT_EMPTY_KEY or LFHT_TOMBSTONE_KEY
+
+// lfht_create(hash_length) creates a new empty table with 2^hash_length
+//   slots.
+// effects: allocates heap memory; client must call lfht_destroy
+// requires: hash_length must be positive
+// time: O(n), where n is the number of slots
+struct lfhashtable *lfht_create(int hash_length);
+
+// lfht_destroy(ht) frees all resources allocated by the table ht.
+// effects: invalidates ht
+// requires: no other thread is using ht
+// time: O(1)
+void lfht_destroy(struct lfhashtable *ht);
+
+// lfht_insert(ht, key) inserts key into ht. The function returns
+//   * HT_SUCCESS if key has been inserted into ht,
+//   * HT_ALREADY_STORED if key is already stored in ht, or
+//   * LFHT_FULL if no free slot is left on the probe sequence of key.
+//   lfht_insert may run concurrently with lfht_insert, lfht_remove and
+//   lfht_contains from other threads.
+// effects: may modify ht
+// time: O(n) worst case, O(1) expected at moderate load
+int lfht_insert(struct lfhashtable *ht, uint64_t key);
+
+// lfht_remove(ht, key) removes key from ht by replacing it with a
+//   tombstone. The function returns
+//   * HT_SUCCESS if key has been removed from ht, or
+//   * HT_NOT_STORED if key was not stored in ht.
+//   lfht_remove may run concurrently with the other operations.
+// effects: may modify ht
+// time: O(n) worst case, O(1) expected at moderate load
+int lfht_remove(struct lfhashtable *ht, uint64_t key);
+
+// lfht_contains(ht, key) returns true if key is stored in ht, and false
+//   otherwise. The lookup is wait-free: it never retries and finishes in
+//   a bounded number of steps regardless of other threads.
+// time: O(n) worst case, O(1) expected at moderate load
+bool lfht_contains(const struct lfhashtable *ht, uint64_t key);
+
+// lfht_count(ht) returns the number of keys stored in ht. The value is
+//   exact only if no other thread is modifying ht.
+// time: O(1)
+int lfht_count(const struct lfhashtable *ht);
+
+// lfht_needs_resize(ht) returns true if more than 3/4 of the slots of ht
+//   are occupied by keys or tombstones.
+// time: O(1)
+bool lfht_needs_resize(const struct lfhashtable *ht);
+
+// lfht_resize(ht, hash_length) rehashes all keys of ht into a new slot
+//   array with 2^hash_length slots and drops all tombstones.
+// effects: modifies ht
+// requires: no other thread is using ht (quiescent point)
+//           hash_length must be positive and 2^hash_length must be larger
+//           than the number of keys in ht
+// time: O(n + n'), where n is the old and n' the new number of slots
+void lfht_resize(struct lfhashtable *ht, int hash_length);
+
+// lfht_print(ht) prints the content of ht to the console.
+// effects: creates output
+// time: O(n), where n is the number of slots
+void lfht_print(const struct lfhashtable *ht);
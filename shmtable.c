@@ -0,0 +1,474 @@
+// This is the implementation of the hash table in a shared memory segment.
+//   The segment is laid out as
+//     [ header | bucket directory | nodes and keys ... ]
+//   and every link is an offset from the start of the segment (0 is NULL).
+//   Nodes are allocated from the segment with a bump pointer and recycled
+//   through a first-fit free list; their memory is never returned, so a
+//   reader that races with a writer can read a stale node, but it never
+//   leaves the segment (all offsets are bounds-checked) and the version
+//   check of the bucket makes it retry.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmtable.h"
+#include <assert.h>
+#include <stdio.h>
+
+const int SHT_FULL = 3;
+const int SHT_LOCK_ERROR = 4;
+
+// identifies a segment that holds an initialized table
+#define SHT_MAGIC 0x5348544142310001ULL
+
+// the header at the start of the segment
+struct sht_header {
+  _Atomic uint64_t magic;                           // SHT_MAGIC once initialized
+  uint64_t size;                                    // size of the segment in bytes
+  int hash_len;
+  int buckets;                                      // number of buckets (2^hash_len)
+  atomic_int count;                                 // number of keys
+  pthread_mutex_t lock;                             // process-shared writer lock
+  uint64_t brk;                                     // offset of the first unused byte
+  uint64_t free_list;                               // offset of the first free node
+};
+
+struct sht_bucket {
+  atomic_uint version;                              // odd while a writer is active
+  _Atomic uint64_t head;                            // offset of the first node
+};
+
+struct sht_node {
+  _Atomic uint64_t next;                            // offset of the next node
+  _Atomic uint64_t hash;
+  atomic_uint len;                                  // length of the key
+  unsigned int cap;                                 // space for key bytes
+  unsigned char key[];
+};
+
+// the mapping of a segment in this process
+struct shmtable {
+  unsigned char *base;
+  size_t size;
+  int fd;
+  struct sht_header *hdr;
+  struct sht_bucket *buckets;
+};
+
+// HELPER FUNCTION DECLERATIONS START ----------------------------------
+
+static struct shmtable *sht_map(int fd);
+static struct sht_node *node_at(const struct shmtable *t, uint64_t off);
+static uint64_t node_alloc(struct shmtable *t, int len);
+static int sht_lock(struct shmtable *t);
+static uint64_t key_hash(const void *key, int len);
+static bool node_matches(const struct sht_node *node, uint64_t hash,
+                         const void *key, int len);
+
+// HELPER FUNCTION DECLERATIONS END ------------------------------------
+// documentation for helper functions is available at location of definition
+
+struct shmtable *sht_create(const char *name, int hash_length, size_t size) {
+  assert(hash_length > 0 && hash_length < 31);
+  const int buckets = 1 << hash_length;
+  const size_t data_start = sizeof(struct sht_header) +
+                            sizeof(struct sht_bucket) * buckets;
+  assert(size > data_start);
+
+  int fd = name ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600)
+                : memfd_create("shmtable", 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    if (name) {
+      shm_unlink(name);
+    }
+    return NULL;
+  }
+  struct shmtable *t = sht_map(fd);
+  if (t == NULL) {
+    close(fd);
+    if (name) {
+      shm_unlink(name);
+    }
+    return NULL;
+  }
+
+  struct sht_header *hdr = t->hdr;
+  hdr->size = size;
+  hdr->hash_len = hash_length;
+  hdr->buckets = buckets;
+  atomic_init(&hdr->count, 0);
+  hdr->brk = (data_start + 7) & ~(uint64_t)7;
+  hdr->free_list = 0;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&hdr->lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  t->buckets = (struct sht_bucket *)(t->base + sizeof(struct sht_header));
+  for (int i = 0; i < buckets; i++) {
+    atomic_init(&t->buckets[i].version, 0);
+    atomic_init(&t->buckets[i].head, 0);
+  }
+  // publish the table: attachers check the magic number
+  atomic_store_explicit(&hdr->magic, SHT_MAGIC, memory_order_release);
+  return t;
+}
+
+struct shmtable *sht_attach(const char *name) {
+  assert(name);
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct shmtable *t = sht_attach_fd(fd);
+  close(fd);
+  return t;
+}
+
+struct shmtable *sht_attach_fd(int fd) {
+  assert(fd >= 0);
+  int dup_fd = dup(fd);
+  if (dup_fd < 0) {
+    return NULL;
+  }
+  struct shmtable *t = sht_map(dup_fd);
+  if (t == NULL ||
+      atomic_load_explicit(&t->hdr->magic, memory_order_acquire) != SHT_MAGIC ||
+      t->hdr->size != t->size) {
+    if (t) {
+      sht_detach(t);
+    } else {
+      close(dup_fd);
+    }
+    return NULL;
+  }
+  t->buckets = (struct sht_bucket *)(t->base + sizeof(struct sht_header));
+  return t;
+}
+
+int sht_fd(const struct shmtable *t) {
+  assert(t);
+  return t->fd;
+}
+
+void sht_detach(struct shmtable *t) {
+  assert(t);
+  munmap(t->base, t->size);
+  close(t->fd);
+  free(t);
+}
+
+void sht_unlink(const char *name) {
+  assert(name);
+  shm_unlink(name);
+}
+
+int sht_insert(struct shmtable *t, const void *key, int len) {
+  assert(t);
+  assert(key);
+  assert(len >= 0);
+  const uint64_t hash = key_hash(key, len);
+  struct sht_bucket *b = &t->buckets[hash >> (64 - t->hdr->hash_len)];
+
+  if (sht_lock(t) != HT_SUCCESS) {
+    return SHT_LOCK_ERROR;
+  }
+  uint64_t head = atomic_load_explicit(&b->head, memory_order_relaxed);
+  for (uint64_t off = head; off; ) {
+    struct sht_node *node = node_at(t, off);
+    if (node_matches(node, hash, key, len)) {
+      pthread_mutex_unlock(&t->hdr->lock);
+      return HT_ALREADY_STORED;
+    }
+    off = atomic_load_explicit(&node->next, memory_order_relaxed);
+  }
+
+  const uint64_t off = node_alloc(t, len);
+  if (off == 0) {
+    pthread_mutex_unlock(&t->hdr->lock);
+    return SHT_FULL;
+  }
+  struct sht_node *node = node_at(t, off);
+  memcpy(node->key, key, len);
+  atomic_store_explicit(&node->len, len, memory_order_relaxed);
+  atomic_store_explicit(&node->hash, hash, memory_order_relaxed);
+  atomic_store_explicit(&node->next, head, memory_order_release);
+
+  atomic_fetch_add_explicit(&b->version, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&b->head, off, memory_order_release);
+  atomic_fetch_add_explicit(&b->version, 1, memory_order_release);
+  atomic_fetch_add_explicit(&t->hdr->count, 1, memory_order_relaxed);
+  pthread_mutex_unlock(&t->hdr->lock);
+  return HT_SUCCESS;
+}
+
+int sht_remove(struct shmtable *t, const void *key, int len) {
+  assert(t);
+  assert(key);
+  assert(len >= 0);
+  const uint64_t hash = key_hash(key, len);
+  struct sht_bucket *b = &t->buckets[hash >> (64 - t->hdr->hash_len)];
+
+  if (sht_lock(t) != HT_SUCCESS) {
+    return SHT_LOCK_ERROR;
+  }
+  _Atomic uint64_t *link = &b->head;
+  uint64_t off = atomic_load_explicit(link, memory_order_relaxed);
+  struct sht_node *node = NULL;
+  while (off) {
+    node = node_at(t, off);
+    if (node_matches(node, hash, key, len)) {
+      break;
+    }
+    link = &node->next;
+    off = atomic_load_explicit(link, memory_order_relaxed);
+  }
+  if (off == 0) {
+    pthread_mutex_unlock(&t->hdr->lock);
+    return HT_NOT_STORED;
+  }
+
+  atomic_fetch_add_explicit(&b->version, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(link, atomic_load_explicit(&node->next, memory_order_relaxed),
+                        memory_order_release);
+  atomic_fetch_add_explicit(&b->version, 1, memory_order_release);
+
+  // recycle the node; a reader standing on it walks into the free list
+  atomic_store_explicit(&node->next, t->hdr->free_list, memory_order_release);
+  t->hdr->free_list = off;
+  atomic_fetch_sub_explicit(&t->hdr->count, 1, memory_order_relaxed);
+  pthread_mutex_unlock(&t->hdr->lock);
+  return HT_SUCCESS;
+}
+
+bool sht_contains(const struct shmtable *t, const void *key, int len) {
+  assert(t);
+  assert(key);
+  assert(len >= 0);
+  const uint64_t hash = key_hash(key, len);
+  const struct sht_bucket *b = &t->buckets[hash >> (64 - t->hdr->hash_len)];
+  // a traversal longer than the number of nodes that fit into the segment
+  //   has run into a cycle of recycled nodes
+  const uint64_t max_steps = t->size / sizeof(struct sht_node);
+
+  for (;;) {
+    unsigned int v1 = atomic_load_explicit(&b->version, memory_order_acquire);
+    if (v1 & 1) {
+      continue;                                     // a writer is active
+    }
+    bool found = false;
+    uint64_t steps = 0;
+    uint64_t off = atomic_load_explicit(&b->head, memory_order_acquire);
+    while (off && steps++ < max_steps) {
+      const struct sht_node *node = node_at(t, off);
+      if (node == NULL) {
+        break;                                      // stale offset
+      }
+      if (node_matches(node, hash, key, len)) {
+        found = true;
+        break;
+      }
+      off = atomic_load_explicit(&node->next, memory_order_acquire);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&b->version, memory_order_relaxed) == v1) {
+      return found;
+    }
+  }
+}
+
+int sht_count(const struct shmtable *t) {
+  assert(t);
+  return atomic_load_explicit(&t->hdr->count, memory_order_relaxed);
+}
+
+void sht_print(const struct shmtable *t, void (*key_print)(const void *, int)) {
+  assert(t);
+  assert(key_print);
+  for (int i = 0; i < t->hdr->buckets; i++) {
+    printf("%d: [", i);
+    uint64_t off = atomic_load_explicit(&t->buckets[i].head, memory_order_acquire);
+    bool first = true;
+    while (off) {
+      const struct sht_node *node = node_at(t, off);
+      if (first) {
+        first = false;
+      } else {
+        printf(",");
+      }
+      key_print(node->key, atomic_load_explicit(&node->len, memory_order_relaxed));
+      off = atomic_load_explicit(&node->next, memory_order_acquire);
+    }
+    printf("]\n");
+  }
+}
+
+
+// HELPER FUNCTION DEFINITIONS START HERE -----------------------------------------------
+
+// sht_map(fd) is a helper function that maps the whole segment fd into the
+//  calling process, or returns NULL if this fails
+// effects: allocates memory (caller must call sht_detach)
+// time: O(1)
+static struct shmtable *sht_map(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct sht_header)) {
+    return NULL;
+  }
+  void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+  struct shmtable *t = malloc(sizeof(struct shmtable));
+  t->base = base;
+  t->size = st.st_size;
+  t->fd = fd;
+  t->hdr = base;
+  t->buckets = NULL;
+  return t;
+}
+
+// node_at(t, off) is a helper function that returns the node at offset off
+//  of the segment of t, or NULL if a node at off would not fit into the
+//  segment (only possible for offsets read by a racing reader)
+// requires: t is a valid pointer
+// time: O(1)
+static struct sht_node *node_at(const struct shmtable *t, uint64_t off) {
+  assert(t);
+  if (off < sizeof(struct sht_header) || off > t->size - sizeof(struct sht_node)) {
+    return NULL;
+  }
+  struct sht_node *node = (struct sht_node *)(t->base + off);
+  if (node->cap > t->size - off - sizeof(struct sht_node)) {
+    return NULL;
+  }
+  return node;
+}
+
+// node_alloc(t, len) is a helper function that returns the offset of an
+//  unused node with space for len key bytes, or 0 if the segment is full
+// requires: t is a valid pointer; the caller holds the lock of t
+// effects: modifies the segment of t
+// time: O(f), where f is the length of the free list
+static uint64_t node_alloc(struct shmtable *t, int len) {
+  assert(t);
+  struct sht_header *hdr = t->hdr;
+
+  // first fit from the free list
+  uint64_t *link = &hdr->free_list;
+  while (*link) {
+    struct sht_node *node = node_at(t, *link);
+    if (node->cap >= (unsigned int)len) {
+      uint64_t off = *link;
+      *link = atomic_load_explicit(&node->next, memory_order_relaxed);
+      return off;
+    }
+    link = (uint64_t *)&node->next;
+  }
+
+  // otherwise take fresh space from the end of the used area
+  const uint64_t need = (sizeof(struct sht_node) + len + 7) & ~(uint64_t)7;
+  if (hdr->brk + need > hdr->size) {
+    return 0;
+  }
+  const uint64_t off = hdr->brk;
+  hdr->brk += need;
+  struct sht_node *node = (struct sht_node *)(t->base + off);
+  node->cap = need - sizeof(struct sht_node);
+  return off;
+}
+
+// sht_lock(t) is a helper function that acquires the writer lock of t and
+//  returns HT_SUCCESS, or SHT_LOCK_ERROR if the lock cannot be acquired
+//  (then the caller must not modify the segment). If the previous owner
+//  died while holding the lock, the buckets it left in the middle of a
+//  modification are marked as finished and the count is recomputed, since
+//  the owner may have died between linking a node and counting it; the
+//  links of a bucket are always consistent because every change is a
+//  single store.
+// requires: t is a valid pointer
+// effects: modifies the segment of t
+// time: O(1), or O(n + m) after the death of a writer, n: number of
+//  buckets, m: number of keys
+static int sht_lock(struct shmtable *t) {
+  assert(t);
+  const int err = pthread_mutex_lock(&t->hdr->lock);
+  if (err == 0) {
+    return HT_SUCCESS;
+  }
+  if (err != EOWNERDEAD) {
+    return SHT_LOCK_ERROR;                          // e.g. ENOTRECOVERABLE
+  }
+  const uint64_t max_steps = t->size / sizeof(struct sht_node);
+  int count = 0;
+  for (int i = 0; i < t->hdr->buckets; i++) {
+    if (atomic_load_explicit(&t->buckets[i].version, memory_order_relaxed) & 1) {
+      atomic_fetch_add_explicit(&t->buckets[i].version, 1, memory_order_release);
+    }
+    uint64_t steps = 0;
+    uint64_t off = atomic_load_explicit(&t->buckets[i].head, memory_order_relaxed);
+    for (; off && steps < max_steps; steps++) {
+      const struct sht_node *node = node_at(t, off);
+      if (node == NULL) {
+        break;
+      }
+      off = atomic_load_explicit(&node->next, memory_order_relaxed);
+    }
+    count += (int)steps;
+  }
+  atomic_store_explicit(&t->hdr->count, count, memory_order_relaxed);
+  if (pthread_mutex_consistent(&t->hdr->lock) != 0) {
+    pthread_mutex_unlock(&t->hdr->lock);
+    return SHT_LOCK_ERROR;
+  }
+  return HT_SUCCESS;
+}
+
+// key_hash(key, len) is a helper function that returns the 64-bit FNV-1a
+//  hash of the len bytes at key, with a final mix so that the top bits can
+//  be used as bucket index. A built-in hash is used (instead of a hash
+//  connector) because every process must compute the same value.
+// time: O(len)
+static uint64_t key_hash(const void *key, int len) {
+  const unsigned char *bytes = key;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < len; i++) {
+    h ^= bytes[i];
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// node_matches(node, hash, key, len) is a helper function that returns true
+//  if node stores the len bytes at key, whose hash is hash
+// requires: node and key are valid pointers
+// time: O(len)
+static bool node_matches(const struct sht_node *node, uint64_t hash,
+                         const void *key, int len) {
+  assert(node);
+  assert(key);
+  return atomic_load_explicit(&node->hash, memory_order_relaxed) == hash &&
+         atomic_load_explicit(&node->len, memory_order_relaxed) == (unsigned int)len &&
+         node->cap >= (unsigned int)len &&
+         memcmp(node->key, key, len) == 0;
+}
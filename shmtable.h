@@ -0,0 +1,117 @@
+// This is the interface of a hash table that lives in a shared memory
+//   segment, so that several processes on one host can share a single copy
+//   of it. The bucket directory, the nodes and the keys are all stored in
+//   the segment and linked by offsets (not pointers), so every process can
+//   map the segment at any address.
+//   Keys are byte strings (a pointer and a length) that are copied into the
+//   segment, because key connectors (and their heap memory) cannot be
+//   shared between processes. Writers serialize on a process-shared lock;
+//   readers do not lock (see sht_contains).
+//   The return codes HT_SUCCESS, HT_ALREADY_STORED and HT_NOT_STORED are
+//   shared with hashtable.h.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hashtable.h"
+
+// SHT_FULL indicates that a key could not be inserted because the segment
+//   has no space left.
+extern const int SHT_FULL;
+// SHT_LOCK_ERROR indicates that the writer lock of the segment could not be
+//   acquired (e.g. it is no longer usable because a writer died holding it
+//   and the state could not be repaired); the table is left unchanged.
+extern const int SHT_LOCK_ERROR;
+
+// a hash table in a shared memory segment (a mapping of the segment in the
+//   calling process)
+struct shmtable;
+
+// requires: all functions require valid (non-NULL) parameters, unless
+//           stated otherwise
+
+// sht_create(name, hash_length, size) creates a new shared memory segment
+//   of size bytes that holds an empty table with 2^hash_length buckets and
+//   maps it into the calling process. If name is not NULL, the segment is
+//   created with shm_open and other processes can attach to it by name;
+//   otherwise an anonymous segment (memfd) is created, which other
+//   processes attach to through its file descriptor (see sht_fd).
+//   The function returns NULL if the segment cannot be created (e.g. name is
+//   already in use).
+// effects: allocates a shared memory segment; client must call sht_detach
+//          (and sht_unlink for named segments)
+// requires: hash_length must be positive
+//           size must be large enough to hold the bucket directory
+// time: O(n), where n is the number of buckets
+struct shmtable *sht_create(const char *name, int hash_length, size_t size);
+
+// sht_attach(name) maps the existing segment name into the calling
+//   process. The function returns NULL if there is no such segment or if it
+//   does not hold a table.
+// effects: allocates memory; client must call sht_detach
+// time: O(1)
+struct shmtable *sht_attach(const char *name);
+
+// sht_attach_fd(fd) is like sht_attach, but maps the segment referred to by
+//   the file descriptor fd (e.g. inherited from the creating process). The
+//   function duplicates fd, so the caller may close it afterwards.
+// effects: allocates memory; client must call sht_detach
+// time: O(1)
+struct shmtable *sht_attach_fd(int fd);
+
+// sht_fd(t) returns the file descriptor of the segment of t.
+// time: O(1)
+int sht_fd(const struct shmtable *t);
+
+// sht_detach(t) unmaps the segment of t from the calling process. The
+//   segment and the table survive as long as any process maps it (or, for
+//   named segments, until sht_unlink).
+// effects: invalidates t
+// time: O(1)
+void sht_detach(struct shmtable *t);
+
+// sht_unlink(name) removes the name of the shared memory segment name.
+// effects: removes the name; the memory is released once every process
+//          has detached
+// time: O(1)
+void sht_unlink(const char *name);
+
+// sht_insert(t, key, len) inserts the len bytes at key into t. The
+//   function returns
+//   * HT_SUCCESS if key has been inserted into t,
+//   * HT_ALREADY_STORED if key is already stored in t,
+//   * SHT_FULL if the segment has no space left for key, or
+//   * SHT_LOCK_ERROR if the writer lock cannot be acquired.
+// effects: modifies t
+// requires: len >= 0
+// time: O(len + m * len), where m is the number of keys in the bucket
+int sht_insert(struct shmtable *t, const void *key, int len);
+
+// sht_remove(t, key, len) removes the len bytes at key from t. The
+//   function returns
+//   * HT_SUCCESS if key has been removed from t,
+//   * HT_NOT_STORED if key was not stored in t, or
+//   * SHT_LOCK_ERROR if the writer lock cannot be acquired.
+// effects: modifies t
+// requires: len >= 0
+// time: O(len + m * len), where m is the number of keys in the bucket
+int sht_remove(struct shmtable *t, const void *key, int len);
+
+// sht_contains(t, key, len) returns true if the len bytes at key are
+//   stored in t, and false otherwise. Readers take no lock and do not write
+//   to the segment; they validate their traversal with the version counter
+//   of the bucket and retry if a writer changed it.
+// requires: len >= 0
+// time: O(len + m * len) if no writer interferes, where m is the number of
+//   keys in the bucket
+bool sht_contains(const struct shmtable *t, const void *key, int len);
+
+// sht_count(t) returns the number of keys stored in t.
+// time: O(1)
+int sht_count(const struct shmtable *t);
+
+// sht_print(t, key_print) prints the content of t to the console, using
+//   key_print to print each key.
+// effects: creates output
+// time: O(n + m * cp), where n: number of buckets, m: number of keys,
+//   cp: complexity of key_print
+void sht_print(const struct shmtable *t, void (*key_print)(const void *, int));
@@ -0,0 +1,129 @@
+// This is the support code of the tests in this directory. A test is a
+//   program that runs its checks and exits with status 0 if all of them
+//   passed; every failed check is reported with its location. Tests that
+//   need files create them in a fresh temporary directory (test_path),
+//   which is removed when the test exits.
+//   The key connectors of int keys are shared by the tests of the generic
+//   tables.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// the number of failed checks of the running test
+static int test_failures;
+
+// CHECK(cond) reports a failure if cond is false.
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+// test_result(name) reports the outcome of the test name and returns its
+//   exit status.
+// effects: creates output
+// time: O(1)
+static inline int test_result(const char *name) {
+  printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// the temporary directory of the running test ("" until it is created)
+static char test_dir[64];
+
+// test_remove_dir() removes the temporary directory with all its files.
+// effects: removes files
+// time: O(f), where f is the number of files
+static inline void test_remove_dir(void) {
+  DIR *dir = opendir(test_dir);
+  if (dir == NULL) {
+    return;
+  }
+  char path[512];
+  for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+    if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0) {
+      snprintf(path, sizeof(path), "%s/%s", test_dir, e->d_name);
+      unlink(path);
+    }
+  }
+  closedir(dir);
+  rmdir(test_dir);
+}
+
+// test_path(name) returns the path of the file name in the temporary
+//   directory of the test; the result stays valid for the next three calls
+//   (so several paths can be passed to one function).
+// effects: creates the directory on the first call
+// time: O(1)
+static inline const char *test_path(const char *name) {
+  static char paths[4][512];
+  static int next;
+  char *path = paths[next++ % 4];
+  if (test_dir[0] == '\0') {
+    const char *tmp = getenv("TMPDIR");
+    snprintf(test_dir, sizeof(test_dir), "%s/httest.XXXXXX", tmp ? tmp : "/tmp");
+    if (mkdtemp(test_dir) == NULL) {
+      perror("mkdtemp");
+      exit(EXIT_FAILURE);
+    }
+    atexit(test_remove_dir);
+  }
+  snprintf(path, sizeof(paths[0]), "%s/%s", test_dir, name);
+  return path;
+}
+
+// the connectors of int keys (see hashtable.h and htsnapshot.h)
+
+static inline void *int_clone(const void *key) {
+  int *clone = (int *)malloc(sizeof(int));
+  *clone = *(const int *)key;
+  return clone;
+}
+
+static inline int int_hash(const void *key, int hash_length) {
+  const unsigned int h = (unsigned int)*(const int *)key * 2654435761u;
+  return (int)(h >> (32 - hash_length));
+}
+
+static inline int int_compare(const void *a, const void *b) {
+  const int x = *(const int *)a;
+  const int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+static inline void int_destroy(void *key) {
+  free(key);
+}
+
+static inline void int_print(const void *key) {
+  printf("%d", *(const int *)key);
+}
+
+static inline int int_encode(const void *key, void *buf, int len) {
+  if (len >= (int)sizeof(int)) {
+    memcpy(buf, key, sizeof(int));
+  }
+  return sizeof(int);
+}
+
+static inline void *int_decode(const void *buf, int len) {
+  (void)len;
+  int *key = (int *)malloc(sizeof(int));
+  memcpy(key, buf, sizeof(int));
+  return key;
+}
+
+// int_count(ctx, key) counts the visited keys in *ctx (an int); it is a
+//   visit function for ht_foreach.
+static inline void int_count(void *ctx, const void *key) {
+  (void)key;
+  ++*(int *)ctx;
+}
@@ -0,0 +1,104 @@
+// This tests the seqlock-validated readers of chashtable.h: writers keep
+//   inserting and removing the even keys of crowded buckets while readers
+//   look up the odd keys (which stay stored) and keys that are never
+//   stored. A reader must never see an odd key missing or a foreign key
+//   present, whatever the writers do to the bucket meanwhile.
+
+#include "tests/test.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include "chashtable.h"
+
+#define WRITERS 2
+#define READERS 3
+#define KEYS 2000
+#define ROUNDS 400
+
+static struct chashtable *shared;
+static atomic_bool writing;
+static atomic_int reader_errors;
+
+// toggle_even(arg) inserts and removes the even keys of its half of the
+//   keys ROUNDS times
+static void *toggle_even(void *arg) {
+  const int first = (int)(long)arg * (KEYS / WRITERS);
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int k = first; k < first + KEYS / WRITERS; k += 2) {
+      if (r % 2 == 0) {
+        cht_insert(shared, &k);
+      } else {
+        cht_remove(shared, &k);
+      }
+    }
+  }
+  return NULL;
+}
+
+// look_up(arg) checks the odd and the foreign keys until the writers are
+//   done
+static void *look_up(void *arg) {
+  (void)arg;
+  while (atomic_load(&writing)) {
+    for (int k = 1; k < KEYS; k += 2) {
+      const int foreign = KEYS + k;
+      if (!cht_contains(shared, &k) || cht_contains(shared, &foreign)) {
+        atomic_fetch_add(&reader_errors, 1);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void test_basic(void) {
+  struct chashtable *ht = cht_create(int_clone, int_hash, 3, int_compare,
+                                     int_destroy, int_print);
+  const int a = 4;
+  CHECK(cht_insert(ht, &a) == HT_SUCCESS);
+  CHECK(cht_insert(ht, &a) == HT_ALREADY_STORED);
+  CHECK(cht_contains(ht, &a));
+  CHECK(cht_remove(ht, &a) == HT_SUCCESS);
+  CHECK(cht_remove(ht, &a) == HT_NOT_STORED);
+  CHECK(!cht_contains(ht, &a));
+  cht_quiesce(ht);
+  cht_destroy(ht);
+}
+
+static void test_concurrent(void) {
+  shared = cht_create(int_clone, int_hash, 4, int_compare, int_destroy,
+                      int_print);
+  for (int k = 1; k < KEYS; k += 2) {
+    cht_insert(shared, &k);
+  }
+  atomic_store(&writing, true);
+  pthread_t readers[READERS];
+  pthread_t writers[WRITERS];
+  for (long i = 0; i < READERS; i++) {
+    pthread_create(&readers[i], NULL, look_up, NULL);
+  }
+  for (long i = 0; i < WRITERS; i++) {
+    pthread_create(&writers[i], NULL, toggle_even, (void *)i);
+  }
+  for (int i = 0; i < WRITERS; i++) {
+    pthread_join(writers[i], NULL);
+  }
+  atomic_store(&writing, false);
+  for (int i = 0; i < READERS; i++) {
+    pthread_join(readers[i], NULL);
+  }
+  CHECK(atomic_load(&reader_errors) == 0);
+  cht_quiesce(shared);
+
+  // ROUNDS is even, so the last round removed the even keys
+  int wrong = 0;
+  for (int k = 0; k < KEYS; k++) {
+    wrong += cht_contains(shared, &k) != (k % 2 == 1);
+  }
+  CHECK(wrong == 0);
+  cht_destroy(shared);
+}
+
+int main(void) {
+  test_basic();
+  test_concurrent();
+  return test_result("chashtable");
+}
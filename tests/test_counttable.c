@@ -0,0 +1,79 @@
+// This tests the counting table of counttable.h: several threads add to
+//   the same keys, directly with ct_add and through ct_buffer, and no
+//   update may be lost.
+
+#include "tests/test.h"
+#include <pthread.h>
+#include "counttable.h"
+
+#define THREADS 4
+#define ROUNDS 100000
+#define HOT_KEYS 50
+
+static struct counttable *shared;
+
+// add_hot(arg) adds 1 to every hot key ROUNDS / HOT_KEYS times, through a
+//   buffer if arg is not NULL
+static void *add_hot(void *arg) {
+  struct ct_buffer *buf = arg ? ct_buffer_create(shared, 16) : NULL;
+  for (int i = 0; i < ROUNDS; i++) {
+    const int key = i % HOT_KEYS;
+    if (buf) {
+      ct_buffer_add(buf, &key, 1);
+    } else {
+      ct_add(shared, &key, 1);
+    }
+  }
+  if (buf) {
+    ct_buffer_destroy(buf);
+  }
+  return NULL;
+}
+
+static void test_basic(void) {
+  struct counttable *ct = ct_create(int_clone, int_hash, 4, int_compare,
+                                    int_destroy, int_print);
+  const int a = 1;
+  const int b = 2;
+  CHECK(ct_get(ct, &a) == 0);
+  CHECK(ct_add(ct, &a, 5) == 5);
+  CHECK(ct_add(ct, &a, -2) == 3);
+  CHECK(ct_add(ct, &b, 1) == 1);
+  CHECK(ct_count(ct) == 2);
+
+  struct ct_buffer *buf = ct_buffer_create(ct, 8);
+  ct_buffer_add(buf, &a, 10);
+  ct_buffer_add(buf, &a, 10);
+  CHECK(ct_get(ct, &a) == 3);                       // still pending
+  ct_buffer_flush(buf);
+  CHECK(ct_get(ct, &a) == 23);
+  ct_buffer_add(buf, &b, 4);
+  ct_buffer_destroy(buf);
+  CHECK(ct_get(ct, &b) == 5);
+  ct_destroy(ct);
+}
+
+static void test_concurrent(void) {
+  shared = ct_create(int_clone, int_hash, 4, int_compare, int_destroy,
+                     int_print);
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, add_hot, i % 2 ? (void *)1 : NULL);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  CHECK(ct_count(shared) == HOT_KEYS);
+  int wrong = 0;
+  for (int key = 0; key < HOT_KEYS; key++) {
+    wrong += ct_get(shared, &key) != (long)THREADS * ROUNDS / HOT_KEYS;
+  }
+  CHECK(wrong == 0);
+  ct_destroy(shared);
+}
+
+int main(void) {
+  test_basic();
+  test_concurrent();
+  return test_result("counttable");
+}
@@ -0,0 +1,93 @@
+// This tests ht::FixedSet of htfixed.hpp: random operations against
+//   std::set, a set that fills up (HTFIXED_FULL), a struct key type with
+//   its own Hash and Eq, and a set placed in a caller-provided buffer.
+
+#include "tests/test.h"
+#include <new>
+#include <random>
+#include <set>
+#include "htfixed.hpp"
+
+namespace {
+
+struct Point {
+  int x, y;
+};
+
+struct PointHash {
+  std::size_t operator()(const Point &p) const {
+    return p.x * 31 + p.y;
+  }
+};
+
+struct PointEq {
+  bool operator()(const Point &a, const Point &b) const {
+    return a.x == b.x && a.y == b.y;
+  }
+};
+
+void test_random() {
+  static ht::FixedSet<std::uint32_t, 10> s;
+  std::set<std::uint32_t> ref;
+  std::mt19937 rng(1);
+  int wrong = 0;
+  for (int i = 0; i < 300000; i++) {
+    const std::uint32_t k = rng() % 1500;
+    const int op = rng() % 3;
+    if (op == 0) {
+      const int result = s.insert(k);
+      if (ref.count(k)) {
+        wrong += result != HT_ALREADY_STORED;
+      } else {
+        wrong += result != HT_SUCCESS;
+        ref.insert(k);
+      }
+    } else if (op == 1) {
+      wrong += s.remove(k) != (ref.erase(k) ? HT_SUCCESS : HT_NOT_STORED);
+    } else {
+      wrong += s.contains(k) != (ref.count(k) == 1);
+    }
+  }
+  CHECK(s.count() == static_cast<int>(ref.size()));
+  int visited = 0;
+  s.for_each([&](std::uint32_t k) { visited += ref.count(k); });
+  CHECK(visited == s.count());
+
+  // fill the remaining slots
+  for (std::uint32_t k = 1500; ref.size() < s.capacity; k++) {
+    wrong += s.insert(k) != HT_SUCCESS;
+    ref.insert(k);
+  }
+  CHECK(s.insert(0xffffffff) == HTFIXED_FULL);
+  for (std::uint32_t k : ref) {
+    wrong += !s.contains(k);
+  }
+  CHECK(wrong == 0);
+
+  ht::FixedSet<std::uint8_t, 2> tiny;
+  for (int i = 0; i < 4; i++) {
+    CHECK(tiny.insert(i) == HT_SUCCESS);
+  }
+  CHECK(tiny.insert(9) == HTFIXED_FULL);
+}
+
+void test_struct_keys() {
+  using PointSet = ht::FixedSet<Point, 4, PointHash, PointEq>;
+  alignas(PointSet) unsigned char buf[sizeof(PointSet)];
+  PointSet *p = new (buf) PointSet();
+  CHECK(p->insert({1, 2}) == HT_SUCCESS);
+  CHECK(p->insert({1, 2}) == HT_ALREADY_STORED);
+  CHECK(p->contains({1, 2}));
+  CHECK(!p->contains({2, 1}));
+  CHECK(p->remove({1, 2}) == HT_SUCCESS);
+  CHECK(p->count() == 0);
+  p->~PointSet();
+}
+
+}  // namespace
+
+int main() {
+  test_random();
+  test_struct_keys();
+  return test_result("FixedSet");
+}
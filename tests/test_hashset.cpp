@@ -0,0 +1,92 @@
+// This tests ht::HashSet of hashset.hpp: random operations against std::set
+//   for every storage policy with string and integer keys and several lock
+//   and stats policies, and concurrent insertions into a striped set with
+//   their operation counts.
+
+#include "tests/test.h"
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hashset.hpp"
+
+namespace {
+
+template <typename Set, typename Key>
+void check_random(Key (*make_key)(std::uint64_t)) {
+  Set s;
+  std::set<Key> ref;
+  std::mt19937_64 rng(1);
+  int wrong = 0;
+  for (int i = 0; i < 60000; i++) {
+    const Key k = make_key(rng() % 5000);
+    const int op = rng() % 3;
+    if (op == 0) {
+      wrong += s.insert(k) != ref.insert(k).second;
+    } else if (op == 1) {
+      wrong += s.erase(k) != (ref.erase(k) == 1);
+    } else {
+      wrong += s.contains(k) != (ref.count(k) == 1);
+    }
+  }
+  CHECK(wrong == 0);
+  CHECK(s.size() == ref.size());
+  std::size_t visited = 0;
+  s.for_each([&](const Key &k) { visited += ref.count(k); });
+  CHECK(visited == ref.size());
+}
+
+std::string string_key(std::uint64_t x) {
+  return "key-" + std::to_string(x) + std::string(20, 'x');
+}
+
+std::uint64_t u64_key(std::uint64_t x) {
+  return x;
+}
+
+using StringHash = std::hash<std::string>;
+using StringEq = std::equal_to<std::string>;
+using U64Hash = std::hash<std::uint64_t>;
+using U64Eq = std::equal_to<std::uint64_t>;
+
+void test_concurrent() {
+  constexpr int threads = 4;
+  constexpr std::uint64_t keys = 20000;
+  ht::HashSet<std::uint64_t, U64Hash, U64Eq, ht::RobinHood, ht::Striped<16>,
+              ht::StatsOn>
+      s;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&s, t] {
+      for (std::uint64_t i = 0; i < keys; i++) {
+        s.insert(i * threads + t);
+        s.insert(i * threads);                      // contended
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  CHECK(s.size() == keys * threads);
+  const ht::HashSetStats stats = s.stats();
+  CHECK(stats.inserts == keys * threads);
+  CHECK(stats.operations == 2 * keys * threads);
+  CHECK(stats.probes >= stats.operations);
+}
+
+}  // namespace
+
+int main() {
+  check_random<ht::HashSet<std::string>>(string_key);
+  check_random<ht::HashSet<std::string, StringHash, StringEq,
+                           ht::RobinHoodCompact>>(string_key);
+  check_random<ht::HashSet<std::string, StringHash, StringEq, ht::Chained,
+                           ht::Mutex>>(string_key);
+  check_random<ht::HashSet<std::uint64_t, U64Hash, U64Eq, ht::FlatU64,
+                           ht::Striped<8>, ht::StatsOn>>(u64_key);
+  check_random<ht::HashSet<std::uint64_t, U64Hash, U64Eq, ht::RobinHood,
+                           ht::Striped<4>, ht::StatsOn>>(u64_key);
+  test_concurrent();
+  return test_result("HashSet");
+}
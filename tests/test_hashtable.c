@@ -0,0 +1,155 @@
+// This tests the generic table of hashtable.h: insertion, removal and
+//   lookup against a reference, the batch functions, sorted buckets,
+//   observers, ht_sample (both its weighted and its sparse strategy) and
+//   ht_key_hash64.
+
+#include "tests/test.h"
+#include "hashtable.h"
+
+#define KEYS 20000
+
+// the numbers of observed insertions and removals
+static int observed_inserts;
+static int observed_removes;
+
+// observe(ctx, op, key, index) counts the notification and checks its
+//   bucket
+static void observe(void *ctx, int op, const void *key, int index) {
+  CHECK(index == ht_index((const struct hashtable *)ctx, key));
+  if (op == HT_OP_INSERT) {
+    observed_inserts++;
+  } else {
+    observed_removes++;
+  }
+}
+
+// check_sorted(ctx, key) checks that the keys of a bucket are visited in
+//   increasing order; *ctx (an int) holds the previous key
+static void check_sorted(void *ctx, const void *key) {
+  CHECK(*(int *)ctx < *(const int *)key);
+  *(int *)ctx = *(const int *)key;
+}
+
+static void test_basic(void) {
+  struct hashtable *ht =
+      ht_create(int_clone, int_hash, 8, int_compare, int_destroy, int_print);
+  ht_observe(ht, observe, ht);
+  static bool ref[KEYS];
+  unsigned int seed = 1;
+  int wrong = 0;
+  for (int i = 0; i < 5 * KEYS; i++) {
+    seed = seed * 1103515245 + 12345;
+    const int k = (seed >> 8) % KEYS;
+    if (seed >> 31) {
+      wrong += ht_insert(ht, &k) != (ref[k] ? HT_ALREADY_STORED : HT_SUCCESS);
+      ref[k] = true;
+    } else {
+      wrong += ht_remove(ht, &k) != (ref[k] ? HT_SUCCESS : HT_NOT_STORED);
+      ref[k] = false;
+    }
+  }
+  int stored = 0;
+  for (int k = 0; k < KEYS; k++) {
+    const int *found = (const int *)ht_lookup(ht, &k);
+    wrong += ht_contains(ht, &k) != ref[k];
+    wrong += ref[k] ? found == NULL || *found != k : found != NULL;
+    stored += ref[k];
+  }
+  CHECK(wrong == 0);
+  CHECK(observed_inserts - observed_removes == stored);
+  int count = 0;
+  ht_foreach(ht, int_count, &count);
+  CHECK(count == stored);
+  CHECK(ht_length(ht) == 256);
+  for (int i = 0; i < ht_length(ht); i++) {
+    int previous = -1;
+    ht_bucket_foreach(ht, i, check_sorted, &previous);
+  }
+
+  int *adopted = (int *)int_clone(&(int){KEYS});
+  CHECK(ht_adopt(ht, adopted) == HT_SUCCESS);
+  CHECK(ht_lookup(ht, &(int){KEYS}) == adopted);
+  CHECK(ht_adopt(ht, int_clone(&(int){KEYS})) == HT_ALREADY_STORED);
+
+  ht_unobserve(ht, observe, ht);
+  const int before = observed_inserts;
+  const int bucket = ht_index(ht, &(int){KEYS});
+  ht_bucket_clear(ht, bucket);
+  CHECK(!ht_contains(ht, &(int){KEYS}));
+  CHECK(ht_insert(ht, &(int){KEYS}) == HT_SUCCESS);
+  CHECK(observed_inserts == before);
+  ht_destroy(ht);
+}
+
+static void test_batch(void) {
+  struct hashtable *ht =
+      ht_create(int_clone, int_hash, 10, int_compare, int_destroy, int_print);
+  static int keys[KEYS];
+  static const void *ptrs[KEYS];
+  static int results[KEYS];
+  static bool found[KEYS];
+  for (int i = 0; i < KEYS; i++) {
+    keys[i] = i % (KEYS / 2);                       // each key twice
+    ptrs[i] = &keys[i];
+  }
+  ht_insert_batch(ht, ptrs, KEYS, results);
+  int wrong = 0;
+  for (int i = 0; i < KEYS; i++) {
+    wrong += results[i] != (i < KEYS / 2 ? HT_SUCCESS : HT_ALREADY_STORED);
+  }
+  ht_remove_batch(ht, ptrs, KEYS / 4, results);
+  ht_contains_batch(ht, ptrs, KEYS, found);
+  for (int i = 0; i < KEYS; i++) {
+    wrong += i < KEYS / 4 && results[i] != HT_SUCCESS;
+    wrong += found[i] != (keys[i] >= KEYS / 4);
+  }
+  CHECK(wrong == 0);
+  ht_destroy(ht);
+}
+
+static void test_sample(void) {
+  // dense: every key is drawn about equally often
+  struct hashtable *ht =
+      ht_create(int_clone, int_hash, 6, int_compare, int_destroy, int_print);
+  for (int i = 0; i < 1000; i++) {
+    ht_insert(ht, &i);
+  }
+  static const void *out[100000];
+  int hits[1000] = {0};
+  CHECK(ht_sample(ht, 100000, out) == 100000);
+  for (int i = 0; i < 100000; i++) {
+    hits[*(const int *)out[i]]++;
+  }
+  int low = hits[0];
+  int high = hits[0];
+  for (int i = 1; i < 1000; i++) {
+    low = hits[i] < low ? hits[i] : low;
+    high = hits[i] > high ? hits[i] : high;
+  }
+  CHECK(low > 50 && high < 150);
+  CHECK(ht_sample(ht, 0, out) == 0);
+  ht_destroy(ht);
+
+  // sparse: distinct keys, at most all of them
+  ht = ht_create(int_clone, int_hash, 16, int_compare, int_destroy, int_print);
+  CHECK(ht_sample(ht, 10, out) == 0);
+  for (int i = 0; i < 3; i++) {
+    ht_insert(ht, &i);
+  }
+  CHECK(ht_sample(ht, 10, out) == 3);
+  CHECK(*(const int *)out[0] + *(const int *)out[1] + *(const int *)out[2] == 3);
+  CHECK(ht_sample(ht, 2, out) == 2);
+  CHECK(*(const int *)out[0] != *(const int *)out[1]);
+  ht_destroy(ht);
+}
+
+int main(void) {
+  test_basic();
+  test_batch();
+  test_sample();
+  const int a = 1;
+  const int b = 2;
+  CHECK(ht_key_hash64(&a, int_encode) == ht_key_hash64(&(int){1}, int_encode));
+  CHECK(ht_key_hash64(&a, int_encode) != ht_key_hash64(&b, int_encode));
+  return test_result("hashtable");
+}
@@ -0,0 +1,196 @@
+// This tests the asynchronous I/O engine of htaio.h and the snapshots that
+//   are written and read through it, with every backend the engine may
+//   pick: io_uring (if the kernel has it), io_uring whose reads and writes
+//   come back short (every submission is capped at 12 KiB), and the thread
+//   pool, which is used when the kernel cannot report the supported
+//   io_uring operations. The faults are injected by wrapping syscall and
+//   mmap; posix_memalign is wrapped to check that snapshots report failed
+//   buffer allocations.
+
+#include "tests/test.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "htaio.h"
+#include "htsnapshot.h"
+
+#ifdef __NR_io_uring_enter
+#include <linux/io_uring.h>
+#endif
+
+#define CAPPED_LEN 12288
+
+static bool no_probe;                               // io_uring_register fails
+static bool cap_transfers;                          // submissions are capped
+static int shortened;                               // submissions that were capped
+static int alloc_failure;                           // the n-th posix_memalign fails
+
+#ifdef __NR_io_uring_enter
+static struct io_uring_sqe *sqes;                   // the submission queue entries
+static size_t sqes_len;
+
+// mmap records where the submission queue entries of a ring are mapped
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t offset) {
+  static void *(*real)(void *, size_t, int, int, int, off_t);
+  if (real == NULL) {
+    real = (void *(*)(void *, size_t, int, int, int, off_t))dlsym(RTLD_NEXT, "mmap");
+  }
+  void *p = real(addr, len, prot, flags, fd, offset);
+  if (offset == IORING_OFF_SQES && p != MAP_FAILED) {
+    sqes = p;
+    sqes_len = len / sizeof(struct io_uring_sqe);
+  }
+  return p;
+}
+#endif
+
+// syscall injects the faults of the io_uring system calls
+long syscall(long number, ...) {
+  static long (*real)(long, ...);
+  if (real == NULL) {
+    real = (long (*)(long, ...))dlsym(RTLD_NEXT, "syscall");
+  }
+  va_list ap;
+  va_start(ap, number);
+  long a[6];
+  for (int i = 0; i < 6; i++) {
+    a[i] = va_arg(ap, long);
+  }
+  va_end(ap);
+#ifdef __NR_io_uring_enter
+  if (number == __NR_io_uring_register && no_probe) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (number == __NR_io_uring_enter && cap_transfers && sqes && a[1] > 0) {
+    for (size_t i = 0; i < sqes_len; i++) {
+      if ((sqes[i].opcode == IORING_OP_READ || sqes[i].opcode == IORING_OP_WRITE) &&
+          sqes[i].len > CAPPED_LEN) {
+        sqes[i].len = CAPPED_LEN;
+        shortened++;
+      }
+    }
+  }
+#endif
+  return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+// posix_memalign fails on the alloc_failure-th call
+int posix_memalign(void **p, size_t alignment, size_t size) {
+  static int (*real)(void **, size_t, size_t);
+  if (real == NULL) {
+    real = (int (*)(void **, size_t, size_t))dlsym(RTLD_NEXT, "posix_memalign");
+  }
+  if (alloc_failure > 0 && --alloc_failure == 0) {
+    return ENOMEM;
+  }
+  return real(p, alignment, size);
+}
+
+#define BLOCK (256 << 10)
+#define BLOCKS 4
+
+static unsigned char out[BLOCKS][BLOCK];
+static unsigned char in[BLOCKS * BLOCK];
+
+// test_engine(uring) writes BLOCKS blocks concurrently, reads them back
+//   from an unaligned offset and reads at the end of the file, and checks
+//   that the engine uses io_uring if uring is true
+static void test_engine(bool uring) {
+  const int fd = open(test_path("aio"), O_CREAT | O_TRUNC | O_RDWR, 0644);
+  struct htaio *aio = htaio_create(fd, BLOCKS);
+  CHECK(htaio_uses_uring(aio) == uring);
+  for (int b = 0; b < BLOCKS; b++) {
+    for (int i = 0; i < BLOCK; i++) {
+      out[b][i] = (unsigned char)(b * 31 + i * 7);
+    }
+    htaio_write(aio, out[b], BLOCK, (off_t)b * BLOCK, b);
+  }
+  bool done[BLOCKS] = {false};
+  for (int n = 0; n < BLOCKS; n++) {
+    long result;
+    const int tag = htaio_wait(aio, &result);
+    CHECK(0 <= tag && tag < BLOCKS && !done[tag] && result == BLOCK);
+    if (0 <= tag && tag < BLOCKS) {
+      done[tag] = true;
+    }
+  }
+
+  long result;
+  htaio_read(aio, in, sizeof(in), 100, 7);
+  CHECK(htaio_wait(aio, &result) == 7);
+  CHECK(result == (long)sizeof(in) - 100);
+  CHECK(memcmp(in, &out[0][100], BLOCK - 100) == 0);
+  CHECK(memcmp(in + BLOCK - 100, out[1], BLOCK) == 0);
+  htaio_read(aio, in, 10, (off_t)BLOCKS * BLOCK, 8);
+  CHECK(htaio_wait(aio, &result) == 8 && result == 0);
+  htaio_destroy(aio);
+  close(fd);
+}
+
+// test_snapshot() saves a table of many keys and loads it back
+static void test_snapshot(void) {
+  struct hashtable *ht = ht_create(int_clone, int_hash, 10, int_compare,
+                                   int_destroy, int_print);
+  for (int k = 0; k < 100000; k++) {
+    ht_insert(ht, &k);
+  }
+  CHECK(ht_snapshot_save(ht, test_path("snap"), 42, int_encode) == HT_SUCCESS);
+  struct hashtable *r = ht_create(int_clone, int_hash, 10, int_compare,
+                                  int_destroy, int_print);
+  uint64_t lsn = 0;
+  CHECK(ht_snapshot_load(r, test_path("snap"), &lsn, int_decode) == HT_SUCCESS);
+  int count = 0;
+  ht_foreach(r, int_count, &count);
+  CHECK(lsn == 42 && count == 100000);
+  ht_destroy(ht);
+  ht_destroy(r);
+}
+
+// test_alloc_failure() checks that snapshots report failed buffer
+//   allocations
+static void test_alloc_failure(void) {
+  struct hashtable *ht = ht_create(int_clone, int_hash, 4, int_compare,
+                                   int_destroy, int_print);
+  const int k = 1;
+  ht_insert(ht, &k);
+  alloc_failure = 2;
+  CHECK(ht_snapshot_save(ht, test_path("snap"), 1, int_encode) == HT_IO_ERROR);
+  CHECK(ht_snapshot_save(ht, test_path("snap"), 1, int_encode) == HT_SUCCESS);
+  struct hashtable *r = ht_create(int_clone, int_hash, 4, int_compare,
+                                  int_destroy, int_print);
+  uint64_t lsn;
+  alloc_failure = 2;
+  CHECK(ht_snapshot_load(r, test_path("snap"), &lsn, int_decode) == HT_IO_ERROR);
+  alloc_failure = 0;
+  ht_destroy(ht);
+  ht_destroy(r);
+}
+
+int main(void) {
+  const int fd = open(test_path("probe"), O_CREAT | O_RDWR, 0644);
+  struct htaio *aio = htaio_create(fd, 1);
+  const bool uring = htaio_uses_uring(aio);
+  htaio_destroy(aio);
+  close(fd);
+  printf("htaio: io_uring is %savailable\n", uring ? "" : "not ");
+
+  test_engine(uring);
+  test_snapshot();
+  if (uring) {
+    cap_transfers = true;
+    test_engine(true);
+    test_snapshot();
+    CHECK(shortened > 0);
+    cap_transfers = false;
+  }
+  no_probe = true;
+  test_engine(false);
+  test_snapshot();
+  no_probe = false;
+  test_alloc_failure();
+  return test_result("htaio");
+}
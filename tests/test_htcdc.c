@@ -0,0 +1,88 @@
+// This tests the change feed of htcdc.h: a follower that starts from a
+//   copy of the primary replicates a stream of insertions and removals
+//   through a small ring buffer (so the writer waits for the replicator
+//   many times) and ends up equal to the primary, and a key too long for
+//   the ring fails the feed and its replicator.
+
+#include "tests/test.h"
+#include "htcdc.h"
+
+#define KEYS 30000
+
+// long_encode(key, buf, len) encodes the key 7 into 2000 bytes and every
+//   other key like int_encode
+static int long_encode(const void *key, void *buf, int len) {
+  const int n = *(const int *)key == 7 ? 2000 : (int)sizeof(int);
+  if (len >= n) {
+    memset(buf, 0, n);
+    memcpy(buf, key, sizeof(int));
+  }
+  return n;
+}
+
+static void test_replicate(void) {
+  struct hashtable *primary =
+      ht_create(int_clone, int_hash, 12, int_compare, int_destroy, int_print);
+  struct hashtable *follower =
+      ht_create(int_clone, int_hash, 12, int_compare, int_destroy, int_print);
+  struct htcdc *feed = htcdc_create(primary, int_encode, 4096, 100);
+  for (int i = 0; i < 50; i++) {
+    ht_insert(primary, &i);
+    ht_insert(follower, &i);                        // the follower's snapshot
+  }
+  const uint64_t seq = htcdc_seq(feed);
+  CHECK(seq == 150);
+  struct htcdc_replicator *r =
+      htcdc_replicate(feed, follower, seq, int_decode, int_destroy);
+  for (int i = 50; i < KEYS; i++) {
+    ht_insert(primary, &i);
+    if (i % 3 == 0) {
+      const int k = i - 7;
+      ht_remove(primary, &k);
+    }
+  }
+  CHECK(htcdc_wait(r, htcdc_seq(feed)) == HT_SUCCESS);
+  CHECK(htcdc_applied(r) == htcdc_seq(feed));
+  CHECK(htcdc_stop(r) == HT_SUCCESS);
+  int wrong = 0;
+  for (int i = 0; i < KEYS; i++) {
+    wrong += ht_contains(primary, &i) != ht_contains(follower, &i);
+  }
+  CHECK(wrong == 0);
+  int a = 0;
+  int b = 0;
+  ht_foreach(primary, int_count, &a);
+  ht_foreach(follower, int_count, &b);
+  CHECK(a == b);
+  htcdc_destroy(feed);
+  ht_destroy(primary);
+  ht_destroy(follower);
+}
+
+static void test_long_key(void) {
+  struct hashtable *primary =
+      ht_create(int_clone, int_hash, 4, int_compare, int_destroy, int_print);
+  struct hashtable *follower =
+      ht_create(int_clone, int_hash, 4, int_compare, int_destroy, int_print);
+  struct htcdc *feed = htcdc_create(primary, long_encode, 4096, 0);
+  struct htcdc_replicator *r =
+      htcdc_replicate(feed, follower, 0, int_decode, int_destroy);
+  for (int i = 0; i < 5; i++) {
+    ht_insert(primary, &i);
+  }
+  CHECK(htcdc_wait(r, htcdc_seq(feed)) == HT_SUCCESS);
+  for (int i = 5; i < 100; i++) {
+    ht_insert(primary, &i);
+  }
+  CHECK(htcdc_wait(r, htcdc_seq(feed)) == HT_IO_ERROR);
+  CHECK(htcdc_stop(r) == HT_IO_ERROR);
+  htcdc_destroy(feed);
+  ht_destroy(primary);
+  ht_destroy(follower);
+}
+
+int main(void) {
+  test_replicate();
+  test_long_key();
+  return test_result("htcdc");
+}
@@ -0,0 +1,115 @@
+// This tests the background checkpointer of htcheckpoint.h: writer threads
+//   replace the whole content of the table while a checkpoint runs, and the
+//   snapshot must still show the table as it was when the checkpoint
+//   started. With a write-ahead log, the checkpoint plus the later records
+//   (after truncating the log up to htckpt_lsn) must recover the final
+//   table.
+
+#include "tests/test.h"
+#include <pthread.h>
+#include "htcheckpoint.h"
+
+#define THREADS 4
+#define KEYS 50000
+
+static struct htckpt *shared;
+
+// replace(arg) removes the keys of its quarter of 0..KEYS-1 and inserts
+//   them again shifted by KEYS
+static void *replace(void *arg) {
+  const int first = (int)(long)arg * (KEYS / THREADS);
+  for (int k = first; k < first + KEYS / THREADS; k++) {
+    const int moved = k + KEYS;
+    htckpt_remove(shared, &k);
+    htckpt_insert(shared, &moved);
+  }
+  return NULL;
+}
+
+// holds_range(ht, lo, n) returns true if ht holds exactly the keys
+//   lo..lo+n-1
+static bool holds_range(const struct hashtable *ht, int lo, int n) {
+  int count = 0;
+  ht_foreach(ht, int_count, &count);
+  for (int k = lo; k < lo + n; k++) {
+    if (!ht_contains(ht, &k)) {
+      return false;
+    }
+  }
+  return count == n;
+}
+
+// run_writers() runs the replace threads on shared and waits for them
+static void run_writers(void) {
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, replace, (void *)i);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+static void test_consistent_snapshot(void) {
+  struct hashtable *ht = ht_create(int_clone, int_hash, 12, int_compare,
+                                   int_destroy, int_print);
+  for (int k = 0; k < KEYS; k++) {
+    ht_insert(ht, &k);
+  }
+  shared = htckpt_create(ht, int_encode);
+  CHECK(htckpt_start(shared, test_path("ckpt"), NULL) == HT_SUCCESS);
+  run_writers();
+  CHECK(htckpt_wait(shared) == HT_SUCCESS);
+  CHECK(!htckpt_running(shared));
+
+  struct hashtable *r = ht_create(int_clone, int_hash, 12, int_compare,
+                                  int_destroy, int_print);
+  uint64_t lsn;
+  CHECK(ht_snapshot_load(r, test_path("ckpt"), &lsn, int_decode) == HT_SUCCESS);
+  CHECK(holds_range(r, 0, KEYS));
+  CHECK(holds_range(ht, KEYS, KEYS));
+  htckpt_destroy(shared);
+  ht_destroy(ht);
+  ht_destroy(r);
+}
+
+static void test_with_log(void) {
+  struct hashtable *ht = ht_create(int_clone, int_hash, 12, int_compare,
+                                   int_destroy, int_print);
+  struct htwal *wal = htwal_open(test_path("log"), int_encode, 100, 0);
+  htwal_attach(wal, ht);
+  shared = htckpt_create(ht, int_encode);
+  for (int k = 0; k < KEYS; k++) {
+    htckpt_insert(shared, &k);
+  }
+  CHECK(htckpt_lsn(shared) == 0);
+  CHECK(htckpt_start(shared, test_path("ckpt"), wal) == HT_SUCCESS);
+  run_writers();
+  CHECK(htckpt_wait(shared) == HT_SUCCESS);
+  CHECK(htckpt_lsn(shared) == KEYS);
+  CHECK(htwal_truncate(wal, htckpt_lsn(shared)) == HT_SUCCESS);
+  CHECK(htwal_sync(wal, htwal_lsn(wal)) == HT_SUCCESS);
+  htwal_detach(wal, ht);
+  htwal_close(wal);
+
+  struct hashtable *r = ht_create(int_clone, int_hash, 12, int_compare,
+                                  int_destroy, int_print);
+  uint64_t lsn;
+  CHECK(ht_recover(r, test_path("ckpt"), test_path("log"), int_decode,
+                   int_destroy, &lsn) == HT_SUCCESS);
+  CHECK(lsn == 3 * KEYS);
+  CHECK(holds_range(r, KEYS, KEYS));
+
+  // a checkpoint that cannot be written leaves htckpt_lsn unchanged
+  CHECK(htckpt_start(shared, test_path("missing/ckpt"), NULL) == HT_IO_ERROR);
+  CHECK(htckpt_lsn(shared) == KEYS);
+  htckpt_destroy(shared);
+  ht_destroy(ht);
+  ht_destroy(r);
+}
+
+int main(void) {
+  test_consistent_snapshot();
+  test_with_log();
+  return test_result("htcheckpoint");
+}
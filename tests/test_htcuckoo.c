@@ -0,0 +1,58 @@
+// This tests the cuckoo filter of htcuckoo.h: it follows its table through
+//   growth and removals without missing a stored key, its false positive
+//   rate is small, and an exported filter imports to an equal read-only
+//   filter (a truncated one is rejected).
+
+#include "tests/test.h"
+#include "htcuckoo.h"
+
+#define KEYS 60000
+#define ABSENT 200000
+
+int main(void) {
+  struct hashtable *ht =
+      ht_create(int_clone, int_hash, 12, int_compare, int_destroy, int_print);
+  for (int i = 0; i < 1000; i++) {
+    ht_insert(ht, &i);
+  }
+  struct htcuckoo *f = htcuckoo_create(ht, int_encode, 2000);
+  CHECK(htcuckoo_count(f) == 1000);
+  for (int i = 1000; i < KEYS; i++) {
+    ht_insert(ht, &i);                              // the filter grows
+  }
+  for (int i = 0; i < KEYS; i += 2) {
+    ht_remove(ht, &i);
+  }
+  CHECK(htcuckoo_count(f) == KEYS / 2);
+  int missed = 0;
+  int false_positives = 0;
+  for (int i = 0; i < KEYS; i++) {
+    if (i % 2) {
+      missed += !htcuckoo_contains(f, &i);
+    } else {
+      false_positives += htcuckoo_contains(f, &i);
+    }
+  }
+  for (int i = KEYS; i < KEYS + ABSENT; i++) {
+    false_positives += htcuckoo_contains(f, &i);
+  }
+  CHECK(missed == 0);
+  CHECK(false_positives < (KEYS / 2 + ABSENT) / 1000);
+
+  size_t len;
+  void *data = htcuckoo_export(f, &len);
+  CHECK(htcuckoo_import(data, len - 1, int_encode) == NULL);
+  struct htcuckoo *g = htcuckoo_import(data, len, int_encode);
+  CHECK(g != NULL);
+  CHECK(htcuckoo_count(g) == KEYS / 2);
+  int wrong = 0;
+  for (int i = 0; i < KEYS + 1000; i++) {
+    wrong += htcuckoo_contains(f, &i) != htcuckoo_contains(g, &i);
+  }
+  CHECK(wrong == 0);
+  free(data);
+  htcuckoo_destroy(g);
+  htcuckoo_destroy(f);
+  ht_destroy(ht);
+  return test_result("htcuckoo");
+}
@@ -0,0 +1,118 @@
+// This tests delta snapshots (htdirty.h and htsnapshot.h): a table changes
+//   randomly between snapshots, and its last full snapshot plus the chain
+//   of deltas (applied one by one, or compacted into one snapshot) must
+//   restore it exactly. Deltas applied out of order, a truncated delta and
+//   a delta that could not be written must not corrupt the chain.
+
+#include "tests/test.h"
+#include <fcntl.h>
+#include "htdirty.h"
+
+#define KEYS 20000
+#define DELTAS 5
+
+// new_table() returns a new empty table of int keys
+static struct hashtable *new_table(void) {
+  return ht_create(int_clone, int_hash, 8, int_compare, int_destroy, int_print);
+}
+
+// same_keys(a, b) returns true if a and b hold the same keys of 0..2*KEYS-1
+static bool same_keys(const struct hashtable *a, const struct hashtable *b) {
+  int count_a = 0;
+  int count_b = 0;
+  ht_foreach(a, int_count, &count_a);
+  ht_foreach(b, int_count, &count_b);
+  for (int k = 0; k < 2 * KEYS; k++) {
+    if (ht_contains(a, &k) != ht_contains(b, &k)) {
+      return false;
+    }
+  }
+  return count_a == count_b;
+}
+
+// change(ht, n) inserts or removes n random keys of ht
+static void change(struct hashtable *ht, int n) {
+  for (int i = 0; i < n; i++) {
+    const int k = rand() % (2 * KEYS);
+    if (ht_insert(ht, &k) == HT_ALREADY_STORED) {
+      ht_remove(ht, &k);
+    }
+  }
+}
+
+// delta_name(i) returns the path of the i-th delta
+static const char *delta_name(int i) {
+  char name[16];
+  snprintf(name, sizeof(name), "delta%d", i);
+  return test_path(name);
+}
+
+int main(void) {
+  srand(1);
+  struct hashtable *ht = new_table();
+  for (int k = 0; k < KEYS; k++) {
+    ht_insert(ht, &k);
+  }
+  CHECK(ht_snapshot_save(ht, test_path("base"), 1, int_encode) == HT_SUCCESS);
+  struct htdirty *d = htdirty_create(ht);
+  CHECK(htdirty_count(d) == 0);
+
+  char paths[DELTAS][512];
+  for (int i = 0; i < DELTAS; i++) {
+    change(ht, 100);
+    CHECK(htdirty_count(d) > 0 && htdirty_count(d) < ht_length(ht));
+    if (i == 2) {
+      // a delta that cannot be written keeps its buckets dirty
+      const int dirty = htdirty_count(d);
+      CHECK(htdirty_save_delta(d, test_path("missing/delta"), i + 1, i + 2,
+                               int_encode) == HT_IO_ERROR);
+      CHECK(htdirty_count(d) == dirty);
+      change(ht, 100);
+    }
+    snprintf(paths[i], sizeof(paths[i]), "%s", delta_name(i));
+    CHECK(htdirty_save_delta(d, paths[i], i + 1, i + 2, int_encode) == HT_SUCCESS);
+    CHECK(htdirty_count(d) == 0);
+  }
+
+  // the base and the chain of deltas
+  struct hashtable *r = new_table();
+  uint64_t lsn;
+  CHECK(ht_snapshot_load(r, test_path("base"), &lsn, int_decode) == HT_SUCCESS);
+  CHECK(ht_snapshot_apply_delta(r, paths[1], &lsn, int_decode) == HT_IO_ERROR);
+  for (int i = 0; i < DELTAS; i++) {
+    CHECK(ht_snapshot_apply_delta(r, paths[i], &lsn, int_decode) == HT_SUCCESS);
+  }
+  CHECK(lsn == DELTAS + 1);
+  CHECK(same_keys(r, ht));
+  ht_destroy(r);
+
+  // the compacted snapshot
+  const char *chain[DELTAS];
+  const char *reversed[DELTAS];
+  for (int i = 0; i < DELTAS; i++) {
+    chain[i] = paths[i];
+    reversed[i] = paths[DELTAS - 1 - i];
+  }
+  CHECK(ht_snapshot_compact(test_path("base"), reversed, DELTAS,
+                            test_path("bad")) == HT_IO_ERROR);
+  CHECK(ht_snapshot_compact(test_path("base"), chain, DELTAS,
+                            test_path("base")) == HT_SUCCESS);
+  r = new_table();
+  CHECK(ht_snapshot_load(r, test_path("base"), &lsn, int_decode) == HT_SUCCESS);
+  CHECK(lsn == DELTAS + 1);
+  CHECK(same_keys(r, ht));
+  ht_destroy(r);
+
+  // a truncated delta is rejected
+  change(ht, 100);
+  CHECK(htdirty_save_delta(d, test_path("next"), lsn, lsn + 1, int_encode) == HT_SUCCESS);
+  CHECK(truncate(test_path("next"), 40) == 0);
+  r = new_table();
+  CHECK(ht_snapshot_load(r, test_path("base"), &lsn, int_decode) == HT_SUCCESS);
+  CHECK(ht_snapshot_apply_delta(r, test_path("next"), &lsn, int_decode) == HT_IO_ERROR);
+  ht_destroy(r);
+
+  htdirty_destroy(d);
+  ht_destroy(ht);
+  return test_result("htdirty");
+}
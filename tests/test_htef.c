@@ -0,0 +1,124 @@
+// This tests the Elias-Fano sets of htef.h: membership, rank, select and
+//   ordered iteration of sets with sparse, full-range, dense, tiny and
+//   extreme keys, their size, and sets built from tables of htu64.h (both
+//   slots and bitsets).
+
+#include "tests/test.h"
+#include "htef.h"
+
+#define KEYS 50000
+
+// the keys a visit is expected to see, and the position of the next one
+struct visit_state {
+  const uint64_t *keys;
+  int next;
+};
+
+// visit(ctx, key) checks that key is the next expected key of *ctx (a
+//   struct visit_state)
+static void visit(void *ctx, uint64_t key) {
+  struct visit_state *state = (struct visit_state *)ctx;
+  CHECK(state->keys[state->next] == key);
+  state->next++;
+}
+
+// rnd() returns a pseudo-random number (xorshift64)
+static uint64_t rnd(void) {
+  static uint64_t s = 11;
+  s ^= s << 13;
+  s ^= s >> 7;
+  s ^= s << 17;
+  return s;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// check_set(keys, n, max_bits) sorts keys[0..n-1], drops duplicates and
+//   checks the set of the remaining keys, which may take at most max_bits
+//   bits per key
+static void check_set(uint64_t *keys, int n, double max_bits) {
+  qsort(keys, n, sizeof(keys[0]), compare_u64);
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    if (m == 0 || keys[m - 1] != keys[i]) {
+      keys[m++] = keys[i];
+    }
+  }
+  n = m;
+  struct htef *s = htef_create(keys, n);
+  CHECK(htef_count(s) == n);
+  int wrong = 0;
+  for (int i = 0; i < n; i++) {
+    const bool gap = i + 1 == n || keys[i + 1] != keys[i] + 1;
+    wrong += !htef_contains(s, keys[i]);
+    wrong += htef_select(s, i) != keys[i];
+    wrong += htef_rank(s, keys[i]) != i;
+    wrong += gap && htef_contains(s, keys[i] + 1);
+    wrong += htef_rank(s, keys[i] + 1) != i + 1;
+  }
+  CHECK(wrong == 0);
+  CHECK(n == 0 || keys[0] == 0 || !htef_contains(s, keys[0] - 1));
+  CHECK(!htef_contains(s, UINT64_MAX));
+  CHECK(n < 1000 || htef_size(s) * 8.0 / n <= max_bits);
+  struct visit_state state = {keys, 0};
+  htef_foreach(s, visit, &state);
+  CHECK(state.next == n);
+  htef_destroy(s);
+}
+
+// check_build(ht, limit, step) checks the set built from ht against ht for
+//   the multiples of step below limit and their successors
+static void check_build(struct hashtable_u64 *ht, uint64_t limit,
+                        uint64_t step) {
+  struct htef *s = htef_build(ht);
+  CHECK(htef_count(s) == ht_count_u64(ht));
+  int wrong = 0;
+  for (uint64_t k = 0; k < limit; k += step) {
+    wrong += htef_contains(s, k) != ht_contains_u64(ht, k);
+    wrong += htef_contains(s, k + 1) != ht_contains_u64(ht, k + 1);
+  }
+  CHECK(wrong == 0);
+  htef_destroy(s);
+}
+
+int main(void) {
+  static uint64_t keys[KEYS];
+  for (int i = 0; i < KEYS; i++) {
+    keys[i] = rnd() % (KEYS * 100ULL);
+  }
+  check_set(keys, KEYS, 2 + 7 + 2);                 // log2(100) < 7
+  for (int i = 0; i < KEYS; i++) {
+    keys[i] = rnd() >> 1;
+  }
+  check_set(keys, KEYS, 2 + 48 + 2);                // log2(2^63 / KEYS) < 48
+  for (int i = 0; i < KEYS; i++) {
+    keys[i] = 1000 + i;
+  }
+  check_set(keys, KEYS, 4);
+  keys[0] = 5;
+  check_set(keys, 1, 0);
+  check_set(keys, 0, 0);
+  keys[0] = 0;
+  keys[1] = UINT64_MAX - 1;
+  check_set(keys, 2, 0);
+
+  struct hashtable_u64 *ht = ht_create_u64(4);
+  for (int i = 0; i < KEYS; i++) {
+    ht_insert_u64(ht, rnd() % 200000 * 1000);
+  }
+  CHECK(!ht_dense_u64(ht));
+  check_build(ht, 200000 * 1000, 1000);
+  ht_destroy_u64(ht);
+  ht = ht_create_u64(4);
+  for (int i = 0; i < KEYS; i++) {
+    ht_insert_u64(ht, 5000 + i * 3);
+  }
+  CHECK(ht_dense_u64(ht));
+  check_build(ht, 5000 + KEYS * 3 + 100, 1);
+  ht_destroy_u64(ht);
+  return test_result("htef");
+}
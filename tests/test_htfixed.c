@@ -0,0 +1,100 @@
+// This tests the fixed-capacity tables of htfixed.h: random operations
+//   against a reference on a table that fills up (HTFIXED_FULL), and
+//   backward-shift deletion in a table whose keys collide.
+
+#include "tests/test.h"
+#include "htfixed.h"
+
+#define RANGE 400
+
+static inline uint64_t u64_hash(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return k;
+}
+
+// collide_hash(k) lets every key collide with every fourth key
+static inline uint32_t collide_hash(int k) {
+  return (uint32_t)k & 3;
+}
+
+#define EQUAL(a, b) ((a) == (b))
+
+HTFIXED_DEFINE(u64set, uint64_t, 8, u64_hash, EQUAL)
+HTFIXED_DEFINE(tiny, int, 3, collide_hash, EQUAL)
+
+// rnd() returns a pseudo-random number (xorshift64)
+static uint64_t rnd(void) {
+  static uint64_t s = 3;
+  s ^= s << 13;
+  s ^= s >> 7;
+  s ^= s << 17;
+  return s;
+}
+
+// visit(ctx, key) counts key in *ctx (an int)
+static void visit(void *ctx, int key) {
+  (void)key;
+  ++*(int *)ctx;
+}
+
+static void test_random(void) {
+  static struct u64set set;
+  static bool ref[RANGE];
+  u64set_init(&set);
+  int stored = 0;
+  int wrong = 0;
+  bool full = false;
+  for (int i = 0; i < 500000; i++) {
+    const uint64_t k = rnd() % RANGE;
+    const int op = rnd() % 4;                       // inserts fill the table
+    if (op < 2) {
+      const int result = u64set_insert(&set, k);
+      if (ref[k]) {
+        wrong += result != HT_ALREADY_STORED;
+      } else if (stored == u64set_CAPACITY) {
+        wrong += result != HTFIXED_FULL;
+        full = true;
+      } else {
+        wrong += result != HT_SUCCESS;
+        ref[k] = true;
+        stored++;
+      }
+    } else if (op == 2) {
+      wrong += u64set_remove(&set, k) != (ref[k] ? HT_SUCCESS : HT_NOT_STORED);
+      stored -= ref[k];
+      ref[k] = false;
+    } else {
+      wrong += u64set_contains(&set, k) != ref[k];
+    }
+  }
+  CHECK(wrong == 0);
+  CHECK(full);
+  CHECK(u64set_count(&set) == stored);
+}
+
+static void test_collisions(void) {
+  struct tiny t;
+  tiny_init(&t);
+  for (int i = 0; i < 8; i++) {
+    CHECK(tiny_insert(&t, i * 4 + 1) == HT_SUCCESS);  // all in one probe run
+  }
+  CHECK(tiny_insert(&t, 2) == HTFIXED_FULL);
+  CHECK(tiny_remove(&t, 5) == HT_SUCCESS);
+  CHECK(tiny_remove(&t, 1) == HT_SUCCESS);
+  for (int i = 2; i < 8; i++) {
+    CHECK(tiny_contains(&t, i * 4 + 1));
+  }
+  CHECK(!tiny_contains(&t, 1) && !tiny_contains(&t, 5));
+  CHECK(tiny_insert(&t, 2) == HT_SUCCESS);
+  int visited = 0;
+  tiny_foreach(&t, visit, &visited);
+  CHECK(visited == 7 && tiny_count(&t) == 7);
+}
+
+int main(void) {
+  test_random();
+  test_collisions();
+  return test_result("htfixed");
+}
@@ -0,0 +1,44 @@
+// This tests the HyperLogLog sketch of hthll.h: estimates of streams with
+//   duplicates stay within a few standard errors, merging sketches
+//   estimates the union, and hthll_hash_length sizes tables as documented.
+
+#include "tests/test.h"
+#include <math.h>
+#include "hthll.h"
+
+int main(void) {
+  static const int sizes[] = {10, 1000, 50000, 500000};
+  for (int t = 0; t < 4; t++) {
+    const int n = sizes[t];
+    struct hthll *a = hthll_create(int_hash, 14);
+    struct hthll *b = hthll_create(int_hash, 14);
+    for (int i = 0; i < n; i++) {
+      hthll_add(i % 2 ? a : b, &i);
+      const int dup = i / 2;                        // already added to a or b
+      hthll_add(a, &dup);
+    }
+    hthll_merge(a, b);
+    const double e = hthll_estimate(a);
+    CHECK(fabs(e - n) <= 0.03 * n + 1);             // about 4 standard errors
+    hthll_destroy(a);
+    hthll_destroy(b);
+  }
+
+  int keys[100];
+  const void *ptrs[100];
+  for (int i = 0; i < 100; i++) {
+    keys[i] = i % 10;
+    ptrs[i] = &keys[i];
+  }
+  struct hthll *s = hthll_create(int_hash, 4);
+  CHECK(hthll_estimate(s) == 0);
+  hthll_add_batch(s, ptrs, 100);
+  CHECK(fabs(hthll_estimate(s) - 10) < 1);
+  hthll_destroy(s);
+
+  CHECK(hthll_hash_length(0, 4) == 1);
+  CHECK(hthll_hash_length(4096, 4) == 10);
+  CHECK(hthll_hash_length(4097, 4) == 11);
+  CHECK(hthll_hash_length(1e12, 1) == 30);
+  return test_result("hthll");
+}
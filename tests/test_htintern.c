@@ -0,0 +1,62 @@
+// This tests the interning pool of htintern.h: equal keys get the same
+//   handle, tables of handles find keys by their handles, and a key stays
+//   in the pool exactly as long as some table or caller holds a reference.
+
+#include "tests/test.h"
+#include "hashtable.h"
+#include "htintern.h"
+
+#define KEYS 1000
+
+int main(void) {
+  struct htintern *pool =
+      htintern_create(int_clone, int_hash, 8, int_compare, int_destroy, int_print);
+  struct hashtable *a = ht_create(htintern_ref, htintern_hash, 6, htintern_compare,
+                                  htintern_release, htintern_print);
+  struct hashtable *b = ht_create(htintern_ref, htintern_hash, 6, htintern_compare,
+                                  htintern_release, htintern_print);
+  for (int i = 0; i < KEYS; i++) {
+    void *h = htintern_get(pool, &i);
+    ht_insert(a, h);
+    if (i % 2 == 0) {
+      ht_insert(b, h);
+    }
+    htintern_release(h);
+  }
+  CHECK(htintern_count(pool) == KEYS);
+
+  int wrong = 0;
+  for (int i = 0; i < KEYS; i++) {
+    void *h = htintern_get(pool, &i);
+    void *again = htintern_get(pool, &(int){i});
+    wrong += h != again;
+    wrong += *(const int *)htintern_key(h) != i;
+    wrong += !ht_contains(a, h);
+    wrong += ht_contains(b, h) != (i % 2 == 0);
+    wrong += ht_lookup(a, h) != h;
+    htintern_release(again);
+    htintern_release(h);
+  }
+  CHECK(wrong == 0);
+  CHECK(htintern_count(pool) == KEYS);
+
+  // the keys that are only in a leave the pool with their last reference
+  for (int i = 0; i < KEYS; i++) {
+    void *h = htintern_get(pool, &i);
+    ht_remove(a, h);
+    htintern_release(h);
+  }
+  CHECK(htintern_count(pool) == KEYS / 2);
+  const int key = 4;
+  void *h = htintern_get(pool, &key);
+  ht_remove(b, h);
+  CHECK(htintern_count(pool) == KEYS / 2);          // held by h
+  htintern_release(h);
+  CHECK(htintern_count(pool) == KEYS / 2 - 1);
+
+  ht_destroy(a);
+  ht_destroy(b);
+  CHECK(htintern_count(pool) == 0);
+  htintern_destroy(pool);
+  return test_result("htintern");
+}
@@ -0,0 +1,63 @@
+// This tests the Merkle digests of htmerkle.h: tables with the same keys
+//   inserted in different orders have equal digests, htmerkle_diff finds
+//   exactly the buckets of the keys that differ, and htmerkle_sync makes
+//   the tables equal again.
+
+#include "tests/test.h"
+#include "htmerkle.h"
+
+#define KEYS 20000
+
+int main(void) {
+  struct hashtable *a =
+      ht_create(int_clone, int_hash, 12, int_compare, int_destroy, int_print);
+  struct hashtable *b =
+      ht_create(int_clone, int_hash, 12, int_compare, int_destroy, int_print);
+  for (int i = 0; i < KEYS; i++) {
+    ht_insert(a, &i);
+  }
+  struct htmerkle *ma = htmerkle_create(a, int_encode);
+  struct htmerkle *mb = htmerkle_create(b, int_encode);
+  for (int i = KEYS - 1; i >= 0; i--) {
+    ht_insert(b, &i);                               // tracked incrementally
+  }
+  CHECK(htmerkle_node(ma, 1) == htmerkle_node(mb, 1));
+  CHECK(htmerkle_diff(ma, mb, NULL, 0) == 0);
+
+  // a removal, an insertion, and a key removed and inserted again
+  const int removed = 5;
+  const int added = KEYS + 12345;
+  const int again = 42;
+  ht_remove(b, &removed);
+  ht_insert(b, &added);
+  ht_remove(a, &again);
+  ht_insert(a, &again);
+  int x = ht_index(a, &removed);
+  int y = ht_index(a, &added);
+  if (x > y) {
+    const int t = x;
+    x = y;
+    y = t;
+  }
+  int buckets[4];
+  const int n = htmerkle_diff(ma, mb, buckets, 4);
+  CHECK(n == (x == y ? 1 : 2));
+  CHECK(buckets[0] == x && buckets[n - 1] == y);
+  CHECK(htmerkle_node(ma, 1) != htmerkle_node(mb, 1));
+  CHECK(htmerkle_diff(ma, mb, buckets, 1) == n);
+
+  CHECK(htmerkle_sync(ma, mb) == n);
+  CHECK(htmerkle_diff(ma, mb, NULL, 0) == 0);
+  CHECK(htmerkle_node(ma, 1) == htmerkle_node(mb, 1));
+  CHECK(ht_contains(b, &removed));
+  CHECK(!ht_contains(b, &added));
+  int count = 0;
+  ht_foreach(b, int_count, &count);
+  CHECK(count == KEYS);
+
+  htmerkle_destroy(ma);
+  htmerkle_destroy(mb);
+  ht_destroy(a);
+  ht_destroy(b);
+  return test_result("htmerkle");
+}
@@ -0,0 +1,80 @@
+// This tests the partitioning layer of htpartition.h: every key is found
+//   in the table of its partition, growing and shrinking move only the keys
+//   whose partition changes (about the expected fraction of them), and
+//   jump consistent hash spreads keys evenly.
+
+#include "tests/test.h"
+#include "htpartition.h"
+
+#define KEYS 20000
+#define TABLES 10
+
+// count(ht) returns the number of keys of ht
+static int count(struct hashtable *ht) {
+  int n = 0;
+  ht_foreach(ht, int_count, &n);
+  return n;
+}
+
+// check_partitions(p, n) checks that p has n partitions, each table only
+//   holds keys of its partition and all keys are stored
+static void check_partitions(struct htpart *p, int n) {
+  CHECK(htpart_count(p) == n);
+  int wrong = 0;
+  int total = 0;
+  for (int i = 0; i < KEYS; i++) {
+    const int part = htpart_of(p, &i);
+    wrong += !ht_contains(htpart_table(p, part), &i);
+  }
+  for (int i = 0; i < n; i++) {
+    total += count(htpart_table(p, i));
+  }
+  CHECK(wrong == 0);
+  CHECK(total == KEYS);
+}
+
+int main(void) {
+  int jumps[8] = {0};
+  for (uint64_t k = 0; k < 80000; k++) {
+    jumps[htpart_jump(k * 0x9e3779b97f4a7c15ULL, 8)]++;
+  }
+  for (int i = 0; i < 8; i++) {
+    CHECK(jumps[i] > 9000 && jumps[i] < 11000);
+  }
+  CHECK(htpart_jump(12345, 1) == 0);
+
+  struct hashtable *tables[TABLES];
+  for (int i = 0; i < TABLES; i++) {
+    tables[i] =
+        ht_create(int_clone, int_hash, 10, int_compare, int_destroy, int_print);
+  }
+  struct htpart *p = htpart_create(tables, 4, int_encode);
+  for (int i = 0; i < KEYS; i++) {
+    CHECK(htpart_insert(p, &i) == HT_SUCCESS);
+  }
+  CHECK(htpart_insert(p, &(int){3}) == HT_ALREADY_STORED);
+  check_partitions(p, 4);
+
+  // 4 -> 5 moves about a fifth of the keys, 5 -> 10 about half of them
+  int moved = htpart_resize(p, tables, 5);
+  CHECK(moved > KEYS / 5 * 9 / 10 && moved < KEYS / 5 * 11 / 10);
+  check_partitions(p, 5);
+  moved = htpart_resize(p, tables, 10);
+  CHECK(moved > KEYS / 2 * 9 / 10 && moved < KEYS / 2 * 11 / 10);
+  check_partitions(p, 10);
+
+  htpart_resize(p, tables, 3);
+  check_partitions(p, 3);
+  for (int i = 3; i < TABLES; i++) {
+    CHECK(count(tables[i]) == 0);
+  }
+
+  CHECK(htpart_remove(p, &(int){3}) == HT_SUCCESS);
+  CHECK(!htpart_contains(p, &(int){3}));
+  CHECK(htpart_remove(p, &(int){3}) == HT_NOT_STORED);
+  htpart_destroy(p);
+  for (int i = 0; i < TABLES; i++) {
+    ht_destroy(tables[i]);
+  }
+  return test_result("htpartition");
+}
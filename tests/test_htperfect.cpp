@@ -0,0 +1,60 @@
+// This tests the compile-time perfect-hash sets of htperfect.hpp: lookups
+//   are checked at compile time (static_assert) and at run time, on a small
+//   and a larger set of keys and on the empty set.
+
+#include "tests/test.h"
+#include <string>
+#include "htperfect.hpp"
+
+namespace {
+
+enum Method { GET, PUT, POST, DELETE, HEAD, OPTIONS, PATCH, TRACE, CONNECT };
+
+constexpr const char *method_names[] = {"GET",     "PUT",   "POST",
+                                        "DELETE",  "HEAD",  "OPTIONS",
+                                        "PATCH",   "TRACE", "CONNECT"};
+
+constexpr auto methods = ht::make_perfect_set(
+    "GET", "PUT", "POST", "DELETE", "HEAD", "OPTIONS", "PATCH", "TRACE",
+    "CONNECT");
+static_assert(methods.size() == 9);
+static_assert(methods.index("POST") == POST);
+static_assert(methods.index("CONNECT") == CONNECT);
+static_assert(!methods.contains("get"));
+static_assert(!methods.contains(""));
+static_assert(!methods.contains("GETS"));
+
+constexpr auto none = ht::make_perfect_set();
+static_assert(none.size() == 0 && !none.contains("x"));
+
+#define KW(n) "kw" #n
+constexpr auto keywords = ht::make_perfect_set(
+    "auto", "break", "case", "char", "const", "continue", "default", "do",
+    "double", "else", "enum", "extern", "float", "for", "goto", "if",
+    "inline", "int", "long", "register", "restrict", "return", "short",
+    "signed", "sizeof", "static", "struct", "switch", "typedef", "union",
+    "unsigned", "void", "volatile", "while", KW(0), KW(1), KW(2), KW(3),
+    KW(4), KW(5), KW(6), KW(7), KW(8), KW(9), KW(10), KW(11), KW(12),
+    KW(13), KW(14), KW(15), KW(16), KW(17), KW(18), KW(19), KW(20), KW(21),
+    KW(22), KW(23), KW(24), KW(25), KW(26), KW(27), KW(28), KW(29));
+#undef KW
+static_assert(keywords.index("while") == 33);
+static_assert(keywords.index("kw29") == 63);
+
+}  // namespace
+
+int main() {
+  for (int i = 0; i < 9; i++) {
+    CHECK(methods.index(method_names[i]) == i);
+  }
+  int wrong = 0;
+  for (int i = 0; i < 100000; i++) {
+    const std::string key = "x" + std::to_string(i);
+    wrong += keywords.contains(key) || methods.contains(key);
+  }
+  for (int i = 0; i < 30; i++) {
+    wrong += keywords.index("kw" + std::to_string(i)) != 34 + i;
+  }
+  CHECK(wrong == 0);
+  return test_result("htperfect");
+}
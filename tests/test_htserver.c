@@ -0,0 +1,248 @@
+// This tests htserver (see htserver.h) over its socket: it starts the
+//   server binary named by the environment variable HTSERVER (default
+//   build/htserver), pipelines many requests and checks every response,
+//   including requests that end with a half-close of the connection, reads
+//   of tables that do not exist (which must not create them) and bad
+//   requests. It also replicates a change feed (see htcdc.h) to the server.
+
+#include "tests/test.h"
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "hashtable.h"
+#include "htcdc.h"
+#include "htserver.h"
+
+#define SINGLES 20000
+
+static unsigned char requests[1 << 20];
+static size_t requests_len;
+static unsigned char responses[1 << 20];
+
+// add_request(id, op, name, count, first) appends a request with the keys
+//   key-first .. key-(first+count-1) to requests
+static void add_request(uint32_t id, int op, const char *name, int count,
+                        int first) {
+  const size_t start = requests_len;
+  const uint16_t n = count;
+  requests_len += sizeof(uint32_t);
+  memcpy(requests + requests_len, &id, sizeof(id));
+  requests[requests_len + 4] = op;
+  requests[requests_len + 5] = strlen(name);
+  memcpy(requests + requests_len + 6, &n, sizeof(n));
+  requests_len += 8;
+  memcpy(requests + requests_len, name, strlen(name));
+  requests_len += strlen(name);
+  for (int i = 0; i < count; i++) {
+    char key[32];
+    const uint32_t len = snprintf(key, sizeof(key), "key-%d", first + i);
+    memcpy(requests + requests_len, &len, sizeof(len));
+    memcpy(requests + requests_len + 4, key, len);
+    requests_len += 4 + len;
+  }
+  const uint32_t body_len = requests_len - start - 4;
+  memcpy(requests + start, &body_len, sizeof(body_len));
+}
+
+// connect_to(path) returns a socket connected to the server at path, or -1
+static int connect_to(const char *path) {
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// exchange(fd, half_close, n) sends requests (and shuts down the sending
+//   side if half_close is true), reads the n responses into responses and
+//   returns their total length, or 0 if the connection ends early
+static size_t exchange(int fd, bool half_close, int n) {
+  for (size_t off = 0; off < requests_len;) {
+    const ssize_t w = write(fd, requests + off, requests_len - off);
+    if (w <= 0) {
+      return 0;
+    }
+    off += w;
+  }
+  if (half_close) {
+    shutdown(fd, SHUT_WR);
+  }
+  size_t len = 0;
+  size_t pos = 0;
+  for (int seen = 0; seen < n;) {
+    const ssize_t r = read(fd, responses + len, sizeof(responses) - len);
+    if (r <= 0) {
+      return 0;
+    }
+    len += r;
+    while (seen < n && len - pos >= 4) {
+      uint32_t body_len;
+      memcpy(&body_len, responses + pos, sizeof(body_len));
+      if (len - pos < 4 + body_len) {
+        break;
+      }
+      pos += 4 + body_len;
+      seen++;
+    }
+  }
+  requests_len = 0;
+  return len;
+}
+
+// response(i, id, status, count) returns the results of the i-th response
+//   in responses and stores its id, status and count
+static const unsigned char *response(int i, uint32_t *id, int *status,
+                                     int *count) {
+  size_t pos = 0;
+  for (;; i--) {
+    uint32_t body_len;
+    memcpy(&body_len, responses + pos, sizeof(body_len));
+    if (i == 0) {
+      uint16_t n;
+      memcpy(id, responses + pos + 4, sizeof(*id));
+      memcpy(&n, responses + pos + 10, sizeof(n));
+      *status = responses[pos + 8];
+      *count = n;
+      return responses + pos + HTS_HEADER_LEN;
+    }
+    pos += 4 + body_len;
+  }
+}
+
+// count_of(i) returns the count of the HTS_OP_COUNT response i
+static uint32_t count_of(int i) {
+  uint32_t id;
+  int status;
+  int count;
+  uint32_t value;
+  memcpy(&value, response(i, &id, &status, &count), sizeof(value));
+  return value;
+}
+
+static void test_pipelining(const char *socket_path) {
+  const int fd = connect_to(socket_path);
+  CHECK(fd >= 0);
+  for (int i = 0; i < SINGLES; i++) {
+    add_request(i, HTS_OP_INSERT, "t1", 1, i);
+  }
+  add_request(SINGLES, HTS_OP_INSERT, "t1", 1000, SINGLES - 500);
+  add_request(SINGLES + 1, HTS_OP_CONTAINS, "t1", 2, SINGLES - 1);
+  add_request(SINGLES + 2, HTS_OP_REMOVE, "t1", 3, 0);
+  add_request(SINGLES + 3, HTS_OP_COUNT, "t1", 0, 0);
+  add_request(SINGLES + 4, 99, "t1", 0, 0);
+  CHECK(exchange(fd, false, SINGLES + 5) > 0);
+
+  int wrong = 0;
+  for (int i = 0; i < SINGLES + 5; i++) {
+    uint32_t id;
+    int status;
+    int count;
+    const unsigned char *results = response(i, &id, &status, &count);
+    wrong += id != (uint32_t)i;
+    if (i < SINGLES) {
+      wrong += status != HTS_OK || count != 1 || results[0] != HT_SUCCESS;
+    } else if (i == SINGLES) {
+      int stored = 0;
+      for (int k = 0; k < count; k++) {
+        stored += results[k] == HT_ALREADY_STORED;
+      }
+      wrong += count != 1000 || stored != 500;
+    } else if (i == SINGLES + 1) {
+      wrong += count != 2 || results[0] != 1 || results[1] != 1;
+    } else if (i == SINGLES + 2) {
+      wrong += count != 3 || results[0] != HT_SUCCESS;
+    } else if (i == SINGLES + 3) {
+      wrong += count != 4 || count_of(i) != SINGLES + 500 - 3;
+    } else {
+      wrong += status != HTS_BAD_REQUEST;
+    }
+  }
+  CHECK(wrong == 0);
+  close(fd);
+}
+
+static void test_half_close(const char *socket_path) {
+  const int fd = connect_to(socket_path);
+  for (int i = 0; i < 1000; i++) {
+    add_request(i, HTS_OP_CONTAINS, "t1", 50, i * 50);
+  }
+  add_request(1000, HTS_OP_COUNT, "missing", 0, 0);
+  add_request(1001, HTS_OP_CONTAINS, "missing", 2, 0);
+  add_request(1002, HTS_OP_REMOVE, "missing", 2, 0);
+  CHECK(exchange(fd, true, 1003) > 0);
+  CHECK(count_of(1000) == 0);
+  uint32_t id;
+  int status;
+  int count;
+  const unsigned char *results = response(1001, &id, &status, &count);
+  CHECK(count == 2 && results[0] == 0 && results[1] == 0);
+  results = response(1002, &id, &status, &count);
+  CHECK(count == 2 && results[0] == HT_NOT_STORED && results[1] == HT_NOT_STORED);
+  char c;
+  CHECK(read(fd, &c, 1) == 0);                      // closed after the responses
+  close(fd);
+
+  // the reads did not create the table, so an insertion creates it now
+  const int fd2 = connect_to(socket_path);
+  add_request(0, HTS_OP_INSERT, "missing", 1, 0);
+  add_request(1, HTS_OP_COUNT, "missing", 0, 0);
+  CHECK(exchange(fd2, true, 2) > 0);
+  CHECK(count_of(1) == 1);
+  close(fd2);
+}
+
+static void test_replicate_socket(const char *socket_path) {
+  struct hashtable *ht =
+      ht_create(int_clone, int_hash, 10, int_compare, int_destroy, int_print);
+  struct htcdc *feed = htcdc_create(ht, int_encode, 4096, 0);
+  struct htcdc_replicator *r =
+      htcdc_replicate_socket(feed, socket_path, "replica", 0);
+  CHECK(r != NULL);
+  for (int i = 0; i < 5000; i++) {
+    ht_insert(ht, &i);
+  }
+  for (int i = 0; i < 1000; i++) {
+    ht_remove(ht, &i);
+  }
+  CHECK(htcdc_wait(r, htcdc_seq(feed)) == HT_SUCCESS);
+  CHECK(htcdc_stop(r) == HT_SUCCESS);
+  htcdc_destroy(feed);
+  ht_destroy(ht);
+
+  const int fd = connect_to(socket_path);
+  add_request(0, HTS_OP_COUNT, "replica", 0, 0);
+  CHECK(exchange(fd, true, 1) > 0);
+  CHECK(count_of(0) == 4000);
+  close(fd);
+}
+
+int main(void) {
+  const char *server = getenv("HTSERVER");
+  char socket_path[512];
+  snprintf(socket_path, sizeof(socket_path), "%s", test_path("socket"));
+  const pid_t pid = fork();
+  if (pid == 0) {
+    execl(server ? server : "build/htserver", "htserver", socket_path, (char *)NULL);
+    perror("execl");
+    _exit(127);
+  }
+  for (int i = 0; i < 200 && access(socket_path, F_OK) != 0; i++) {
+    const struct timespec pause = {0, 10000000};
+    nanosleep(&pause, NULL);
+  }
+  test_pipelining(socket_path);
+  test_half_close(socket_path);
+  test_replicate_socket(socket_path);
+  kill(pid, SIGTERM);
+  int status;
+  waitpid(pid, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  return test_result("htserver");
+}
@@ -0,0 +1,61 @@
+// This tests the string table of htstr.h: insertion, removal and lookup of
+//   many keys (so the table grows and its arena is compacted), keys that
+//   are prefixes of each other or contain NUL bytes, and the empty key.
+
+#include "tests/test.h"
+#include "htstr.h"
+
+#define KEYS 50000
+
+// visit(ctx, key, len) checks that key is NUL-terminated and counts it in
+//   *ctx (an int)
+static void visit(void *ctx, const char *key, size_t len) {
+  CHECK(key[len] == '\0');
+  ++*(int *)ctx;
+}
+
+int main(void) {
+  struct hashtable_str *ht = ht_create_str(1);
+  char buf[32];
+  int wrong = 0;
+  for (int i = 0; i < KEYS; i++) {
+    const int len = snprintf(buf, sizeof(buf), "key-%d", i);
+    wrong += ht_insert_str(ht, buf, len) != HT_SUCCESS;
+  }
+  for (int i = 0; i < KEYS; i++) {
+    const int len = snprintf(buf, sizeof(buf), "key-%d", i);
+    wrong += ht_insert_str(ht, buf, len) != HT_ALREADY_STORED;
+  }
+  // removing three quarters of the keys compacts the arena
+  for (int i = 0; i < KEYS; i++) {
+    const int len = snprintf(buf, sizeof(buf), "key-%d", i);
+    if (i % 4) {
+      wrong += ht_remove_str(ht, buf, len) != HT_SUCCESS;
+    }
+  }
+  for (int i = 0; i < KEYS; i++) {
+    const int len = snprintf(buf, sizeof(buf), "key-%d", i);
+    const char *copy = ht_lookup_str(ht, buf, len);
+    wrong += ht_contains_str(ht, buf, len) != (i % 4 == 0);
+    wrong += i % 4 ? copy != NULL : copy == NULL || strcmp(copy, buf) != 0;
+    wrong += i % 4 && ht_remove_str(ht, buf, len) != HT_NOT_STORED;
+  }
+  CHECK(wrong == 0);
+  CHECK(ht_count_str(ht) == KEYS / 4);
+
+  CHECK(!ht_contains_str(ht, "key-4", 4));          // a prefix of a key
+  CHECK(ht_contains_str(ht, "key-4xyz", 5));
+  CHECK(ht_insert_str(ht, "a\0b", 3) == HT_SUCCESS);
+  CHECK(!ht_contains_str(ht, "a", 1));
+  CHECK(ht_contains_str(ht, "a\0b", 3));
+  CHECK(memcmp(ht_lookup_str(ht, "a\0b", 3), "a\0b", 4) == 0);
+  CHECK(ht_insert_str(ht, "", 0) == HT_SUCCESS);
+  CHECK(ht_contains_str(ht, "", 0));
+  int visited = 0;
+  ht_foreach_str(ht, visit, &visited);
+  CHECK(visited == KEYS / 4 + 2);
+  CHECK(ht_remove_str(ht, "", 0) == HT_SUCCESS);
+  CHECK(ht_count_str(ht) == KEYS / 4 + 1);
+  ht_destroy_str(ht);
+  return test_result("htstr");
+}
@@ -0,0 +1,70 @@
+// This tests the tiered storage of httier.h against a reference set: random
+//   insertions, removals and lookups over a key range several times larger
+//   than the resident limit must give the same results as an in-memory
+//   set, while the resident keys stay close to the limit; loading all
+//   buckets back must restore exactly the reference keys.
+
+#include "tests/test.h"
+#include "httier.h"
+
+#define KEYS 50000
+#define RANGE 150000
+#define MAX_RESIDENT 10000
+#define OPERATIONS 150000
+
+static bool reference[RANGE];
+
+int main(void) {
+  struct hashtable *ht = ht_create(int_clone, int_hash, 12, int_compare,
+                                   int_destroy, int_print);
+  for (int k = 0; k < KEYS; k++) {
+    ht_insert(ht, &k);
+    reference[k] = true;
+  }
+  struct httier *t = httier_create(ht, test_path("segment"), MAX_RESIDENT,
+                                   int_encode, int_decode);
+  CHECK(t != NULL);
+  CHECK(httier_count(t) == KEYS);
+  CHECK(httier_resident(t) <= MAX_RESIDENT);
+  CHECK(httier_spilled(t) > 0);
+
+  int wrong = 0;
+  int over_limit = 0;
+  unsigned int seed = 1;
+  for (int i = 0; i < OPERATIONS; i++) {
+    seed = seed * 1103515245 + 12345;
+    const int k = (seed >> 8) % RANGE;
+    switch ((seed >> 3) % 3) {
+    case 0:
+      wrong += httier_insert(t, &k) != (reference[k] ? HT_ALREADY_STORED : HT_SUCCESS);
+      reference[k] = true;
+      break;
+    case 1:
+      wrong += httier_remove(t, &k) != (reference[k] ? HT_SUCCESS : HT_NOT_STORED);
+      reference[k] = false;
+      break;
+    default:
+      wrong += httier_contains(t, &k) != (reference[k] ? HT_ALREADY_STORED : HT_NOT_STORED);
+    }
+    // a bucket that is faulted in may exceed the limit until the next spill
+    over_limit += httier_resident(t) > MAX_RESIDENT + 200;
+  }
+  CHECK(wrong == 0);
+  CHECK(over_limit == 0);
+
+  int stored = 0;
+  for (int k = 0; k < RANGE; k++) {
+    stored += reference[k];
+  }
+  CHECK(httier_count(t) == stored);
+  CHECK(httier_load_all(t) == HT_SUCCESS);
+  CHECK(httier_spilled(t) == 0);
+  wrong = 0;
+  for (int k = 0; k < RANGE; k++) {
+    wrong += ht_contains(ht, &k) != reference[k];
+  }
+  CHECK(wrong == 0);
+  httier_destroy(t);
+  ht_destroy(ht);
+  return test_result("httier");
+}
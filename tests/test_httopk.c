@@ -0,0 +1,50 @@
+// This tests the top-k tracker of httopk.h on a skewed stream: 20 hot keys
+//   get 30% of the counts; they must be the listed candidates, and no
+//   estimate may be below the true count.
+
+#include "tests/test.h"
+#include "httopk.h"
+
+#define KEYS 100000
+#define STREAM 500000
+
+int main(void) {
+  static long truth[KEYS];
+  struct httopk *t = httopk_create(int_clone, int_hash, int_compare,
+                                   int_destroy, int_print, 20, 1 << 12, 4);
+  unsigned int seed = 7;
+  for (int i = 0; i < STREAM; i++) {
+    seed = seed * 1103515245 + 12345;
+    const unsigned int r = (seed >> 8) % 1000;
+    int k = r % 20;
+    if (r >= 300) {
+      seed = seed * 1103515245 + 12345;
+      k = 20 + (seed >> 4) % (KEYS - 20);
+    }
+    httopk_add(t, &k, 1);
+    truth[k]++;
+  }
+  const int hot = 5;
+  CHECK(httopk_add(t, &hot, 10) == httopk_estimate(t, &hot));
+  truth[hot] += 10;
+
+  const void *keys[20];
+  long counts[20];
+  const int n = httopk_list(t, keys, counts, 20);
+  CHECK(n == 20);
+  int wrong = 0;
+  for (int i = 0; i < n; i++) {
+    const int k = *(const int *)keys[i];
+    wrong += k >= 20;
+    wrong += counts[i] < truth[k];
+    wrong += i > 0 && counts[i] > counts[i - 1];
+  }
+  CHECK(wrong == 0);
+  CHECK(httopk_list(t, keys, counts, 3) == 3);
+  for (int k = 0; k < KEYS; k += 97) {
+    wrong += httopk_estimate(t, &k) < truth[k];
+  }
+  CHECK(wrong == 0);
+  httopk_destroy(t);
+  return test_result("httopk");
+}
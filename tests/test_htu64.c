@@ -0,0 +1,122 @@
+// This tests the table of 64-bit keys of htu64.h: random operations
+//   against a reference in phases that make the keys dense, sparse and
+//   dense again, so the table switches between slots and a bitset;
+//   ranks, probe lengths, the batch functions and keys at the ends of the
+//   range.
+
+#include "tests/test.h"
+#include "htu64.h"
+
+#define RANGE (1 << 21)
+#define OPS 300000
+
+static const uint64_t base = 1000000000000ULL;
+static bool ref[RANGE];
+
+// rnd() returns a pseudo-random number (xorshift64)
+static uint64_t rnd(void) {
+  static uint64_t s = 7;
+  s ^= s << 13;
+  s ^= s >> 7;
+  s ^= s << 17;
+  return s;
+}
+
+// visit(ctx, key) checks that key is in the reference and counts it in
+//   *ctx (an int)
+static void visit(void *ctx, uint64_t key) {
+  CHECK(key >= base && ref[key - base]);
+  ++*(int *)ctx;
+}
+
+static void test_random(void) {
+  struct hashtable_u64 *ht = ht_create_u64(3);
+  int stored = 0;
+  int switches = 0;
+  bool dense = false;
+  int wrong = 0;
+  for (int i = 0; i < OPS; i++) {
+    // phase 0 fills a small range (a bitset), phase 1 empties it and spreads
+    //   a few keys over the whole range (slots), and phase 2 fills the whole
+    //   range (a bitset again); lookups are mixed in everywhere
+    const int phase = i / (OPS / 3);
+    const int op = rnd() % 10;
+    uint64_t k = rnd() % (phase == 2 || (phase == 1 && op == 0) ? RANGE : 20000);
+    if (op < 3) {
+      wrong += ht_contains_u64(ht, base + k) != ref[k];
+      wrong += ht_probes_u64(ht, base + k) < 1;
+    } else if (phase == 1 ? op == 0 : op < 8) {
+      wrong += ht_insert_u64(ht, base + k) !=
+               (ref[k] ? HT_ALREADY_STORED : HT_SUCCESS);
+      stored += !ref[k];
+      ref[k] = true;
+    } else {
+      if (phase == 1) {
+        k = rnd() % 20000;
+      }
+      wrong += ht_remove_u64(ht, base + k) !=
+               (ref[k] ? HT_SUCCESS : HT_NOT_STORED);
+      stored -= ref[k];
+      ref[k] = false;
+    }
+    if (ht_dense_u64(ht) != dense) {
+      dense = !dense;
+      switches++;
+    }
+    if (i % 50000 == 0) {
+      const uint64_t q = rnd() % 200000;
+      int rank = 0;
+      for (uint64_t j = 0; j < q; j++) {
+        rank += ref[j];
+      }
+      wrong += ht_rank_u64(ht, base + q) != rank;
+    }
+  }
+  CHECK(wrong == 0);
+  CHECK(switches >= 3);
+  CHECK(ht_count_u64(ht) == stored);
+  int visited = 0;
+  ht_foreach_u64(ht, visit, &visited);
+  CHECK(visited == stored);
+  ht_destroy_u64(ht);
+}
+
+static void test_batch(void) {
+  struct hashtable_u64 *ht = ht_create_u64(1);
+  uint64_t keys[300];
+  int results[300];
+  bool found[300];
+  for (int i = 0; i < 300; i++) {
+    keys[i] = HTU64_EMPTY_KEY - 1 - i;              // the largest keys
+  }
+  ht_insert_batch_u64(ht, keys, 300, results);
+  int wrong = 0;
+  for (int i = 0; i < 300; i++) {
+    wrong += results[i] != HT_SUCCESS;
+  }
+  CHECK(ht_dense_u64(ht));
+  ht_contains_batch_u64(ht, keys, 300, found);
+  for (int i = 0; i < 300; i++) {
+    wrong += !found[i];
+  }
+  CHECK(ht_probes_u64(ht, keys[0]) == 1);
+  CHECK(ht_insert_u64(ht, 0) == HT_SUCCESS);        // spans the whole range
+  CHECK(!ht_dense_u64(ht));
+  CHECK(ht_rank_u64(ht, HTU64_EMPTY_KEY - 100) == 1 + 300 - 100);
+  ht_remove_batch_u64(ht, keys, 300, results);
+  for (int i = 0; i < 300; i++) {
+    wrong += results[i] != HT_SUCCESS;
+  }
+  ht_remove_batch_u64(ht, keys, 1, results);
+  wrong += results[0] != HT_NOT_STORED;
+  CHECK(wrong == 0);
+  CHECK(ht_count_u64(ht) == 1);
+  CHECK(ht_contains_u64(ht, 0));
+  ht_destroy_u64(ht);
+}
+
+int main(void) {
+  test_random();
+  test_batch();
+  return test_result("htu64");
+}
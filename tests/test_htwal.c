@@ -0,0 +1,181 @@
+// This tests the write-ahead log of htwal.h and ht_recover: a writer
+//   process that logs, snapshots and truncates is killed at random points,
+//   and recovery must bring back every key whose record was synced (and
+//   nothing that was never inserted). It also checks a torn log tail, the
+//   detection of a log that does not continue the snapshot (HT_LOG_GAP),
+//   and that a file that is not a log is left untouched.
+
+#include "tests/test.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "htwal.h"
+
+// new_table() returns a new empty table of int keys
+static struct hashtable *new_table(void) {
+  return ht_create(int_clone, int_hash, 8, int_compare, int_destroy, int_print);
+}
+
+// count(ht) returns the number of keys of ht
+static int count(const struct hashtable *ht) {
+  int n = 0;
+  ht_foreach(ht, int_count, &n);
+  return n;
+}
+
+// holds_prefix(ht, n) returns true if ht holds exactly the keys 0..n-1
+static bool holds_prefix(const struct hashtable *ht, int n) {
+  for (int k = 0; k < n; k++) {
+    if (!ht_contains(ht, &k)) {
+      return false;
+    }
+  }
+  return count(ht) == n;
+}
+
+// write_until_killed(start_lsn, synced) recovers the table, inserts the
+//   next keys with the log attached and publishes the LSN of every sync in
+//   *synced; from time to time it saves a snapshot and truncates the log
+static void write_until_killed(uint64_t start_lsn, volatile uint64_t *synced) {
+  struct hashtable *ht = new_table();
+  uint64_t lsn = 0;
+  if (ht_recover(ht, test_path("snap"), test_path("log"), int_decode,
+                 int_destroy, &lsn) != HT_SUCCESS || lsn != start_lsn) {
+    _exit(1);
+  }
+  struct htwal *wal = htwal_open(test_path("log"), int_encode, 100, lsn);
+  htwal_attach(wal, ht);
+  for (int k = (int)lsn;; k++) {
+    ht_insert(ht, &k);                              // the record of k has LSN k + 1
+    if (k % 100 == 99) {
+      if (htwal_sync(wal, htwal_lsn(wal)) != HT_SUCCESS) {
+        _exit(1);
+      }
+      *synced = htwal_lsn(wal);
+    }
+    if (k % 5000 == 4999) {
+      const uint64_t snap = htwal_lsn(wal);
+      if (ht_snapshot_save(ht, test_path("snap"), snap, int_encode) != HT_SUCCESS ||
+          htwal_truncate(wal, snap) != HT_SUCCESS) {
+        _exit(1);
+      }
+    }
+  }
+}
+
+static void test_crash_recovery(void) {
+  volatile uint64_t *synced = mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  unlink(test_path("log"));                         // creates the directory before the fork
+  uint64_t lsn = 0;
+  for (int round = 0; round < 10; round++) {
+    *synced = 0;
+    const pid_t child = fork();
+    if (child == 0) {
+      write_until_killed(lsn, synced);
+    }
+    const struct timespec pause = {0, 20000000 + 7000000 * round};
+    nanosleep(&pause, NULL);
+    kill(child, SIGKILL);
+    int status;
+    waitpid(child, &status, 0);
+    CHECK(WIFSIGNALED(status));
+
+    struct hashtable *ht = new_table();
+    CHECK(ht_recover(ht, test_path("snap"), test_path("log"), int_decode,
+                     int_destroy, &lsn) == HT_SUCCESS);
+    CHECK(lsn >= *synced);
+    CHECK(holds_prefix(ht, (int)lsn));
+    ht_destroy(ht);
+  }
+  CHECK(lsn > 0);
+  munmap((void *)synced, sizeof(uint64_t));
+}
+
+static void test_torn_tail(void) {
+  unlink(test_path("log"));
+  struct hashtable *ht = new_table();
+  struct htwal *wal = htwal_open(test_path("log"), int_encode, 0, 0);
+  htwal_attach(wal, ht);
+  for (int k = 0; k < 10; k++) {
+    ht_insert(ht, &k);
+  }
+  CHECK(htwal_sync(wal, htwal_lsn(wal)) == HT_SUCCESS);
+  htwal_detach(wal, ht);
+  htwal_close(wal);
+
+  // a record that was cut off by a crash
+  const int fd = open(test_path("log"), O_WRONLY | O_APPEND);
+  CHECK(write(fd, "\x20\0\0\0torn", 8) == 8);
+  close(fd);
+
+  struct hashtable *r = new_table();
+  uint64_t lsn = 0;
+  CHECK(ht_recover(r, test_path("none"), test_path("log"), int_decode,
+                   int_destroy, &lsn) == HT_SUCCESS);
+  CHECK(lsn == 10 && holds_prefix(r, 10));
+
+  // reopening discards the torn record, so new records follow LSN 10
+  wal = htwal_open(test_path("log"), int_encode, 0, lsn);
+  CHECK(wal && htwal_lsn(wal) == 10);
+  htwal_attach(wal, r);
+  const int k = 10;
+  ht_insert(r, &k);
+  CHECK(htwal_sync(wal, htwal_lsn(wal)) == HT_SUCCESS);
+  htwal_detach(wal, r);
+  htwal_close(wal);
+  struct hashtable *r2 = new_table();
+  CHECK(ht_recover(r2, test_path("none"), test_path("log"), int_decode,
+                   int_destroy, &lsn) == HT_SUCCESS);
+  CHECK(lsn == 11 && holds_prefix(r2, 11));
+  ht_destroy(ht);
+  ht_destroy(r);
+  ht_destroy(r2);
+}
+
+static void test_gap(void) {
+  unlink(test_path("log"));
+  struct hashtable *ht = new_table();
+  CHECK(ht_snapshot_save(ht, test_path("old"), 0, int_encode) == HT_SUCCESS);
+  struct htwal *wal = htwal_open(test_path("log"), int_encode, 0, 0);
+  htwal_attach(wal, ht);
+  for (int k = 0; k < 5; k++) {
+    ht_insert(ht, &k);
+  }
+  // the log is truncated for a snapshot with LSN 3 that never got saved
+  CHECK(htwal_truncate(wal, 3) == HT_SUCCESS);
+  CHECK(htwal_sync(wal, htwal_lsn(wal)) == HT_SUCCESS);
+  htwal_detach(wal, ht);
+  htwal_close(wal);
+
+  struct hashtable *r = new_table();
+  uint64_t lsn = 0;
+  CHECK(ht_recover(r, test_path("old"), test_path("log"), int_decode,
+                   int_destroy, &lsn) == HT_LOG_GAP);
+  CHECK(lsn == 0 && count(r) == 0);
+  ht_destroy(ht);
+  ht_destroy(r);
+}
+
+static void test_foreign_file(void) {
+  const char text[] = "this is not a log";
+  int fd = open(test_path("foreign"), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  CHECK(write(fd, text, sizeof(text)) == sizeof(text));
+  close(fd);
+  CHECK(htwal_open(test_path("foreign"), int_encode, 0, 0) == NULL);
+  char buf[64];
+  fd = open(test_path("foreign"), O_RDONLY);
+  CHECK(read(fd, buf, sizeof(buf)) == sizeof(text));
+  CHECK(memcmp(buf, text, sizeof(text)) == 0);
+  close(fd);
+}
+
+int main(void) {
+  test_crash_recovery();
+  test_torn_tail();
+  test_gap();
+  test_foreign_file();
+  return test_result("htwal");
+}
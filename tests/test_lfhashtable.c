@@ -0,0 +1,114 @@
+// This tests the lock-free table of lfhashtable.h: its single-threaded
+//   semantics, LFHT_FULL and tombstones, and a stress test in which
+//   several threads insert and remove the same keys concurrently; every key
+//   must be inserted (and removed) by exactly one thread.
+
+#include "tests/test.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include "lfhashtable.h"
+
+#define THREADS 4
+#define KEYS 50000
+
+static struct lfhashtable *shared;
+static atomic_int inserted[KEYS];
+static atomic_int removed[KEYS];
+
+// insert_all(arg) inserts all keys into shared and counts the successes
+static void *insert_all(void *arg) {
+  const int first = (int)(long)arg * (KEYS / THREADS);
+  for (int n = 0; n < KEYS; n++) {
+    const int k = (first + n) % KEYS;
+    if (lfht_insert(shared, k) == HT_SUCCESS) {
+      atomic_fetch_add(&inserted[k], 1);
+    }
+  }
+  return NULL;
+}
+
+// remove_even(arg) removes all even keys from shared and counts the
+//   successes, while looking up the odd keys (which stay stored)
+static void *remove_even(void *arg) {
+  (void)arg;
+  for (int k = 0; k < KEYS; k++) {
+    if (k % 2 == 0 && lfht_remove(shared, k) == HT_SUCCESS) {
+      atomic_fetch_add(&removed[k], 1);
+    }
+    if (k % 2 == 1 && !lfht_contains(shared, k)) {
+      atomic_fetch_add(&removed[k], 1);
+    }
+  }
+  return NULL;
+}
+
+static void test_basic(void) {
+  struct lfhashtable *ht = lfht_create(4);
+  CHECK(lfht_insert(ht, 7) == HT_SUCCESS);
+  CHECK(lfht_insert(ht, 7) == HT_ALREADY_STORED);
+  CHECK(lfht_contains(ht, 7));
+  CHECK(!lfht_contains(ht, 8));
+  CHECK(lfht_remove(ht, 8) == HT_NOT_STORED);
+  CHECK(lfht_remove(ht, 7) == HT_SUCCESS);
+  CHECK(!lfht_contains(ht, 7));
+  CHECK(lfht_count(ht) == 0);
+
+  // tombstones are not reused, so with the one of 7 they fill the table
+  //   until it is resized
+  for (uint64_t k = 0; k < 15; k++) {
+    CHECK(lfht_insert(ht, k + 100) == HT_SUCCESS);
+    CHECK(lfht_remove(ht, k + 100) == HT_SUCCESS);
+  }
+  CHECK(lfht_needs_resize(ht));
+  CHECK(lfht_insert(ht, 1) == LFHT_FULL);
+  lfht_resize(ht, 4);
+  CHECK(!lfht_needs_resize(ht));
+  for (uint64_t k = 0; k < 16; k++) {
+    CHECK(lfht_insert(ht, k) == HT_SUCCESS);
+  }
+  CHECK(lfht_insert(ht, 16) == LFHT_FULL);
+  lfht_resize(ht, 6);
+  CHECK(lfht_count(ht) == 16);
+  for (uint64_t k = 0; k < 16; k++) {
+    CHECK(lfht_contains(ht, k));
+  }
+  lfht_destroy(ht);
+}
+
+static void test_concurrent(void) {
+  shared = lfht_create(17);
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, insert_all, (void *)i);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  int wrong = 0;
+  for (int k = 0; k < KEYS; k++) {
+    wrong += atomic_load(&inserted[k]) != 1;
+  }
+  CHECK(wrong == 0);
+  CHECK(lfht_count(shared) == KEYS);
+
+  for (long i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, remove_even, (void *)i);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  wrong = 0;
+  for (int k = 0; k < KEYS; k++) {
+    wrong += atomic_load(&removed[k]) != (k % 2 == 0);
+    wrong += lfht_contains(shared, k) != (k % 2 == 1);
+  }
+  CHECK(wrong == 0);
+  CHECK(lfht_count(shared) == KEYS / 2);
+  lfht_destroy(shared);
+}
+
+int main(void) {
+  test_basic();
+  test_concurrent();
+  return test_result("lfhashtable");
+}
@@ -0,0 +1,124 @@
+// This tests the shared-memory table of shmtable.h across processes: a
+//   child attached to the segment sees the keys of the parent and the
+//   other way round, lock-free readers never miss a stable key while
+//   another process keeps writing, and a writer that is killed (possibly
+//   while it holds the writer lock) leaves a table that the next writer
+//   repairs, with a count that matches the stored keys.
+
+#include "tests/test.h"
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "shmtable.h"
+
+#define KEYS 1000
+
+// key(buf, k) writes the key number k to buf and returns its length
+static int key(char *buf, int k) {
+  return snprintf(buf, 16, "key-%d", k);
+}
+
+static void test_basic(void) {
+  struct shmtable *t = sht_create(NULL, 3, 1 << 16);
+  CHECK(t != NULL);
+  CHECK(sht_insert(t, "hello", 5) == HT_SUCCESS);
+  CHECK(sht_insert(t, "hello", 5) == HT_ALREADY_STORED);
+
+  const pid_t child = fork();
+  if (child == 0) {
+    struct shmtable *c = sht_attach_fd(sht_fd(t));
+    const bool ok = c && sht_contains(c, "hello", 5) &&
+                    sht_insert(c, "child", 5) == HT_SUCCESS;
+    _exit(ok ? 0 : 1);
+  }
+  int status;
+  waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  CHECK(sht_contains(t, "child", 5));
+  CHECK(sht_count(t) == 2);
+  CHECK(sht_remove(t, "hello", 5) == HT_SUCCESS);
+  CHECK(sht_remove(t, "hello", 5) == HT_NOT_STORED);
+
+  // removed nodes are reused, new keys fill the segment
+  char buf[16];
+  int n = 0;
+  while (sht_insert(t, buf, key(buf, n)) == HT_SUCCESS) {
+    n++;
+  }
+  CHECK(sht_insert(t, buf, key(buf, n)) == SHT_FULL);
+  CHECK(sht_count(t) == n + 1);
+  CHECK(sht_remove(t, buf, key(buf, 0)) == HT_SUCCESS);
+  CHECK(sht_insert(t, buf, key(buf, n)) == HT_SUCCESS);
+  sht_detach(t);
+}
+
+// toggle_even(t, rounds) inserts and removes the even keys rounds times
+static void toggle_even(struct shmtable *t, int rounds) {
+  char buf[16];
+  for (int r = 0; r < rounds; r++) {
+    for (int k = 0; k < KEYS; k += 2) {
+      if (r % 2 == 0) {
+        sht_insert(t, buf, key(buf, k));
+      } else {
+        sht_remove(t, buf, key(buf, k));
+      }
+    }
+  }
+}
+
+static void test_shared_readers(void) {
+  struct shmtable *t = sht_create(NULL, 4, 1 << 20);
+  char buf[16];
+  for (int k = 1; k < KEYS; k += 2) {
+    sht_insert(t, buf, key(buf, k));
+  }
+  const pid_t child = fork();
+  if (child == 0) {
+    toggle_even(t, 200);
+    _exit(0);
+  }
+  int errors = 0;
+  while (waitpid(child, NULL, WNOHANG) == 0) {
+    for (int k = 1; k < KEYS; k += 2) {
+      errors += !sht_contains(t, buf, key(buf, k));
+    }
+  }
+  CHECK(errors == 0);
+  CHECK(sht_count(t) == KEYS / 2);
+  sht_detach(t);
+}
+
+static void test_dead_writer(void) {
+  struct shmtable *t = sht_create(NULL, 4, 1 << 20);
+  char buf[16];
+  for (int round = 0; round < 20; round++) {
+    const pid_t child = fork();
+    if (child == 0) {
+      for (int i = 0;; i++) {
+        sht_insert(t, buf, key(buf, i % KEYS));
+        sht_remove(t, buf, key(buf, (i + KEYS / 2) % KEYS));
+      }
+    }
+    const struct timespec pause = {0, 1000000 * (1 + round % 5)};
+    nanosleep(&pause, NULL);
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+
+    // the next writer repairs the table if the child died holding the lock
+    CHECK(sht_insert(t, "parent", 6) != SHT_LOCK_ERROR);
+    int stored = sht_contains(t, "parent", 6);
+    for (int k = 0; k < KEYS; k++) {
+      stored += sht_contains(t, buf, key(buf, k));
+    }
+    CHECK(sht_count(t) == stored);
+    CHECK(sht_remove(t, "parent", 6) == HT_SUCCESS);
+  }
+  sht_detach(t);
+}
+
+int main(void) {
+  test_basic();
+  test_shared_readers();
+  test_dead_writer();
+  return test_result("shmtable");
+}